@@ -2,6 +2,10 @@ TEMPLATE = subdirs
 
 SUBDIRS += \
     SqlAccessor \
-    testing
+    testing \
+    tests
+
+testing.depends = SqlAccessor
+tests.depends = SqlAccessor
 
 
@@ -1,10 +1,20 @@
 #pragma once
 #include <QObject>
+#include <QPointer>
 #include <QSqlQuery>
 #include <QSqlRecord>
 #include <QStandardItemModel>
+#include <QTimer>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QMetaProperty>
+#include <memory>
+#include <atomic>
 #include "ISqlTableItem.h"
+#include "SqlItemSnapshot.h"
 #include "SqlDatabaseConnector.h"
+#include "SqlChangeFetcher.h"
 
 /****************************************************************************
  *                           ISqlTableManager                               *
@@ -39,6 +49,24 @@ public:
     };
     Q_ENUM(LoadedState)
 
+    //!
+    //! \brief The MemoryUsage struct
+    //! Оценка памяти, занятой менеджером, в байтах
+    struct MemoryUsage
+    {
+        //! Объекты элементов и их поля, кроме текста
+        qint64 items { 0 };
+        //! Текст полей и идентификаторов элементов
+        qint64 strings { 0 };
+        //! Ячейки и текст модели данных
+        qint64 model { 0 };
+        //! Узлы _items, копии элементов для снимка и индексы,
+        //! построенные по элементам (см. reportIndexMemory)
+        qint64 indexes { 0 };
+
+        qint64 total() const { return items + strings + model + indexes; }
+    };
+
     // enum SyncMode
     // {
     //     DoFullReloads,
@@ -76,7 +104,7 @@ protected:
     //!
     //! \brief _connector
     //! Указатель на коннектор к базе данных
-    SqlDatabaseConnector * _connector { nullptr };
+    QPointer<SqlDatabaseConnector> _connector;
 
     //!
     //! \brief _model
@@ -89,17 +117,90 @@ protected:
     //! Данные таблицы
     QMap<QString, ISqlTableItem::ptr> _items;
 
-    //!
-    //! \brief _awaitedQueries
-    //! Список идентификаторов sql-запросов, которые были сделаны,
-    //! но результат еще не вернулся
-    QList<QUuid> _awaitedQueries;
-
     //!
     //! \brief _lastItemCheckString
     //! Строка с результатом последней проверки методом checkItemValid()
     QString _lastItemCheckString;
 
+    //!
+    //! \brief _changeFetcher
+    //! Дочитывает строки по уведомлениям формата ChangePointer
+    SqlChangeFetcher * _changeFetcher { nullptr };
+
+    //!
+    //! \brief _parallelParseThreshold
+    //! Начиная с какого количества строк результат SELECT разбирается параллельно.
+    //! 0 - параллельный разбор выключен
+    int _parallelParseThreshold { 0 };
+
+    //!
+    //! \brief _snapshot
+    //! Последний опубликованный снимок элементов.
+    //! Читается и заменяется только через std::atomic_load/atomic_store
+    std::shared_ptr<const SqlItemSnapshot> _snapshot;
+
+    //!
+    //! \brief _snapshotVersion
+    //! Номер версии последнего снимка
+    quint64 _snapshotVersion { 0 };
+
+    //!
+    //! \brief _snapshotItems
+    //! Копии элементов, из которых собирается снимок (см. cloneItem).
+    //! При публикации заново копируются только элементы из _snapshotDirty
+    SqlItemSnapshot::Items _snapshotItems;
+
+    //!
+    //! \brief _snapshotDirty
+    //! Идентификаторы элементов, изменившихся после последней публикации
+    QSet<QString> _snapshotDirty;
+    //! Копии нужно собрать заново целиком (после unload и т.п.)
+    bool _snapshotRebuild { false };
+
+    //!
+    //! \brief _snapshotWanted
+    //! Снимок запрашивали через snapshot() после последней публикации
+    mutable std::atomic<bool> _snapshotWanted { false };
+
+    //!
+    //! \brief _snapshotStale
+    //! Элементы менялись после последней публикации
+    std::atomic<bool> _snapshotStale { false };
+
+    //!
+    //! \brief _snapshotTimer
+    //! Откладывает публикацию снимка до конца пачки изменений
+    QTimer _snapshotTimer;
+
+    //!
+    //! \brief _memoryBudget
+    //! Ограничение памяти для memoryBudgetExceeded(). 0 - не проверять
+    qint64 _memoryBudget { 0 };
+    bool _memoryBudgetExceeded { false };
+
+    //!
+    //! \brief The RowMemory struct
+    //! Оценка памяти одного элемента на момент последнего изменения
+    struct RowMemory
+    {
+        qint64 items { 0 };
+        qint64 strings { 0 };
+        //! Поля в виде текста - по ним оцениваются ячейки модели
+        qint64 text { 0 };
+    };
+
+    //!
+    //! \brief _rowMemory
+    //! Оценки по элементам. Обновляются в потоке менеджера по itemsChanged()
+    QHash<QString, RowMemory> _rowMemory;
+    //! Суммы по _rowMemory
+    RowMemory _memoryTotal;
+
+    //!
+    //! \brief _indexMemory
+    //! Память индексов, о которой они сообщили через reportIndexMemory()
+    QHash<const QObject *, qint64> _indexMemory;
+
 
     //! Выводить или не выводить дебаг в консоль.
     bool _debug { true };
@@ -114,6 +215,10 @@ public:
     //! \param parent - Указатель на родителя QObject
     ISqlTableManager(SqlDatabaseConnector * connector, const QString & tableScheme, const QString & tableName, QObject * parent = nullptr);
 
+    //!
+    //! Деструктор. Сообщает коннектору, что за таблицей больше не следят
+    virtual ~ISqlTableManager();
+
     //!
     //! \brief insert Метод для вставки элемента в таблицу БД
     //! \param row - Элемент
@@ -153,6 +258,19 @@ public:
     //! \return Список всех элементов, сейчас загруженных из базы
     const QList<ISqlTableItem::ptr> items();
 
+    //!
+    //! \brief snapshot Метод для получения снимка элементов
+    //! \return Последний опубликованный снимок
+    //!
+    //! Можно вызывать из любого потока, блокировок нет.
+    //! Новый снимок публикуется после каждой пачки изменений: SELECT,
+    //! уведомления, обработанные в одной итерации цикла событий, и т.п.
+    //! При вызове из потока менеджера отложенная публикация выполняется сразу,
+    //! из другого потока - ставится в очередь менеджера, а возвращается
+    //! прошлый снимок. Элементы снимка - копии, менеджер их не меняет
+    //! (см. SqlItemSnapshot)
+    SqlItemSnapshot::ptr snapshot() const;
+
     //!
     //! \brief item Метод для получения конкретного элемента
     //! \param uuid - Идентификатор элемента
@@ -170,7 +288,10 @@ public:
     void unload();
 
     //!
-    //! \brief fullReload Полная перезагрузка всех элементов
+    //! \brief fullReload Полная перезагрузка всех элементов.
+    //! Элементы не выгружаются: существующие обновляются на месте
+    //! (указатели на них остаются действительными), новые создаются,
+    //! отсутствующие в базе удаляются. Разница отдается сигналом reloaded()
     //!
     void fullReload();
 
@@ -223,6 +344,70 @@ public:
     //!
     void setTableScheme(const QString &newTableScheme);
 
+    //!
+    //! \brief changeFetcher
+    //! \return Объект, дочитывающий строки по уведомлениям формата ChangePointer.
+    //! Через него можно задать окно накопления (SqlChangeFetcher::setWindow)
+    //! и колонки, если selectQuery() читает не "*"
+    //!
+    SqlChangeFetcher * changeFetcher() const;
+
+    //!
+    //! \brief parallelParseThreshold
+    //! \return Начиная с какого количества строк результат SELECT
+    //! разбирается в пуле потоков. 0 (по умолчанию) - всегда в потоке менеджера
+    //!
+    int parallelParseThreshold() const;
+
+    //!
+    //! \brief setParallelParseThreshold Метод для задания порога параллельного разбора
+    //! \param rows - Количество строк, например 10000. 0 - отключить параллельный разбор
+    //!
+    //! parseSingleQuery() при этом вызывается одновременно из нескольких потоков,
+    //! поэтому включайте только для менеджеров, у которых parseSingleQuery()
+    //! не меняет состояние менеджера, а элементы создаются без родителя.
+    //! Элемент, который нельзя создавать в чужом потоке, может отказаться
+    //! от параллельного разбора в объявлении своего класса:
+    //! -- Q_CLASSINFO("ParallelParse", "false")
+    //!
+    void setParallelParseThreshold(int rows);
+
+    //!
+    //! \brief memoryUsage Метод оценки занятой памяти
+    //! \return Оценка в байтах по частям
+    //!
+    //! Элементы учитываются по оценкам, обновляемым при каждом изменении,
+    //! а ячейки модели обходятся, поэтому не стоит вызывать на каждое изменение.
+    //! Размеры объектов Qt оцениваются приблизительно
+    MemoryUsage memoryUsage() const;
+
+    //!
+    //! \brief reportIndexMemory Метод учета памяти индекса, построенного
+    //! по элементам менеджера (SqlSortedView, SqlSearchIndex, SqlAggregate и т.п.)
+    //! \param index - Индекс. Оценка забывается, когда он удаляется
+    //! \param bytes - Оценка в байтах
+    //!
+    //! Вызывается из потока менеджера. Оценка входит в MemoryUsage::indexes
+    //! и в проверку ограничения памяти
+    void reportIndexMemory(QObject * index, qint64 bytes);
+
+    //!
+    //! \brief memoryBudget
+    //! \return Ограничение памяти в байтах. 0 - не задано
+    //!
+    qint64 memoryBudget() const;
+
+    //!
+    //! \brief setMemoryBudget Метод для задания ограничения памяти
+    //! \param bytes - Ограничение в байтах. 0 - не проверять (по умолчанию)
+    //!
+    //! Проверяется при каждом изменении элементов в потоке менеджера
+    //! по накопленным оценкам, без обхода элементов; текст ячеек модели
+    //! при этом оценивается по тексту полей элементов.
+    //! При превышении один раз отправляется memoryBudgetExceeded(), повторно -
+    //! только после того, как оценка снова опустится ниже ограничения
+    void setMemoryBudget(qint64 bytes);
+
 protected:
     //!
     //! \brief selectQuery Метод для создания SQL запроса SELECT
@@ -283,19 +468,146 @@ protected:
     //!
     bool autoParseQuery(ISqlTableItem::ptr item, const QJsonObject & record);
 
+    //!
+    //! \brief parseRecords Метод разбора записей результата SELECT в элементы.
+    //! Большие результаты делятся на куски и разбираются в QThreadPool::globalInstance(),
+    //! готовые элементы переносятся в поток менеджера
+    //! \param records - Записи
+    //! \return Элементы по идентификаторам, в порядке записей
+    //!
+    QList<QPair<QString, ISqlTableItem::ptr>> parseRecords(const QList<QJsonObject> & records);
+
+    //!
+    //! \brief reconcile Метод сверки элементов с результатом SELECT
+    //! \param records - Все записи таблицы
+    //!
+    //! Существующие элементы сверяются по свойствам через patchItem() на месте,
+    //! без разбора записи; новые объекты создаются только для новых
+    //! идентификаторов через parseRecords(). Элементы, которых нет в записях, удаляются.
+    //! Отправляет reloaded() и updatedItemFields() для изменившихся элементов
+    //!
+    void reconcile(const QList<QJsonObject> & records);
+
+    //!
+    //! \brief applyNotification Метод применения уведомления формата FullRow
+    //! или ColumnDiff к элементам. Сигналы не отправляет
+    //! \param notif - Уведомление
+    //! \param changedFields - Сюда записываются изменившиеся поля при UPDATE,
+    //! если их можно определить (ColumnDiff или FullRow с data_old)
+    //! \return false, если элемент дочитывается из базы и применять пока нечего
+    //!
+    bool applyNotification(const SqlNotification & notif, QStringList * changedFields = nullptr);
+
+    //!
+    //! \brief patchItem Метод применения изменившихся колонок к элементу
+    //! \param uuid - Идентификатор элемента
+    //! \param changes - Изменившиеся колонки в формате Json
+    //! \return Список полей элемента, которые были изменены
+    //!
+    //! Как и в autoParseQuery(), значения записываются в свойства из sqlFields()
+    //! с приведением к типу свойства, но только для колонок, которые есть
+    //! в changes и отличаются от текущих. parseSingleQuery() не вызывается.
+    //! Свойства меняются на месте, указатель на элемент остается прежним
+    QStringList patchItem(const QString & uuid, const QJsonObject & changes);
+
+    //!
+    //! \brief patchItem Метод применения изменившихся колонок к элементу
+    //! по заранее найденным свойствам (см. sqlProperties)
+    //! \param item - Элемент
+    //! \param properties - Свойства класса элемента из sqlFields()
+    //! \param changes - Изменившиеся колонки в формате Json
+    //! \return Список полей элемента, которые были изменены
+    //!
+    QStringList patchItem(ISqlTableItem * item, const QVector<QMetaProperty> & properties, const QJsonObject & changes);
+
+    //!
+    //! \brief sqlProperties Метод для получения свойств, соответствующих sqlFields()
+    //! \param meta - Метаобъект класса элемента
+    //! \return Свойства в порядке sqlFields()
+    //!
+    static QVector<QMetaProperty> sqlProperties(const QMetaObject * meta);
+
+    //!
+    //! \brief publishSnapshot Метод публикации снимка текущих элементов.
+    //! Отправляет snapshotPublished()
+    //!
+    //! Копирует только изменившиеся элементы и только если снимок нужен:
+    //! его запрашивали после прошлой публикации или прошлый снимок
+    //! еще кто-то держит. Иначе публикация откладывается до snapshot()
+    //!
+    void publishSnapshot();
+
+    //!
+    //! \brief cloneItem Метод копирования элемента для снимка
+    //! \param item - Элемент
+    //! \return Новый элемент с теми же значениями свойств или nullptr
+    //!
+    //! Элемент создается через parseSingleQuery(), затем значения свойств
+    //! переносятся как есть
+    //!
+    ISqlTableItem::ptr cloneItem(const ISqlTableItem::ptr & item);
+
+    //!
+    //! \brief schedulePublish Метод, откладывающий публикацию снимка
+    //! до возврата в цикл событий, чтобы пачка изменений дала одну версию
+    //!
+    void schedulePublish();
+
+    //!
+    //! \brief checkMemoryBudget Метод проверки ограничения памяти
+    //! по накопленным оценкам (см. accountedMemoryUsage)
+    //!
+    void checkMemoryBudget();
+
+    //!
+    //! \brief reportMemoryUsage Метод сравнения оценки с ограничением
+    //! и отправки memoryBudgetExceeded()
+    //! \param usage - Оценка в байтах
+    //!
+    void reportMemoryUsage(qint64 usage);
+
+    //!
+    //! \brief accountedMemoryUsage Метод оценки памяти по накопленным оценкам,
+    //! без обхода элементов и модели. Ячейки модели оцениваются по их
+    //! количеству и тексту полей элементов
+    //! \return Оценка в байтах по частям
+    //!
+    MemoryUsage accountedMemoryUsage() const;
+
+    //!
+    //! \brief accountItems Метод обновления оценок памяти по изменившимся элементам
+    //! \param uuids - Идентификаторы элементов (новых, измененных или удаленных)
+    //!
+    void accountItems(const QStringList & uuids);
+
+    //!
+    //! \brief rowMemoryUsage Метод оценки памяти одного элемента
+    //! \param uuid - Идентификатор
+    //! \param item - Элемент
+    //! \return Оценка без узла _items
+    //!
+    static RowMemory rowMemoryUsage(const QString & uuid, const ISqlTableItem * item);
+
 protected slots:
     //!
     //! \brief sendQuery Слот для отправки запроса в БД.
-    //! Создает уникальный идентификатор для данного запроса, помещает его
-    //! в список ожидаемых результатов и отправляет сигнал execQuerySignal
+    //! Результат запроса коннектор передает только этому менеджеру,
+    //! в слот onQueryFinished
     //! \param query - Строка запроса
     //!
     void sendQuery(const QString & query);
 
+    //!
+    //! \brief sendReadQuery Слот для отправки запроса на чтение.
+    //! Если у соединения есть реплики (SqlConnectorManager::addReplica),
+    //! запрос уходит на реплику, иначе - как sendQuery
+    //! \param query - Строка запроса
+    //!
+    void sendReadQuery(const QString & query);
+
     //!
     //! \brief onQueryFinished Слот обработки результата запроса в БД.
-    //! Если идентификатор не совпадает ни с одним из ожидаемых, то
-    //! результат игнорируется
+    //! Вызывается только для запросов, отправленных этим менеджером
     //! \param uuid - Идентификатор
     //! \param result - Результат запроса
     //!
@@ -304,14 +616,16 @@ protected slots:
     //!
     //! \brief onDBNotification Слот обработки уведомления из базы данных
     //!
-    virtual void onDBNotification(const SqlNotification);
+    virtual void onDBNotification(const SqlNotification & notif);
 
-signals:
     //!
-    //! \brief execQuerySignal Сигнал для отправки запроса в БД
+    //! \brief onChangesResolved Слот применения пачки дочитанных строк.
+    //! Сигнал updated() отправляется один раз на пачку
+    //! \param notifications - Уведомления формата FullRow
     //!
-    void execQuerySignal(const QUuid & uuid, const QString & query);
+    void onChangesResolved(const QList<SqlNotification> & notifications);
 
+signals:
     //!
     //! \brief updated Сигнал того, что данные в менеджере обновились
     //!
@@ -322,6 +636,50 @@ signals:
     //!
     void updatedItem(ISqlTableItem::ptr item);
 
+    //!
+    //! \brief updatedItemFields Сигнал того, что у элемента изменились поля (UPDATE)
+    //! \param item - Элемент
+    //! \param fields - Изменившиеся поля. Пустой список - неизвестно какие
+    //!
+    void updatedItemFields(ISqlTableItem::ptr item, const QStringList & fields);
+
+    //!
+    //! \brief reloaded Сигнал того, что элементы сверены с результатом SELECT
+    //! \param inserted - Идентификаторы новых элементов
+    //! \param updated - Идентификаторы элементов, у которых изменились поля
+    //! \param removed - Идентификаторы удаленных элементов
+    //!
+    void reloaded(const QStringList & inserted, const QStringList & updated, const QStringList & removed);
+
+    //!
+    //! \brief itemsChanged Сигнал того, что изменился набор элементов или их поля.
+    //! Отправляется на каждое уведомление, пачку дочитанных строк и сверку после SELECT
+    //! \param inserted - Идентификаторы новых элементов
+    //! \param updated - Идентификаторы измененных элементов (объект мог быть заменен)
+    //! \param removed - Идентификаторы удаленных элементов
+    //!
+    void itemsChanged(const QStringList & inserted, const QStringList & updated, const QStringList & removed);
+
+    //!
+    //! \brief itemsReset Сигнал того, что все элементы выгружены (unload)
+    //!
+    void itemsReset();
+
+    //!
+    //! \brief snapshotPublished Сигнал того, что опубликован новый снимок элементов.
+    //! Снимок публикуется, только пока он нужен (см. publishSnapshot)
+    //! \param version - Номер версии снимка
+    //!
+    void snapshotPublished(quint64 version);
+
+    //!
+    //! \brief memoryBudgetExceeded Сигнал того, что оценка памяти
+    //! превысила ограничение (см. setMemoryBudget)
+    //! \param usage - Оценка в байтах
+    //! \param budget - Ограничение в байтах
+    //!
+    void memoryBudgetExceeded(qint64 usage, qint64 budget);
+
     //!
     //! \brief modelUpdated Сигнал того, что модель данных обновилась
     //!
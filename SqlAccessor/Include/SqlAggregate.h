@@ -0,0 +1,175 @@
+#pragma once
+#include <QObject>
+#include <QPointer>
+#include <QHash>
+#include <QMap>
+#include "ISqlTableManager.h"
+#include "SqlValue.h"
+
+
+//!
+//! \brief The SqlAggregate class
+//! \author Ivanov GD
+//!
+//! Агрегаты count, sum, min, max по колонке элементов менеджера
+//! с группировкой по другой колонке (GROUP BY без запроса к базе).
+//!
+//! Заполняется из загруженных элементов, дальше поддерживается
+//! по сигналу ISqlTableManager::itemsChanged(): для каждого элемента
+//! хранится его последний вклад (группа и значение), поэтому изменение
+//! вычитает старый вклад и добавляет новый без пересчета группы.
+//! count и sum обновляются за O(1). min и max не O(1): значения группы
+//! хранятся упорядоченными с кратностью, и обновление, и чтение min/max
+//! стоят O(log n) от числа разных значений в группе.
+//! Сумма целых (int, bigint, bool) считается точно в qint64, сумма
+//! дробных - с компенсацией ошибки округления (Neumaier), поэтому
+//! не уплывает от многократных прибавлений и вычитаний.
+//! На каждую затронутую группу отдается один сигнал groupChanged().
+//!
+//! Пример:
+//! -- auto totals = new SqlAggregate(manager, "client", "amount", this);
+//! -- connect(totals, &SqlAggregate::groupChanged, this, [totals](const SqlValue & client) {
+//! --     qDebug() << client.toString() << totals->value(client).sum;
+//! -- });
+//!
+class SqlAggregate : public QObject
+{
+    Q_OBJECT
+
+public:
+    //!
+    //! \brief The Result struct
+    //! Значения агрегатов одной группы
+    struct Result
+    {
+        SqlValue group;
+        //! Количество элементов в группе
+        qint64 count { 0 };
+        //! Количество элементов с непустым значением
+        qint64 valueCount { 0 };
+        //! Сумма всех числовых значений
+        double sum { 0 };
+        //! Точная сумма целых значений (без дробных)
+        qint64 integerSum { 0 };
+        //! min и max - O(log n), см. описание класса
+        SqlValue min;
+        SqlValue max;
+
+        double average() const { return valueCount ? sum / valueCount : 0; }
+    };
+
+    //!
+    //! \brief SqlAggregate Конструктор
+    //! \param manager - Менеджер таблицы
+    //! \param groupField - Колонка группировки. Пустая - одна группа с ключом Null
+    //! \param valueField - Колонка значений. Пустая - считается только count
+    //! \param parent - Указатель на родителя QObject
+    //!
+    SqlAggregate(ISqlTableManager * manager, const QString & groupField,
+                 const QString & valueField = QString(), QObject * parent = nullptr);
+
+    //!
+    //! \brief groups
+    //! \return Ключи групп по возрастанию
+    //!
+    QList<SqlValue> groups() const;
+
+    //!
+    //! \brief contains
+    //! \return Есть ли элементы в группе
+    //!
+    bool contains(const SqlValue & group) const;
+
+    //!
+    //! \brief value Метод получения агрегатов группы
+    //! \param group - Ключ группы
+    //! \return Агрегаты. Для неизвестной группы count = 0
+    //!
+    Result value(const SqlValue & group) const;
+
+    //!
+    //! \brief total
+    //! \return Агрегаты по всем элементам
+    //!
+    Result total() const;
+
+    //!
+    //! \brief memoryUsage Метод оценки памяти агрегатов
+    //! \return Оценка в байтах. Считается без обхода элементов
+    //!
+    //! После каждого изменения оценка передается менеджеру
+    //! (см. ISqlTableManager::reportIndexMemory)
+    qint64 memoryUsage() const;
+
+public slots:
+    //!
+    //! \brief rebuild Слот полного пересчета
+    //!
+    void rebuild();
+
+signals:
+    //!
+    //! \brief groupChanged Сигнал изменения агрегатов группы (в том числе новой)
+    //!
+    void groupChanged(const SqlValue & group);
+
+    //!
+    //! \brief groupRemoved Сигнал того, что в группе не осталось элементов
+    //!
+    void groupRemoved(const SqlValue & group);
+
+    //!
+    //! \brief reset Сигнал пересчета всех групп
+    //!
+    void reset();
+
+private:
+    //!
+    //! \brief The Contribution struct
+    //! Последний учтенный вклад элемента
+    struct Contribution
+    {
+        SqlValue group;
+        SqlValue value;
+    };
+
+    struct Group
+    {
+        qint64 count { 0 };
+        qint64 valueCount { 0 };
+        //! Сумма целых значений, точная
+        qint64 integerSum { 0 };
+        //! Количество дробных значений. Когда их не остается,
+        //! сумма дробных обнуляется вместе с накопленной ошибкой
+        qint64 floatCount { 0 };
+        //! Сумма дробных значений и компенсация ошибки округления
+        double floatSum { 0 };
+        double floatCompensation { 0 };
+        //! Значения с кратностью, для min и max
+        QMap<SqlValue, int> values;
+
+        //!
+        //! \brief addNumber Метод прибавления (sign = 1) или вычитания (sign = -1) числа
+        //!
+        void addNumber(const SqlValue & value, int sign);
+    };
+
+    void onItemsChanged(const QStringList & inserted, const QStringList & updated,
+                        const QStringList & removed);
+    void onItemsReset();
+    void clear();
+
+    Contribution contributionOf(const ISqlTableItem::ptr & item) const;
+    void add(const Contribution & contribution);
+    void subtract(const Contribution & contribution);
+    Result resultOf(const SqlValue & key, const Group & group) const;
+    void reportMemory();
+
+    QPointer<ISqlTableManager> _manager;
+    QByteArray _groupField;
+    QByteArray _valueField;
+
+    QHash<QString, Contribution> _contributions;
+    QMap<SqlValue, Group> _groups;
+    Group _total;
+};
@@ -0,0 +1,149 @@
+#pragma once
+#include <QObject>
+#include <QTimer>
+#include <QPointer>
+#include "SqlDatabaseConnector.h"
+
+
+//!
+//! \brief The SqlChangeDataCapture class
+//! \author Ivanov GD
+//!
+//! Источник уведомлений из слота логической репликации (плагин test_decoding)
+//! вместо триггеров и NOTIFY. Нужен сервер PostgreSQL 11+ с wal_level=logical.
+//!
+//! Изменения читаются опросом через pg_logical_slot_peek_changes(),
+//! превращаются в SqlNotification формата FullRow и передаются
+//! менеджерам через SqlDatabaseConnector::dispatchNotification().
+//! Только после этого пачка подтверждается (pg_replication_slot_advance
+//! до LSN последней транзакции), поэтому изменения, сделанные пока
+//! программа была отключена, приходят после переподключения,
+//! и полная перезагрузка не нужна.
+//!
+//! Для DELETE в уведомлении есть только колонки идентичности реплики,
+//! поэтому _uuid должен быть первичным ключом или у таблицы должно быть
+//! REPLICA IDENTITY FULL (тогда UPDATE также приходит со старыми значениями).
+//!
+//! Пример:
+//! -- auto cdc = new SqlChangeDataCapture(connector, "my_app_slot");
+//! -- connector->setListenEnabled(false);
+//! -- cdc->createSlot();
+//! -- cdc->start(200);
+//!
+class SqlChangeDataCapture : public QObject
+{
+    Q_OBJECT
+
+public:
+    //!
+    //! \brief SqlChangeDataCapture Конструктор
+    //! \param connector - Коннектор, через который читается слот и
+    //! которому передаются уведомления
+    //! \param slotName - Название слота репликации
+    //! \param parent - Указатель на родителя QObject
+    //!
+    SqlChangeDataCapture(SqlDatabaseConnector * connector, const QString & slotName,
+                         QObject * parent = nullptr);
+
+    //!
+    //! \brief slotName
+    //! \return Название слота репликации
+    //!
+    const QString & slotName() const;
+
+    //!
+    //! \brief createSlot Метод создания слота, если его еще нет
+    //!
+    void createSlot();
+
+    //!
+    //! \brief dropSlot Метод удаления слота. Пока слот существует,
+    //! сервер хранит WAL, который через него еще не прочитан
+    //!
+    void dropSlot();
+
+    //!
+    //! \brief start Метод запуска опроса слота
+    //! \param intervalMs - Период опроса в мс
+    //!
+    void start(int intervalMs = 200);
+
+    //!
+    //! \brief stop Метод остановки опроса
+    //!
+    void stop();
+
+    //!
+    //! \brief isRunning
+    //! \return true/false - Идет ли опрос
+    //!
+    bool isRunning() const;
+
+    //!
+    //! \brief setBatchSize Метод для задания размера пачки
+    //! \param changes - Сколько изменений читать за один запрос (не разрывая транзакции)
+    //!
+    void setBatchSize(int changes);
+
+    //!
+    //! \brief lastConfirmedLsn
+    //! \return LSN последней подтвержденной транзакции
+    //!
+    const QString & lastConfirmedLsn() const;
+
+    //!
+    //! \brief parseChange Метод разбора строки вывода test_decoding
+    //! \param line - Строка вида "table public.t: INSERT: a[integer]:1 b[text]:'x'"
+    //! \param notification - Сюда записывается уведомление
+    //! \return true, если строка - изменение строки таблицы
+    //! (BEGIN, COMMIT, TRUNCATE и т.п. возвращают false)
+    //!
+    static bool parseChange(const QString & line, SqlNotification & notification);
+
+public slots:
+    //!
+    //! \brief poll Слот, читающий очередную пачку изменений
+    //!
+    void poll();
+
+signals:
+    //!
+    //! \brief lsnConfirmed Сигнал того, что пачка изменений обработана и подтверждена
+    //! \param lsn - LSN последней транзакции пачки
+    //!
+    void lsnConfirmed(const QString & lsn);
+
+    //!
+    //! \brief errorOccurred Сигнал ошибки при работе со слотом
+    //! \param text - Текст ошибки
+    //!
+    void errorOccurred(const QString & text);
+
+private:
+    //!
+    //! \brief onPeeked Метод обработки прочитанной пачки изменений
+    //!
+    void onPeeked(const QueryResult & result);
+
+    //!
+    //! \brief onConfirmed Метод обработки подтверждения пачки
+    //!
+    void onConfirmed(const QString & lsn, bool full, const QueryResult & result);
+
+    //!
+    //! \brief decodingOptions
+    //! \return Параметры плагина test_decoding для запросов к слоту
+    //!
+    static QString decodingOptions();
+
+    QPointer<SqlDatabaseConnector> _connector;
+    QString _slotName;
+    QString _lastConfirmedLsn;
+    QTimer _timer;
+    int _batchSize { 1000 };
+
+    //!
+    //! \brief _busy
+    //! Запрос к слоту уже отправлен, и ответ еще не пришел
+    bool _busy { false };
+};
@@ -0,0 +1,135 @@
+#pragma once
+#include <QObject>
+#include <QTimer>
+#include <QHash>
+#include <QPointer>
+#include "SqlDatabaseConnector.h"
+
+
+//!
+//! \brief The SqlChangeFetcher class
+//! \author Ivanov GD
+//!
+//! Дочитывает строки по уведомлениям формата SqlNotification::ChangePointer.
+//!
+//! Идентификаторы строк копятся в течение window() мс, после чего
+//! все строки читаются одним запросом WHERE _uuid = ANY('{...}').
+//! Результат отдается сигналом resolved() в виде обычных уведомлений
+//! формата FullRow, которые менеджер обрабатывает как раньше:
+//! - строка нашлась - INSERT или UPDATE (по последнему уведомлению);
+//! - строка не нашлась - DELETE (ее удалили, пока шел запрос);
+//! - DELETE не дочитывается.
+//!
+class SqlChangeFetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    //!
+    //! \brief SqlChangeFetcher Конструктор
+    //! \param connector - Коннектор, через который читаются строки
+    //! \param schema - Название схемы
+    //! \param table - Название таблицы
+    //! \param parent - Указатель на родителя QObject
+    //!
+    SqlChangeFetcher(SqlDatabaseConnector * connector, const QString & schema,
+                     const QString & table, QObject * parent = nullptr);
+
+    //!
+    //! \brief enqueue Метод добавления уведомления в текущую пачку
+    //! \param notification - Уведомление формата ChangePointer
+    //!
+    void enqueue(const SqlNotification & notification);
+
+    //!
+    //! \brief flush Метод, сразу отправляющий запрос за текущей пачкой
+    //!
+    void flush();
+
+    //!
+    //! \brief setTable Метод для смены таблицы. Текущая пачка отправляется
+    //! \param schema - Название схемы
+    //! \param table - Название таблицы
+    //!
+    void setTable(const QString & schema, const QString & table);
+
+    //!
+    //! \brief window
+    //! \return Время накопления пачки в мс
+    //!
+    int window() const;
+
+    //!
+    //! \brief setWindow Метод для задания времени накопления пачки
+    //! \param ms - Время в мс. По умолчанию 20
+    //!
+    void setWindow(int ms);
+
+    //!
+    //! \brief columns
+    //! \return Список читаемых колонок через запятую. По умолчанию "*"
+    //!
+    const QString & columns() const;
+
+    //!
+    //! \brief setColumns Метод для задания читаемых колонок
+    //! \param columns - Список колонок через запятую (должен содержать _uuid)
+    //!
+    void setColumns(const QString & columns);
+
+    //!
+    //! \brief pendingCount
+    //! \return Количество строк в текущей пачке
+    //!
+    int pendingCount() const;
+
+    //!
+    //! \brief fetchQuery Метод создания запроса за строками
+    //! \param schema - Название схемы
+    //! \param table - Название таблицы
+    //! \param columns - Список колонок
+    //! \param uuids - Идентификаторы строк
+    //! \return Текст запроса
+    //!
+    static QString fetchQuery(const QString & schema, const QString & table,
+                              const QString & columns, const QStringList & uuids);
+
+signals:
+    //!
+    //! \brief resolved Сигнал того, что строки пачки дочитаны
+    //! \param notifications - Уведомления формата FullRow в порядке пачки
+    //!
+    void resolved(const QList<SqlNotification> & notifications);
+
+private:
+    //!
+    //! \brief onFetched Метод обработки результата запроса за строками
+    //! \param batch - Идентификаторы и последние действия строк пачки
+    //! \param order - Порядок строк в пачке
+    //! \param result - Результат запроса
+    //!
+    void onFetched(const QHash<QString, SqlNotification::ActionType> & batch,
+                   const QStringList & order, const QueryResult & result);
+
+    QPointer<SqlDatabaseConnector> _connector;
+    QString _schema;
+    QString _table;
+    QString _columns { "*" };
+
+    //!
+    //! \brief _pending
+    //! Последнее действие по каждой строке текущей пачки
+    QHash<QString, SqlNotification::ActionType> _pending;
+
+    //!
+    //! \brief _order
+    //! Порядок строк текущей пачки
+    QStringList _order;
+
+    //!
+    //! \brief _timer
+    //! Таймер окна накопления
+    QTimer _timer;
+
+    int _source { 0 };
+};
@@ -1,5 +1,7 @@
 #pragma once
 #include "SqlDatabaseConnector.h"
+#include "SqlReplicaSet.h"
+#include "SqlNotificationHub.h"
 #include <QMap>
 
 
@@ -29,6 +31,20 @@ class SqlConnectorManager
     //! \brief _connectors
     //! Коннекторы к базам данных
     QMap<QString, SqlDatabaseConnector *> _connectors;
+    //!
+    //! \brief _replicaSets
+    //! Реплики для чтения, по имени соединения основного сервера
+    QMap<QString, SqlReplicaSet *> _replicaSets;
+    //!
+    //! \brief _hubs
+    //! Хабы уведомлений, по ключу базы данных (SqlNotificationHub::key)
+    QMap<QString, SqlNotificationHub *> _hubs;
+
+    //!
+    //! \brief releaseHub Метод отключения коннектора от хаба.
+    //! Хаб без коннекторов удаляется
+    //!
+    void releaseHub(SqlDatabaseConnector * connector);
 
 public:
     //!
@@ -68,6 +84,53 @@ public:
                         const QString & host, int port,
                         QString connectionName = QString());
 
+    //!
+    //! \brief addReplica Метод добавления реплики для чтения к существующему соединению
+    //! \param connectionName - Имя соединения основного сервера (логическое имя)
+    //! \param baseName - название базы
+    //! \param host - Адрес сервера реплики
+    //! \param port - Порт
+    //! \return true/false - получилось добавить или нет
+    //!
+    //! Реплика открывается и закрывается вместе с основным соединением,
+    //! с теми же именем пользователя и паролем
+    bool addReplica (const QString & connectionName,
+                     const QString & baseName,
+                     const QString & host, int port);
+
+    //!
+    //! \brief replicaSet Метод, возвращающий набор реплик соединения
+    //! \param connectionName - Имя соединения основного сервера
+    //! \return набор реплик или nullptr, если реплик нет
+    //!
+    SqlReplicaSet * replicaSet(const QString & connectionName);
+
+    //!
+    //! \brief getReadConnector Метод, возвращающий коннектор для запроса на чтение.
+    //! Если у соединения нет подходящих реплик, возвращает основной коннектор
+    //! \param connectionName - Имя соединения
+    //! \return коннектор
+    //!
+    SqlDatabaseConnector * getReadConnector(const QString & connectionName);
+
+    //!
+    //! \brief shareNotifications Метод подключения соединения к общему хабу
+    //! уведомлений его базы данных
+    //! \param connectionName - Имя соединения
+    //! \return true/false - получилось или нет
+    //!
+    //! Все соединения одной базы, подключенные к хабу, получают уведомления
+    //! через одно выделенное соединение LISTEN. Хаб открывается вместе с
+    //! первым открытым соединением, с теми же именем пользователя и паролем
+    bool shareNotifications(const QString & connectionName);
+
+    //!
+    //! \brief notificationHub Метод, возвращающий хаб уведомлений соединения
+    //! \param connectionName - Имя соединения
+    //! \return хаб или nullptr, если соединение не подключено к хабу
+    //!
+    SqlNotificationHub * notificationHub(const QString & connectionName);
+
     //!
     //! \brief removeConnection Метод удаления существующего соединения
     //! \param connectionName - Имя соединения
@@ -1,14 +1,24 @@
 #pragma once
 #include <QMap>
+#include <QHash>
 #include <QList>
 #include <QPair>
+#include <QVector>
 #include <QVariant>
+#include <array>
+#include <utility>
+#include <type_traits>
+#include <cstddef>
 
 //!
 //! \brief The SqlDataMapper class
 //! \author Ivanov GD
 //! Класс, для упрощения установления соответствия данных
 //! в базе и программе
+//!
+//! Значения хранятся в плоском массиве пар, поиск идет по хэш-таблицам.
+//! Если типы значений известны заранее, лучше использовать
+//! SqlTypedDataMapper или SqlStaticDataMapper
 class SqlDataMapper
 {
 public:
@@ -20,16 +30,56 @@ public:
     //! Второе значение в паре - то, как записано в программе
     explicit SqlDataMapper(QList<QPair<QVariant, QVariant>> datamap);
 
+    //!
+    //! \brief The Key struct
+    //! Ключ хэш-таблицы, приведенный к одному виду один раз при создании.
+    //! Целые числа любых типов, double без дробной части (из Json)
+    //! и строки с записью целого числа ("1") становятся одним ключом qint64,
+    //! поэтому большие int8 не совпадают друг с другом, как при сравнении через double
+    struct Key
+    {
+        enum Kind : quint8
+        {
+            Integer,
+            Real,
+            Text,
+            Other,
+        };
+
+        Kind kind { Other };
+        qint64 integer { 0 };
+        double real { 0 };
+        //! Текст для Text, toString() для Other
+        QString text;
+        QVariant value;
+
+        static Key from(const QVariant & value);
+
+        friend bool operator == (const Key & a, const Key & b);
+        friend uint qHash(const Key & key, uint seed);
+    };
+
 private:
     //!
-    //! \brief base_values
-    //! Карта соответствия программа->база
-    QMap<QVariant, QVariant> base_values;
+    //! \brief pairs
+    //! Все пары значений (база, программа) в порядке регистрации
+    QVector<QPair<QVariant, QVariant>> pairs;
 
     //!
-    //! \brief screen_values
-    //! Карта соответствия база->программа
-    QMap<QVariant, QVariant> screen_values;
+    //! \brief base_index
+    //! Индекс пары по значению в базе
+    QHash<Key, int> base_index;
+
+    //!
+    //! \brief screen_index
+    //! Индекс пары по значению в программе
+    QHash<Key, int> screen_index;
+
+    //!
+    //! \brief findIndex Поиск пары в индексе за O(1)
+    //! \return Номер пары или -1
+    //!
+    int findIndex(const QHash<Key, int> & index, const QVariant & key) const;
 
 public:
     //!
@@ -46,6 +96,20 @@ public:
     //!
     const QVariant sval (const QVariant & bkey) const;
 
+    //!
+    //! \brief bvals Метод для получения значений в базе для целой колонки
+    //! \param skeys - значения в программе
+    //! \return значения в базе
+    //!
+    QVariantList bvals (const QVariantList & skeys) const;
+
+    //!
+    //! \brief svals Метод для получения значений в программе для целой колонки
+    //! \param bkeys - значения в базе
+    //! \return значения в программе
+    //!
+    QVariantList svals (const QVariantList & bkeys) const;
+
     //!
     //! \brief registerValue Метод для добавления новой пары значений
     //! \param pair
@@ -78,3 +142,281 @@ public:
     //!
     QList<QVariant> allBaseValues () const;
 };
+
+
+
+//!
+//! \brief The SqlTypedDataMapper class
+//! \author Ivanov GD
+//! Типизированный вариант SqlDataMapper. Ключи хранятся в хэш-таблицах
+//! своих типов, без QVariant
+//!
+//! Пример:
+//! -- SqlTypedDataMapper<int, QString> mapper({{0, "Нет"}, {1, "Да"}}, -1, "Неизвестно");
+//! -- QVector<QString> column = mapper.svals(values);
+template<typename BaseT, typename ScreenT>
+class SqlTypedDataMapper
+{
+public:
+    //!
+    //! \brief SqlTypedDataMapper Конструктор
+    //! \param datamap - Список пар (база, программа)
+    //! \param defaultBase - Значение в базе, если значение в программе не найдено
+    //! \param defaultScreen - Значение в программе, если значение в базе не найдено
+    //!
+    SqlTypedDataMapper(const QList<QPair<BaseT, ScreenT>> & datamap,
+                       const BaseT & defaultBase = BaseT(),
+                       const ScreenT & defaultScreen = ScreenT()) :
+        _defaultBase { defaultBase },
+        _defaultScreen { defaultScreen }
+    {
+        _base.reserve(datamap.size());
+        _screen.reserve(datamap.size());
+        for(const auto & pair: datamap)
+            registerValue(pair.first, pair.second);
+    }
+
+    //!
+    //! \brief registerValue Метод для добавления новой пары значений
+    //!
+    void registerValue(const BaseT & base, const ScreenT & screen)
+    {
+        _base.insert(base, screen);
+        _screen.insert(screen, base);
+    }
+
+    //!
+    //! \brief bval Метод для получения значения в базе
+    //!
+    BaseT bval(const ScreenT & skey) const
+    {
+        return _screen.value(skey, _defaultBase);
+    }
+
+    //!
+    //! \brief sval Метод для получения значения в программе
+    //!
+    ScreenT sval(const BaseT & bkey) const
+    {
+        return _base.value(bkey, _defaultScreen);
+    }
+
+    //!
+    //! \brief bvals Метод для получения значений в базе для целой колонки
+    //!
+    QVector<BaseT> bvals(const QVector<ScreenT> & skeys) const
+    {
+        QVector<BaseT> out;
+        out.reserve(skeys.size());
+        for(const auto & key: skeys)
+            out.append(bval(key));
+        return out;
+    }
+
+    //!
+    //! \brief svals Метод для получения значений в программе для целой колонки
+    //!
+    QVector<ScreenT> svals(const QVector<BaseT> & bkeys) const
+    {
+        QVector<ScreenT> out;
+        out.reserve(bkeys.size());
+        for(const auto & key: bkeys)
+            out.append(sval(key));
+        return out;
+    }
+
+    //!
+    //! \brief svals Метод для получения значений в программе для целой колонки
+    //! \param rows - Контейнер строк (например, QList<QJsonObject> из QueryResult)
+    //! \param get - Функция, достающая значение в базе из строки
+    //!
+    template<typename Container, typename Getter>
+    QVector<ScreenT> svals(const Container & rows, Getter get) const
+    {
+        QVector<ScreenT> out;
+        out.reserve(int(rows.size()));
+        for(const auto & row: rows)
+            out.append(sval(get(row)));
+        return out;
+    }
+
+    //!
+    //! \brief allScreenValues
+    //! \return все возможные значения в программе
+    //!
+    QList<ScreenT> allScreenValues() const { return _screen.keys(); }
+
+    //!
+    //! \brief allBaseValues
+    //! \return все возможные значения в базе
+    //!
+    QList<BaseT> allBaseValues() const { return _base.keys(); }
+
+private:
+    QHash<BaseT, ScreenT> _base;
+    QHash<ScreenT, BaseT> _screen;
+    BaseT _defaultBase;
+    ScreenT _defaultScreen;
+};
+
+
+
+namespace SqlDataMapperDetail
+{
+    template<typename T>
+    constexpr bool equal(const T & a, const T & b)
+    {
+        return a == b;
+    }
+
+    constexpr bool equal(const char * a, const char * b)
+    {
+        while(*a && *a == *b)
+        {
+            ++a;
+            ++b;
+        }
+        return *a == *b;
+    }
+
+    template<typename T>
+    constexpr long long toIndex(const T & value, std::true_type)
+    {
+        return static_cast<long long>(value);
+    }
+
+    template<typename T>
+    constexpr long long toIndex(const T &, std::false_type)
+    {
+        return -1;
+    }
+
+    template<typename T>
+    constexpr long long toIndex(const T & value)
+    {
+        return toIndex(value, std::integral_constant<bool, std::is_integral<T>::value ||
+                                                           std::is_enum<T>::value>());
+    }
+}
+
+//!
+//! \brief The SqlStaticDataMapper class
+//! \author Ivanov GD
+//! Вариант SqlDataMapper для соответствий, известных на этапе компиляции
+//! (например, перечисления). Хранит пары в плоском массиве.
+//! Если значения в базе - это 0, 1, ..., N-1 в порядке объявления, то
+//! sval() берет значение прямо по индексу
+//!
+//! Пример:
+//! -- constexpr auto StateMapper = makeSqlStaticDataMapper<int, const char *>(
+//! --     { {0, "Выключен"}, {1, "Включен"} }, -1, "Неизвестно");
+//! -- static_assert(SqlDataMapperDetail::equal(StateMapper.sval(1), "Включен"), "");
+template<typename BaseT, typename ScreenT, std::size_t N>
+class SqlStaticDataMapper
+{
+public:
+    using Pair = std::pair<BaseT, ScreenT>;
+
+    constexpr SqlStaticDataMapper(const std::array<Pair, N> & pairs,
+                                  const BaseT & defaultBase,
+                                  const ScreenT & defaultScreen) :
+        _pairs { pairs },
+        _defaultBase { defaultBase },
+        _defaultScreen { defaultScreen },
+        _dense { isDense(pairs) }
+    {
+    }
+
+    //!
+    //! \brief bval Метод для получения значения в базе
+    //!
+    constexpr BaseT bval(const ScreenT & skey) const
+    {
+        for(std::size_t i = 0; i < N; i++)
+            if(SqlDataMapperDetail::equal(_pairs[i].second, skey))
+                return _pairs[i].first;
+        return _defaultBase;
+    }
+
+    //!
+    //! \brief sval Метод для получения значения в программе
+    //!
+    constexpr ScreenT sval(const BaseT & bkey) const
+    {
+        if(_dense)
+        {
+            const long long index = SqlDataMapperDetail::toIndex(bkey);
+            return (index >= 0 && index < static_cast<long long>(N)) ?
+                        _pairs[static_cast<std::size_t>(index)].second :
+                        _defaultScreen;
+        }
+        for(std::size_t i = 0; i < N; i++)
+            if(SqlDataMapperDetail::equal(_pairs[i].first, bkey))
+                return _pairs[i].second;
+        return _defaultScreen;
+    }
+
+    //!
+    //! \brief svals Метод для получения значений в программе для целой колонки
+    //!
+    QVector<ScreenT> svals(const QVector<BaseT> & bkeys) const
+    {
+        QVector<ScreenT> out;
+        out.reserve(bkeys.size());
+        for(const auto & key: bkeys)
+            out.append(sval(key));
+        return out;
+    }
+
+    //!
+    //! \brief bvals Метод для получения значений в базе для целой колонки
+    //!
+    QVector<BaseT> bvals(const QVector<ScreenT> & skeys) const
+    {
+        QVector<BaseT> out;
+        out.reserve(skeys.size());
+        for(const auto & key: skeys)
+            out.append(bval(key));
+        return out;
+    }
+
+    constexpr std::size_t size() const { return N; }
+    constexpr const Pair & at(std::size_t i) const { return _pairs[i]; }
+
+private:
+    static constexpr bool isDense(const std::array<Pair, N> & pairs)
+    {
+        for(std::size_t i = 0; i < N; i++)
+            if(SqlDataMapperDetail::toIndex(pairs[i].first) != static_cast<long long>(i))
+                return false;
+        return true;
+    }
+
+    std::array<Pair, N> _pairs;
+    BaseT _defaultBase;
+    ScreenT _defaultScreen;
+    bool _dense;
+};
+
+namespace SqlDataMapperDetail
+{
+    template<typename BaseT, typename ScreenT, std::size_t N, std::size_t... I>
+    constexpr SqlStaticDataMapper<BaseT, ScreenT, N>
+    makeStatic(const std::pair<BaseT, ScreenT> (&pairs)[N], std::index_sequence<I...>,
+               const BaseT & defaultBase, const ScreenT & defaultScreen)
+    {
+        return SqlStaticDataMapper<BaseT, ScreenT, N>({{ pairs[I]... }}, defaultBase, defaultScreen);
+    }
+}
+
+//!
+//! \brief makeSqlStaticDataMapper Вспомогательная функция, выводящая N
+//!
+template<typename BaseT, typename ScreenT, std::size_t N>
+constexpr SqlStaticDataMapper<BaseT, ScreenT, N>
+makeSqlStaticDataMapper(const std::pair<BaseT, ScreenT> (&pairs)[N],
+                        const BaseT & defaultBase, const ScreenT & defaultScreen)
+{
+    return SqlDataMapperDetail::makeStatic(pairs, std::make_index_sequence<N>(),
+                                           defaultBase, defaultScreen);
+}
@@ -12,26 +12,26 @@
 #include <QQueue>
 #include <QSqlDriver>
 #include <QTextCodec>
+#include <QFuture>
+#include <QFutureInterface>
+#include <QHash>
+#include <QPointer>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <functional>
+#include <memory>
 
 #include "SqlNotification.h"
+#include "SqlQueryResult.h"
+#include "SqlQueryCache.h"
+#include "SqlTextDecoder.h"
+#include "SqlSlowQueryLog.h"
 
 
-//!
-//! \brief The QueryResult struct
-//! Класс, в который записывается результат работы QSqlQuery
-//!
-//! \author Ivanov GD
-//!
-struct QueryResult
-{
-    QList<QJsonObject> records;
-    bool isSelect;
-    QSqlError error;
-};
-
-Q_DECLARE_METATYPE(QueryResult)
 Q_DECLARE_METATYPE(QSqlDriver::NotificationSource)
 
+class SqlNotificationHub;
+
 
 //!
 //! \brief The SqlDatabaseConnector class
@@ -56,6 +56,97 @@ public:
     };
     Q_ENUM(State)
 
+    //!
+    //! \brief The ListenMode enum
+    //! На какие каналы уведомлений подписывается коннектор
+    enum ListenMode
+    {
+        //! Общий канал IDSqlChangedEvent, уведомления всех таблиц
+        GlobalChannel,
+        //! Каналы таблиц, за которыми следят менеджеры (см. watchTable)
+        TableChannels,
+    };
+    Q_ENUM(ListenMode)
+
+    //!
+    //! \brief The Priority enum
+    //! Приоритет запроса. Определяет, что делать, когда очередь заполнена
+    //! (см. setOverflowPolicy)
+    enum Priority
+    {
+        HighPriority,
+        NormalPriority,
+        LowPriority,
+    };
+    Q_ENUM(Priority)
+
+    //!
+    //! \brief The OverflowPolicy enum
+    //! Что делать с запросом, когда очередь заполнена
+    enum OverflowPolicy
+    {
+        //! Поставить в очередь сверх ограничения
+        Accept,
+        //! Отклонить: обработчик получает ошибку, отправляется queryRejected()
+        Reject,
+        //! Ждать в вызывающем потоке, пока в очереди не освободится место.
+        //! В потоке коннектора - как Accept
+        Block,
+    };
+    Q_ENUM(OverflowPolicy)
+
+    //!
+    //! \brief The ExplainMode enum
+    //! Получать ли план медленных запросов (см. setSlowQueryExplain)
+    enum ExplainMode
+    {
+        NoExplain,
+        //! EXPLAIN - план без выполнения
+        Explain,
+        //! EXPLAIN (ANALYZE, BUFFERS) для SELECT без блокировок и вызовов функций,
+        //! EXPLAIN для остальных запросов
+        ExplainAnalyze,
+    };
+    Q_ENUM(ExplainMode)
+
+    //!
+    //! \brief The QueueStats struct
+    //! Статистика очереди запросов
+    struct QueueStats
+    {
+        //! Запросов принято и еще не начато
+        int     depth { 0 };
+        //! Размер их текста в байтах
+        qint64  bytes { 0 };
+        int     peakDepth { 0 };
+        quint64 rejected { 0 };
+        //! Сколько раз вызывающий поток ждал места в очереди
+        quint64 blocked { 0 };
+        //! Время ожидания в очереди последнего запроса, мс
+        qint64  lastWaitMs { 0 };
+        qint64  maxWaitMs { 0 };
+        //! Скользящее среднее времени ожидания, мс
+        double  averageWaitMs { 0 };
+    };
+
+    //!
+    //! \brief The MemoryUsage struct
+    //! Оценка памяти, занятой коннектором, в байтах
+    struct MemoryUsage
+    {
+        //! Запросы, принятые и еще не начатые
+        qint64 queue { 0 };
+        //! Обработчики запросов, ожидающих результата
+        qint64 pending { 0 };
+        //! Результаты, отправленные в потоки получателей и еще не обработанные.
+        //! Считаются, только когда задано ограничение (см. setMemoryBudget)
+        qint64 undelivered { 0 };
+        qint64 resultCache { 0 };
+        qint64 slowLog { 0 };
+
+        qint64 total() const { return queue + pending + undelivered + resultCache + slowLog; }
+    };
+
     Q_PROPERTY(State state READ state NOTIFY stateChanged)
     Q_PROPERTY(QString connectionName READ connectionName WRITE setConnectionName)
     Q_PROPERTY(QString databaseName READ databaseName)
@@ -64,6 +155,11 @@ public:
     Q_PROPERTY(QString username READ username)
     Q_PROPERTY(QString password READ password)
 
+    //!
+    //! \brief ResultHandler
+    //! Обработчик результата запроса
+    using ResultHandler = std::function<void(const QUuid & uuid, const QueryResult & result)>;
+
 public:
     //!
     //! \brief SqlDatabaseConnector
@@ -176,6 +272,160 @@ public:
     //! Возвращает nullptr, если кодировщик не был установлен
     QTextCodec * const codec () const;
 
+    //!
+    //! \brief listenEnabled
+    //! \return true/false - Подписываться ли на уведомления из базы при подключении
+    //!
+    bool listenEnabled() const;
+
+    //!
+    //! \brief setListenEnabled Метод для включения/выключения подписки на уведомления.
+    //! Выключается для реплик, потому что уведомления приходят только с основного сервера.
+    //! Если соединение уже открыто, подписки сразу меняются
+    //! \param enabled - Новое значение
+    //!
+    void setListenEnabled(bool enabled);
+
+    //!
+    //! \brief listenMode
+    //! \return На какие каналы уведомлений подписывается коннектор
+    //!
+    ListenMode listenMode() const;
+
+    //!
+    //! \brief setListenMode Метод для выбора каналов уведомлений.
+    //! Если соединение уже открыто, подписки сразу меняются
+    //! \param mode - Новое значение. По умолчанию GlobalChannel
+    //!
+    //! В режиме TableChannels триггеры таблиц должны отправлять уведомления
+    //! в канал SqlNotificationTrigger::channelName(), см. SqlNotificationTrigger::createDdl()
+    void setListenMode(ListenMode mode);
+
+    //!
+    //! \brief watchTable Метод, сообщающий, что появился менеджер таблицы.
+    //! В режиме TableChannels при первом вызове для таблицы коннектор
+    //! подписывается на ее канал
+    //! \param schema - Название схемы
+    //! \param table - Название таблицы
+    //!
+    void watchTable(const QString & schema, const QString & table);
+
+    //!
+    //! \brief unwatchTable Метод, сообщающий, что менеджер таблицы удален.
+    //! Когда за таблицей больше никто не следит, коннектор отписывается от ее канала
+    //! \param schema - Название схемы
+    //! \param table - Название таблицы
+    //!
+    void unwatchTable(const QString & schema, const QString & table);
+
+    //!
+    //! \brief watchedChannels
+    //! \return Каналы таблиц, за которыми сейчас следят менеджеры
+    //!
+    QStringList watchedChannels() const;
+
+    //!
+    //! \brief watchChannel Метод, сообщающий, что за каналом таблицы следят.
+    //! То же, что watchTable(), но по готовому названию канала
+    //! \param channel - Канал таблицы (SqlNotificationTrigger::channelName)
+    //!
+    void watchChannel(const QString & channel);
+
+    //!
+    //! \brief unwatchChannel Метод, сообщающий, что за каналом таблицы больше не следят
+    //! \param channel - Канал таблицы
+    //!
+    void unwatchChannel(const QString & channel);
+
+    //!
+    //! \brief notificationHub
+    //! \return Хаб, от которого коннектор получает уведомления, или nullptr
+    //!
+    SqlNotificationHub * notificationHub() const;
+
+    //!
+    //! \brief setNotificationHub Метод, вызываемый хабом при подключении
+    //! и отключении коннектора (см. SqlNotificationHub::attach).
+    //! Пока коннектор подключен к хабу, сам он на уведомления не подписывается,
+    //! а каналы таблиц, за которыми он следит, передаются хабу
+    //! \param hub - Хаб или nullptr
+    //!
+    void setNotificationHub(SqlNotificationHub * hub);
+
+    //!
+    //! \brief dispatchNotification Метод передачи разобранного уведомления
+    //! менеджерам этого коннектора. Должен вызываться в потоке коннектора
+    //! \param notification - Уведомление
+    //!
+    //! В режиме TableChannels уведомления таблиц, за которыми не следят, отбрасываются
+    void dispatchNotification(SqlNotification::ptr notification);
+
+    //!
+    //! \brief queueSize
+    //! \return Количество запросов, ожидающих в очереди
+    //!
+    int queueSize() const;
+
+    //!
+    //! \brief setQueueLimit Метод для ограничения очереди запросов
+    //! \param entries - Сколько запросов может ждать выполнения. 0 - без ограничения
+    //! \param bytes - Сколько байт текста запросов может ждать выполнения. 0 - без ограничения
+    //!
+    //! Учитываются все принятые и еще не начатые запросы, в том числе
+    //! отправленные из других потоков и ждущие в очереди событий.
+    //! Что делать при переполнении, задается setOverflowPolicy()
+    void setQueueLimit(int entries, qint64 bytes = 0);
+
+    //!
+    //! \brief queueLimit
+    //! \return Ограничение очереди по количеству запросов
+    //!
+    int queueLimit() const;
+
+    //!
+    //! \brief queueByteLimit
+    //! \return Ограничение очереди по размеру в байтах
+    //!
+    qint64 queueByteLimit() const;
+
+    //!
+    //! \brief setOverflowPolicy Метод для выбора поведения при переполнении очереди
+    //! \param priority - Приоритет запросов
+    //! \param policy - Поведение. По умолчанию HighPriority - Accept,
+    //! NormalPriority - Block, LowPriority - Reject
+    //!
+    void setOverflowPolicy(Priority priority, OverflowPolicy policy);
+
+    //!
+    //! \brief overflowPolicy
+    //! \param priority - Приоритет запросов
+    //! \return Поведение при переполнении очереди
+    //!
+    OverflowPolicy overflowPolicy(Priority priority) const;
+
+    //!
+    //! \brief setQueueWatermarks Метод для задания уровней очереди,
+    //! при пересечении которых отправляются queueHighWatermark() и queueLowWatermark()
+    //! \param high - Верхний уровень в запросах. 0 - не отправлять
+    //! \param low - Нижний уровень в запросах
+    //!
+    //! Пример: производитель приостанавливает вставку по queueHighWatermark()
+    //! и продолжает по queueLowWatermark()
+    void setQueueWatermarks(int high, int low);
+
+    //!
+    //! \brief setQueueWaitThreshold Метод для задания времени ожидания в очереди,
+    //! после которого отправляется queueWaitExceeded()
+    //! \param ms - Время в мс. 0 - не отправлять
+    //!
+    void setQueueWaitThreshold(qint64 ms);
+
+    //!
+    //! \brief queueStats
+    //! \return Статистика очереди запросов
+    //!
+    QueueStats queueStats() const;
+
     //!
     //! \brief setCodec Метод для установки кодировщика текста
     //! \param codec - указатель на кодировщик
@@ -183,6 +433,194 @@ public:
     void setCodec (QTextCodec * codec);
 
 
+    //!
+    //! \brief execute Метод для асинхронного выполнения запроса
+    //! \param query - Текст запроса
+    //! \return Будущий результат запроса. Результат получает только тот,
+    //! кто вызвал execute(), сигнал queryFinishedSignal при этом тоже отправляется
+    //!
+    //! Можно вызывать из любого потока. Для использования в корутинах
+    //! см. SqlQueryAwaitable.h
+    //!
+    //!
+    //! Пример:
+    //! -- auto watcher = new QFutureWatcher<QueryResult>(this);
+    //! -- connect(watcher, &QFutureWatcherBase::finished, this, [watcher] {
+    //! --     QueryResult res = watcher->result();
+    //! --     watcher->deleteLater();
+    //! -- });
+    //! -- watcher->setFuture(connector->execute("SELECT 1;"));
+    QFuture<QueryResult> execute(const QString & query, Priority priority = NormalPriority);
+
+    //!
+    //! \brief sendQuery Метод для отправки запроса с адресной доставкой результата
+    //! \param query - Текст запроса
+    //! \param receiver - Объект, в потоке которого вызывается обработчик.
+    //! Если объект удален до окончания запроса, результат отбрасывается.
+    //! nullptr - обработчик вызывается в потоке коннектора
+    //! \param handler - Обработчик результата
+    //! \param priority - Приоритет запроса (см. setOverflowPolicy)
+    //! \return Уникальный идентификатор запроса
+    //!
+    //! Результат получает только этот обработчик: поиск идет по
+    //! идентификатору запроса, остальные объекты ничего не делают.
+    //! Можно вызывать из любого потока
+    QUuid sendQuery(const QString & query, QObject * receiver, ResultHandler handler,
+                    Priority priority = NormalPriority);
+
+    //!
+    //! \brief pendingCount
+    //! \return Количество запросов с обработчиком, ожидающих результата
+    //!
+    int pendingCount();
+
+    //!
+    //! \brief selectDeduplication
+    //! \return true/false - Объединяются ли одинаковые SELECT, отправленные
+    //! через sendQuery() с обработчиком или execute()
+    //!
+    //! Пока такой же SELECT стоит в очереди или выполняется, новый запрос
+    //! не отправляется, а получает результат первого. Если между ними был
+    //! отправлен запрос на запись, запрос выполняется заново.
+    //! Объединяются только запросы без побочных эффектов (SqlQueryText::isPure):
+    //! SELECT ... FOR UPDATE/SHARE и вызовы функций, кроме агрегатов
+    //! и встроенных (nextval() и т.п.), выполняются каждый раз
+    bool selectDeduplication() const;
+
+    //!
+    //! \brief setSelectDeduplication Метод для включения/выключения объединения SELECT
+    //! \param enabled - Новое значение. По умолчанию выключено
+    //!
+    void setSelectDeduplication(bool enabled);
+
+    //!
+    //! \brief dedupHits
+    //! \return Количество запросов, которые получили результат уже
+    //! выполнявшегося такого же запроса
+    //!
+    quint64 dedupHits();
+
+    //!
+    //! \brief typedResults
+    //! \return true/false - Отдаются ли результаты SELECT в виде SqlValue
+    //! (QueryResult::columns и QueryResult::rows) вместо Json
+    //!
+    bool typedResults() const;
+
+    //!
+    //! \brief setTypedResults Метод для выбора вида результатов SELECT
+    //! \param enabled - true - QueryResult::rows, false - QueryResult::records (по умолчанию)
+    //!
+    //! Менеджеры таблиц разбирают records, поэтому включайте только
+    //! для коннекторов, результаты которых читаются напрямую (sendQuery, execute)
+    void setTypedResults(bool enabled);
+
+    //!
+    //! \brief resultCacheEnabled
+    //! \return true/false - Кэшируются ли результаты SELECT
+    //!
+    //! Результат берется из кэша без обращения к базе, пока не придет
+    //! уведомление об изменении одной из таблиц запроса или этот коннектор
+    //! не выполнит запрос на запись в нее. Таблицы, на которые нет триггера
+    //! уведомлений, кэшировать нельзя, поэтому по умолчанию кэш выключен.
+    //! В режиме TableChannels кэшируются только запросы к таблицам,
+    //! за которыми следят менеджеры (см. watchTable)
+    bool resultCacheEnabled() const;
+
+    //!
+    //! \brief setResultCacheEnabled Метод для включения/выключения кэша результатов
+    //! \param enabled - Новое значение. При выключении кэш очищается
+    //!
+    void setResultCacheEnabled(bool enabled);
+
+    //!
+    //! \brief setResultCacheBudget Метод для задания ограничения кэша по памяти
+    //! \param bytes - Ограничение в байтах
+    //!
+    void setResultCacheBudget(qint64 bytes);
+
+    //!
+    //! \brief resultCacheStats
+    //! \return Статистика кэша результатов
+    //!
+    SqlQueryCache::Stats resultCacheStats() const;
+
+    //!
+    //! \brief setSlowQueryThreshold Метод для включения журнала медленных запросов
+    //! \param ms - Время выполнения в мс, начиная с которого запрос записывается
+    //! в журнал. 0 - журнал выключен (по умолчанию)
+    //!
+    void setSlowQueryThreshold(qint64 ms);
+
+    //!
+    //! \brief slowQueryThreshold
+    //! \return Порог журнала медленных запросов в мс
+    //!
+    qint64 slowQueryThreshold() const;
+
+    //!
+    //! \brief setSlowQueryLogSize Метод для задания размера журнала
+    //! \param entries - Сколько последних медленных запросов хранить. По умолчанию 256
+    //!
+    void setSlowQueryLogSize(int entries);
+
+    //!
+    //! \brief setSlowQueryExplain Метод для получения планов медленных запросов
+    //! \param mode - Режим. По умолчанию NoExplain
+    //!
+    //! План получается повторным выполнением EXPLAIN по отдельному соединению
+    //! (копия соединения коннектора) в пуле потоков и добавляется к записи журнала.
+    //! ANALYZE снова выполняет запрос, поэтому используется только для чтения
+    //! без блокировок и вызовов функций (SqlQueryText::isPure) и выполняется
+    //! в транзакции BEGIN READ ONLY, которая затем откатывается.
+    //! Пока получается один план, планы следующих медленных запросов не запрашиваются
+    void setSlowQueryExplain(ExplainMode mode);
+
+    //!
+    //! \brief slowQueryExplain
+    //! \return Режим получения планов медленных запросов
+    //!
+    ExplainMode slowQueryExplain() const;
+
+    //!
+    //! \brief slowQueries
+    //! \return Записи журнала медленных запросов от старых к новым
+    //!
+    QList<SqlSlowQueryLog::Entry> slowQueries() const;
+
+    //!
+    //! \brief dumpSlowQueries Метод записи журнала медленных запросов
+    //! \param device - Открытое на запись устройство
+    //! \return true/false - Удалось ли записать
+    //!
+    bool dumpSlowQueries(QIODevice * device) const;
+
+    //!
+    //! \brief clearSlowQueries Метод очистки журнала медленных запросов
+    //!
+    void clearSlowQueries();
+
+    //!
+    //! \brief memoryUsage Метод оценки занятой памяти
+    //! \return Оценка в байтах по частям
+    //!
+    MemoryUsage memoryUsage() const;
+
+    //!
+    //! \brief memoryBudget
+    //! \return Ограничение памяти в байтах. 0 - не задано
+    //!
+    qint64 memoryBudget() const;
+
+    //!
+    //! \brief setMemoryBudget Метод для задания ограничения памяти
+    //! \param bytes - Ограничение в байтах. 0 - не проверять (по умолчанию)
+    //!
+    //! Проверяется после каждого запроса. При превышении один раз отправляется
+    //! memoryBudgetExceeded(), повторно - только после того, как оценка
+    //! снова опустится ниже ограничения
+    void setMemoryBudget(qint64 bytes);
+
 public slots:
     //!
     //! \brief sendQuery Слот для отправки запроса в базу данных.
@@ -201,13 +639,6 @@ protected slots:
     //!
     void onSendQuery(const QUuid & uuid, const QString query);
 
-    //!
-    //! \brief onQueryFinished Слот-обработчик окончания запроса
-    //! \param uuid - Уникальный идентификатор запроса
-    //! \param res - Результат запроса
-    //!
-    void onQueryFinished(const QUuid & uuid, QueryResult res);
-
     //!
     //! \brief onDBNotify Слот-обработчик уведомления из базы даных
     //! Привязывается к сигналу QSqlDriver::notification
@@ -234,6 +665,13 @@ signals:
     //!
     void queryFinishedSignal(const QUuid &, QueryResult res);
 
+    //!
+    //! \brief writeQueued Сигнал того, что принят запрос на запись (не SELECT).
+    //! Испускается в потоке, вызвавшем sendQuery()
+    //! \param uuid - Уникальный идентификатор запроса
+    //!
+    void writeQueued(const QUuid & uuid);
+
     //!
     //! \brief queryErrorSignal Сигнал того, что запрос вернулся с ошибкой
     //! \param uuid - Уникальный идентификатор запроса
@@ -242,11 +680,62 @@ signals:
     void queryErrorSignal(const QUuid &, QSqlError error);
 
     //!
-    //! \brief dbNotification Сигнал того, что пришло уведомление из базы данных
+    //! \brief dbNotification Сигнал того, что пришло уведомление из базы данных.
+    //! Испускается только при наличии подключений, так как копирует уведомление
     //! \param notification - Уведомление
     //!
     void dbNotification(const SqlNotification notification);
 
+    //!
+    //! \brief sharedNotification Сигнал того, что пришло уведомление из базы данных.
+    //! В отличие от dbNotification, уведомление не копируется при передаче в другой поток
+    //! \param notification - Уведомление
+    //!
+    void sharedNotification(SqlNotification::ptr notification);
+
+    //!
+    //! \brief queueHighWatermark Сигнал того, что очередь дошла до верхнего уровня
+    //! \param depth - Количество запросов в очереди
+    //!
+    void queueHighWatermark(int depth);
+
+    //!
+    //! \brief queueLowWatermark Сигнал того, что очередь после верхнего уровня
+    //! опустилась до нижнего
+    //! \param depth - Количество запросов в очереди
+    //!
+    void queueLowWatermark(int depth);
+
+    //!
+    //! \brief queryRejected Сигнал того, что запрос отклонен из-за переполнения очереди
+    //! \param uuid - Уникальный идентификатор запроса
+    //!
+    void queryRejected(const QUuid & uuid);
+
+    //!
+    //! \brief queueWaitExceeded Сигнал того, что запрос ждал в очереди дольше
+    //! порога (см. setQueueWaitThreshold). Повторно отправляется только после того,
+    //! как время ожидания снова опустится ниже порога
+    //! \param waitMs - Время ожидания в мс
+    //!
+    void queueWaitExceeded(qint64 waitMs);
+
+    //!
+    //! \brief slowQuery Сигнал того, что запрос выполнялся дольше порога
+    //! журнала (см. setSlowQueryThreshold)
+    //! \param uuid - Уникальный идентификатор запроса
+    //! \param ms - Время выполнения в мс
+    //!
+    void slowQuery(const QUuid & uuid, qint64 ms);
+
+    //!
+    //! \brief memoryBudgetExceeded Сигнал того, что оценка памяти
+    //! превысила ограничение (см. setMemoryBudget)
+    //! \param usage - Оценка в байтах
+    //! \param budget - Ограничение в байтах
+    //!
+    void memoryBudgetExceeded(qint64 usage, qint64 budget);
+
     //!
     //! \brief stateChanged
     //! Сигнал того, что изменилось состояние коннектора
@@ -264,6 +753,94 @@ signals:
     void disconnected();
 
 private:
+    //!
+    //! \brief executeQuery Метод, выполняющий запрос и отправляющий результат
+    //! \param uuid - Уникальный идентификатор запроса
+    //! \param query - Текст запроса
+    //!
+    void executeQuery(const QUuid & uuid, const QString & query);
+
+    //!
+    //! \brief processQueue Метод, выполняющий запросы из очереди,
+    //! пока коннектор свободен
+    //!
+    void processQueue();
+
+    //!
+    //! \brief updateSubscriptions Метод, приводящий подписки на уведомления
+    //! в соответствие с режимом и списком таблиц, за которыми следят
+    //!
+    void updateSubscriptions();
+
+    //!
+    //! \brief notifyHub Метод, передающий хабу изменение списка каналов
+    //! \param channel - Канал таблицы
+    //! \param watch - true - следить, false - больше не следить
+    //!
+    void notifyHub(const QString & channel, bool watch);
+
+    //!
+    //! \brief enterQueue Метод учета запроса в очереди с учетом ограничений.
+    //! Может ждать места в очереди (политика Block)
+    //! \return false, если запрос отклонен
+    //!
+    bool enterQueue(const QUuid & uuid, const QString & query, Priority priority);
+
+    //!
+    //! \brief leaveQueue Метод, снимающий запрос с учета в очереди
+    //! \param started - true - запрос начал выполняться (учитывается время ожидания)
+    //! \return Время ожидания в очереди в мс или -1, если запрос не учитывался
+    //!
+    qint64 leaveQueue(const QUuid & uuid, bool started = true);
+
+    //!
+    //! \brief explainSlowQuery Метод, запрашивающий план медленного запроса
+    //! по отдельному соединению
+    //!
+    void explainSlowQuery(const QUuid & uuid, const QString & query);
+
+    //!
+    //! \brief checkMemoryBudget Метод проверки ограничения памяти
+    //!
+    void checkMemoryBudget();
+
+    //!
+    //! \brief isQueueFull Проверка переполнения. Вызывается под _queueMutex
+    //! \param bytes - Размер нового запроса
+    //!
+    bool isQueueFull(qint64 bytes) const;
+
+    //!
+    //! \brief dispatchResult Метод, передающий результат обработчику запроса,
+    //! если запрос был отправлен через execute() или sendQuery() с обработчиком
+    //!
+    void dispatchResult(const QUuid & uuid, const QueryResult & result);
+
+    //!
+    //! \brief The PendingQuery struct
+    //! Обработчик запроса, ожидающего результата
+    struct PendingQuery
+    {
+        QPointer<QObject> receiver;
+        bool hasReceiver { false };
+        ResultHandler handler;
+        //! Текст SELECT, если к этому запросу могут присоединиться другие
+        QString dedupKey;
+    };
+
+    //!
+    //! \brief deliverResult Метод, вызывающий обработчик в потоке получателя
+    //!
+    void deliverResult(const QUuid & uuid, const PendingQuery & pending, const QueryResult & result);
+
+    //!
+    //! \brief The InflightSelect struct
+    //! SELECT в очереди или в работе, к которому можно присоединиться
+    struct InflightSelect
+    {
+        QUuid leader;
+        quint64 writeSequence;
+    };
 
     //!
     //! \brief _mutex
@@ -284,16 +861,98 @@ private:
     QThread _thread;
     //!
     //! \brief _queue
-    //! Очередь запросов на отправку
+    //! Очередь запросов на отправку. sendQuery() пополняет ее из любого потока,
+    //! поэтому доступ только под _queueMutex
     QQueue<QPair<QUuid, QString>> _queue;
     //!
+    //! \brief _pending
+    //! Обработчики запросов, ожидающих результата, по идентификатору запроса
+    QHash<QUuid, PendingQuery> _pending;
+    //!
+    //! \brief _pendingMutex
+    //! Мютекс для _pending, запросы можно отправлять из любого потока
+    mutable QMutex _pendingMutex;
+    //!
+    //! \brief _inflightSelects
+    //! SELECT в очереди или в работе, по тексту запроса
+    QHash<QString, InflightSelect> _inflightSelects;
+    //!
+    //! \brief _followers
+    //! Запросы, присоединившиеся к SELECT, по идентификатору первого запроса
+    QHash<QUuid, QList<QPair<QUuid, PendingQuery>>> _followers;
+    //!
+    //! \brief _queueMutex
+    //! Мютекс очереди и ее учета, запросы принимаются из любого потока
+    mutable QMutex _queueMutex;
+    //!
+    //! \brief _queueNotFull
+    //! Ожидание места в очереди (политика Block)
+    QWaitCondition _queueNotFull;
+    //!
+    //! \brief _waiting
+    //! Время постановки в очередь (мс по _clock) и размер запросов, еще не начатых
+    QHash<QUuid, QPair<qint64, qint64>> _waiting;
+    //!
+    //! \brief _clock
+    //! Часы для времени ожидания в очереди
+    QElapsedTimer _clock;
+    //!
+    //! \brief _queueStats
+    //! Статистика очереди
+    QueueStats _queueStats;
+    int _queueLimit { 0 };
+    qint64 _queueByteLimit { 0 };
+    OverflowPolicy _overflowPolicies[3] { Accept, Block, Reject };
+    int _highWatermark { 0 };
+    int _lowWatermark { 0 };
+    bool _aboveHighWatermark { false };
+    qint64 _queueWaitThreshold { 0 };
+    bool _queueWaitExceeded { false };
+    //!
+    //! \brief _writeSequence
+    //! Счетчик отправленных запросов на запись
+    quint64 _writeSequence { 0 };
+    //!
+    //! \brief _dedupHits
+    //! Счетчик объединенных запросов
+    quint64 _dedupHits { 0 };
+    //!
+    //! \brief _selectDeduplication
+    //! Объединять ли одинаковые SELECT
+    bool _selectDeduplication { false };
+    //!
+    //! \brief _cache
+    //! Кэш результатов SELECT
+    SqlQueryCache _cache;
+    //!
+    //! \brief _resultCacheEnabled
+    //! Кэшировать ли результаты SELECT
+    bool _resultCacheEnabled { false };
+    //!
+    //! \brief _typedResults
+    //! Отдавать ли результаты SELECT в виде SqlValue
+    bool _typedResults { false };
+    //!
+    //! \brief _slowLog
+    //! Журнал медленных запросов. Общий с задачами EXPLAIN,
+    //! которые могут закончиться после удаления коннектора
+    std::shared_ptr<SqlSlowQueryLog> _slowLog { std::make_shared<SqlSlowQueryLog>() };
+    ExplainMode _slowQueryExplain { NoExplain };
+    //!
+    //! \brief _undelivered
+    //! Байт результатов в очередях событий получателей. Общий с обработчиками,
+    //! которые могут выполниться после удаления коннектора
+    std::shared_ptr<QAtomicInteger<qint64>> _undelivered { std::make_shared<QAtomicInteger<qint64>>(0) };
+    qint64 _memoryBudget { 0 };
+    bool _memoryBudgetExceeded { false };
+    //!
     //! \brief debug
     //! Режим дебаг. (Выводит информацию в консоль, если true)
     bool debug { false };
     //!
-    //! \brief
-    //! Кодировщик. Для доступа к базам данных с кодировкой не UTF
-    QTextCodec * _codec { nullptr };
+    //! \brief _decoder
+    //! Перекодировщик. Для доступа к базам данных с кодировкой не UTF
+    SqlTextDecoder _decoder;
     //!
     //! \brief m_connectionName
     //! Название соединения
@@ -302,5 +961,21 @@ private:
     //! \brief m_state
     //! Состояние коннектора
     State   m_state { Disconnected };
+    //!
+    //! \brief m_listenEnabled
+    //! Подписываться ли на уведомления при подключении
+    bool    m_listenEnabled { true };
+    //!
+    //! \brief m_listenMode
+    //! На какие каналы подписываться
+    ListenMode m_listenMode { GlobalChannel };
+    //!
+    //! \brief _watchedChannels
+    //! Количество менеджеров, следящих за таблицей, по каналу таблицы
+    QHash<QString, int> _watchedChannels;
+    //!
+    //! \brief _hub
+    //! Хаб, от которого коннектор получает уведомления
+    QPointer<SqlNotificationHub> _hub;
 };
 
@@ -0,0 +1,91 @@
+#pragma once
+#include <QMap>
+#include <QString>
+#include <memory>
+#include "ISqlTableItem.h"
+
+
+//!
+//! \brief The SqlItemSnapshot class
+//! \author Ivanov GD
+//!
+//! Снимок элементов менеджера таблицы на момент публикации
+//! (см. ISqlTableManager::snapshot).
+//!
+//! Элементы в снимке - копии элементов менеджера: менеджер меняет свои
+//! элементы на месте, а копии после публикации не трогает. При следующей
+//! публикации заново копируются только изменившиеся элементы, остальные
+//! копии переходят в новый снимок (QMap с неявным разделением).
+//! Снимок можно передавать в другие потоки и читать без блокировок,
+//! пока на него есть указатель. Менять элементы снимка нельзя.
+//!
+//! Пример:
+//! -- SqlItemSnapshot::ptr snap = manager->snapshot();
+//! -- QtConcurrent::run([snap] {
+//! --     for(const auto & item: *snap)
+//! --         ...
+//! -- });
+//!
+class SqlItemSnapshot
+{
+public:
+    using ptr = std::shared_ptr<const SqlItemSnapshot>;
+    using Items = QMap<QString, ISqlTableItem::ptr>;
+    using const_iterator = Items::const_iterator;
+
+    //!
+    //! \brief SqlItemSnapshot Конструктор
+    //! \param items - Элементы по идентификаторам
+    //! \param version - Номер версии
+    //!
+    SqlItemSnapshot(const Items & items = Items(), quint64 version = 0);
+
+    //!
+    //! \brief version
+    //! \return Номер версии. Растет с каждой публикацией
+    //!
+    quint64 version() const;
+
+    //!
+    //! \brief count
+    //! \return Количество элементов
+    //!
+    int count() const;
+
+    //!
+    //! \brief isEmpty
+    //! \return true/false - Пустой ли снимок
+    //!
+    bool isEmpty() const;
+
+    //!
+    //! \brief contains
+    //! \param uuid - Идентификатор элемента
+    //! \return true/false - Есть ли элемент в снимке
+    //!
+    bool contains(const QString & uuid) const;
+
+    //!
+    //! \brief item Метод для получения конкретного элемента
+    //! \param uuid - Идентификатор элемента
+    //! \return Элемент или nullptr
+    //!
+    ISqlTableItem::ptr item(const QString & uuid) const;
+
+    //!
+    //! \brief items
+    //! \return Элементы по идентификаторам, без копирования
+    //!
+    const Items & items() const;
+
+    //!
+    //! \brief begin, end
+    //! Перебор элементов в порядке идентификаторов, без копирования
+    //!
+    const_iterator begin() const;
+    const_iterator end() const;
+
+private:
+    Items _items;
+    quint64 _version { 0 };
+};
@@ -0,0 +1,340 @@
+#pragma once
+#include <QObject>
+#include <QPointer>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QJsonObject>
+#include <functional>
+#include "ISqlTableItem.h"
+#include "SqlDatabaseConnector.h"
+#include "SqlChangeFetcher.h"
+
+/****************************************************************************
+ *                         SqlJoinedTableManager                            *
+ *                                                                          *
+ *  Класс для управления основной таблицей и связанными с ней таблицами-    *
+ *  справочниками. Все таблицы загружаются одним запросом с JOIN, а затем   *
+ *  синхронизируются по уведомлениям каждой из таблиц отдельно.             *
+ *                                                                          *
+ ****************************************************************************
+*/
+
+
+
+//!
+//! \brief The SqlJoinedTableManager class
+//! \author Ivanov GD
+//!
+//! Строки основной таблицы хранятся отдельно от строк справочников,
+//! а объединенная строка собирается по ссылкам при обращении. Поэтому
+//! изменение строки справочника не требует повторного JOIN: менеджер
+//! только сообщает, какие строки основной таблицы на нее ссылаются.
+//!
+//! Пример:
+//! -- auto joined = new SqlJoinedTableManager(connector);
+//! -- joined->setBaseTable<OrderItem>("shop", "orders", "o");
+//! -- joined->addJoin<ClientItem>("shop", "clients", "c", "client_uuid");
+//! -- joined->addJoin<StatusItem>("shop", "statuses", "s", "status", "code");
+//! -- joined->load();
+//!
+class SqlJoinedTableManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    //!
+    //! \brief The JoinType enum
+    //! Тип соединения таблиц
+    enum JoinType
+    {
+        InnerJoin,
+        LeftJoin,
+    };
+    Q_ENUM(JoinType)
+
+    //!
+    //! \brief ItemFactory
+    //! Функция, создающая пустой элемент таблицы
+    using ItemFactory = std::function<ISqlTableItem::ptr()>;
+
+protected:
+    //!
+    //! \brief The Member struct
+    //! Описание одной таблицы в соединении.
+    //! Нулевой элемент - основная таблица
+    struct Member
+    {
+        QString scheme;
+        QString table;
+        QString alias;
+        QStringList fields;
+        ItemFactory factory;
+
+        //! Поле основной таблицы, по которому идет соединение
+        QString localField;
+        //! Поле справочника, по которому идет соединение
+        QString foreignField;
+        JoinType joinType { LeftJoin };
+
+        //! Строки таблицы: uuid -> данные
+        QHash<QString, QJsonObject> records;
+        //! Справочник: значение foreignField -> uuid строки
+        QHash<QString, QString> byKey;
+        //! Справочник: значение foreignField -> uuid строк основной таблицы
+        QHash<QString, QSet<QString>> referrers;
+    };
+
+    //!
+    //! \brief _connector
+    //! Указатель на коннектор к базе данных
+    QPointer<SqlDatabaseConnector> _connector;
+
+    //!
+    //! \brief _members
+    //! Таблицы соединения. Нулевой элемент - основная таблица
+    QVector<Member> _members;
+
+    //!
+    //! \brief _joinedRows
+    //! Строки основной таблицы, входящие в соединение (у которых есть
+    //! все строки справочников InnerJoin). Обновляется при каждом изменении
+    //! строк, поэтому count() и contains() не проверяют ссылки заново
+    QSet<QString> _joinedRows;
+
+    //!
+    //! \brief _requestedKeys
+    //! Ключи справочников, которые уже запрошены из базы
+    QSet<QString> _requestedKeys;
+
+    //!
+    //! \brief _changeFetchers
+    //! Дочитывают строки по уведомлениям формата ChangePointer, по номеру таблицы
+    QHash<int, SqlChangeFetcher *> _changeFetchers;
+
+    //! Выводить или не выводить дебаг в консоль.
+    bool _debug { false };
+
+public:
+    //!
+    //! \brief SqlJoinedTableManager - конструктор
+    //! \param connector - Указатель на коннектор к БД
+    //! \param parent - Указатель на родителя QObject
+    //!
+    SqlJoinedTableManager(SqlDatabaseConnector * connector, QObject * parent = nullptr);
+
+    //!
+    //! Деструктор. Сообщает коннектору, что за таблицами больше не следят
+    ~SqlJoinedTableManager();
+
+    //!
+    //! \brief setBaseTable Метод для задания основной таблицы
+    //! \param scheme - Название схемы
+    //! \param table - Название таблицы
+    //! \param alias - Псевдоним таблицы в запросе
+    //!
+    template<typename ItemT>
+    void setBaseTable(const QString & scheme, const QString & table, const QString & alias)
+    {
+        setBaseTable(scheme, table, alias, [] { return ISqlTableItem::ptr(ItemT::create()); });
+    }
+
+    //!
+    //! \brief setBaseTable Метод для задания основной таблицы
+    //! \param factory - Функция, создающая элемент таблицы.
+    //! По нему определяется список полей
+    //!
+    void setBaseTable(const QString & scheme, const QString & table, const QString & alias,
+                      ItemFactory factory);
+
+    //!
+    //! \brief addJoin Метод для добавления таблицы-справочника
+    //! \param scheme - Название схемы
+    //! \param table - Название таблицы
+    //! \param alias - Псевдоним таблицы в запросе
+    //! \param localField - Поле основной таблицы
+    //! \param foreignField - Поле справочника
+    //! \param joinType - Тип соединения
+    //!
+    template<typename ItemT>
+    void addJoin(const QString & scheme, const QString & table, const QString & alias,
+                 const QString & localField, const QString & foreignField = "_uuid",
+                 JoinType joinType = LeftJoin)
+    {
+        addJoin(scheme, table, alias, localField, foreignField, joinType,
+                [] { return ISqlTableItem::ptr(ItemT::create()); });
+    }
+
+    //!
+    //! \brief addJoin Метод для добавления таблицы-справочника
+    //! \param factory - Функция, создающая элемент таблицы.
+    //! По нему определяется список полей
+    //!
+    void addJoin(const QString & scheme, const QString & table, const QString & alias,
+                 const QString & localField, const QString & foreignField,
+                 JoinType joinType, ItemFactory factory);
+
+    //!
+    //! \brief load Метод для загрузки всех таблиц одним запросом
+    //!
+    void load();
+
+    //!
+    //! \brief unload Метод для выгрузки данных из памяти
+    //!
+    void unload();
+
+    //!
+    //! \brief count
+    //! \return Количество строк основной таблицы в соединении, за O(1)
+    //!
+    int count() const;
+
+    //!
+    //! \brief uuids
+    //! \return Идентификаторы строк основной таблицы в соединении
+    //!
+    QStringList uuids() const;
+
+    //!
+    //! \brief contains
+    //! \return true, если строка основной таблицы входит в соединение
+    //!
+    bool contains(const QString & uuid) const;
+
+    //!
+    //! \brief row Метод для получения объединенной строки
+    //! \param uuid - Идентификатор строки основной таблицы
+    //! \return Данные в формате Json, ключи вида "alias.field"
+    //!
+    QJsonObject row(const QString & uuid) const;
+
+    //!
+    //! \brief record Метод для получения строки одной из таблиц соединения
+    //! \param uuid - Идентификатор строки основной таблицы
+    //! \param alias - Псевдоним таблицы
+    //! \return Данные в формате Json
+    //!
+    QJsonObject record(const QString & uuid, const QString & alias) const;
+
+    //!
+    //! \brief value Метод для получения значения поля
+    //! \param uuid - Идентификатор строки основной таблицы
+    //! \param alias - Псевдоним таблицы
+    //! \param field - Название поля
+    //!
+    QVariant value(const QString & uuid, const QString & alias, const QString & field) const;
+
+    //!
+    //! \brief item Метод для получения элемента одной из таблиц соединения
+    //! \param uuid - Идентификатор строки основной таблицы
+    //! \param alias - Псевдоним таблицы
+    //! \return Элемент или nullptr, если строки нет
+    //!
+    ISqlTableItem::ptr item(const QString & uuid, const QString & alias) const;
+
+    //!
+    //! \brief selectQuery Метод для создания SQL запроса SELECT с JOIN
+    //!
+    virtual QString selectQuery() const;
+
+protected:
+    //!
+    //! \brief memberIndex
+    //! \return Номер таблицы по псевдониму или -1
+    //!
+    int memberIndex(const QString & alias) const;
+
+    //!
+    //! \brief lookupRecord Метод для поиска строки справочника для строки основной таблицы
+    //!
+    const QJsonObject * lookupRecord(int member, const QJsonObject & base) const;
+
+    //!
+    //! \brief isJoined Метод проверки ссылок строки основной таблицы
+    //! \return true, если строка есть и для всех InnerJoin найдены строки справочников
+    //!
+    bool isJoined(const QString & uuid) const;
+
+    //!
+    //! \brief refreshJoined Метод обновления _joinedRows для строк основной таблицы
+    //! \param uuids - Идентификаторы строк, ссылки которых могли измениться
+    //!
+    void refreshJoined(const QSet<QString> & uuids);
+
+    //!
+    //! \brief setBaseRecord Метод для вставки/замены строки основной таблицы
+    //! \param fetchMissing - Дозагрузить строки справочников, которых еще нет
+    //!
+    void setBaseRecord(const QString & uuid, const QJsonObject & record, bool fetchMissing = true);
+
+    //!
+    //! \brief removeBaseRecord Метод для удаления строки основной таблицы
+    //!
+    void removeBaseRecord(const QString & uuid);
+
+    //!
+    //! \brief setLookupRecord Метод для вставки/замены строки справочника
+    //! \return Строки основной таблицы, которые на нее ссылаются
+    //!
+    QSet<QString> setLookupRecord(int member, const QString & uuid, const QJsonObject & record);
+
+    //!
+    //! \brief removeLookupRecord Метод для удаления строки справочника
+    //! \return Строки основной таблицы, которые на нее ссылались
+    //!
+    QSet<QString> removeLookupRecord(int member, const QString & uuid);
+
+    //!
+    //! \brief requestLookup Метод для дозагрузки одной строки справочника,
+    //! если на нее сослалась новая строка основной таблицы
+    //!
+    void requestLookup(int member, const QString & key);
+
+    //!
+    //! \brief sendQuery Метод для отправки запроса в БД
+    //! \param member - Номер таблицы, для которой запрошена строка справочника,
+    //! или -1 для полной загрузки
+    //!
+    void sendQuery(const QString & query, int member);
+
+    //!
+    //! \brief onQueryFinished Метод обработки результата запроса в БД
+    //! \param member - см. sendQuery()
+    //!
+    void onQueryFinished(int member, const QueryResult & result);
+    //!
+    //! \brief changeFetcher Метод, возвращающий (и при необходимости создающий)
+    //! объект, дочитывающий строки таблицы соединения
+    //! \param member - Номер таблицы
+    //!
+    SqlChangeFetcher * changeFetcher(int member);
+
+protected slots:
+    //!
+    //! \brief onDBNotification Слот обработки уведомления из базы данных
+    //!
+    virtual void onDBNotification(const SqlNotification & incoming);
+
+signals:
+    //!
+    //! \brief updated Сигнал того, что соединение полностью загружено
+    //!
+    void updated();
+
+    //!
+    //! \brief rowInserted Сигнал того, что в соединении появилась строка
+    //!
+    void rowInserted(const QString & uuid);
+
+    //!
+    //! \brief rowRemoved Сигнал того, что из соединения удалена строка
+    //!
+    void rowRemoved(const QString & uuid);
+
+    //!
+    //! \brief rowsChanged Сигнал того, что изменились данные строк
+    //! (самих строк или справочников, на которые они ссылаются)
+    //!
+    void rowsChanged(const QStringList & uuids);
+};
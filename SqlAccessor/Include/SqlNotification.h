@@ -3,6 +3,8 @@
 #include <QString>
 #include <QJsonObject>
 #include <QDate>
+#include <QSharedPointer>
+#include "SqlValue.h"
 
 static QByteArray IDSqlChangedEvent = QByteArrayLiteral("data_change_event");
 
@@ -15,12 +17,35 @@ static QByteArray IDSqlChangedEvent = QByteArrayLiteral("data_change_event");
 //!
 struct SqlNotification
 {
+    //!
+    //! \brief ptr
+    //! Разобранное уведомление, общее для всех получателей.
+    //! Не изменяется после разбора, поэтому его можно передавать
+    //! между потоками без копирования
+    using ptr = QSharedPointer<const SqlNotification>;
+
     enum ActionType
     {
         UPDATE,
         INSERT,
         DELETE,
     };
+
+    //!
+    //! \brief The PayloadFormat enum
+    //! Что триггер передает в уведомлении (поле "format")
+    enum PayloadFormat
+    {
+        //! Строка целиком в data и data_old
+        FullRow,
+        //! Только _uuid в data. Строку нужно дочитать из базы
+        //! (уведомления PostgreSQL ограничены ~8000 байтами)
+        ChangePointer,
+        //! При UPDATE в data только _uuid и изменившиеся колонки,
+        //! которые накладываются на уже загруженный элемент
+        ColumnDiff,
+    };
+
     int iSource;
 
     QString itemUuid;
@@ -29,6 +54,18 @@ struct SqlNotification
     ActionType actionType;
     QJsonObject data;
     QJsonObject oldData;
+    PayloadFormat format { FullRow };
+
+    //!
+    //! \brief value Метод получения значения колонки из data
+    //! \param column - Название колонки
+    //! \return Значение или SqlValue::Null, если колонки нет
+    //!
+    SqlValue value(const QString & column) const
+    {
+        return SqlValue::fromJson(data.value(column));
+    }
 };
 
 Q_DECLARE_METATYPE(SqlNotification)
+Q_DECLARE_METATYPE(SqlNotification::ptr)
@@ -0,0 +1,146 @@
+#pragma once
+#include <QObject>
+#include <QList>
+#include <QPointer>
+#include "SqlDatabaseConnector.h"
+
+
+//!
+//! \brief The SqlNotificationHub class
+//! \author Ivanov GD
+//!
+//! Одно выделенное соединение LISTEN к базе данных, уведомления
+//! которого получают все подключенные к хабу коннекторы этой базы.
+//!
+//! Уведомление разбирается один раз, в SqlNotification::ptr, и
+//! передается коннекторам без копирования, в их собственных потоках
+//! (см. SqlDatabaseConnector::dispatchNotification). Подключенные
+//! коннекторы сами на уведомления не подписываются. На каналы таблиц
+//! хаб подписывается, пока за таблицей следит хотя бы один коннектор.
+//!
+//! Обычно создается через SqlConnectorManager::shareNotifications()
+class SqlNotificationHub : public QObject
+{
+    Q_OBJECT
+
+public:
+    //!
+    //! \brief SqlNotificationHub Конструктор
+    //! \param host - Адрес сервера
+    //! \param port - Порт
+    //! \param baseName - Название базы данных
+    //! \param parent - Указатель на родителя QObject
+    //!
+    SqlNotificationHub(const QString & host, int port, const QString & baseName,
+                       QObject * parent = nullptr);
+
+    //!
+    //! Деструктор. Отключает все коннекторы от хаба
+    ~SqlNotificationHub();
+
+    //!
+    //! \brief key Метод получения ключа базы данных
+    //! \return Строка вида "host:port/baseName"
+    //!
+    static QString key(const QString & host, int port, const QString & baseName);
+
+    //!
+    //! \brief open Метод открытия соединения LISTEN
+    //! \param username - Имя пользователя
+    //! \param password - Пароль
+    //! \return true/false - Удалось подключиться или нет
+    //!
+    bool open(const QString & username, const QString & password);
+
+    //!
+    //! \brief close Метод закрытия соединения LISTEN
+    //!
+    void close();
+
+    //!
+    //! \brief isOpen
+    //! \return true/false - Открыто ли соединение LISTEN
+    //!
+    bool isOpen() const;
+
+    //!
+    //! \brief attach Метод подключения коннектора к хабу
+    //! \param connector - Коннектор к той же базе данных
+    //!
+    void attach(SqlDatabaseConnector * connector);
+
+    //!
+    //! \brief detach Метод отключения коннектора от хаба.
+    //! Коннектор снова подписывается на уведомления сам
+    //! \param connector - Коннектор
+    //!
+    void detach(SqlDatabaseConnector * connector);
+
+    //!
+    //! \brief connectors
+    //! \return Подключенные к хабу коннекторы
+    //!
+    QList<SqlDatabaseConnector *> connectors() const;
+
+    //!
+    //! \brief listener
+    //! \return Коннектор соединения LISTEN
+    //!
+    SqlDatabaseConnector * listener() const;
+
+    //!
+    //! \brief setListenMode Метод для выбора каналов уведомлений
+    //! \param mode - см. SqlDatabaseConnector::ListenMode
+    //!
+    void setListenMode(SqlDatabaseConnector::ListenMode mode);
+
+    //!
+    //! \brief setCodec Метод для установки кодировщика текста уведомлений
+    //! \param codec - Кодировщик
+    //!
+    void setCodec(QTextCodec * codec);
+
+    //!
+    //! \brief notificationCount
+    //! \return Количество разобранных уведомлений
+    //!
+    quint64 notificationCount() const;
+
+public slots:
+    //!
+    //! \brief watchChannel Слот, через который коннекторы сообщают,
+    //! что за каналом таблицы следят
+    //! \param channel - Канал таблицы
+    //!
+    void watchChannel(const QString & channel);
+
+    //!
+    //! \brief unwatchChannel Слот, через который коннекторы сообщают,
+    //! что за каналом таблицы больше не следят
+    //! \param channel - Канал таблицы
+    //!
+    void unwatchChannel(const QString & channel);
+
+private slots:
+    //!
+    //! \brief onNotification Слот рассылки уведомления подключенным коннекторам
+    //! \param notification - Разобранное уведомление
+    //!
+    void onNotification(SqlNotification::ptr notification);
+
+private:
+    //!
+    //! \brief _listener
+    //! Коннектор соединения LISTEN
+    SqlDatabaseConnector * _listener { nullptr };
+
+    //!
+    //! \brief _connectors
+    //! Подключенные коннекторы
+    QList<QPointer<SqlDatabaseConnector>> _connectors;
+
+    //!
+    //! \brief _notificationCount
+    //! Счетчик разобранных уведомлений
+    quint64 _notificationCount { 0 };
+};
@@ -0,0 +1,89 @@
+#pragma once
+#include <QString>
+#include "SqlNotification.h"
+
+
+//!
+//! \brief The SqlNotificationTrigger class
+//! \author Ivanov GD
+//!
+//! Генератор SQL для триггеров, которые отправляют уведомления
+//! в формате, ожидаемом SqlDatabaseConnector::onDBNotify.
+//!
+//! Уведомление уходит либо в общий канал IDSqlChangedEvent,
+//! либо в канал таблицы channelName(schema, table), на который
+//! коннектор подписывается, пока жив хотя бы один менеджер этой таблицы
+//! (см. SqlDatabaseConnector::setListenMode)
+//!
+//! Пример:
+//! -- QString ddl = SqlNotificationTrigger::createDdl("shop", "orders");
+//! -- connector->sendQuery(ddl, nullptr, [](const QUuid &, const QueryResult &) {});
+//!
+class SqlNotificationTrigger
+{
+public:
+    //!
+    //! \brief channelName Метод получения названия канала уведомлений таблицы
+    //! \param schema - Название схемы
+    //! \param table - Название таблицы
+    //! \return Название канала вида "data_change_event:schema:table".
+    //! Если название не влезает в 63 байта или содержит точку или кавычку,
+    //! вместо "schema:table" используется md5 от "schema.table"
+    //!
+    static QString channelName(const QString & schema, const QString & table);
+
+    //!
+    //! \brief createDdl Метод получения SQL для создания триггера уведомлений
+    //! \param schema - Название схемы
+    //! \param table - Название таблицы
+    //! \param format - Что передается в уведомлении. Для ChangePointer
+    //! в таблице должна быть колонка _uuid
+    //! \param tableChannel - true - уведомления уходят в канал таблицы,
+    //! false - в общий канал IDSqlChangedEvent
+    //! \return Текст SQL: функция триггера и сам триггер
+    //!
+    static QString createDdl(const QString & schema, const QString & table,
+                             SqlNotification::PayloadFormat format = SqlNotification::FullRow,
+                             bool tableChannel = true);
+
+    //!
+    //! \brief dropDdl Метод получения SQL для удаления триггера уведомлений
+    //! \param schema - Название схемы
+    //! \param table - Название таблицы
+    //! \return Текст SQL
+    //!
+    static QString dropDdl(const QString & schema, const QString & table);
+
+    //!
+    //! \brief quoteIdentifier Метод экранирования идентификатора SQL
+    //! \param name - Идентификатор
+    //! \return Идентификатор в двойных кавычках
+    //!
+    static QString quoteIdentifier(const QString & name);
+
+    //!
+    //! \brief quoteLiteral Метод экранирования строки SQL
+    //! \param value - Строка
+    //! \return Строка в одинарных кавычках
+    //!
+    static QString quoteLiteral(const QString & value);
+
+private:
+    //!
+    //! \brief functionBody
+    //! \return Тело функции триггера для формата уведомления
+    //!
+    static QString functionBody(const QString & channel, SqlNotification::PayloadFormat format);
+
+    //!
+    //! \brief functionName
+    //! \return Название функции триггера (без схемы)
+    //!
+    static QString functionName(const QString & table);
+
+    //!
+    //! \brief triggerName
+    //! \return Название триггера
+    //!
+    static QString triggerName(const QString & table);
+};
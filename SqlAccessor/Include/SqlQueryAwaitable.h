@@ -0,0 +1,83 @@
+#pragma once
+#include <QFuture>
+#include <QFutureWatcher>
+#include "SqlDatabaseConnector.h"
+
+//!
+//! Поддержка корутин C++20 для SqlDatabaseConnector::execute().
+//! Доступна, только если проект собирается с CONFIG += c++2a (или новее)
+//!
+//! Пример:
+//! -- SqlTask MyWidget::reload()
+//! -- {
+//! --     QueryResult clients = co_await _connector->execute("SELECT * FROM shop.clients;");
+//! --     QueryResult orders  = co_await _connector->execute("SELECT * FROM shop.orders;");
+//! --     ...
+//! -- }
+//!
+//! Корутина продолжается в потоке, который ее приостановил,
+//! поэтому в нем должен работать цикл событий
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#include <exception>
+
+//!
+//! \brief The SqlQueryAwaitable class
+//! \author Ivanov GD
+//! Объект ожидания результата запроса в корутине
+class SqlQueryAwaitable
+{
+public:
+    explicit SqlQueryAwaitable(QFuture<QueryResult> future) :
+        _future { future }
+    {
+    }
+
+    bool await_ready() const
+    {
+        return _future.isFinished();
+    }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        // QFutureWatcher сообщит о завершении, даже если запрос
+        // успел выполниться между await_ready() и setFuture()
+        auto watcher = new QFutureWatcher<QueryResult>();
+        QObject::connect(watcher, &QFutureWatcherBase::finished, watcher, [watcher, handle]() {
+            watcher->deleteLater();
+            handle.resume();
+        });
+        watcher->setFuture(_future);
+    }
+
+    QueryResult await_resume() const
+    {
+        return _future.result();
+    }
+
+private:
+    QFuture<QueryResult> _future;
+};
+
+inline SqlQueryAwaitable operator co_await(QFuture<QueryResult> future)
+{
+    return SqlQueryAwaitable(future);
+}
+
+//!
+//! \brief The SqlTask struct
+//! \author Ivanov GD
+//! Простейший тип корутины "запустил и забыл" для слотов и обработчиков
+struct SqlTask
+{
+    struct promise_type
+    {
+        SqlTask get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+#endif
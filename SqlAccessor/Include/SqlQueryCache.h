@@ -0,0 +1,166 @@
+#pragma once
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QMutex>
+#include <functional>
+#include <list>
+#include "SqlQueryResult.h"
+
+
+//!
+//! \brief The SqlQueryCache class
+//! \author Ivanov GD
+//!
+//! Кэш результатов SELECT с ограничением по памяти и вытеснением
+//! давно не использованных записей (LRU).
+//!
+//! Каждая запись помечена таблицами (schema.table), из которых читает
+//! запрос, и удаляется, как только приходит уведомление об изменении
+//! одной из них, или этот же коннектор выполняет запрос на запись в нее.
+//! Запросы, в которых не удалось найти ни одной таблицы, запросы
+//! к таблицам без схемы (схема зависит от search_path) и запросы
+//! с вызовами функций (см. SqlQueryText::callsFunctions) не кэшируются
+class SqlQueryCache
+{
+public:
+    //!
+    //! \brief TableFilter
+    //! Проверка, придет ли кэшу уведомление об изменении таблицы (schema, table)
+    using TableFilter = std::function<bool(const QString & schema, const QString & table)>;
+
+    //!
+    //! \brief The Stats struct
+    //! Статистика кэша
+    struct Stats
+    {
+        quint64 hits { 0 };
+        quint64 misses { 0 };
+        quint64 evictions { 0 };
+        quint64 invalidations { 0 };
+        qint64  bytes { 0 };
+        int     entries { 0 };
+    };
+
+    //!
+    //! \brief SqlQueryCache Конструктор
+    //! \param budget - Ограничение по памяти в байтах
+    //!
+    explicit SqlQueryCache(qint64 budget = 64 * 1024 * 1024);
+
+    //!
+    //! \brief lookup Метод поиска результата в кэше
+    //! \param query - Текст запроса
+    //! \param result - Сюда записывается результат, если он найден
+    //! \return true/false - найден или нет
+    //!
+    bool lookup(const QString & query, QueryResult & result);
+
+    //!
+    //! \brief insert Метод для добавления результата в кэш
+    //! \param query - Текст запроса
+    //! \param result - Результат
+    //! \param watched - Если задана, запрос кэшируется, только когда
+    //! за изменениями всех его таблиц кто-то следит
+    //! \return true/false - добавлен или нет (нет таблиц, есть таблица без схемы
+    //! или без уведомлений, есть вызов функции или слишком большой)
+    //!
+    bool insert(const QString & query, const QueryResult & result, const TableFilter & watched = TableFilter());
+
+    //!
+    //! \brief invalidateTable Метод удаления всех записей, читающих из таблицы
+    //! \param schema - Название схемы
+    //! \param table - Название таблицы
+    //!
+    void invalidateTable(const QString & schema, const QString & table);
+
+    //!
+    //! \brief invalidateQuery Метод удаления записей, читающих из таблиц,
+    //! в которые пишет запрос. Если запрос вызывает функцию, кэш очищается целиком.
+    //! Для таблицы без схемы удаляются записи, читающие из таблицы с тем же названием в любой схеме
+    //! \param query - Текст запроса на запись
+    //!
+    void invalidateQuery(const QString & query);
+
+    //!
+    //! \brief clear Метод очистки кэша
+    //!
+    void clear();
+
+    //!
+    //! \brief budget
+    //! \return Ограничение по памяти в байтах
+    //!
+    qint64 budget() const;
+
+    //!
+    //! \brief setBudget Метод для задания ограничения по памяти
+    //! \param bytes - Ограничение в байтах
+    //!
+    void setBudget(qint64 bytes);
+
+    //!
+    //! \brief stats
+    //! \return Статистика кэша
+    //!
+    Stats stats() const;
+
+    //!
+    //! \brief tablesOf Метод поиска таблиц, упомянутых в запросе
+    //! \param query - Текст запроса
+    //! \param unqualified - Сюда записываются названия таблиц без схемы
+    //! \return Список вида "schema.table". Таблицы без схемы в него не входят
+    //!
+    static QStringList tablesOf(const QString & query, QStringList * unqualified = nullptr);
+
+    //!
+    //! \brief estimateSize Метод оценки занимаемой результатом памяти
+    //! \param result - Результат запроса
+    //! \return Примерный размер в байтах
+    //!
+    static qint64 estimateSize(const QueryResult & result);
+
+private:
+    //!
+    //! \brief The Entry struct
+    //! Запись кэша
+    struct Entry
+    {
+        QString query;
+        QueryResult result;
+        QStringList tables;
+        qint64 size { 0 };
+    };
+
+    using Iterator = std::list<Entry>::iterator;
+
+    //!
+    //! \brief removeEntry Метод удаления записи вместе с ее пометками таблиц
+    //!
+    void removeEntry(Iterator it);
+
+    //!
+    //! \brief shrink Метод вытеснения записей, пока кэш не влезет в бюджет
+    //!
+    void shrink();
+
+    //!
+    //! \brief _entries
+    //! Записи, в начале - использованные последними
+    std::list<Entry> _entries;
+
+    //!
+    //! \brief _index
+    //! Записи по тексту запроса
+    QHash<QString, Iterator> _index;
+
+    //!
+    //! \brief _byTable
+    //! Тексты запросов по таблицам, из которых они читают
+    QHash<QString, QSet<QString>> _byTable;
+
+    qint64 _budget;
+    Stats _stats;
+    mutable QMutex _mutex;
+};
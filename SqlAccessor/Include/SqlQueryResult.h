@@ -0,0 +1,28 @@
+#pragma once
+#include <QList>
+#include <QVector>
+#include <QJsonObject>
+#include <QSqlError>
+#include <QMetaType>
+#include "SqlValue.h"
+
+
+//!
+//! \brief The QueryResult struct
+//! Класс, в который записывается результат работы QSqlQuery
+//!
+//! \author Ivanov GD
+//!
+struct QueryResult
+{
+    QList<QJsonObject> records;
+    //! Названия колонок и строки результата в виде SqlValue,
+    //! если коннектор отдает типизированный результат (см. setTypedResults).
+    //! В этом случае records пустой
+    QVector<QString> columns;
+    QVector<QVector<SqlValue>> rows;
+    bool isSelect { false };
+    QSqlError error;
+};
+
+Q_DECLARE_METATYPE(QueryResult)
@@ -0,0 +1,65 @@
+#pragma once
+#include <QString>
+
+
+//!
+//! \brief The SqlQueryText class
+//! \author Ivanov GD
+//!
+//! Грубый разбор текста запроса без обращения к серверу: что запрос
+//! может изменить и можно ли разделить или закэшировать его результат.
+//! Ошибается только в сторону осторожности: непонятный запрос
+//! считается записью
+class SqlQueryText
+{
+public:
+    //!
+    //! \brief The Kind enum
+    //! Вид запроса
+    enum Kind
+    {
+        //! Меняет данные: INSERT/UPDATE/DELETE/..., SELECT ... INTO,
+        //! вызов функции, которая может иметь побочные эффекты (nextval() и т.п.)
+        Write,
+        //! Только читает, но блокирует строки (FOR UPDATE/SHARE)
+        LockingRead,
+        //! Только читает. Результат можно разделить между одинаковыми запросами
+        PureRead
+    };
+
+    //!
+    //! \brief classify Метод определения вида запроса
+    //! \param query - Текст запроса
+    //! \return Вид запроса
+    //!
+    static Kind classify(const QString & query);
+
+    //!
+    //! \brief isPure
+    //! \return true, если запрос только читает, ничего не блокирует
+    //! и вызывает только функции без побочных эффектов
+    //!
+    static bool isPure(const QString & query) { return classify(query) == PureRead; }
+
+    //!
+    //! \brief mayWrite
+    //! \return true, если запрос может изменить данные
+    //!
+    static bool mayWrite(const QString & query) { return classify(query) == Write; }
+
+    //!
+    //! \brief callsFunctions
+    //! \param query - Текст запроса
+    //! \return true, если в запросе вызывается функция, кроме агрегатов
+    //! и встроенных функций без побочных эффектов (count(), lower(), coalesce() и т.п.)
+    //!
+    static bool callsFunctions(const QString & query);
+
+    //!
+    //! \brief stripLiterals Метод, заменяющий строковые литералы ('...', E'...', $$...$$)
+    //! на '' и комментарии на пробел. Имена в кавычках ("...") остаются
+    //! \param query - Текст запроса
+    //! \return Текст, в котором ключевые слова и имена ищутся без ложных совпадений
+    //!
+    static QString stripLiterals(const QString & query);
+};
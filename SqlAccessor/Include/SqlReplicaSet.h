@@ -0,0 +1,203 @@
+#pragma once
+#include <QObject>
+#include <QList>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QSet>
+#include "SqlDatabaseConnector.h"
+
+
+//!
+//! \brief The SqlReplicaSet class
+//! \author Ivanov GD
+//!
+//! Основной сервер и его реплики для чтения, зарегистрированные
+//! под одним логическим именем соединения в SqlConnectorManager.
+//!
+//! Запросы SELECT могут уходить на наименее загруженную реплику,
+//! отставание которой не превышает maxLag(). Запись и подписка на
+//! уведомления остаются на основном сервере. После записи через
+//! основной коннектор (любой запрос, кроме SELECT) чтение в течение
+//! stickiness() мс идет с основного сервера, чтобы программа видела
+//! свои же изменения.
+//!
+//! Реплика считается исправной, только если сервер в режиме восстановления
+//! (pg_is_in_recovery()), а его WAL receiver в состоянии streaming и получал
+//! сообщения не позже receiverTimeout() мс назад. Для чтения
+//! pg_stat_wal_receiver роли реплики нужны права pg_read_all_stats
+//! (или pg_monitor), иначе реплика считается неисправной
+class SqlReplicaSet : public QObject
+{
+    Q_OBJECT
+
+public:
+    //!
+    //! \brief The ReplicaInfo struct
+    //! Состояние реплики
+    struct ReplicaInfo
+    {
+        //! Коннектор к реплике
+        SqlDatabaseConnector * connector { nullptr };
+        //! Соединение с репликой открыто
+        bool open { false };
+        //! Отставание от основного сервера в мс, -1 - неизвестно или реплика неисправна
+        qint64 lagMs { -1 };
+        //! Количество запросов в очереди и в работе
+        int load { 0 };
+        //! Количество запросов, отправленных на эту реплику
+        quint64 routedQueries { 0 };
+    };
+
+    //!
+    //! \brief SqlReplicaSet Конструктор
+    //! \param primary - Коннектор к основному серверу
+    //! \param parent - Указатель на родителя QObject
+    //!
+    explicit SqlReplicaSet(SqlDatabaseConnector * primary, QObject * parent = nullptr);
+
+    //!
+    //! Деструктор. Удаляет коннекторы к репликам
+    ~SqlReplicaSet();
+
+    //!
+    //! \brief primary
+    //! \return Коннектор к основному серверу
+    //!
+    SqlDatabaseConnector * primary() const;
+
+    //!
+    //! \brief addReplica Метод добавления реплики
+    //! \param connector - Коннектор к реплике. Переходит во владение набора
+    //!
+    void addReplica(SqlDatabaseConnector * connector);
+
+    //!
+    //! \brief replicas
+    //! \return Состояние всех реплик
+    //!
+    QList<ReplicaInfo> replicas() const;
+
+    //!
+    //! \brief readConnector Метод выбора коннектора для запроса на чтение
+    //! \return Реплика или основной сервер, если подходящих реплик нет
+    //!
+    SqlDatabaseConnector * readConnector();
+
+    //!
+    //! \brief route Правило выбора реплики для чтения: из открытых реплик
+    //! с известным отставанием не больше maxLag выбирается наименее загруженная,
+    //! при равной загрузке - первая, начиная с start
+    //! \param replicas - Состояние реплик
+    //! \param start - Номер реплики, с которой начинается обход
+    //! \param maxLag - Максимальное отставание в мс
+    //! \return Номер реплики или -1, если подходящих нет
+    //!
+    static int route(const QList<ReplicaInfo> & replicas, int start, qint64 maxLag);
+
+    //!
+    //! \brief lagOf Правило расчета отставания по результату запроса к реплике
+    //! \param record - Строка с колонками in_recovery, receiver_status,
+    //! receipt_age_ms и lag_ms
+    //! \param receiverTimeout - Сколько мс WAL receiver может не получать сообщений
+    //! \return Отставание в мс или -1, если сервер не реплика, WAL receiver
+    //! не работает или давно ничего не получал, или отставание неизвестно
+    //!
+    static qint64 lagOf(const QJsonObject & record, qint64 receiverTimeout);
+
+    //!
+    //! \brief noteWrite Метод, сообщающий о записи в обход основного коннектора.
+    //! Запросы на запись через primary() учитываются автоматически
+    //!
+    void noteWrite();
+
+    //!
+    //! \brief isSticky
+    //! \return true, если после недавней записи чтение идет с основного сервера
+    //!
+    bool isSticky() const;
+
+    //!
+    //! \brief maxLag
+    //! \return Максимальное отставание реплики в мс, при котором на нее идет чтение
+    //!
+    qint64 maxLag() const;
+    void setMaxLag(qint64 ms);
+
+    //!
+    //! \brief stickiness
+    //! \return Время после локальной записи в мс, в течение которого
+    //! чтение идет с основного сервера. 0 - выключено
+    //!
+    qint64 stickiness() const;
+    void setStickiness(qint64 ms);
+
+    //!
+    //! \brief receiverTimeout
+    //! \return Сколько мс WAL receiver реплики может не получать сообщений
+    //! от основного сервера, прежде чем реплика считается неисправной.
+    //! По умолчанию 60000, как wal_sender_timeout
+    //!
+    qint64 receiverTimeout() const;
+    void setReceiverTimeout(qint64 ms);
+
+    //!
+    //! \brief setLagCheckInterval Метод для задания периода проверки отставания реплик
+    //! \param ms - Период в мс. 0 - не проверять
+    //!
+    void setLagCheckInterval(int ms);
+
+public slots:
+    //!
+    //! \brief checkLag Слот, отправляющий на реплики запрос об их отставании
+    //!
+    void checkLag();
+
+signals:
+    //!
+    //! \brief replicaLagChanged Сигнал того, что известно новое отставание реплики
+    //! \param connectionName - Имя соединения реплики
+    //! \param lagMs - Отставание в мс
+    //!
+    void replicaLagChanged(const QString & connectionName, qint64 lagMs);
+
+private:
+    //!
+    //! \brief onLagQueryFinished Метод обработки результата запроса об отставании
+    //! \param index - Номер реплики
+    //!
+    void onLagQueryFinished(int index, const QueryResult & result);
+
+    //!
+    //! \brief _primary
+    //! Коннектор к основному серверу
+    SqlDatabaseConnector * _primary { nullptr };
+
+    //!
+    //! \brief _replicas
+    //! Реплики
+    QList<ReplicaInfo> _replicas;
+
+    //!
+    //! \brief _lagQueries
+    //! Номера реплик, запрос об отставании которых еще не вернулся
+    QSet<int> _lagQueries;
+
+    //!
+    //! \brief _lastWrite
+    //! Время с последней локальной записи
+    QElapsedTimer _lastWrite;
+
+    //!
+    //! \brief _lagTimer
+    //! Таймер проверки отставания
+    QTimer _lagTimer;
+
+    //!
+    //! \brief _next
+    //! Номер реплики, с которой начинается выбор (для равномерности)
+    int _next { 0 };
+
+    qint64 _maxLag { 5000 };
+    qint64 _stickiness { 0 };
+    qint64 _receiverTimeout { 60000 };
+};
@@ -0,0 +1,202 @@
+#pragma once
+#include <QObject>
+#include <QPointer>
+#include <QVector>
+#include <QHash>
+#include "ISqlTableManager.h"
+#include "SqlValue.h"
+
+
+//!
+//! \brief The SqlFilter struct
+//! \author Ivanov GD
+//!
+//! Условие поиска по одной колонке. Условия списка объединяются через И.
+//! Значения сравниваются через SqlValue::compare (5 и 5.0 равны)
+//!
+struct SqlFilter
+{
+    enum Kind
+    {
+        Equals,
+        //! Значение между min и max включительно. Null - граница не задана
+        Range,
+        In,
+        //! Подстрока без учета регистра. Колонка должна быть текстовой в индексе
+        Contains,
+    };
+
+    Kind kind { Equals };
+    QString column;
+    SqlValue min;
+    SqlValue max;
+    QVector<SqlValue> values;
+    QString text;
+
+    static SqlFilter equals(const QString & column, const SqlValue & value);
+    static SqlFilter range(const QString & column, const SqlValue & min, const SqlValue & max);
+    static SqlFilter in(const QString & column, const QVector<SqlValue> & values);
+    static SqlFilter contains(const QString & column, const QString & text);
+};
+
+
+
+//!
+//! \brief The SqlSearchIndex class
+//! \author Ivanov GD
+//!
+//! Индекс для фильтрации и поиска подстроки по элементам менеджера
+//! без обхода items() и value(name).toString() на каждое нажатие клавиши.
+//!
+//! Значения выбранных колонок хранятся по колонкам в виде SqlValue,
+//! для текстовых колонок дополнительно строится индекс триграмм
+//! (строки в нижнем регистре). Поиск подстроки от 3 символов берет
+//! кандидатов из самого редкого триграмма запроса и проверяет их,
+//! остальные условия проверяются по хранимым значениям.
+//!
+//! Индекс обновляется по сигналу ISqlTableManager::itemsChanged().
+//! Устаревшие записи триграмм не удаляются сразу (кандидаты все равно
+//! проверяются), а вычищаются, когда их становится больше живых.
+//!
+//! Пример:
+//! -- auto index = new SqlSearchIndex(manager, {"client", "amount"}, {"client"}, this);
+//! -- auto query = index->compile({ SqlFilter::contains("client", text),
+//! --                               SqlFilter::range("amount", 10, SqlValue()) });
+//! -- QStringList uuids = index->find(query, 1000);
+//!
+class SqlSearchIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    //!
+    //! \brief The Query class
+    //! Условия, заранее привязанные к колонкам индекса (см. compile)
+    class Query
+    {
+    public:
+        bool isValid() const { return _valid; }
+
+    private:
+        friend class SqlSearchIndex;
+
+        struct Predicate
+        {
+            SqlFilter::Kind kind;
+            int column;
+            //! Номер текстовой колонки для Contains, иначе -1
+            int textColumn;
+            SqlValue min;
+            SqlValue max;
+            //! Отсортированы для двоичного поиска
+            QVector<SqlValue> values;
+            QString text;
+        };
+
+        QVector<Predicate> _predicates;
+        bool _valid { true };
+    };
+
+    //!
+    //! \brief SqlSearchIndex Конструктор
+    //! \param manager - Менеджер таблицы
+    //! \param columns - Колонки (из sqlFields()), по которым можно фильтровать
+    //! \param textColumns - Колонки, по которым можно искать подстроку
+    //! (добавляются к columns, если их там нет)
+    //! \param parent - Указатель на родителя QObject
+    //!
+    SqlSearchIndex(ISqlTableManager * manager, const QStringList & columns,
+                   const QStringList & textColumns = QStringList(), QObject * parent = nullptr);
+
+    //!
+    //! \brief compile Метод подготовки условий к поиску
+    //! \param filters - Условия (объединяются через И)
+    //! \return Подготовленный запрос. Недействителен, если колонки нет в индексе
+    //!
+    Query compile(const QList<SqlFilter> & filters) const;
+
+    //!
+    //! \brief find Метод поиска элементов
+    //! \param query - Подготовленный запрос
+    //! \param limit - Сколько идентификаторов вернуть. -1 - все
+    //! \return Идентификаторы подходящих элементов
+    //!
+    QStringList find(const Query & query, int limit = -1) const;
+
+    //!
+    //! \brief find То же, с подготовкой условий
+    //!
+    QStringList find(const QList<SqlFilter> & filters, int limit = -1) const;
+
+    //!
+    //! \brief count
+    //! \return Количество элементов в индексе
+    //!
+    int count() const;
+
+    //!
+    //! \brief memoryUsage Метод оценки памяти индекса
+    //! \return Оценка в байтах. Считается без обхода элементов
+    //!
+    //! После каждого изменения оценка передается менеджеру
+    //! (см. ISqlTableManager::reportIndexMemory)
+    qint64 memoryUsage() const;
+
+public slots:
+    //!
+    //! \brief rebuild Слот полного перестроения индекса
+    //!
+    void rebuild();
+
+signals:
+    //!
+    //! \brief changed Сигнал того, что индекс обновился и результаты
+    //! поиска могли измениться
+    //!
+    void changed();
+
+private:
+    void onItemsChanged(const QStringList & inserted, const QStringList & updated,
+                        const QStringList & removed);
+    void clear();
+    void store(const QString & uuid, const ISqlTableItem::ptr & item);
+    void release(const QString & uuid);
+    void indexText(int textColumn, int slot, const QString & folded);
+    void rebuildTrigrams();
+    bool matches(const Query & query, int slot) const;
+    void reportMemory();
+
+    static quint64 trigram(const QChar * text);
+
+    QPointer<ISqlTableManager> _manager;
+    QVector<QByteArray> _columnNames;
+    //! Номер колонки в _columnNames для каждой текстовой колонки
+    QVector<int> _textColumns;
+
+    //!
+    //! \brief _uuids
+    //! Идентификатор элемента в каждой ячейке. Пустой - ячейка свободна
+    QVector<QString> _uuids;
+    QHash<QString, int> _slots;
+    QVector<int> _freeSlots;
+
+    //!
+    //! \brief _values
+    //! Значения по колонкам: _values[колонка][ячейка]
+    QVector<QVector<SqlValue>> _values;
+
+    //!
+    //! \brief _folded
+    //! Текст в нижнем регистре: _folded[текстовая колонка][ячейка]
+    QVector<QVector<QString>> _folded;
+
+    //!
+    //! \brief _trigrams
+    //! Ячейки по триграмму для каждой текстовой колонки
+    QVector<QHash<quint64, QVector<int>>> _trigrams;
+
+    int _livePostings { 0 };
+    int _stalePostings { 0 };
+    //! Размер строк _folded
+    qint64 _foldedBytes { 0 };
+};
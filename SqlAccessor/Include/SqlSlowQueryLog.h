@@ -0,0 +1,132 @@
+#pragma once
+#include <QString>
+#include <QUuid>
+#include <QDateTime>
+#include <QVector>
+#include <QList>
+#include <QMutex>
+#include <QAtomicInt>
+
+class QIODevice;
+
+
+//!
+//! \brief The SqlSlowQueryLog class
+//! \author Ivanov GD
+//!
+//! Журнал медленных запросов коннектора: последние запросы, выполнявшиеся
+//! дольше порога, в кольцевом буфере фиксированного размера.
+//! План запроса (EXPLAIN) добавляется к записи позже, когда он получен
+//! по отдельному соединению (см. SqlDatabaseConnector::setSlowQueryExplain).
+//!
+//! Методы можно вызывать из любого потока
+class SqlSlowQueryLog
+{
+public:
+    //!
+    //! \brief The Entry struct
+    //! Запись о медленном запросе
+    struct Entry
+    {
+        QUuid     uuid;
+        QDateTime startedAt;
+        QString   query;
+        //! Ожидание в очереди, мс
+        qint64    waitMs { 0 };
+        //! Выполнение exec(), мс
+        qint64    executeMs { 0 };
+        //! Чтение строк результата, мс
+        qint64    fetchMs { 0 };
+        //! Строк в результате или затронуто запросом
+        int       rows { 0 };
+        QString   error;
+        //! Вывод EXPLAIN, если он был получен
+        QString   plan;
+
+        qint64 totalMs() const { return executeMs + fetchMs; }
+    };
+
+    //!
+    //! \brief SqlSlowQueryLog Конструктор
+    //! \param capacity - Сколько последних записей хранить
+    //!
+    explicit SqlSlowQueryLog(int capacity = 256);
+
+    //!
+    //! \brief threshold
+    //! \return Порог в мс, начиная с которого запрос записывается. 0 - журнал выключен
+    //!
+    qint64 threshold() const;
+    void setThreshold(qint64 ms);
+
+    //!
+    //! \brief isSlow
+    //! \param ms - Время выполнения запроса
+    //! \return true/false - Нужно ли записать запрос
+    //!
+    bool isSlow(qint64 ms) const;
+
+    int capacity() const;
+
+    //!
+    //! \brief setCapacity Метод изменения размера буфера. Последние записи сохраняются
+    //!
+    void setCapacity(int capacity);
+
+    //!
+    //! \brief record Метод записи запроса. Самая старая запись вытесняется
+    //!
+    void record(const Entry & entry);
+
+    //!
+    //! \brief attachPlan Метод добавления плана к записи, если она еще в буфере
+    //! \param uuid - Идентификатор запроса
+    //! \param plan - Вывод EXPLAIN
+    //!
+    void attachPlan(const QUuid & uuid, const QString & plan);
+
+    //!
+    //! \brief entries
+    //! \return Записи от старых к новым
+    //!
+    QList<Entry> entries() const;
+
+    //!
+    //! \brief recorded
+    //! \return Сколько запросов было записано всего, включая вытесненные
+    //!
+    quint64 recorded() const;
+
+    //!
+    //! \brief memoryUsage
+    //! \return Оценка памяти, занятой записями, в байтах
+    //!
+    qint64 memoryUsage() const;
+
+    void clear();
+
+    //!
+    //! \brief dump Метод записи журнала в текстовом виде
+    //! \param device - Открытое на запись устройство (файл и т.п.)
+    //! \return true/false - Удалось ли записать
+    //!
+    bool dump(QIODevice * device) const;
+
+    //!
+    //! \brief beginExplain Метод, занимающий место для EXPLAIN.
+    //! Одновременно выполняется только один EXPLAIN
+    //! \return false, если EXPLAIN уже выполняется
+    //!
+    bool beginExplain();
+    void endExplain();
+
+private:
+    mutable QMutex _mutex;
+    QVector<Entry> _entries;
+    //! Позиция следующей записи в _entries
+    int _next { 0 };
+    int _size { 0 };
+    quint64 _recorded { 0 };
+    qint64 _threshold { 0 };
+    QAtomicInt _explaining { 0 };
+};
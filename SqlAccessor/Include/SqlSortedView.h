@@ -0,0 +1,149 @@
+#pragma once
+#include <QObject>
+#include <QPointer>
+#include <QVector>
+#include <QHash>
+#include <QPair>
+#include "ISqlTableManager.h"
+#include "SqlValue.h"
+
+
+//!
+//! \brief The SqlSortedView class
+//! \author Ivanov GD
+//!
+//! Элементы менеджера, отсортированные по одной или нескольким колонкам
+//! из sqlFields(). При равенстве колонок порядок определяет uuid.
+//!
+//! Порядок поддерживается по сигналу ISqlTableManager::itemsChanged():
+//! каждый элемент вставляется, удаляется или переставляется на свое место
+//! двоичным поиском, без пересортировки всего списка. Позиция элемента
+//! по uuid ищется за O(log n). Изменения отдаются сигналами с номерами строк,
+//! которые модель может передать в beginInsertRows()/endInsertRows() и т.п.
+//! Перестановка элемента отдается как удаление и вставка.
+//!
+//! Пример:
+//! -- auto view = new SqlSortedView(manager, {{"client", Qt::AscendingOrder},
+//! --                                         {"price", Qt::DescendingOrder}}, this);
+//! -- connect(view, &SqlSortedView::rowsAboutToBeInserted, model,
+//! --         [model](int first, int last) { model->beginInsert(first, last); });
+//!
+class SqlSortedView : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Column = QPair<QString, Qt::SortOrder>;
+
+    //!
+    //! \brief SqlSortedView Конструктор
+    //! \param manager - Менеджер таблицы
+    //! \param columns - Колонки сортировки и направление
+    //! \param parent - Указатель на родителя QObject
+    //!
+    SqlSortedView(ISqlTableManager * manager, const QList<Column> & columns,
+                  QObject * parent = nullptr);
+
+    //!
+    //! \brief SqlSortedView Конструктор для сортировки по одной колонке
+    //!
+    SqlSortedView(ISqlTableManager * manager, const QString & field,
+                  Qt::SortOrder order = Qt::AscendingOrder, QObject * parent = nullptr);
+
+    //!
+    //! \brief count
+    //! \return Количество элементов
+    //!
+    int count() const;
+
+    //!
+    //! \brief at Метод для получения элемента по позиции
+    //! \param row - Позиция
+    //! \return Элемент или nullptr
+    //!
+    ISqlTableItem::ptr at(int row) const;
+
+    //!
+    //! \brief indexOf Метод поиска позиции элемента за O(log n)
+    //! \param uuid - Идентификатор элемента
+    //! \return Позиция или -1
+    //!
+    int indexOf(const QString & uuid) const;
+
+    //!
+    //! \brief columns
+    //! \return Колонки сортировки
+    //!
+    QList<Column> columns() const;
+
+    //!
+    //! \brief setBatchResetThreshold Метод для задания размера пачки изменений,
+    //! начиная с которого список сортируется заново (с сигналами сброса)
+    //! \param changes - Количество изменений. По умолчанию 1/8 элементов, но не меньше 64
+    //!
+    void setBatchResetThreshold(int changes);
+
+    //!
+    //! \brief memoryUsage Метод оценки памяти списка
+    //! \return Оценка в байтах. Считается без обхода элементов
+    //!
+    //! После каждого изменения оценка передается менеджеру
+    //! (см. ISqlTableManager::reportIndexMemory)
+    qint64 memoryUsage() const;
+
+public slots:
+    //!
+    //! \brief rebuild Слот полной пересортировки
+    //!
+    void rebuild();
+
+signals:
+    void rowsAboutToBeInserted(int first, int last);
+    void rowsInserted(int first, int last);
+    void rowsAboutToBeRemoved(int first, int last);
+    void rowsRemoved(int first, int last);
+
+    //!
+    //! \brief rowsChanged Сигнал того, что поля элементов изменились,
+    //! а их позиции - нет
+    //!
+    void rowsChanged(int first, int last);
+
+    void aboutToBeReset();
+    void reset();
+
+private:
+    //!
+    //! \brief The Entry struct
+    //! Элемент и значения его колонок сортировки
+    struct Entry
+    {
+        QVector<SqlValue> key;
+        QString uuid;
+        ISqlTableItem::ptr item;
+    };
+
+    void onItemsChanged(const QStringList & inserted, const QStringList & updated,
+                        const QStringList & removed);
+    void onItemsReset();
+
+    QVector<SqlValue> keyOf(const ISqlTableItem::ptr & item) const;
+    int compare(const QVector<SqlValue> & key, const QString & uuid, const Entry & entry) const;
+    int lowerBound(const QVector<SqlValue> & key, const QString & uuid) const;
+    void insertEntry(const QString & uuid, const ISqlTableItem::ptr & item);
+    void removeAt(int row);
+    void updateEntry(int row, const ISqlTableItem::ptr & item);
+    void reportMemory();
+
+    QPointer<ISqlTableManager> _manager;
+    QVector<QPair<QByteArray, Qt::SortOrder>> _columns;
+    QVector<Entry> _entries;
+
+    //!
+    //! \brief _keys
+    //! Ключ сортировки по uuid: по нему находится позиция элемента,
+    //! даже если поля элемента уже изменились
+    QHash<QString, QVector<SqlValue>> _keys;
+
+    int _batchResetThreshold { -1 };
+};
@@ -0,0 +1,173 @@
+#pragma once
+#include <QObject>
+#include <QPointer>
+#include <QStringList>
+#include <functional>
+#include "ISqlTableItem.h"
+#include "SqlDatabaseConnector.h"
+
+class QIODevice;
+class ISqlTableManager;
+
+
+//!
+//! \brief The SqlTableExporter class
+//! \author Ivanov GD
+//!
+//! Выгрузка таблицы в компактный двоичный файл и загрузка обратно.
+//!
+//! Файл: заголовок (схема, таблица, колонки), затем блоки строк
+//! по setBatchSize() строк, значения записываются как SqlValue
+//! (тип и значение, без Json и QVariant): bytea - как Bytes,
+//! nan и inf - строками 'NaN', 'Infinity'. numeric и время выгружаются
+//! текстом сервера: double и QDateTime теряют знаки и микросекунды,
+//! а текстовый литерал при загрузке приводится к типу колонки без потерь.
+//! Время из exportItems() - момент в UTC, который при загрузке пишется
+//! литералом со смещением. Память не зависит от размера
+//! таблицы: выгрузка читает строки серверным курсором (DECLARE/FETCH),
+//! загрузка вставляет по одному блоку многострочным INSERT.
+//! COPY ... (FORMAT binary) драйвер QPSQL выполнить не может.
+//!
+//! Работает по своему соединению с параметрами коннектора
+//! в потоке вызывающего, поэтому методы можно вызывать из QtConcurrent::run.
+//!
+//! Пример:
+//! -- QFile file("orders.sqlt");
+//! -- file.open(QIODevice::WriteOnly);
+//! -- SqlTableExporter exporter(connector);
+//! -- if(exporter.exportTable("public", "orders", &file))
+//! --     qDebug() << exporter.stats().rowsPerSecond() << exporter.stats().megabytesPerSecond();
+//!
+class SqlTableExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    //!
+    //! \brief The Stats struct
+    //! Статистика последней выгрузки или загрузки
+    struct Stats
+    {
+        qint64 rows { 0 };
+        //! Байт записано или прочитано
+        qint64 bytes { 0 };
+        qint64 elapsedMs { 0 };
+
+        double rowsPerSecond() const { return elapsedMs > 0 ? rows * 1000.0 / elapsedMs : 0; }
+        double megabytesPerSecond() const
+        {
+            return elapsedMs > 0 ? bytes * 1000.0 / elapsedMs / (1024 * 1024) : 0;
+        }
+    };
+
+    //!
+    //! \brief ItemFactory
+    //! Создает пустой элемент нужного класса для importItems()
+    using ItemFactory = std::function<ISqlTableItem::ptr()>;
+
+    //!
+    //! \brief ItemHandler
+    //! Получает каждый загруженный элемент
+    using ItemHandler = std::function<void(ISqlTableItem::ptr item)>;
+
+    //!
+    //! \brief SqlTableExporter Конструктор
+    //! \param connector - Коннектор, параметры которого используются для соединения
+    //! \param parent - Указатель на родителя QObject
+    //!
+    explicit SqlTableExporter(SqlDatabaseConnector * connector, QObject * parent = nullptr);
+
+    //!
+    //! \brief batchSize
+    //! \return Сколько строк читается и записывается за раз
+    //!
+    int batchSize() const;
+
+    //!
+    //! \brief setBatchSize Метод для задания размера блока
+    //! \param rows - Количество строк. По умолчанию 10000
+    //!
+    void setBatchSize(int rows);
+
+    //!
+    //! \brief exportTable Метод выгрузки таблицы
+    //! \param schema - Название схемы
+    //! \param table - Название таблицы
+    //! \param device - Открытое на запись устройство
+    //! \param where - Условие WHERE без самого слова. Пустое - вся таблица
+    //! \return true/false - Удалось или нет (см. lastError)
+    //!
+    bool exportTable(const QString & schema, const QString & table, QIODevice * device,
+                     const QString & where = QString());
+
+    //!
+    //! \brief importTable Метод загрузки строк в таблицу одной транзакцией
+    //! \param device - Открытое на чтение устройство
+    //! \param schema - Название схемы. Пустое - из файла
+    //! \param table - Название таблицы. Пустое - из файла
+    //! \return true/false - Удалось или нет. При ошибке транзакция откатывается
+    //!
+    bool importTable(QIODevice * device, const QString & schema = QString(),
+                     const QString & table = QString());
+
+    //!
+    //! \brief exportItems Метод выгрузки загруженных элементов менеджера
+    //! через ISqlTableItem::toJsonObject(), без обращения к базе
+    //! \param manager - Менеджер таблицы. Выгружается его последний снимок
+    //! \param device - Открытое на запись устройство
+    //! \return true/false - Удалось или нет
+    //!
+    bool exportItems(ISqlTableManager * manager, QIODevice * device);
+
+    //!
+    //! \brief importItems Метод чтения файла в элементы через ISqlTableItem::fromJsonObject()
+    //! \param device - Открытое на чтение устройство
+    //! \param create - Создает пустой элемент
+    //! \param handler - Получает каждый элемент, элементы не накапливаются
+    //! \return true/false - Удалось или нет
+    //!
+    bool importItems(QIODevice * device, ItemFactory create, ItemHandler handler);
+
+    //!
+    //! \brief stats
+    //! \return Статистика последней выгрузки или загрузки
+    //!
+    Stats stats() const;
+
+    //!
+    //! \brief lastError
+    //! \return Текст последней ошибки
+    //!
+    QString lastError() const;
+
+signals:
+    //!
+    //! \brief progress Сигнал после каждого блока строк
+    //! \param rows - Строк обработано
+    //! \param bytes - Байт обработано
+    //!
+    void progress(qint64 rows, qint64 bytes);
+
+private:
+    //!
+    //! \brief The Header struct
+    //! Заголовок файла
+    struct Header
+    {
+        QString schema;
+        QString table;
+        QStringList columns;
+    };
+
+    bool fail(const QString & error);
+    bool writeHeader(QIODevice * device, const Header & header);
+    bool writeBlock(QIODevice * device, qint32 rows, const QByteArray & block);
+    bool readHeader(QDataStream & stream, Header & header);
+    void finishBlock(qint64 rows, qint64 bytes);
+
+    QPointer<SqlDatabaseConnector> _connector;
+    int _batchSize { 10000 };
+    Stats _stats;
+    QElapsedTimer _timer;
+    QString _lastError;
+};
@@ -0,0 +1,466 @@
+#pragma once
+#include <QObject>
+#include <QPointer>
+#include <QHash>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QDateTime>
+#include <QtNumeric>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#include "SqlDatabaseConnector.h"
+#include "SqlChangeFetcher.h"
+#include "SqlNotificationTrigger.h"
+
+
+//!
+//! \brief The SqlTableManagerBase class
+//! \author Ivanov GD
+//!
+//! Нешаблонная часть SqlTableManager: сигналы, запросы, подписка
+//! на уведомления таблицы и дочитывание строк формата ChangePointer.
+//! Шаблоны не могут содержать Q_OBJECT, поэтому все сигналы здесь
+//!
+class SqlTableManagerBase : public QObject
+{
+    Q_OBJECT
+
+public:
+    //!
+    //! \brief SqlTableManagerBase Конструктор
+    //! \param connector - Указатель на коннектор к БД
+    //! \param schema - Название схемы
+    //! \param table - Название таблицы
+    //! \param parent - Указатель на родителя QObject
+    //!
+    SqlTableManagerBase(SqlDatabaseConnector * connector, const QString & schema,
+                        const QString & table, QObject * parent = nullptr);
+
+    //!
+    //! Деструктор. Сообщает коннектору, что за таблицей больше не следят
+    ~SqlTableManagerBase();
+
+    //!
+    //! \brief tableScheme
+    //! \return Название схемы в БД
+    //!
+    const QString & tableScheme() const;
+
+    //!
+    //! \brief tableName
+    //! \return Название таблицы в БД
+    //!
+    const QString & tableName() const;
+
+    //!
+    //! \brief load Метод для загрузки строк из БД
+    //!
+    void load();
+
+    //!
+    //! \brief changeFetcher
+    //! \return Объект, дочитывающий строки по уведомлениям формата ChangePointer
+    //!
+    SqlChangeFetcher * changeFetcher() const;
+
+protected:
+    //!
+    //! \brief selectQuery
+    //! \return Текст запроса SELECT всех строк
+    //!
+    virtual QString selectQuery() const = 0;
+
+    //!
+    //! \brief applyRecords Метод замены всех строк результатом SELECT
+    //! \param records - Записи
+    //!
+    virtual void applyRecords(const QList<QJsonObject> & records) = 0;
+
+    //!
+    //! \brief applyNotification Метод применения уведомления формата FullRow
+    //! или ColumnDiff. Сигналы не отправляет
+    //! \return false, если применять нечего (строка дочитывается из базы)
+    //!
+    virtual bool applyNotification(const SqlNotification & notif) = 0;
+
+    //!
+    //! \brief sendQuery Метод для отправки запроса в БД. Результат SELECT
+    //! передается в applyRecords()
+    //! \param query - Строка запроса
+    //!
+    void sendQuery(const QString & query);
+
+    //!
+    //! \brief onQueryResult Метод обработки результата запроса
+    //!
+    void onQueryResult(const QueryResult & result);
+
+    //!
+    //! \brief onNotification Метод обработки уведомления из базы
+    //!
+    void onNotification(const SqlNotification & notif);
+
+    //!
+    //! \brief onChangesResolved Метод применения пачки дочитанных строк
+    //!
+    void onChangesResolved(const QList<SqlNotification> & notifications);
+
+    QPointer<SqlDatabaseConnector> _connector;
+    QString _schema;
+    QString _table;
+    SqlChangeFetcher * _changeFetcher { nullptr };
+
+signals:
+    //!
+    //! \brief updated Сигнал того, что данные в менеджере обновились
+    //!
+    void updated();
+
+    //!
+    //! \brief rowChanged Сигнал того, что строка изменилась по уведомлению
+    //! \param uuid - Идентификатор строки
+    //! \param action - Действие
+    //!
+    void rowChanged(const QString & uuid, SqlNotification::ActionType action);
+};
+
+
+
+//!
+//! \brief The SqlFieldTraits struct
+//! Преобразование значения поля строки из Json (как его отдает коннектор)
+//! и в литерал SQL, без QVariant.
+//! Для своих типов добавьте специализацию с теми же двумя функциями
+//!
+template<typename T>
+struct SqlFieldTraits
+{
+    static_assert(sizeof(T) == 0, "SqlFieldTraits is not specialized for this field type");
+};
+
+template<>
+struct SqlFieldTraits<int>
+{
+    static int fromJson(const QJsonValue & value) { return value.toInt(); }
+    static QString toSql(int value) { return QString::number(value); }
+};
+
+template<>
+struct SqlFieldTraits<qint64>
+{
+    // Числа в Json - double, поэтому точно передаются только значения до 2^53
+    static qint64 fromJson(const QJsonValue & value)
+    {
+        return value.isString() ? value.toString().toLongLong() : qint64(value.toDouble());
+    }
+    static QString toSql(qint64 value) { return QString::number(value); }
+};
+
+template<>
+struct SqlFieldTraits<double>
+{
+    static double fromJson(const QJsonValue & value)
+    {
+        return value.isString() ? value.toString().toDouble() : value.toDouble();
+    }
+    static QString toSql(double value)
+    {
+        // nan и inf PostgreSQL принимает только как строки
+        if(qIsNaN(value))
+            return QStringLiteral("'NaN'");
+        if(qIsInf(value))
+            return value > 0 ? QStringLiteral("'Infinity'") : QStringLiteral("'-Infinity'");
+        return QString::number(value, 'g', 17);
+    }
+};
+
+template<>
+struct SqlFieldTraits<bool>
+{
+    static bool fromJson(const QJsonValue & value) { return value.toBool(); }
+    static QString toSql(bool value) { return value ? "true" : "false"; }
+};
+
+template<>
+struct SqlFieldTraits<QString>
+{
+    // NULL из базы приходит как null QString и уходит обратно как NULL, а не ''
+    static QString fromJson(const QJsonValue & value) { return value.isNull() ? QString() : value.toString(); }
+    static QString toSql(const QString & value)
+    {
+        return value.isNull() ? QStringLiteral("NULL") : SqlNotificationTrigger::quoteLiteral(value);
+    }
+};
+
+template<>
+struct SqlFieldTraits<QDateTime>
+{
+    static QDateTime fromJson(const QJsonValue & value) { return QDateTime::fromString(value.toString(), Qt::ISODateWithMs); }
+    static QString toSql(const QDateTime & value)
+    {
+        return value.isValid() ? SqlNotificationTrigger::quoteLiteral(value.toString(Qt::ISODateWithMs)) : "NULL";
+    }
+};
+
+
+
+template<>
+struct SqlFieldTraits<SqlValue>
+{
+    static SqlValue fromJson(const QJsonValue & value) { return SqlValue::fromJson(value); }
+    static QString toSql(const SqlValue & value) { return value.toSqlLiteral(); }
+};
+
+
+
+//!
+//! \brief The SqlColumn struct
+//! Описание колонки строки: название в базе и поле структуры
+//!
+template<typename Row, typename T>
+struct SqlColumn
+{
+    using Type = T;
+    const char * name;
+    T Row::* member;
+};
+
+//!
+//! \brief sqlColumn Вспомогательная функция, выводящая типы колонки
+//!
+template<typename Row, typename T>
+constexpr SqlColumn<Row, T> sqlColumn(const char * name, T Row::* member)
+{
+    return SqlColumn<Row, T> { name, member };
+}
+
+
+
+//!
+//! \brief The SqlTableManager class
+//! \author Ivanov GD
+//!
+//! Типизированный менеджер таблицы. Вместо ISqlTableItem с Q_PROPERTY
+//! строка - обычная структура с полем uuid и списком колонок columns,
+//! известным на этапе компиляции. Запросы, разбор результата SELECT
+//! и уведомлений разворачиваются для каждой колонки отдельно,
+//! без QMetaProperty и QVariant; строки хранятся по значению.
+//!
+//! Работает рядом с ISqlTableManager, с теми же триггерами уведомлений
+//! (все форматы SqlNotification::PayloadFormat).
+//!
+//! Пример:
+//! -- struct OrderRow
+//! -- {
+//! --     QString uuid;
+//! --     QString client;
+//! --     int amount { 0 };
+//! --     double price { 0 };
+//! --
+//! --     static constexpr auto columns = std::make_tuple(
+//! --         sqlColumn("client", &OrderRow::client),
+//! --         sqlColumn("amount", &OrderRow::amount),
+//! --         sqlColumn("price",  &OrderRow::price));
+//! -- };
+//! --
+//! -- auto orders = new SqlTableManager<OrderRow>(connector, "shop", "orders", this);
+//! -- orders->load();
+//!
+template<typename Row>
+class SqlTableManager : public SqlTableManagerBase
+{
+public:
+    using Rows = QHash<QString, Row>;
+
+    SqlTableManager(SqlDatabaseConnector * connector, const QString & schema,
+                    const QString & table, QObject * parent = nullptr) :
+        SqlTableManagerBase(connector, schema, table, parent)
+    {
+        _changeFetcher->setColumns(columnList());
+    }
+
+    //!
+    //! \brief columnList
+    //! \return Список колонок через запятую, включая _uuid.
+    //! Собирается один раз для типа строки
+    //!
+    static const QString & columnList()
+    {
+        static const QString list = [] {
+            QStringList names;
+            forEachColumn([&names](const auto & column) { names << QLatin1String(column.name); });
+            names << QStringLiteral("_uuid");
+            return names.join(", ");
+        }();
+        return list;
+    }
+
+    //!
+    //! \brief decode Метод записи в строку колонок, которые есть в записи.
+    //! Колонок, которых нет (например, в уведомлении ColumnDiff), не касается
+    //! \param record - Запись
+    //! \param row - Строка
+    //! \return Количество записанных колонок
+    //!
+    static int decode(const QJsonObject & record, Row & row)
+    {
+        int applied = 0;
+        auto uuid = record.constFind(QLatin1String("_uuid"));
+        if(uuid != record.constEnd())
+            row.uuid = uuid.value().toString();
+
+        forEachColumn([&](const auto & column) {
+            using T = typename std::decay_t<decltype(column)>::Type;
+            auto it = record.constFind(QLatin1String(column.name));
+            if(it == record.constEnd())
+                return;
+            row.*(column.member) = SqlFieldTraits<T>::fromJson(it.value());
+            applied++;
+        });
+        return applied;
+    }
+
+    //!
+    //! \brief values Метод получения значений колонок строки в виде литералов SQL
+    //! \param row - Строка
+    //! \return Значения в порядке columnList(), без _uuid
+    //!
+    static QStringList values(const Row & row)
+    {
+        QStringList out;
+        out.reserve(int(std::tuple_size<decltype(Row::columns)>::value));
+        forEachColumn([&](const auto & column) {
+            using T = typename std::decay_t<decltype(column)>::Type;
+            out << SqlFieldTraits<T>::toSql(row.*(column.member));
+        });
+        return out;
+    }
+
+    QString selectQuery() const override
+    {
+        return QString("SELECT %1 FROM %2.%3;").arg(columnList(), _schema, _table);
+    }
+
+    QString insertQuery(const Row & row) const
+    {
+        return QString("INSERT INTO %1.%2 (%3) VALUES (%4, %5);")
+                .arg(_schema, _table, columnList(),
+                     values(row).join(", "),
+                     SqlFieldTraits<QString>::toSql(row.uuid));
+    }
+
+    QString updateQuery(const Row & row) const
+    {
+        QStringList assignments;
+        const QStringList vals = values(row);
+        int i = 0;
+        forEachColumn([&](const auto & column) {
+            assignments << QString("%1=%2").arg(QLatin1String(column.name), vals[i++]);
+        });
+        return QString("UPDATE %1.%2 SET %3 WHERE _uuid=%4;")
+                .arg(_schema, _table, assignments.join(", "),
+                     SqlFieldTraits<QString>::toSql(row.uuid));
+    }
+
+    QString deleteQuery(const Row & row) const
+    {
+        return QString("DELETE FROM %1.%2 WHERE _uuid=%3;")
+                .arg(_schema, _table, SqlFieldTraits<QString>::toSql(row.uuid));
+    }
+
+    //!
+    //! \brief insert, update, remove Методы изменения строки в БД.
+    //! Строки в менеджере меняются по уведомлению
+    //!
+    void insert(const Row & row) { sendQuery(insertQuery(row)); }
+    void update(const Row & row) { sendQuery(updateQuery(row)); }
+    void remove(const Row & row) { sendQuery(deleteQuery(row)); }
+
+    //!
+    //! \brief row Метод для получения конкретной строки
+    //! \param uuid - Идентификатор строки
+    //! \return Указатель на строку или nullptr. Действителен до следующего изменения строк
+    //!
+    const Row * row(const QString & uuid) const
+    {
+        auto it = _rows.constFind(uuid);
+        return it == _rows.constEnd() ? nullptr : &it.value();
+    }
+
+    //!
+    //! \brief rows
+    //! \return Все строки по идентификаторам, без копирования
+    //!
+    const Rows & rows() const { return _rows; }
+
+    //!
+    //! \brief count
+    //! \return Количество строк
+    //!
+    int count() const { return _rows.size(); }
+
+protected:
+    void applyRecords(const QList<QJsonObject> & records) override
+    {
+        Rows rows;
+        rows.reserve(records.size());
+        for(const auto & record: records)
+        {
+            Row row;
+            decode(record, row);
+            rows.insert(row.uuid, std::move(row));
+        }
+        _rows.swap(rows);
+    }
+
+    bool applyNotification(const SqlNotification & notif) override
+    {
+        switch(notif.actionType)
+        {
+        case SqlNotification::INSERT:
+        {
+            Row row;
+            decode(notif.data, row);
+            _rows.insert(notif.itemUuid, std::move(row));
+        }
+        break;
+        case SqlNotification::UPDATE:
+        {
+            auto it = _rows.find(notif.itemUuid);
+            if(it == _rows.end())
+            {
+                if(notif.format != SqlNotification::ColumnDiff)
+                {
+                    Row row;
+                    decode(notif.data, row);
+                    _rows.insert(notif.itemUuid, std::move(row));
+                    break;
+                }
+                // Из одних изменений строку не собрать - дочитываем целиком
+                SqlNotification pointer = notif;
+                pointer.format = SqlNotification::ChangePointer;
+                pointer.actionType = SqlNotification::INSERT;
+                _changeFetcher->enqueue(pointer);
+                return false;
+            }
+            // FullRow и ColumnDiff применяются одинаково: записываются пришедшие колонки
+            decode(notif.data, it.value());
+        }
+        break;
+        case SqlNotification::DELETE:
+            _rows.remove(notif.itemUuid);
+        break;
+        }
+        return true;
+    }
+
+private:
+    template<typename F>
+    static void forEachColumn(F && f)
+    {
+        std::apply([&f](const auto & ... column) { (f(column), ...); }, Row::columns);
+    }
+
+    Rows _rows;
+};
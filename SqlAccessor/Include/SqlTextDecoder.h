@@ -0,0 +1,128 @@
+#pragma once
+#include <QVector>
+#include <QString>
+#include <QVariant>
+#include <QSqlRecord>
+#include <QJsonObject>
+#include <QTextCodec>
+#include "SqlValue.h"
+
+
+//!
+//! \brief The SqlTextDecoder class
+//! \author Ivanov GD
+//!
+//! Класс, отвечающий за перекодировку текстовых данных, пришедших
+//! из базы данных с кодировкой, отличной от UTF-8
+//!
+//! Перекодируются только текстовые колонки. Если строка состоит
+//! только из 7-битных символов, или кодировщик и так UTF-8,
+//! кодировщик не вызывается и данные не копируются
+class SqlTextDecoder
+{
+public:
+    //!
+    //! \brief The Plan struct
+    //! План преобразования колонок результата запроса.
+    //! Строится один раз на результат запроса методом plan()
+    struct Plan
+    {
+        //!
+        //! \brief fieldNames
+        //! Названия колонок
+        QVector<QString> fieldNames;
+        //!
+        //! \brief textColumns
+        //! true - колонка текстовая и ее нужно перекодировать
+        QVector<bool> textColumns;
+    };
+
+    //!
+    //! \brief SqlTextDecoder Конструктор
+    //! \param codec - Кодировщик. nullptr - без перекодировки
+    //!
+    explicit SqlTextDecoder(QTextCodec * codec = nullptr);
+
+    //!
+    //! \brief codec
+    //! \return Кодировщик
+    //!
+    QTextCodec * codec() const;
+
+    //!
+    //! \brief setCodec Метод для установки кодировщика
+    //! \param codec - Кодировщик. nullptr - без перекодировки
+    //!
+    void setCodec(QTextCodec * codec);
+
+    //!
+    //! \brief isPassthrough
+    //! \return true, если перекодировка не нужна вообще
+    //! (кодировщик не установлен или он и так UTF-8)
+    //!
+    bool isPassthrough() const;
+
+    //!
+    //! \brief plan Метод для построения плана преобразования колонок
+    //! \param record - Запись с описанием колонок результата
+    //! \return План
+    //!
+    Plan plan(const QSqlRecord & record) const;
+
+    //!
+    //! \brief recordToJson Метод для преобразования записи в Json
+    //! \param record - Запись
+    //! \param plan - План, построенный методом plan() для этого результата
+    //! \return Данные в формате Json
+    //!
+    QJsonObject recordToJson(const QSqlRecord & record, const Plan & plan) const;
+
+    //!
+    //! \brief recordToValues Метод для преобразования записи в значения SqlValue
+    //! \param record - Запись
+    //! \param plan - План, построенный методом plan() для этого результата
+    //! \return Значения в порядке колонок
+    //!
+    QVector<SqlValue> recordToValues(const QSqlRecord & record, const Plan & plan) const;
+
+    //!
+    //! \brief decodeText Метод для перекодировки строки
+    //! \param text - Строка в том виде, в каком ее отдал драйвер
+    //! \return Перекодированная строка
+    //!
+    QString decodeText(const QString & text) const;
+
+    //!
+    //! \brief decodePayload Метод для перекодировки данных уведомления
+    //! \param payload - Данные уведомления
+    //! \return Данные в UTF-8, пригодные для QJsonDocument::fromJson
+    //!
+    QByteArray decodePayload(const QVariant & payload) const;
+
+    //!
+    //! \brief isAscii Проверка, что все байты 7-битные
+    //!
+    static bool isAscii(const char * data, int size);
+
+    //!
+    //! \brief isAscii Проверка, что все символы 7-битные
+    //!
+    static bool isAscii(const QChar * data, int size);
+
+private:
+    //!
+    //! \brief _codec
+    //! Кодировщик
+    QTextCodec * _codec { nullptr };
+
+    //!
+    //! \brief _passthrough
+    //! Перекодировка не нужна
+    bool _passthrough { true };
+
+    //!
+    //! \brief _asciiCompatible
+    //! Кодировка совпадает с ASCII на 7-битных символах,
+    //! значит такие строки можно не перекодировать
+    bool _asciiCompatible { true };
+};
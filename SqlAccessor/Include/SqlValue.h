@@ -1,20 +1,149 @@
 #pragma once
 #include <QVariant>
 #include <QSqlField>
+#include <QString>
+#include <QUuid>
+#include <QDateTime>
+#include <QJsonValue>
+#include <QMetaType>
+#include <QDataStream>
 
 
+//!
+//! \brief The SqlValue class
+//! \author Ivanov GD
+//!
+//! Компактное значение ячейки для основных типов PostgreSQL:
+//! int4, int8, float8, bool, uuid, timestamp, text и bytea.
+//!
+//! Занимает 32 байта и не выделяет память, кроме текста длиннее
+//! InlineTextSize символов и bytea (они хранятся в QString и QByteArray
+//! с неявным разделением).
+//! Преобразование из QSqlField и QVariant читает значение напрямую,
+//! без промежуточных преобразований QVariant.
+//!
+//! Пример:
+//! -- SqlValue value(query.record().field("amount"));
+//! -- if(value.type() == SqlValue::Int32)
+//! --     sum += value.toInt();
+//!
 class SqlValue
 {
 public:
+    //!
+    //! \brief The Type enum
+    //! Тип хранимого значения
+    enum Type : quint8
+    {
+        Null,
+        Int32,
+        Int64,
+        Float64,
+        Bool,
+        Uuid,
+        //! Миллисекунды от начала эпохи и Qt::TimeSpec
+        Timestamp,
+        Text,
+        //! bytea. В тексте и литерале SQL - шестнадцатеричный вид \x...
+        Bytes,
+    };
+
+    //!
+    //! \brief InlineTextSize
+    //! Текст до этой длины (в QChar) хранится внутри значения
+    static constexpr int InlineTextSize = 11;
+
     SqlValue();
+    SqlValue(qint32 value);
+    SqlValue(qint64 value);
+    SqlValue(double value);
+    SqlValue(bool value);
+    SqlValue(const QUuid & value);
+    SqlValue(const QDateTime & value);
+    SqlValue(const QString & value);
+    SqlValue(const char * value);
+    SqlValue(const QByteArray & value);
 
+    //!
+    //! \brief SqlValue Конструктор из поля записи QSqlQuery
+    //!
     explicit SqlValue(const QSqlField & field);
     SqlValue(const SqlValue & other);
+    SqlValue(SqlValue && other) noexcept;
     SqlValue(const QVariant & other);
+    ~SqlValue();
+
+    SqlValue & operator = (const SqlValue & other);
+    SqlValue & operator = (SqlValue && other) noexcept;
+
+    //!
+    //! \brief fromJson Метод преобразования значения из Json (записи QueryResult,
+    //! данные SqlNotification). Числа без дробной части становятся Int32/Int64,
+    //! если помещаются в qint64, иначе остаются Float64
+    //!
+    static SqlValue fromJson(const QJsonValue & value);
+
+    Type type() const;
+    bool isNull() const;
+
+    qint32    toInt() const;
+    qint64    toLongLong() const;
+    double    toDouble() const;
+    bool      toBool() const;
+    QUuid     toUuid() const;
+    QDateTime toDateTime() const;
+    QString   toString() const;
+    QByteArray toByteArray() const;
+
+    QVariant   toVariant() const;
+    QJsonValue toJson() const;
+
+    //!
+    //! \brief toSqlLiteral
+    //! \return Значение в виде литерала SQL ('text', 42, true, NULL ...).
+    //! Timestamp - со смещением от UTC, nan и inf - в кавычках ('NaN', 'Infinity')
+    //!
+    QString toSqlLiteral() const;
+
+    //!
+    //! \brief heapSize
+    //! \return Сколько байт значение занимает вне себя (длинный текст), оценка
+    //!
+    qint64 heapSize() const;
+
+    //!
+    //! \brief compare Метод сравнения значений для сортировки.
+    //! Null меньше всего, числа разных типов сравниваются по значению,
+    //! значения разных типов - по типу
+    //! \return <0, 0, >0
+    //!
+    int compare(const SqlValue & other) const;
+
+    bool operator == (const SqlValue & other) const;
+    bool operator != (const SqlValue & other) const { return !(*this == other); }
+    //! Порядок compare(), для ключей QMap
+    bool operator < (const SqlValue & other) const { return compare(other) < 0; }
 
 private:
-    QVariant::Type _type {QVariant::Invalid};
-    QVariant _data { QVariant() };
-    int _length { -1 };
+    void clear();
+    void copyFrom(const SqlValue & other);
+    void setText(const QChar * text, int size);
+    const QString * longText() const;
+
+    //! Для Uuid - QUuid, для Bytes - QByteArray,
+    //! для длинного Text - QString, для короткого - QChar[]
+    alignas(8) char _data[24];
+    Type _type { Null };
+    //! Длина короткого текста или -1, если текст в QString.
+    //! Для Timestamp - Qt::TimeSpec
+    qint8 _extra { 0 };
 };
 
+Q_DECLARE_METATYPE(SqlValue)
+
+//!
+//! \brief operator << Запись значения в двоичный поток: тип и значение
+//! без QVariant (см. SqlTableExporter)
+//!
+QDataStream & operator << (QDataStream & stream, const SqlValue & value);
+QDataStream & operator >> (QDataStream & stream, SqlValue & value);
@@ -1,4 +1,6 @@
-QT += core sql
+QT += core sql concurrent
+
+CONFIG += c++17
 
 TARGET = SqlAccessor
 TEMPLATE = lib
@@ -23,18 +25,52 @@ unix {
 SOURCES += \
     Src/ISqlTableItem.cpp \
     Src/ISqlTableManager.cpp \
+    Src/SqlAggregate.cpp \
+    Src/SqlChangeDataCapture.cpp \
+    Src/SqlChangeFetcher.cpp \
     Src/SqlConnectorManager.cpp \
     Src/SqlDataMapper.cpp \
     Src/SqlDatabaseConnector.cpp \
+    Src/SqlItemSnapshot.cpp \
+    Src/SqlJoinedTableManager.cpp \
+    Src/SqlNotificationHub.cpp \
+    Src/SqlNotificationTrigger.cpp \
+    Src/SqlQueryCache.cpp \
+    Src/SqlQueryText.cpp \
+    Src/SqlReplicaSet.cpp \
+    Src/SqlSearchIndex.cpp \
+    Src/SqlSlowQueryLog.cpp \
+    Src/SqlSortedView.cpp \
+    Src/SqlTableExporter.cpp \
+    Src/SqlTableManager.cpp \
+    Src/SqlTextDecoder.cpp \
     Src/SqlValue.cpp
 
 HEADERS += \
     Include/ISqlTableItem.h \
     Include/ISqlTableManager.h \
+    Include/SqlAggregate.h \
+    Include/SqlChangeDataCapture.h \
+    Include/SqlChangeFetcher.h \
     Include/SqlConnectorManager.h \
     Include/SqlDataMapper.h \
     Include/SqlDatabaseConnector.h \
+    Include/SqlItemSnapshot.h \
+    Include/SqlJoinedTableManager.h \
     Include/SqlNotification.h \
+    Include/SqlNotificationHub.h \
+    Include/SqlNotificationTrigger.h \
+    Include/SqlQueryAwaitable.h \
+    Include/SqlQueryCache.h \
+    Include/SqlQueryResult.h \
+    Include/SqlQueryText.h \
+    Include/SqlReplicaSet.h \
+    Include/SqlSearchIndex.h \
+    Include/SqlSlowQueryLog.h \
+    Include/SqlSortedView.h \
+    Include/SqlTableExporter.h \
+    Include/SqlTableManager.h \
+    Include/SqlTextDecoder.h \
     Include/SqlValue.h \
     Include/sql_acccessor_defs.h
 
@@ -52,37 +52,37 @@ void ISqlTableItem::setUuid(const QString &uuid)
 
 bool ISqlTableItem::fromJsonObject(const QJsonObject &obj)
 {
-//    bool ok = true;
-//    for(auto field : sqlFields())
-//    {
-//        if(obj.contains(field))
-//            _private->setProperty(field.toStdString().c_str(), obj.value(field).toString());
-//        else
-//        {
-//            qDebug() << "[ISqlTableItem][fromJsonObject] : Json object does not have field" << field;
-//            ok = false;
-//        }
-//    }
-//    if(!obj.contains("_uuid"))
-//    {
-//        ok = false;
-//        qDebug() << "[ISqlTableItem][fromJsonObject] : Json object does not have field '_uuid'!";
-//    }
-//    else
-//        setUuid(obj.value("_uuid").toString());
-
-//    return ok;
+    bool ok = true;
+    for(const auto & field : sqlFields())
+    {
+        if(obj.contains(field))
+            setProperty(field.toStdString().c_str(), obj.value(field).toVariant());
+        else
+        {
+            qDebug() << "[ISqlTableItem][fromJsonObject] : Json object does not have field" << field;
+            ok = false;
+        }
+    }
+    if(!obj.contains("_uuid"))
+    {
+        ok = false;
+        qDebug() << "[ISqlTableItem][fromJsonObject] : Json object does not have field '_uuid'!";
+    }
+    else
+        setUuid(obj.value("_uuid").toString());
+
+    return ok;
 }
 
 QJsonObject ISqlTableItem::toJsonObject() const
 {
-//    QJsonObject obj;
-//    for(auto field: sqlFields())
-//    {
-//        obj.insert(field, _private->property(field.toStdString().c_str()).toJsonValue());
-//    }
-//    obj.insert("_uuid", uuid());
-//    return obj;
+    QJsonObject obj;
+    for(const auto & field: sqlFields())
+    {
+        obj.insert(field, QJsonValue::fromVariant(property(field.toStdString().c_str())));
+    }
+    obj.insert("_uuid", uuid());
+    return obj;
 }
 
 QString ISqlTableItem::sqlNotaion(const QString &fieldName)
@@ -1,14 +1,74 @@
 #include "ISqlTableManager.h"
+#include "SqlConnectorManager.h"
 #include <QUuid>
 #include <QSqlQuery>
 #include <QDebug>
 #include <QMetaClassInfo>
 #include <QJsonObject>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <QMetaProperty>
 
 
 namespace
 {
     QByteArray Title = QByteArrayLiteral("[ISqlTableManager] :");
+
+    //! Раскладывает примененное уведомление по спискам для itemsChanged()
+    void collectChange(const SqlNotification & notif, QStringList & inserted,
+                       QStringList & updated, QStringList & removed)
+    {
+        switch(notif.actionType)
+        {
+        case SqlNotification::INSERT: inserted << notif.itemUuid; break;
+        case SqlNotification::UPDATE: updated << notif.itemUuid; break;
+        case SqlNotification::DELETE: removed << notif.itemUuid; break;
+        }
+    }
+
+    //! Отказ от параллельного разбора через Q_CLASSINFO("ParallelParse", "false")
+    bool allowsParallelParse(const QMetaObject * meta)
+    {
+        const int index = meta->indexOfClassInfo("ParallelParse");
+        return index < 0 || qstrcmp(meta->classInfo(index).value(), "false") != 0;
+    }
+
+    //! Оценки размеров для memoryUsage(): QObject с приватной частью
+    //! и блок счетчиков QSharedPointer, поле свойства, узел QMap,
+    //! QStandardItem с приватной частью и данными роли
+    const qint64 ItemOverhead = 176;
+    const qint64 FieldSize = 16;
+    const qint64 MapNodeSize = 48;
+    const qint64 ModelCellSize = 160;
+
+    //! Записывает значение колонки в свойство элемента, приводя его к типу свойства.
+    //! NULL записывается как значение типа по умолчанию.
+    //! Возвращает true, если значение изменилось
+    bool writeField(QObject * item, const QMetaProperty & property, const QJsonValue & json)
+    {
+        const int type = property.userType();
+        QVariant value = json.toVariant();
+        if(value.isNull())
+            value = QVariant(type, nullptr);
+        else if(value.userType() != type && type != QMetaType::QVariant && !value.convert(type))
+        {
+            qWarning().noquote() << Title << "can't convert" << json << "to the type of field" << property.name();
+            return false;
+        }
+
+        if(property.read(item) == value)
+            return false;
+        property.write(item, value);
+        return true;
+    }
+
+    //! Заголовок QArrayData и строка с завершающим нулем
+    qint64 stringSize(const QString & text)
+    {
+        return text.isNull() ? 0 : 24 + (text.size() + 1) * qint64(sizeof(QChar));
+    }
 }
 
 
@@ -16,20 +76,72 @@ ISqlTableManager::ISqlTableManager(SqlDatabaseConnector *connector, const QStrin
     QObject(parent)
 {
     _connector = connector;
-    setTableName(tableName);
-    setTableScheme(tableScheme);
+    m_tableName = tableName;
+    m_tableScheme = tableScheme;
+    _connector->watchTable(m_tableScheme, m_tableName);
 
-    connect(this, &ISqlTableManager::execQuerySignal,
-            _connector, &SqlDatabaseConnector::sendQuery);
+    // Уведомление приходит по указателю и не копируется,
+    // даже если коннектор живет в другом потоке
+    connect(_connector, &SqlDatabaseConnector::sharedNotification,
+            this, [this](SqlNotification::ptr notification) { onDBNotification(*notification); });
 
-    connect(_connector, &SqlDatabaseConnector::queryFinishedSignal,
-            this, &ISqlTableManager::onQueryFinished);
+    connect(this, &ISqlTableManager::updated,
+            this, &ISqlTableManager::updateModel);
 
-    connect(_connector, &SqlDatabaseConnector::dbNotification,
-            this, &ISqlTableManager::onDBNotification);
+    _changeFetcher = new SqlChangeFetcher(_connector, m_tableScheme, m_tableName, this);
+    connect(_changeFetcher, &SqlChangeFetcher::resolved,
+            this, &ISqlTableManager::onChangesResolved);
 
+    _snapshot = std::make_shared<const SqlItemSnapshot>();
+    _snapshotTimer.setSingleShot(true);
+    _snapshotTimer.setInterval(0);
+    connect(&_snapshotTimer, &QTimer::timeout,
+            this, &ISqlTableManager::publishSnapshot);
     connect(this, &ISqlTableManager::updated,
-            this, &ISqlTableManager::updateModel);
+            this, &ISqlTableManager::schedulePublish);
+
+    // Изменившиеся элементы копируются для снимка только при публикации
+    connect(this, &ISqlTableManager::itemsChanged, this,
+            [this](const QStringList & inserted, const QStringList & updated, const QStringList & removed) {
+        if(!_snapshotRebuild)
+        {
+            for(const auto & uuid: inserted)
+                _snapshotDirty.insert(uuid);
+            for(const auto & uuid: updated)
+                _snapshotDirty.insert(uuid);
+            for(const auto & uuid: removed)
+                _snapshotDirty.insert(uuid);
+            if(_snapshotDirty.size() > _items.size())
+            {
+                _snapshotDirty.clear();
+                _snapshotRebuild = true;
+            }
+        }
+        _snapshotStale = true;
+    });
+    connect(this, &ISqlTableManager::itemsReset, this, [this]() {
+        _snapshotDirty.clear();
+        _snapshotRebuild = true;
+        _snapshotStale = true;
+    });
+
+    // Оценка памяти обновляется по изменившимся элементам в потоке менеджера,
+    // чтобы проверка ограничения не обходила элементы и не читала их из других потоков
+    connect(this, &ISqlTableManager::itemsChanged, this,
+            [this](const QStringList & inserted, const QStringList & updated, const QStringList & removed) {
+        accountItems(inserted + updated + removed);
+    });
+    connect(this, &ISqlTableManager::itemsReset, this, [this]() {
+        _rowMemory.clear();
+        _memoryTotal = RowMemory();
+        accountItems(_items.keys());
+    });
+}
+
+ISqlTableManager::~ISqlTableManager()
+{
+    if(_connector)
+        _connector->unwatchTable(m_tableScheme, m_tableName);
 }
 
 int ISqlTableManager::insert(ISqlTableItem::ptr row)
@@ -70,12 +182,240 @@ QString ISqlTableManager::lastItemCheckString()
 
 const QList<ISqlTableItem::ptr> ISqlTableManager::items()
 {
-    QList<ISqlTableItem::ptr> out;
-    for(auto key: _items.keys())
-        out << _items[key];
+    return _items.values();
+}
+
+SqlItemSnapshot::ptr ISqlTableManager::snapshot() const
+{
+    const bool wanted = _snapshotWanted.exchange(true);
+    if(_snapshotStale)
+    {
+        ISqlTableManager * self = const_cast<ISqlTableManager *>(this);
+        if(QThread::currentThread() == thread())
+            self->publishSnapshot();
+        else if(!wanted)
+        {
+            // Элементы читаются только в потоке менеджера, поэтому публикация
+            // ставится в его очередь, а сейчас возвращается прошлый снимок
+            QMetaObject::invokeMethod(self, [self]() { self->publishSnapshot(); }, Qt::QueuedConnection);
+        }
+    }
+    return std::atomic_load(&_snapshot);
+}
+
+void ISqlTableManager::publishSnapshot()
+{
+    _snapshotTimer.stop();
+    if(!_snapshotStale)
+        return;
+
+    // Прошлый снимок держит только менеджер и нового никто не просил:
+    // копировать элементы незачем, публикация дождется snapshot()
+    if(!_snapshotWanted && _snapshot.use_count() <= 1)
+        return;
+
+    if(_snapshotRebuild)
+    {
+        _snapshotItems.clear();
+        for(auto it = _items.constBegin(); it != _items.constEnd(); ++it)
+        {
+            const ISqlTableItem::ptr copy = cloneItem(it.value());
+            if(copy)
+                _snapshotItems.insert(it.key(), copy);
+        }
+    }
+    else
+    {
+        for(const auto & uuid: qAsConst(_snapshotDirty))
+        {
+            const ISqlTableItem::ptr copy = cloneItem(_items.value(uuid));
+            if(copy)
+                _snapshotItems.insert(uuid, copy);
+            else
+                _snapshotItems.remove(uuid);
+        }
+    }
+    _snapshotDirty.clear();
+    _snapshotRebuild = false;
+    _snapshotStale = false;
+    _snapshotWanted = false;
+
+    // Копия QMap не копирует элементы: неизменившиеся копии переходят в новый снимок
+    std::atomic_store(&_snapshot, std::make_shared<const SqlItemSnapshot>(_snapshotItems, ++_snapshotVersion));
+    emit snapshotPublished(_snapshotVersion);
+}
+
+ISqlTableItem::ptr ISqlTableManager::cloneItem(const ISqlTableItem::ptr &item)
+{
+    if(!item)
+        return ISqlTableItem::ptr();
+
+    ISqlTableItem::ptr copy = parseSingleQuery(item->toJsonObject());
+    if(!copy)
+        return copy;
+
+    // Значения переносятся как есть, без преобразований через Json
+    const QMetaObject * meta = item->metaObject();
+    for(int i = meta->propertyOffset(); i < meta->propertyCount(); i++)
+    {
+        const QMetaProperty property = meta->property(i);
+        copy->setProperty(property.name(), property.read(item.data()));
+    }
+    copy->_uuid = item->_uuid;
+    copy->_creationTime = item->_creationTime;
+    return copy;
+}
+
+ISqlTableManager::MemoryUsage ISqlTableManager::memoryUsage() const
+{
+    MemoryUsage out = accountedMemoryUsage();
+    out.model = 0;
+    if(_model)
+    {
+        for(int row = 0; row < _model->rowCount(); row++)
+        {
+            for(int column = 0; column < _model->columnCount(); column++)
+            {
+                const QStandardItem * cell = _model->item(row, column);
+                if(cell)
+                    out.model += ModelCellSize + stringSize(cell->text());
+            }
+        }
+    }
     return out;
 }
 
+void ISqlTableManager::reportIndexMemory(QObject *index, qint64 bytes)
+{
+    if(!index)
+        return;
+
+    if(!_indexMemory.contains(index))
+    {
+        connect(index, &QObject::destroyed, this, [this, index]() {
+            _indexMemory.remove(index);
+        });
+    }
+    _indexMemory.insert(index, qMax<qint64>(0, bytes));
+    checkMemoryBudget();
+}
+
+qint64 ISqlTableManager::memoryBudget() const
+{
+    return _memoryBudget;
+}
+
+void ISqlTableManager::setMemoryBudget(qint64 bytes)
+{
+    _memoryBudget = qMax<qint64>(0, bytes);
+    _memoryBudgetExceeded = false;
+    checkMemoryBudget();
+}
+
+ISqlTableManager::MemoryUsage ISqlTableManager::accountedMemoryUsage() const
+{
+    MemoryUsage out;
+    out.items = _memoryTotal.items;
+    out.strings = _memoryTotal.strings;
+    out.indexes = qint64(_items.size() + _rowMemory.size()) * MapNodeSize;
+
+    // Копии для снимка оцениваются средним размером элемента
+    if(!_snapshotItems.isEmpty() && !_rowMemory.isEmpty())
+    {
+        const qint64 average = (_memoryTotal.items + _memoryTotal.strings) / _rowMemory.size();
+        out.indexes += qint64(_snapshotItems.size()) * (average + MapNodeSize);
+    }
+
+    for(auto it = _indexMemory.constBegin(); it != _indexMemory.constEnd(); ++it)
+        out.indexes += it.value();
+
+    if(_model)
+        out.model = qint64(_model->rowCount()) * _model->columnCount() * ModelCellSize + _memoryTotal.text;
+    return out;
+}
+
+ISqlTableManager::RowMemory ISqlTableManager::rowMemoryUsage(const QString &uuid, const ISqlTableItem *item)
+{
+    RowMemory out;
+    out.strings += stringSize(uuid);
+
+    const QMetaObject * meta = item->metaObject();
+    out.items += ItemOverhead + (meta->propertyCount() - meta->propertyOffset()) * FieldSize;
+    out.strings += stringSize(item->_uuid);
+    for(int i = meta->propertyOffset(); i < meta->propertyCount(); i++)
+    {
+        const QVariant value = meta->property(i).read(item);
+        if(value.userType() == QMetaType::QString)
+            out.strings += stringSize(value.toString());
+        else if(value.userType() == QMetaType::QByteArray)
+            out.strings += 24 + value.toByteArray().size() + 1;
+        out.text += stringSize(value.toString());
+    }
+    return out;
+}
+
+void ISqlTableManager::accountItems(const QStringList &uuids)
+{
+    for(const auto & uuid: uuids)
+    {
+        auto row = _rowMemory.find(uuid);
+        if(row != _rowMemory.end())
+        {
+            _memoryTotal.items -= row.value().items;
+            _memoryTotal.strings -= row.value().strings;
+            _memoryTotal.text -= row.value().text;
+        }
+
+        const ISqlTableItem::ptr item = _items.value(uuid);
+        if(!item)
+        {
+            if(row != _rowMemory.end())
+                _rowMemory.erase(row);
+            continue;
+        }
+
+        const RowMemory usage = rowMemoryUsage(uuid, item.data());
+        _memoryTotal.items += usage.items;
+        _memoryTotal.strings += usage.strings;
+        _memoryTotal.text += usage.text;
+        if(row != _rowMemory.end())
+            row.value() = usage;
+        else
+            _rowMemory.insert(uuid, usage);
+    }
+    checkMemoryBudget();
+}
+
+void ISqlTableManager::checkMemoryBudget()
+{
+    if(_memoryBudget <= 0)
+        return;
+    reportMemoryUsage(accountedMemoryUsage().total());
+}
+
+void ISqlTableManager::reportMemoryUsage(qint64 usage)
+{
+    if(_memoryBudget <= 0)
+        return;
+
+    const bool exceeded = usage > _memoryBudget;
+    if(exceeded && !_memoryBudgetExceeded)
+    {
+        qWarning().noquote() << Title << QString("%1.%2 uses ~%3 bytes, budget is %4")
+                                .arg(m_tableScheme, m_tableName).arg(usage).arg(_memoryBudget);
+        _memoryBudgetExceeded = true;
+        emit memoryBudgetExceeded(usage, _memoryBudget);
+    }
+    else if(!exceeded)
+        _memoryBudgetExceeded = false;
+}
+
+void ISqlTableManager::schedulePublish()
+{
+    if(!_snapshotTimer.isActive())
+        _snapshotTimer.start();
+}
+
 ISqlTableItem::ptr ISqlTableManager::item(const QString &uuid)
 {
     if(_items.contains(uuid))
@@ -145,19 +485,150 @@ bool ISqlTableManager::autoParseQuery(ISqlTableItem::ptr item, const QJsonObject
     return ok;
 }
 
+QList<QPair<QString, ISqlTableItem::ptr>> ISqlTableManager::parseRecords(const QList<QJsonObject> &records)
+{
+    QList<QPair<QString, ISqlTableItem::ptr>> out;
+    out.reserve(records.size());
+    if(records.isEmpty())
+        return out;
+
+    // Первая запись разбирается здесь: по ней видно, можно ли разбирать элементы параллельно
+    auto first = parseSingleQuery(records.first());
+    out << qMakePair(records.first().value("_uuid").toString(), first);
+
+    const int threads = QThreadPool::globalInstance()->maxThreadCount();
+    const bool parallel = _parallelParseThreshold > 0
+            && records.size() >= _parallelParseThreshold
+            && threads > 1
+            && allowsParallelParse(metaObject())
+            && (!first || allowsParallelParse(first->metaObject()));
+
+    if(!parallel)
+    {
+        for(int i = 1; i < records.size(); i++)
+            out << qMakePair(records[i].value("_uuid").toString(), parseSingleQuery(records[i]));
+        return out;
+    }
+
+    // Несколько кусков на поток, чтобы потоки не простаивали на неравных кусках
+    const int chunk = qMax(256, records.size() / (threads * 4));
+    QVector<QPair<int, int>> ranges;
+    for(int begin = 1; begin < records.size(); begin += chunk)
+        ranges << qMakePair(begin, qMin(begin + chunk, records.size()));
+
+    QThread * owner = thread();
+    const auto parsed = QtConcurrent::blockingMapped<QVector<QList<QPair<QString, ISqlTableItem::ptr>>>>(
+                ranges, [this, &records, owner](const QPair<int, int> & range) {
+        QList<QPair<QString, ISqlTableItem::ptr>> part;
+        part.reserve(range.second - range.first);
+        for(int i = range.first; i < range.second; i++)
+        {
+            auto item = parseSingleQuery(records[i]);
+            // Объект создан в потоке пула, а жить должен в потоке менеджера
+            if(item && item->thread() != owner)
+                item->moveToThread(owner);
+            part << qMakePair(records[i].value("_uuid").toString(), item);
+        }
+        return part;
+    });
+
+    for(const auto & part: parsed)
+        out << part;
+
+    if(_debug) qDebug().noquote() << Title << QString("parsed %1 records in %2 chunks").arg(records.size()).arg(ranges.size());
+    return out;
+}
+
+void ISqlTableManager::reconcile(const QList<QJsonObject> &records)
+{
+    QStringList inserted;
+    QStringList updated;
+    QStringList removed;
+    QList<QPair<ISqlTableItem::ptr, QStringList>> changes;
+
+    QList<QJsonObject> fresh;
+    QSet<QString> seen;
+    seen.reserve(records.size());
+
+    // Свойства находятся один раз на класс элементов, а не на каждую запись
+    const QMetaObject * meta = nullptr;
+    QVector<QMetaProperty> properties;
+    for(const auto & record: records)
+    {
+        const QString uuid = record.value("_uuid").toString();
+        seen.insert(uuid);
+
+        const auto existing = _items.constFind(uuid);
+        if(existing == _items.constEnd())
+        {
+            fresh << record;
+            continue;
+        }
+        if(!existing.value())
+            continue;
+
+        if(existing.value()->metaObject() != meta)
+        {
+            meta = existing.value()->metaObject();
+            properties = sqlProperties(meta);
+        }
+        const QStringList fields = patchItem(existing.value().data(), properties, record);
+        if(!fields.isEmpty())
+        {
+            updated << uuid;
+            changes << qMakePair(existing.value(), fields);
+        }
+    }
+
+    for(auto it = _items.begin(); it != _items.end();)
+    {
+        if(seen.contains(it.key()))
+        {
+            ++it;
+            continue;
+        }
+        removed << it.key();
+        it = _items.erase(it);
+    }
+
+    // Новые элементы добавляются одним шагом, уже после разбора
+    for(const auto & pair: parseRecords(fresh))
+    {
+        if(!pair.second)
+        {
+            qWarning().noquote() << Title << "not adding item to the list";
+            continue;
+        }
+        _items[pair.first] = pair.second;
+        inserted << pair.first;
+    }
+
+    if(_debug) qDebug().noquote() << Title << QString("reloaded %1.%2 : %3 inserted, %4 updated, %5 removed")
+                                     .arg(m_tableScheme, m_tableName)
+                                     .arg(inserted.size()).arg(updated.size()).arg(removed.size());
+
+    emit reloaded(inserted, updated, removed);
+    if(!inserted.isEmpty() || !updated.isEmpty() || !removed.isEmpty())
+        emit itemsChanged(inserted, updated, removed);
+    for(const auto & change: changes)
+        emit updatedItemFields(change.first, change.second);
+}
+
 void ISqlTableManager::load()
 {
-    sendQuery(selectQuery());
+    sendReadQuery(selectQuery());
 }
 
 void ISqlTableManager::unload()
 {
     _items.clear();
+    emit itemsReset();
+    schedulePublish();
 }
 
 void ISqlTableManager::fullReload()
 {
-    unload();
+    // Элементы сверяются с результатом в onQueryFinished, см. reconcile()
     load();
 }
 
@@ -176,6 +647,21 @@ void ISqlTableManager::setModel(QStandardItemModel *newModel)
     _model = newModel;
 }
 
+SqlChangeFetcher *ISqlTableManager::changeFetcher() const
+{
+    return _changeFetcher;
+}
+
+int ISqlTableManager::parallelParseThreshold() const
+{
+    return _parallelParseThreshold;
+}
+
+void ISqlTableManager::setParallelParseThreshold(int rows)
+{
+    _parallelParseThreshold = qMax(0, rows);
+}
+
 const QString &ISqlTableManager::tableName() const
 {
     return m_tableName;
@@ -183,7 +669,10 @@ const QString &ISqlTableManager::tableName() const
 
 void ISqlTableManager::setTableName(const QString &newTableName)
 {
+    _connector->unwatchTable(m_tableScheme, m_tableName);
     m_tableName = newTableName;
+    _connector->watchTable(m_tableScheme, m_tableName);
+    _changeFetcher->setTable(m_tableScheme, m_tableName);
 }
 
 const QString &ISqlTableManager::tableScheme() const
@@ -193,26 +682,37 @@ const QString &ISqlTableManager::tableScheme() const
 
 void ISqlTableManager::setTableScheme(const QString &newTableScheme)
 {
+    _connector->unwatchTable(m_tableScheme, m_tableName);
     m_tableScheme = newTableScheme;
+    _connector->watchTable(m_tableScheme, m_tableName);
+    _changeFetcher->setTable(m_tableScheme, m_tableName);
 }
 
 void ISqlTableManager::sendQuery(const QString &query)
 {
-    QUuid uuid = QUuid::createUuid();
-    _awaitedQueries << uuid;
-    emit execQuerySignal(uuid, query);
+    _connector->sendQuery(query, this, [this](const QUuid & uuid, const QueryResult & result) {
+        onQueryFinished(uuid, result);
+    });
 }
 
-void ISqlTableManager::onQueryFinished(const QUuid &uuid, QueryResult result)
+void ISqlTableManager::sendReadQuery(const QString &query)
 {
-    if(_debug) qDebug().noquote() << Title << QString("query finished for table %1.%2!").arg(m_tableScheme, m_tableName);
-//    qDebug() << _awaitedQueries << uuid;
-
-    if(!_awaitedQueries.contains(uuid))
+    SqlDatabaseConnector * reader = SqlConnectorManager::instance().getReadConnector(_connector->connectionName());
+    if(!reader || reader == _connector)
     {
+        sendQuery(query);
         return;
     }
-    _awaitedQueries.removeAll(uuid);
+
+    reader->sendQuery(query, this, [this](const QUuid & uuid, const QueryResult & result) {
+        onQueryFinished(uuid, result);
+    });
+}
+
+void ISqlTableManager::onQueryFinished(const QUuid &uuid, QueryResult result)
+{
+    if(_debug) qDebug().noquote() << Title << QString("query finished for table %1.%2!").arg(m_tableScheme, m_tableName);
+    Q_UNUSED(uuid)
 
     if(result.error.type() != QSqlError::NoError)
     {
@@ -226,20 +726,12 @@ void ISqlTableManager::onQueryFinished(const QUuid &uuid, QueryResult result)
         if(_debug) qDebug().noquote() << Title << "type - SELECT";
         if(_debug) qDebug().noquote() << Title << "size - " << result.records.size();
 //        qDebug().noquote() << Title << "data - " << result.records;
-        unload();
-        for(auto record: result.records)
-        {
-            auto item = parseSingleQuery(record);
-            if(item)
-                _items[record.value("_uuid").toString()] = item;
-            else
-                qWarning().noquote() << Title << "not adding item to the list";
-        }
+        reconcile(result.records);
         emit updated();
     }
 }
 
-void ISqlTableManager::onDBNotification(const SqlNotification notif)
+void ISqlTableManager::onDBNotification(const SqlNotification & notif)
 {
 //    qDebug().noquote() << QString("[ISqlTableManager] : notification for %1.%2").arg(notif.schema, notif.table);
     if(notif.table != tableName() || notif.schema != tableScheme())
@@ -255,6 +747,86 @@ void ISqlTableManager::onDBNotification(const SqlNotification notif)
         return;
     }
 
+    if(notif.format == SqlNotification::ChangePointer)
+    {
+        // Строка дочитывается пачкой, см. onChangesResolved
+        _changeFetcher->enqueue(notif);
+        return;
+    }
+
+    QStringList fields;
+    if(!applyNotification(notif, &fields))
+        return;
+
+    QStringList insertedUuids, updatedUuids, removedUuids;
+    collectChange(notif, insertedUuids, updatedUuids, removedUuids);
+    emit itemsChanged(insertedUuids, updatedUuids, removedUuids);
+
+    emit updated();
+    emit updatedItem(item(notif.itemUuid));
+    if(notif.actionType == SqlNotification::UPDATE)
+        emit updatedItemFields(item(notif.itemUuid), fields);
+}
+
+void ISqlTableManager::onChangesResolved(const QList<SqlNotification> &notifications)
+{
+    QList<QStringList> fields;
+    fields.reserve(notifications.size());
+    QStringList insertedUuids, updatedUuids, removedUuids;
+    for(const auto & notif: notifications)
+    {
+        fields << QStringList();
+        if(applyNotification(notif, &fields.last()))
+            collectChange(notif, insertedUuids, updatedUuids, removedUuids);
+    }
+    emit itemsChanged(insertedUuids, updatedUuids, removedUuids);
+
+    emit updated();
+    for(int i = 0; i < notifications.size(); i++)
+    {
+        const SqlNotification & notif = notifications[i];
+        emit updatedItem(item(notif.itemUuid));
+        if(notif.actionType == SqlNotification::UPDATE)
+            emit updatedItemFields(item(notif.itemUuid), fields[i]);
+    }
+}
+
+QStringList ISqlTableManager::patchItem(const QString &uuid, const QJsonObject &changes)
+{
+    const ISqlTableItem::ptr item = _items.value(uuid);
+    if(!item)
+        return QStringList();
+
+    return patchItem(item.data(), sqlProperties(item->metaObject()), changes);
+}
+
+QStringList ISqlTableManager::patchItem(ISqlTableItem *item, const QVector<QMetaProperty> &properties, const QJsonObject &changes)
+{
+    // Меняются только колонки, пришедшие в changes: значение приводится
+    // к типу свойства и сравнивается с текущим, временный элемент не нужен
+    QStringList changed;
+    for(const auto & property: properties)
+    {
+        const auto change = changes.constFind(QLatin1String(property.name()));
+        if(change == changes.constEnd())
+            continue;
+        if(writeField(item, property, change.value()))
+            changed << QString::fromLatin1(property.name());
+    }
+    return changed;
+}
+
+QVector<QMetaProperty> ISqlTableManager::sqlProperties(const QMetaObject *meta)
+{
+    QVector<QMetaProperty> out;
+    out.reserve(meta->propertyCount() - meta->propertyOffset());
+    for(int i = meta->propertyOffset(); i < meta->propertyCount(); i++)
+        out << meta->property(i);
+    return out;
+}
+
+bool ISqlTableManager::applyNotification(const SqlNotification &notif, QStringList *changedFields)
+{
     switch(notif.actionType)
     {
     case SqlNotification::INSERT:
@@ -267,6 +839,33 @@ void ISqlTableManager::onDBNotification(const SqlNotification notif)
     case SqlNotification::UPDATE:
     {
         if(_debug) qDebug().noquote() << Title << QString("Received UPDATE for table %1.%2").arg(tableScheme(), tableName());
+        if(notif.format == SqlNotification::ColumnDiff)
+        {
+            if(!_items.contains(notif.itemUuid))
+            {
+                // Из одних изменений элемент не собрать - дочитываем строку целиком
+                SqlNotification pointer = notif;
+                pointer.format = SqlNotification::ChangePointer;
+                pointer.actionType = SqlNotification::INSERT;
+                _changeFetcher->enqueue(pointer);
+                return false;
+            }
+
+            const QStringList changed = patchItem(notif.itemUuid, notif.data);
+            if(changedFields)
+                *changedFields = changed;
+            break;
+        }
+
+        if(changedFields && !notif.oldData.isEmpty())
+        {
+            for(auto it = notif.data.constBegin(); it != notif.data.constEnd(); ++it)
+            {
+                if(notif.oldData.value(it.key()) != it.value())
+                    *changedFields << it.key();
+            }
+        }
+
         auto item = parseSingleQuery(notif.data);
         if(_items.contains(notif.itemUuid))
             _items[notif.itemUuid] = item;
@@ -284,7 +883,5 @@ void ISqlTableManager::onDBNotification(const SqlNotification notif)
     }
     break;
     }
-
-    emit updated();
-    emit updatedItem(item(notif.itemUuid));
+    return true;
 }
@@ -0,0 +1,257 @@
+#include "SqlAggregate.h"
+
+namespace
+{
+    bool isNumber(const SqlValue & value)
+    {
+        switch(value.type())
+        {
+        case SqlValue::Int32:
+        case SqlValue::Int64:
+        case SqlValue::Float64:
+        case SqlValue::Bool:
+            return true;
+        default:
+            return false;
+        }
+    }
+}
+
+void SqlAggregate::Group::addNumber(const SqlValue &value, int sign)
+{
+    if(value.type() != SqlValue::Float64)
+    {
+        integerSum += sign * value.toLongLong();
+        return;
+    }
+
+    floatCount += sign;
+    if(floatCount <= 0)
+    {
+        floatCount = 0;
+        floatSum = 0;
+        floatCompensation = 0;
+        return;
+    }
+
+    // Суммирование Ноймайера: теряемые при сложении младшие разряды
+    // накапливаются отдельно и добавляются при чтении суммы
+    const double term = sign * value.toDouble();
+    const double next = floatSum + term;
+    if(qAbs(floatSum) >= qAbs(term))
+        floatCompensation += (floatSum - next) + term;
+    else
+        floatCompensation += (term - next) + floatSum;
+    floatSum = next;
+}
+
+SqlAggregate::SqlAggregate(ISqlTableManager *manager, const QString &groupField,
+                           const QString &valueField, QObject *parent) :
+    QObject(parent),
+    _manager { manager },
+    _groupField { groupField.toUtf8() },
+    _valueField { valueField.toUtf8() }
+{
+    connect(_manager, &ISqlTableManager::itemsChanged,
+            this, &SqlAggregate::onItemsChanged);
+    connect(_manager, &ISqlTableManager::itemsReset,
+            this, &SqlAggregate::onItemsReset);
+    rebuild();
+}
+
+QList<SqlValue> SqlAggregate::groups() const
+{
+    return _groups.keys();
+}
+
+bool SqlAggregate::contains(const SqlValue &group) const
+{
+    return _groups.contains(group);
+}
+
+SqlAggregate::Result SqlAggregate::value(const SqlValue &group) const
+{
+    auto it = _groups.constFind(group);
+    if(it == _groups.constEnd())
+    {
+        Result out;
+        out.group = group;
+        return out;
+    }
+    return resultOf(it.key(), it.value());
+}
+
+SqlAggregate::Result SqlAggregate::total() const
+{
+    return resultOf(SqlValue(), _total);
+}
+
+qint64 SqlAggregate::memoryUsage() const
+{
+    // Вклад элемента с узлом хеша, группа с узлом QMap и значения
+    // для min и max: по одному узлу в группе и в общем итоге
+    const qint64 valueNode = 48 + qint64(sizeof(SqlValue));
+    return _contributions.size() * (32 + qint64(sizeof(Contribution)))
+            + _groups.size() * (valueNode + qint64(sizeof(Group)))
+            + _total.values.size() * 2 * valueNode;
+}
+
+void SqlAggregate::rebuild()
+{
+    clear();
+    if(_manager)
+    {
+        for(const auto & item: _manager->items())
+        {
+            if(!item)
+                continue;
+            const Contribution contribution = contributionOf(item);
+            _contributions.insert(item->uuid(), contribution);
+            add(contribution);
+        }
+    }
+    reportMemory();
+    emit reset();
+}
+
+void SqlAggregate::onItemsChanged(const QStringList &inserted, const QStringList &updated, const QStringList &removed)
+{
+    if(!_manager)
+        return;
+
+    QMap<SqlValue, bool> affected;
+
+    for(const auto & uuid: removed)
+    {
+        auto it = _contributions.find(uuid);
+        if(it == _contributions.end())
+            continue;
+        affected.insert(it.value().group, true);
+        subtract(it.value());
+        _contributions.erase(it);
+    }
+
+    for(const auto & uuid: updated + inserted)
+    {
+        auto item = _manager->item(uuid);
+        auto it = _contributions.find(uuid);
+        if(!item)
+        {
+            if(it != _contributions.end())
+            {
+                affected.insert(it.value().group, true);
+                subtract(it.value());
+                _contributions.erase(it);
+            }
+            continue;
+        }
+
+        const Contribution contribution = contributionOf(item);
+        if(it != _contributions.end())
+        {
+            // Поля вне группировки и значения не влияют на агрегаты
+            if(it.value().group == contribution.group && it.value().value == contribution.value)
+                continue;
+            affected.insert(it.value().group, true);
+            subtract(it.value());
+            it.value() = contribution;
+        }
+        else
+            _contributions.insert(uuid, contribution);
+
+        affected.insert(contribution.group, true);
+        add(contribution);
+    }
+
+    for(auto it = affected.constBegin(); it != affected.constEnd(); ++it)
+    {
+        if(_groups.contains(it.key()))
+            emit groupChanged(it.key());
+        else
+            emit groupRemoved(it.key());
+    }
+    reportMemory();
+}
+
+void SqlAggregate::onItemsReset()
+{
+    clear();
+    reportMemory();
+    emit reset();
+}
+
+void SqlAggregate::clear()
+{
+    _contributions.clear();
+    _groups.clear();
+    _total = Group();
+}
+
+SqlAggregate::Contribution SqlAggregate::contributionOf(const ISqlTableItem::ptr &item) const
+{
+    Contribution out;
+    if(!_groupField.isEmpty())
+        out.group = SqlValue(item->property(_groupField.constData()));
+    if(!_valueField.isEmpty())
+        out.value = SqlValue(item->property(_valueField.constData()));
+    return out;
+}
+
+void SqlAggregate::add(const Contribution &contribution)
+{
+    for(Group * group: { &_groups[contribution.group], &_total })
+    {
+        group->count++;
+        if(contribution.value.isNull())
+            continue;
+        group->valueCount++;
+        if(isNumber(contribution.value))
+            group->addNumber(contribution.value, 1);
+        group->values[contribution.value]++;
+    }
+}
+
+void SqlAggregate::subtract(const Contribution &contribution)
+{
+    auto it = _groups.find(contribution.group);
+    if(it == _groups.end())
+        return;
+
+    for(Group * group: { &it.value(), &_total })
+    {
+        group->count--;
+        if(contribution.value.isNull())
+            continue;
+        group->valueCount--;
+        if(isNumber(contribution.value))
+            group->addNumber(contribution.value, -1);
+        auto value = group->values.find(contribution.value);
+        if(value != group->values.end() && --value.value() <= 0)
+            group->values.erase(value);
+    }
+
+    if(it.value().count <= 0)
+        _groups.erase(it);
+}
+
+SqlAggregate::Result SqlAggregate::resultOf(const SqlValue &key, const Group &group) const
+{
+    Result out;
+    out.group = key;
+    out.count = group.count;
+    out.valueCount = group.valueCount;
+    out.integerSum = group.integerSum;
+    out.sum = double(group.integerSum) + (group.floatSum + group.floatCompensation);
+    if(!group.values.isEmpty())
+    {
+        out.min = group.values.firstKey();
+        out.max = group.values.lastKey();
+    }
+    return out;
+}
+
+void SqlAggregate::reportMemory()
+{
+    if(_manager)
+        _manager->reportIndexMemory(this, memoryUsage());
+}
@@ -0,0 +1,342 @@
+#include "SqlChangeDataCapture.h"
+#include "SqlNotificationTrigger.h"
+#include <QDebug>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonValue>
+
+namespace
+{
+    QByteArray Title = QByteArrayLiteral("[SqlChangeDataCapture] :");
+
+    //! Идентификатор в выводе test_decoding: "Name" или name
+    QString readIdentifier(const QString & text, int & pos, const QString & stop)
+    {
+        QString out;
+        if(pos < text.size() && text[pos] == '"')
+        {
+            pos++;
+            while(pos < text.size())
+            {
+                if(text[pos] == '"')
+                {
+                    if(pos + 1 < text.size() && text[pos + 1] == '"')
+                    {
+                        out += '"';
+                        pos += 2;
+                        continue;
+                    }
+                    pos++;
+                    break;
+                }
+                out += text[pos++];
+            }
+            return out;
+        }
+
+        while(pos < text.size() && !stop.contains(text[pos]))
+            out += text[pos++];
+        return out;
+    }
+
+    //! Приводит значение к тому же виду, что и row_to_json в триггере
+    QJsonValue toJson(const QString & type, const QString & value)
+    {
+        static const QStringList numeric = { "smallint", "integer", "bigint", "real",
+                                             "double precision", "numeric", "oid" };
+        if(numeric.contains(type) || type.startsWith("numeric("))
+            return value.toDouble();
+        if(type == "boolean")
+            return value == "true";
+        if(type == "json" || type == "jsonb")
+        {
+            QJsonDocument doc = QJsonDocument::fromJson(value.toUtf8());
+            if(doc.isObject())
+                return doc.object();
+            if(doc.isArray())
+                return doc.array();
+        }
+        return value;
+    }
+
+    //! Колонки вида name[type]:value до конца строки или до "new-tuple:"
+    void readColumns(const QString & text, int & pos, QJsonObject & out)
+    {
+        static const QString NewTuple = QStringLiteral("new-tuple:");
+        while(pos < text.size())
+        {
+            while(pos < text.size() && text[pos] == ' ')
+                pos++;
+            if(pos >= text.size() || text.midRef(pos).startsWith(NewTuple))
+                return;
+
+            const QString name = readIdentifier(text, pos, "[");
+            const int typeEnd = text.indexOf("]:", pos);
+            if(pos >= text.size() || text[pos] != '[' || typeEnd < 0)
+                return;
+            const QString type = text.mid(pos + 1, typeEnd - pos - 1);
+            pos = typeEnd + 2;
+
+            if(pos < text.size() && text[pos] == '\'')
+            {
+                QString value;
+                pos++;
+                while(pos < text.size())
+                {
+                    if(text[pos] == '\'')
+                    {
+                        if(pos + 1 < text.size() && text[pos + 1] == '\'')
+                        {
+                            value += '\'';
+                            pos += 2;
+                            continue;
+                        }
+                        pos++;
+                        break;
+                    }
+                    value += text[pos++];
+                }
+                out.insert(name, toJson(type, value));
+                continue;
+            }
+
+            const int end = text.indexOf(' ', pos);
+            const QString value = text.mid(pos, end < 0 ? -1 : end - pos);
+            pos = end < 0 ? text.size() : end;
+
+            // Неизмененное TOAST значение в WAL не попадает
+            if(value == "unchanged-toast-datum")
+                continue;
+            out.insert(name, value == "null" ? QJsonValue(QJsonValue::Null) : toJson(type, value));
+        }
+    }
+}
+
+SqlChangeDataCapture::SqlChangeDataCapture(SqlDatabaseConnector *connector, const QString &slotName, QObject *parent) :
+    QObject(parent),
+    _connector { connector },
+    _slotName { slotName }
+{
+    connect(&_timer, &QTimer::timeout,
+            this, &SqlChangeDataCapture::poll);
+}
+
+const QString &SqlChangeDataCapture::slotName() const
+{
+    return _slotName;
+}
+
+void SqlChangeDataCapture::createSlot()
+{
+    if(!_connector)
+        return;
+
+    const QString slot = SqlNotificationTrigger::quoteLiteral(_slotName);
+    _connector->sendQuery(QString("SELECT pg_create_logical_replication_slot(%1, 'test_decoding') "
+                                  "WHERE NOT EXISTS (SELECT 1 FROM pg_replication_slots WHERE slot_name = %1);").arg(slot),
+                          this, [this](const QUuid &, const QueryResult & result) {
+        if(result.error.type() != QSqlError::NoError)
+        {
+            qWarning().noquote() << Title << "can't create replication slot" << _slotName << result.error.text();
+            emit errorOccurred(result.error.text());
+        }
+    });
+}
+
+void SqlChangeDataCapture::dropSlot()
+{
+    if(!_connector)
+        return;
+
+    stop();
+    const QString slot = SqlNotificationTrigger::quoteLiteral(_slotName);
+    _connector->sendQuery(QString("SELECT pg_drop_replication_slot(slot_name) FROM pg_replication_slots "
+                                  "WHERE slot_name = %1;").arg(slot),
+                          this, [this](const QUuid &, const QueryResult & result) {
+        if(result.error.type() != QSqlError::NoError)
+            emit errorOccurred(result.error.text());
+    });
+}
+
+void SqlChangeDataCapture::start(int intervalMs)
+{
+    _timer.start(intervalMs);
+    poll();
+}
+
+void SqlChangeDataCapture::stop()
+{
+    _timer.stop();
+}
+
+bool SqlChangeDataCapture::isRunning() const
+{
+    return _timer.isActive();
+}
+
+void SqlChangeDataCapture::setBatchSize(int changes)
+{
+    _batchSize = qMax(1, changes);
+}
+
+const QString &SqlChangeDataCapture::lastConfirmedLsn() const
+{
+    return _lastConfirmedLsn;
+}
+
+bool SqlChangeDataCapture::parseChange(const QString &line, SqlNotification &notification)
+{
+    static const QString Prefix = QStringLiteral("table ");
+    if(!line.startsWith(Prefix))
+        return false;
+
+    int pos = Prefix.size();
+    const QString schema = readIdentifier(line, pos, ".");
+    if(pos >= line.size() || line[pos] != '.')
+        return false;
+    pos++;
+    const QString table = readIdentifier(line, pos, ":");
+    if(!line.midRef(pos).startsWith(QLatin1String(": ")))
+        return false;
+    pos += 2;
+
+    const int actionEnd = line.indexOf(':', pos);
+    if(actionEnd < 0)
+        return false;
+    const QString action = line.mid(pos, actionEnd - pos);
+    pos = actionEnd + 1;
+
+    if(action == "INSERT")
+        notification.actionType = SqlNotification::INSERT;
+    else if(action == "UPDATE")
+        notification.actionType = SqlNotification::UPDATE;
+    else if(action == "DELETE")
+        notification.actionType = SqlNotification::DELETE;
+    else
+        return false;
+
+    notification.schema = schema;
+    notification.table = table;
+    notification.format = SqlNotification::FullRow;
+    notification.data = QJsonObject();
+    notification.oldData = QJsonObject();
+
+    while(pos < line.size() && line[pos] == ' ')
+        pos++;
+
+    if(line.midRef(pos).startsWith(QLatin1String("old-key:")))
+    {
+        pos += 8;
+        readColumns(line, pos, notification.oldData);
+        while(pos < line.size() && line[pos] == ' ')
+            pos++;
+        if(line.midRef(pos).startsWith(QLatin1String("new-tuple:")))
+            pos += 10;
+    }
+
+    // "(no-tuple-data)" - у таблицы нет идентичности реплики
+    if(!line.midRef(pos).startsWith(QLatin1String("(no-tuple-data)")))
+        readColumns(line, pos, notification.data);
+
+    notification.itemUuid = notification.data.value("_uuid").toString();
+    return true;
+}
+
+void SqlChangeDataCapture::poll()
+{
+    if(_busy || !_connector || !_connector->isOpen())
+        return;
+
+    _busy = true;
+    _connector->sendQuery(QString("SELECT lsn::text AS lsn, data FROM pg_logical_slot_peek_changes(%1, NULL, %2, %3);")
+                          .arg(SqlNotificationTrigger::quoteLiteral(_slotName))
+                          .arg(_batchSize)
+                          .arg(decodingOptions()),
+                          this, [this](const QUuid &, const QueryResult & result) {
+        onPeeked(result);
+    });
+}
+
+void SqlChangeDataCapture::onPeeked(const QueryResult &result)
+{
+    if(result.error.type() != QSqlError::NoError)
+    {
+        _busy = false;
+        qWarning().noquote() << Title << "can't read replication slot" << _slotName << result.error.text();
+        emit errorOccurred(result.error.text());
+        return;
+    }
+
+    // Уведомления отдаются по транзакциям, целиком: транзакция без COMMIT
+    // в этой пачке не подтверждается и будет прочитана заново
+    QList<SqlNotification::ptr> transaction;
+    QString commitLsn;
+    for(const auto & record: result.records)
+    {
+        const QString data = record.value("data").toString();
+        if(data.startsWith(QLatin1String("BEGIN")))
+        {
+            transaction.clear();
+            continue;
+        }
+        if(data.startsWith(QLatin1String("COMMIT")))
+        {
+            for(const auto & notification: transaction)
+            {
+                if(!_connector)
+                    break;
+                _connector->dispatchNotification(notification);
+            }
+            transaction.clear();
+            commitLsn = record.value("lsn").toString();
+            continue;
+        }
+
+        QSharedPointer<SqlNotification> notification(new SqlNotification);
+        notification->iSource = QSqlDriver::OtherSource;
+        if(parseChange(data, *notification))
+            transaction << notification;
+    }
+
+    if(commitLsn.isEmpty() || !_connector)
+    {
+        _busy = false;
+        return;
+    }
+
+    // LSN строки COMMIT - конец записи о фиксации, поэтому после сдвига
+    // слота до него эта транзакция повторно не читается.
+    // Слот сдвигается без повторного декодирования и передачи изменений
+    const bool full = result.records.size() >= _batchSize;
+    _connector->sendQuery(QString("SELECT end_lsn::text AS lsn FROM pg_replication_slot_advance(%1, %2::pg_lsn);")
+                          .arg(SqlNotificationTrigger::quoteLiteral(_slotName),
+                               SqlNotificationTrigger::quoteLiteral(commitLsn)),
+                          this, [this, commitLsn, full](const QUuid &, const QueryResult & confirmed) {
+        onConfirmed(commitLsn, full, confirmed);
+    });
+}
+
+void SqlChangeDataCapture::onConfirmed(const QString &lsn, bool full, const QueryResult &result)
+{
+    _busy = false;
+
+    if(result.error.type() != QSqlError::NoError)
+    {
+        qWarning().noquote() << Title << "can't confirm changes up to" << lsn << result.error.text();
+        emit errorOccurred(result.error.text());
+        return;
+    }
+
+    _lastConfirmedLsn = lsn;
+    emit lsnConfirmed(lsn);
+
+    // Пачка заполнена целиком - скорее всего, изменения еще есть
+    if(full && isRunning())
+        QTimer::singleShot(0, this, &SqlChangeDataCapture::poll);
+}
+
+QString SqlChangeDataCapture::decodingOptions()
+{
+    return QStringLiteral("'include-xids', '0', 'skip-empty-xacts', '1'");
+}
@@ -0,0 +1,178 @@
+#include "SqlChangeFetcher.h"
+#include <QDebug>
+
+namespace
+{
+    QByteArray Title = QByteArrayLiteral("[SqlChangeFetcher] :");
+
+    //! Элемент литерала массива PostgreSQL ('{"a","b"}')
+    QString arrayElement(const QString & value)
+    {
+        QString escaped = value;
+        escaped.replace("\\", "\\\\");
+        escaped.replace("\"", "\\\"");
+        escaped.replace("'", "''");
+        return QString("\"%1\"").arg(escaped);
+    }
+}
+
+SqlChangeFetcher::SqlChangeFetcher(SqlDatabaseConnector *connector, const QString &schema,
+                                   const QString &table, QObject *parent) :
+    QObject(parent),
+    _connector { connector },
+    _schema { schema },
+    _table { table }
+{
+    _timer.setSingleShot(true);
+    _timer.setInterval(20);
+    connect(&_timer, &QTimer::timeout,
+            this, &SqlChangeFetcher::flush);
+}
+
+void SqlChangeFetcher::enqueue(const SqlNotification &notification)
+{
+    const QString & uuid = notification.itemUuid;
+    if(uuid.isEmpty())
+        return;
+
+    _source = notification.iSource;
+
+    auto it = _pending.find(uuid);
+    if(it == _pending.end())
+    {
+        _pending.insert(uuid, notification.actionType);
+        _order << uuid;
+    }
+    else if(it.value() == SqlNotification::INSERT && notification.actionType == SqlNotification::DELETE)
+    {
+        // Строка появилась и исчезла внутри одного окна
+        _pending.erase(it);
+        _order.removeOne(uuid);
+    }
+    else if(it.value() != SqlNotification::INSERT)
+        it.value() = notification.actionType;
+
+    // Таймер не перезапускается, чтобы задержка была не больше окна
+    if(!_timer.isActive())
+        _timer.start();
+}
+
+void SqlChangeFetcher::flush()
+{
+    _timer.stop();
+    if(_order.isEmpty())
+        return;
+
+    const QHash<QString, SqlNotification::ActionType> batch = _pending;
+    const QStringList order = _order;
+    _pending.clear();
+    _order.clear();
+
+    QStringList uuids;
+    for(const auto & uuid: order)
+    {
+        if(batch.value(uuid) != SqlNotification::DELETE)
+            uuids << uuid;
+    }
+
+    if(uuids.isEmpty() || !_connector)
+    {
+        onFetched(batch, order, QueryResult());
+        return;
+    }
+
+    _connector->sendQuery(fetchQuery(_schema, _table, _columns, uuids), this,
+                          [this, batch, order](const QUuid &, const QueryResult & result) {
+        onFetched(batch, order, result);
+    });
+}
+
+void SqlChangeFetcher::setTable(const QString &schema, const QString &table)
+{
+    if(schema == _schema && table == _table)
+        return;
+
+    flush();
+    _schema = schema;
+    _table = table;
+}
+
+int SqlChangeFetcher::window() const
+{
+    return _timer.interval();
+}
+
+void SqlChangeFetcher::setWindow(int ms)
+{
+    _timer.setInterval(ms);
+}
+
+const QString &SqlChangeFetcher::columns() const
+{
+    return _columns;
+}
+
+void SqlChangeFetcher::setColumns(const QString &columns)
+{
+    _columns = columns;
+}
+
+int SqlChangeFetcher::pendingCount() const
+{
+    return _order.size();
+}
+
+QString SqlChangeFetcher::fetchQuery(const QString &schema, const QString &table,
+                                     const QString &columns, const QStringList &uuids)
+{
+    QStringList elements;
+    elements.reserve(uuids.size());
+    for(const auto & uuid: uuids)
+        elements << arrayElement(uuid);
+
+    // Тип массива выводится из типа колонки _uuid (uuid или text)
+    return QString("SELECT %1 FROM %2.%3 WHERE _uuid = ANY('{%4}');")
+            .arg(columns, schema, table, elements.join(","));
+}
+
+void SqlChangeFetcher::onFetched(const QHash<QString, SqlNotification::ActionType> &batch,
+                                 const QStringList &order, const QueryResult &result)
+{
+    const bool failed = result.error.type() != QSqlError::NoError;
+    if(failed)
+        qWarning().noquote() << Title << QString("can't fetch changed rows of %1.%2 :").arg(_schema, _table)
+                             << result.error.text();
+
+    QHash<QString, QJsonObject> rows;
+    for(const auto & record: result.records)
+        rows.insert(record.value("_uuid").toString(), record);
+
+    QList<SqlNotification> out;
+    for(const auto & uuid: order)
+    {
+        SqlNotification notif;
+        notif.iSource = _source;
+        notif.itemUuid = uuid;
+        notif.schema = _schema;
+        notif.table = _table;
+        notif.format = SqlNotification::FullRow;
+        notif.actionType = batch.value(uuid);
+
+        auto row = rows.constFind(uuid);
+        if(notif.actionType == SqlNotification::DELETE)
+            notif.data.insert("_uuid", uuid);
+        else if(row != rows.constEnd())
+            notif.data = row.value();
+        else if(failed || notif.actionType == SqlNotification::INSERT)
+            continue;
+        else
+        {
+            notif.actionType = SqlNotification::DELETE;
+            notif.data.insert("_uuid", uuid);
+        }
+        out << notif;
+    }
+
+    if(!out.isEmpty())
+        emit resolved(out);
+}
@@ -17,11 +17,16 @@ SqlConnectorManager::SqlConnectorManager()
 //    qDebug() << "[SqlConnectorManager][constructor] : Registering meta types now";
     qRegisterMetaType<QueryResult> ();
     qRegisterMetaType<SqlNotification> ();
+    qRegisterMetaType<SqlNotification::ptr> ();
     qRegisterMetaType<QSqlDriver::NotificationSource> ();
 }
 
 SqlConnectorManager::~SqlConnectorManager()
 {
+    for(auto hub: _hubs)
+        delete hub;
+    for(auto set: _replicaSets)
+        delete set;
     for(auto conn: _connectors)
         delete conn;
 }
@@ -64,10 +69,100 @@ bool SqlConnectorManager::addConnection(const QString &baseName, const QString &
     return true;
 }
 
+bool SqlConnectorManager::addReplica(const QString &connectionName, const QString &baseName, const QString &host, int port)
+{
+    if(!_connectors.contains(connectionName))
+    {
+        qWarning() << Title << "can't add replica, don't have connection called" << connectionName;
+        return false;
+    }
+
+    SqlReplicaSet * set = _replicaSets.value(connectionName, nullptr);
+    if(!set)
+    {
+        set = new SqlReplicaSet(_connectors[connectionName]);
+        _replicaSets[connectionName] = set;
+    }
+
+    auto replica = new SqlDatabaseConnector(host, port, baseName);
+    replica->setConnectionName(QString("%1-replica-%2").arg(connectionName).arg(set->replicas().size()));
+    replica->setCodec(_connectors[connectionName]->codec());
+    set->addReplica(replica);
+
+    // Если основное соединение уже открыто, открываем и реплику
+    SqlDatabaseConnector * primary = _connectors[connectionName];
+    if(primary->isOpen())
+        replica->connectToBase(primary->username(), primary->password());
+    return true;
+}
+
+SqlReplicaSet *SqlConnectorManager::replicaSet(const QString &connectionName)
+{
+    return _replicaSets.value(connectionName, nullptr);
+}
+
+SqlDatabaseConnector *SqlConnectorManager::getReadConnector(const QString &connectionName)
+{
+    if(_replicaSets.contains(connectionName))
+        return _replicaSets[connectionName]->readConnector();
+    return getConnector(connectionName);
+}
+
+bool SqlConnectorManager::shareNotifications(const QString &connectionName)
+{
+    SqlDatabaseConnector * connector = getConnector(connectionName);
+    if(!connector)
+    {
+        qWarning() << Title << "can't share notifications, don't have connection called" << connectionName;
+        return false;
+    }
+
+    const QString key = SqlNotificationHub::key(connector->hostName(), connector->port(), connector->databaseName());
+    SqlNotificationHub * hub = _hubs.value(key, nullptr);
+    if(!hub)
+    {
+        hub = new SqlNotificationHub(connector->hostName(), connector->port(), connector->databaseName());
+        hub->setCodec(connector->codec());
+        hub->setListenMode(connector->listenMode());
+        _hubs[key] = hub;
+    }
+
+    hub->attach(connector);
+    if(connector->isOpen() && !hub->isOpen())
+        hub->open(connector->username(), connector->password());
+    return true;
+}
+
+SqlNotificationHub *SqlConnectorManager::notificationHub(const QString &connectionName)
+{
+    SqlDatabaseConnector * connector = getConnector(connectionName);
+    return connector ? connector->notificationHub() : nullptr;
+}
+
+void SqlConnectorManager::releaseHub(SqlDatabaseConnector *connector)
+{
+    SqlNotificationHub * hub = connector->notificationHub();
+    if(!hub)
+        return;
+
+    hub->detach(connector);
+    if(hub->connectors().isEmpty())
+    {
+        _hubs.remove(_hubs.key(hub));
+        delete hub;
+    }
+}
+
 void SqlConnectorManager::removeConnection(const QString connectionName)
 {
+    if(_replicaSets.contains(connectionName))
+    {
+        delete _replicaSets[connectionName];
+        _replicaSets.remove(connectionName);
+    }
     if(_connectors.contains(connectionName))
     {
+        releaseHub(_connectors[connectionName]);
         delete _connectors[connectionName];
         _connectors.remove(connectionName);
     }
@@ -80,7 +175,22 @@ bool SqlConnectorManager::openConnection(const QString connectionName, const QSt
         qWarning() << Title << "don't have connection called" << connectionName;
         return false;
     }
-    return _connectors[connectionName]->connectToBase(username, password);
+    bool ok = _connectors[connectionName]->connectToBase(username, password);
+
+    SqlNotificationHub * hub = _connectors[connectionName]->notificationHub();
+    if(ok && hub && !hub->isOpen())
+        hub->open(username, password);
+
+    // Реплика, которая не открылась, просто не получает запросы на чтение
+    if(ok && _replicaSets.contains(connectionName))
+    {
+        for(const auto & replica: _replicaSets[connectionName]->replicas())
+        {
+            if(!replica.connector->isOpen())
+                replica.connector->connectToBase(username, password);
+        }
+    }
+    return ok;
 }
 
 bool SqlConnectorManager::closeConnection(const QString &connectionName)
@@ -90,5 +200,22 @@ bool SqlConnectorManager::closeConnection(const QString &connectionName)
         qWarning() << Title << "don't have connection named" << connectionName;
         return false;
     }
-    return _connectors[connectionName]->disconnectFromBase();
+    if(_replicaSets.contains(connectionName))
+    {
+        for(const auto & replica: _replicaSets[connectionName]->replicas())
+            replica.connector->disconnectFromBase();
+    }
+    bool ok = _connectors[connectionName]->disconnectFromBase();
+
+    // Хаб закрывается вместе с последним открытым соединением
+    SqlNotificationHub * hub = _connectors[connectionName]->notificationHub();
+    if(hub)
+    {
+        bool anyOpen = false;
+        for(auto connector: hub->connectors())
+            anyOpen = anyOpen || connector->isOpen();
+        if(!anyOpen)
+            hub->close();
+    }
+    return ok;
 }
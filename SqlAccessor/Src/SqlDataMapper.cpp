@@ -1,51 +1,208 @@
 #include "SqlDataMapper.h"
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+namespace
+{
+    QList<QVariant> uniqueSorted(QList<QVariant> values)
+    {
+        std::sort(values.begin(), values.end(),
+                  [](const QVariant & a, const QVariant & b) { return a < b; });
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+        return values;
+    }
+
+    //! Границы double, которые точно помещаются в qint64: [-2^63, 2^63)
+    const double Int64Lower = -9223372036854775808.0;
+    const double Int64Upper = 9223372036854775808.0;
+}
+
+SqlDataMapper::Key SqlDataMapper::Key::from(const QVariant &value)
+{
+    Key key;
+    key.value = value;
+
+    switch(int(value.type()))
+    {
+    case QMetaType::Int:
+    case QMetaType::LongLong:
+    case QMetaType::Short:
+    case QMetaType::Char:
+    case QMetaType::SChar:
+    case QMetaType::Long:
+    case QMetaType::Bool:
+        key.kind = Integer;
+        key.integer = value.toLongLong();
+        return key;
+    case QMetaType::UInt:
+    case QMetaType::UShort:
+    case QMetaType::UChar:
+    case QMetaType::ULong:
+    case QMetaType::ULongLong:
+    {
+        const qulonglong number = value.toULongLong();
+        if(number <= qulonglong(std::numeric_limits<qint64>::max()))
+        {
+            key.kind = Integer;
+            key.integer = qint64(number);
+        }
+        else
+        {
+            key.kind = Real;
+            key.real = double(number);
+        }
+        return key;
+    }
+    case QMetaType::Double:
+    case QMetaType::Float:
+    {
+        const double number = value.toDouble();
+        if(std::trunc(number) == number && number >= Int64Lower && number < Int64Upper)
+        {
+            key.kind = Integer;
+            key.integer = qint64(number);
+        }
+        else
+        {
+            key.kind = Real;
+            key.real = number;
+        }
+        return key;
+    }
+    case QMetaType::QString:
+    {
+        key.text = value.toString();
+        // "1" и 1 - один ключ, но только для точной записи целого ("01", "1.0" - текст)
+        bool ok = false;
+        const qint64 number = key.text.toLongLong(&ok);
+        if(ok && QString::number(number) == key.text)
+        {
+            key.kind = Integer;
+            key.integer = number;
+        }
+        else
+            key.kind = Text;
+        return key;
+    }
+    default:
+        key.kind = Other;
+        key.text = value.toString();
+        return key;
+    }
+}
+
+bool operator ==(const SqlDataMapper::Key &a, const SqlDataMapper::Key &b)
+{
+    if(a.kind != b.kind)
+        return false;
+
+    switch(a.kind)
+    {
+    case SqlDataMapper::Key::Integer: return a.integer == b.integer;
+    case SqlDataMapper::Key::Real:    return a.real == b.real;
+    case SqlDataMapper::Key::Text:    return a.text == b.text;
+    case SqlDataMapper::Key::Other:   return a.value == b.value;
+    }
+    return false;
+}
+
+uint qHash(const SqlDataMapper::Key &key, uint seed)
+{
+    switch(key.kind)
+    {
+    case SqlDataMapper::Key::Integer: return qHash(key.integer, seed);
+    case SqlDataMapper::Key::Real:    return qHash(key.real, seed);
+    default:                          return qHash(key.text, seed);
+    }
+}
 
 SqlDataMapper::SqlDataMapper(QList<QPair<QVariant, QVariant>> datamap)
 {
+    pairs.reserve(datamap.size());
+    base_index.reserve(datamap.size());
+    screen_index.reserve(datamap.size());
     for(auto pair: datamap)
     {
         registerValue(pair);
     }
 }
 
+int SqlDataMapper::findIndex(const QHash<Key, int> &index, const QVariant &key) const
+{
+    return index.value(Key::from(key), -1);
+}
+
 const QVariant SqlDataMapper::bval(const QVariant &skey) const
 {
-    if(screen_values.contains(skey))
-        return screen_values[skey];
+    int i = findIndex(screen_index, skey);
+    if(i >= 0)
+        return pairs[i].first;
     else
         return "Неизвестно";
 }
 
 const QVariant SqlDataMapper::sval(const QVariant &bkey) const
 {
-    if(base_values.contains(bkey))
-        return base_values[bkey];
+    int i = findIndex(base_index, bkey);
+    if(i >= 0)
+        return pairs[i].second;
     else
         return "0";
 }
 
+QVariantList SqlDataMapper::bvals(const QVariantList &skeys) const
+{
+    QVariantList out;
+    out.reserve(skeys.size());
+    for(const auto & key: skeys)
+        out << bval(key);
+    return out;
+}
+
+QVariantList SqlDataMapper::svals(const QVariantList &bkeys) const
+{
+    QVariantList out;
+    out.reserve(bkeys.size());
+    for(const auto & key: bkeys)
+        out << sval(key);
+    return out;
+}
+
 void SqlDataMapper::registerValue(QPair<QVariant, QVariant> pair)
 {
-    base_values[pair.first] = pair.second;
-    screen_values[pair.second] = pair.first;
+    pairs << pair;
+    base_index[Key::from(pair.first)] = pairs.size() - 1;
+    screen_index[Key::from(pair.second)] = pairs.size() - 1;
 }
 
 const QVariant SqlDataMapper::operator [](const QVariant &key) const
 {
-    if(base_values.contains(key))
-        return base_values[key];
-    else if (screen_values.contains(key))
-        return screen_values[key];
-    else
-        return "0";
+    int i = findIndex(base_index, key);
+    if(i >= 0)
+        return pairs[i].second;
+
+    i = findIndex(screen_index, key);
+    if(i >= 0)
+        return pairs[i].first;
+
+    return "0";
 }
 
 QList<QVariant> SqlDataMapper::allScreenValues() const
 {
-    return screen_values.keys();
+    QList<QVariant> out;
+    out.reserve(pairs.size());
+    for(const auto & pair: pairs)
+        out << pair.second;
+    return uniqueSorted(out);
 }
 
 QList<QVariant> SqlDataMapper::allBaseValues() const
 {
-    return base_values.keys();
+    QList<QVariant> out;
+    out.reserve(pairs.size());
+    for(const auto & pair: pairs)
+        out << pair.first;
+    return uniqueSorted(out);
 }
@@ -1,4 +1,7 @@
 #include "SqlDatabaseConnector.h"
+#include "SqlNotificationTrigger.h"
+#include "SqlNotificationHub.h"
+#include "SqlQueryText.h"
 #include <QDebug>
 #include <QSqlError>
 #include <QSqlResult>
@@ -6,34 +9,19 @@
 #include <QSqlDriver>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QElapsedTimer>
+#include <QtConcurrent>
+#include <QMetaMethod>
 
 namespace
 {
     QByteArray Title = QByteArrayLiteral("[SqlDatabaseConnector] :");
 }
 
-inline QJsonObject recordToJson(const QSqlRecord & record, QTextCodec * codec)
-{
-    QJsonObject out;
-//    qDebug().noquote() << "[recordToJson] : handling record : " << record;
-    for(int i = 0; i < record.count(); i++)
-    {
-        QJsonValue value;
-        if(codec)
-            value = QJsonValue::fromVariant(codec->toUnicode(record.value(i).toByteArray()));
-        else
-            value = QJsonValue::fromVariant(record.value(i));
-
-        out.insert(record.fieldName(i), value);
-    }
-//    qDebug().noquote() << "[recordToJson] : created json : " << out;
-    return out;
-}
-
 
 SqlDatabaseConnector::SqlDatabaseConnector(QObject * parent):
     QObject(parent),
-    _database {QSqlDatabase::addDatabase("QPSQL")}
+    _database {QSqlDatabase::addDatabase("QPSQL", QUuid::createUuid().toString())}
 {
 //    _mutex = new QMutex();
 //    moveToThread(&_thread);
@@ -42,8 +30,8 @@ SqlDatabaseConnector::SqlDatabaseConnector(QObject * parent):
 
     connect(this, &SqlDatabaseConnector::sendQuerySignal,
             this, &SqlDatabaseConnector::onSendQuery);
-    connect(this, &SqlDatabaseConnector::queryFinishedSignal,
-            this, &SqlDatabaseConnector::onQueryFinished);
+
+    _clock.start();
 }
 
 SqlDatabaseConnector::SqlDatabaseConnector(const QString baseHost, int port, const QString baseName, QObject *parent) :
@@ -59,7 +47,19 @@ SqlDatabaseConnector::~SqlDatabaseConnector()
 {
 //    _thread.exit(0);
 //    delete _mutex;
+    delete _query;
+    _query = nullptr;
+
+    if(_hub)
+    {
+        for(auto it = _watchedChannels.constBegin(); it != _watchedChannels.constEnd(); ++it)
+            notifyHub(it.key(), false);
+    }
+
+    const QString sqlConnectionName = _database.connectionName();
     _database.close();
+    _database = QSqlDatabase();
+    QSqlDatabase::removeDatabase(sqlConnectionName);
     qDebug() << Title << connectionName() << "closed connection";
 }
 
@@ -100,14 +100,43 @@ const QString SqlDatabaseConnector::connectionName() const
 
 void SqlDatabaseConnector::sendQuery(const QUuid &uuid, const QString &query)
 {
+    // Запросы из sendQuery() с обработчиком уже учтены, остальные учитываются здесь
+    if(!enterQueue(uuid, query, NormalPriority))
+    {
+        QueryResult out;
+        out.error = QSqlError(QString(), "query queue is full", QSqlError::UnknownError);
+        dispatchResult(uuid, out);
+        emit queryErrorSignal(uuid, out.error);
+        return;
+    }
+
+    if(SqlQueryText::mayWrite(query))
+    {
+        bool counted = true;
+        {
+            QMutexLocker locker(&_pendingMutex);
+            counted = _pending.contains(uuid);
+            if(!counted)
+                _writeSequence++;
+        }
+        if(!counted)
+            emit writeQueued(uuid);
+    }
+
     if(debug) qDebug() << m_state;
-    if(_queue.isEmpty() && m_state == Idle)
+    bool queued = false;
+    {
+        QMutexLocker locker(&_queueMutex);
+        if(!_queue.isEmpty() || m_state != Idle)
+        {
+            _queue.push_back({uuid, query});
+            queued = true;
+        }
+    }
+    if(!queued)
         emit sendQuerySignal(uuid, query);
     else
-    {
         qDebug().noquote() << Title << "Queuing query" << uuid.toString().mid(1, 36);
-        _queue.push_back({uuid, query});
-    }
 }
 
 bool SqlDatabaseConnector::connectToBase(const QString &username, const QString &password)
@@ -149,15 +178,12 @@ bool SqlDatabaseConnector::connectToBase(const QString &host, int port, const QS
     qDebug().noquote() << Title << "connected to database" << databaseName() << "as user" << this->username();
     m_state = Idle;
     emit connected();
+    processQueue();
 
-    if(!_database.driver()->subscribeToNotification(IDSqlChangedEvent))
-        qDebug().noquote() << Title << _database.driver()->lastError().databaseText();
-    else
-        qDebug().noquote().nospace() << Title << "subscribed for notification \"" << IDSqlChangedEvent << "\"";
-
-    connect(_database.driver(), SIGNAL(notification(const QString &, QSqlDriver::NotificationSource, const QVariant &)),
-            this, SLOT(onDBNotify(const QString &, QSqlDriver::NotificationSource, const QVariant &)));
+    if(!m_listenEnabled)
+        return true;
 
+    updateSubscriptions();
     return true;
 }
 
@@ -165,21 +191,273 @@ bool SqlDatabaseConnector::disconnectFromBase()
 {
     if(isOpen()){
         _database.close();
+        m_state = Disconnected;
         emit disconnected();
     }
     return true;
 }
 
-void SqlDatabaseConnector::onSendQuery(const QUuid &uuid, const QString query_str)
+QFuture<QueryResult> SqlDatabaseConnector::execute(const QString &query, Priority priority)
 {
-    QString query_str_coded = query_str;
+    QFutureInterface<QueryResult> promise;
+    promise.reportStarted();
+    QFuture<QueryResult> future = promise.future();
+
+    sendQuery(query, nullptr, [promise](const QUuid &, const QueryResult & result) mutable {
+        promise.reportResult(result);
+        promise.reportFinished();
+    }, priority);
+    return future;
+}
+
+QUuid SqlDatabaseConnector::sendQuery(const QString &query, QObject *receiver, ResultHandler handler,
+                                      Priority priority)
+{
+    QUuid uuid = QUuid::createUuid();
+    PendingQuery pending { QPointer<QObject>(receiver), receiver != nullptr, handler };
+
+    if(!enterQueue(uuid, query, priority))
+    {
+        // Обработчик вызывается не внутри sendQuery(), а как обычно - после возврата
+        QueryResult out;
+        out.error = QSqlError(QString(), "query queue is full", QSqlError::UnknownError);
+        QMetaObject::invokeMethod(this, [this, uuid, pending, out]() {
+            deliverResult(uuid, pending, out);
+            emit queryErrorSignal(uuid, out.error);
+        }, Qt::QueuedConnection);
+        return uuid;
+    }
+
+    bool attached = false;
+    const SqlQueryText::Kind kind = SqlQueryText::classify(query);
+    const bool write = kind == SqlQueryText::Write;
+    {
+        QMutexLocker locker(&_pendingMutex);
+        if(write)
+            _writeSequence++;
+        else if(_selectDeduplication && kind == SqlQueryText::PureRead)
+        {
+            // Такой же SELECT уже в очереди или выполняется, и после него
+            // не отправлялось запросов на запись - ждем его результат
+            auto inflight = _inflightSelects.constFind(query);
+            if(inflight != _inflightSelects.constEnd() &&
+               inflight.value().writeSequence == _writeSequence)
+            {
+                _followers[inflight.value().leader] << qMakePair(uuid, pending);
+                _dedupHits++;
+                if(debug) qDebug().noquote() << Title << "attached to in-flight query" << inflight.value().leader.toString().mid(1, 36);
+                attached = true;
+            }
+            else
+            {
+                _inflightSelects.insert(query, InflightSelect { uuid, _writeSequence });
+                pending.dedupKey = query;
+            }
+        }
+        if(!attached)
+            _pending.insert(uuid, pending);
+    }
+
+    if(write)
+        emit writeQueued(uuid);
+
+    // Присоединенный запрос отдельно не выполняется и места в очереди не занимает
+    if(attached)
+    {
+        leaveQueue(uuid, false);
+        return uuid;
+    }
+
+    // Очередь коннектора не защищена мютексом, поэтому из чужого потока
+    // запрос передается через очередь событий
+    QMetaObject::invokeMethod(this, "sendQuery", Qt::AutoConnection,
+                              Q_ARG(QUuid, uuid), Q_ARG(QString, query));
+    return uuid;
+}
+
+int SqlDatabaseConnector::pendingCount()
+{
+    QMutexLocker locker(&_pendingMutex);
+    int count = _pending.size();
+    for(const auto & followers: _followers)
+        count += followers.size();
+    return count;
+}
+
+quint64 SqlDatabaseConnector::dedupHits()
+{
+    QMutexLocker locker(&_pendingMutex);
+    return _dedupHits;
+}
+
+bool SqlDatabaseConnector::selectDeduplication() const
+{
+    return _selectDeduplication;
+}
+
+void SqlDatabaseConnector::setSelectDeduplication(bool enabled)
+{
+    QMutexLocker locker(&_pendingMutex);
+    _selectDeduplication = enabled;
+}
+
+bool SqlDatabaseConnector::typedResults() const
+{
+    return _typedResults;
+}
+
+void SqlDatabaseConnector::setTypedResults(bool enabled)
+{
+    _typedResults = enabled;
+    // Результаты в кэше другого вида
+    _cache.clear();
+}
+
+bool SqlDatabaseConnector::resultCacheEnabled() const
+{
+    return _resultCacheEnabled;
+}
+
+void SqlDatabaseConnector::setResultCacheEnabled(bool enabled)
+{
+    _resultCacheEnabled = enabled;
+    if(!enabled)
+        _cache.clear();
+}
+
+void SqlDatabaseConnector::setResultCacheBudget(qint64 bytes)
+{
+    _cache.setBudget(bytes);
+}
+
+SqlQueryCache::Stats SqlDatabaseConnector::resultCacheStats() const
+{
+    return _cache.stats();
+}
+
+void SqlDatabaseConnector::setSlowQueryThreshold(qint64 ms)
+{
+    _slowLog->setThreshold(ms);
+}
 
+qint64 SqlDatabaseConnector::slowQueryThreshold() const
+{
+    return _slowLog->threshold();
+}
+
+void SqlDatabaseConnector::setSlowQueryLogSize(int entries)
+{
+    _slowLog->setCapacity(entries);
+}
+
+void SqlDatabaseConnector::setSlowQueryExplain(ExplainMode mode)
+{
+    _slowQueryExplain = mode;
+}
+
+SqlDatabaseConnector::ExplainMode SqlDatabaseConnector::slowQueryExplain() const
+{
+    return _slowQueryExplain;
+}
+
+QList<SqlSlowQueryLog::Entry> SqlDatabaseConnector::slowQueries() const
+{
+    return _slowLog->entries();
+}
+
+bool SqlDatabaseConnector::dumpSlowQueries(QIODevice *device) const
+{
+    return _slowLog->dump(device);
+}
+
+void SqlDatabaseConnector::clearSlowQueries()
+{
+    _slowLog->clear();
+}
+
+SqlDatabaseConnector::MemoryUsage SqlDatabaseConnector::memoryUsage() const
+{
+    // Узел QHash/QQueue, обработчик std::function с захваченными значениями
+    const qint64 NodeSize = 48;
+    const qint64 HandlerSize = 64;
+
+    MemoryUsage out;
+    {
+        QMutexLocker locker(&_queueMutex);
+        out.queue = _queueStats.bytes + _waiting.size() * NodeSize
+                + _queue.size() * (NodeSize + qint64(sizeof(QPair<QUuid, QString>)));
+    }
+    {
+        QMutexLocker locker(&_pendingMutex);
+        out.pending = _pending.size() * (NodeSize + qint64(sizeof(PendingQuery)) + HandlerSize);
+        for(auto it = _followers.constBegin(); it != _followers.constEnd(); ++it)
+            out.pending += NodeSize + it.value().size() * (NodeSize + qint64(sizeof(PendingQuery)) + HandlerSize);
+        for(auto it = _inflightSelects.constBegin(); it != _inflightSelects.constEnd(); ++it)
+            out.pending += NodeSize + it.key().size() * qint64(sizeof(QChar));
+    }
+    out.undelivered = _undelivered->loadAcquire();
+    out.resultCache = _cache.stats().bytes;
+    out.slowLog = _slowLog->memoryUsage();
+    return out;
+}
+
+qint64 SqlDatabaseConnector::memoryBudget() const
+{
+    return _memoryBudget;
+}
+
+void SqlDatabaseConnector::setMemoryBudget(qint64 bytes)
+{
+    _memoryBudget = qMax<qint64>(0, bytes);
+    _memoryBudgetExceeded = false;
+}
+
+void SqlDatabaseConnector::onSendQuery(const QUuid &uuid, const QString query_str)
+{
     if(!_database.isOpen())
     {
         qWarning() << Title << "base is not open, can't send a query!";
+
+        QueryResult out;
+        out.error = QSqlError(QString(), "database is not open", QSqlError::ConnectionError);
+        leaveQueue(uuid, false);
+        dispatchResult(uuid, out);
         return;
     }
 
+    {
+        QMutexLocker locker(&_queueMutex);
+        if(!_queue.isEmpty() || m_state != Idle)
+        {
+            _queue.push_back({uuid, query_str});
+            locker.unlock();
+            if(debug) qDebug() << Title << "Putting query in queue";
+            return;
+        }
+    }
+
+    executeQuery(uuid, query_str);
+    processQueue();
+}
+
+void SqlDatabaseConnector::executeQuery(const QUuid &uuid, const QString &query_str)
+{
+    const qint64 waitMs = leaveQueue(uuid);
+
+    const SqlQueryText::Kind kind = SqlQueryText::classify(query_str);
+    if(_resultCacheEnabled && kind == SqlQueryText::PureRead)
+    {
+        QueryResult cached;
+        if(_cache.lookup(query_str, cached))
+        {
+            if(debug) qDebug().noquote() << Title << "Result taken from cache" << uuid.toString().mid(1, 36);
+            dispatchResult(uuid, cached);
+            emit queryFinishedSignal(uuid, cached);
+            return;
+        }
+    }
+
+    QString query_str_coded = query_str;
 
     if(!_query)
     {
@@ -188,23 +466,20 @@ void SqlDatabaseConnector::onSendQuery(const QUuid &uuid, const QString query_st
         _query->setForwardOnly(true);
     }
 
-    if(!_queue.isEmpty() || m_state != Idle)
-    {
-        if(debug) qDebug() << Title << "Putting query in queue";
-        _queue.push_back({uuid, query_str});
-        return;
-    }
-
-
     if (debug) qDebug().noquote() << "[SqlDatabaseConnector] : executing query:" << query_str;
     m_state = Busy;
     _query->finish();
 
-    if(_codec)
-        query_str_coded = _codec->fromUnicode(query_str);
+    if(_decoder.codec())
+        query_str_coded = _decoder.codec()->fromUnicode(query_str);
     // qDebug() << query_str_coded;
 
+    const QDateTime startedAt = QDateTime::currentDateTime();
+    QElapsedTimer timer;
+    timer.start();
+
     bool ok = _query->exec(query_str_coded);
+    const qint64 executeMs = timer.elapsed();
 
     if(!ok)
     {
@@ -221,26 +496,140 @@ void SqlDatabaseConnector::onSendQuery(const QUuid &uuid, const QString query_st
     out.error = _query->lastError();
     out.isSelect = _query->isSelect();
     if(out.isSelect)
-        while(_query->next()){
-            out.records << recordToJson(_query->record(), _codec);
+    {
+        const SqlTextDecoder::Plan plan = _decoder.plan(_query->record());
+        if(_typedResults)
+        {
+            out.columns = plan.fieldNames;
+            while(_query->next())
+                out.rows << _decoder.recordToValues(_query->record(), plan);
+        }
+        else
+        {
+            while(_query->next()){
+                out.records << _decoder.recordToJson(_query->record(), plan);
+            }
         }
+    }
 
+    const int affectedRows = out.isSelect ? qMax(out.rows.size(), out.records.size())
+                                          : _query->numRowsAffected();
     _query->finish();
 
+    const qint64 fetchMs = timer.elapsed() - executeMs;
+    if(_slowLog->isSlow(executeMs + fetchMs))
+    {
+        SqlSlowQueryLog::Entry entry;
+        entry.uuid = uuid;
+        entry.startedAt = startedAt;
+        entry.query = query_str;
+        entry.waitMs = qMax<qint64>(0, waitMs);
+        entry.executeMs = executeMs;
+        entry.fetchMs = fetchMs;
+        entry.rows = affectedRows;
+        if(!ok)
+            entry.error = out.error.text();
+        _slowLog->record(entry);
+
+        if(debug) qDebug().noquote() << Title << "Slow query" << uuid.toString().mid(1, 36)
+                                     << executeMs + fetchMs << "ms";
+        if(ok)
+            explainSlowQuery(uuid, query_str);
+        emit slowQuery(uuid, executeMs + fetchMs);
+    }
+
+    if(_resultCacheEnabled)
+    {
+        if(kind == SqlQueryText::Write)
+            _cache.invalidateQuery(query_str);
+        else if(kind == SqlQueryText::PureRead && ok && out.isSelect)
+        {
+            // В режиме TableChannels уведомления приходят только по таблицам
+            // менеджеров, результат по другим таблицам некому инвалидировать
+            _cache.insert(query_str, out, [this](const QString & schema, const QString & table) {
+                return m_listenMode != TableChannels ||
+                       _watchedChannels.contains(SqlNotificationTrigger::channelName(schema, table));
+            });
+        }
+    }
 
+    dispatchResult(uuid, out);
     emit queryFinishedSignal(uuid, out);
     m_state = Idle;
+
+    checkMemoryBudget();
+}
+
+void SqlDatabaseConnector::processQueue()
+{
+    // Запросы, поставленные в очередь из обработчиков результата,
+    // выполняются здесь, после того как коннектор снова стал Idle
+    while(m_state == Idle && _database.isOpen())
+    {
+        QPair<QUuid, QString> q;
+        {
+            QMutexLocker locker(&_queueMutex);
+            if(_queue.isEmpty())
+                break;
+            q = _queue.dequeue();
+        }
+        if (debug) qDebug().noquote() << Title << "Dequeuing query" << q.first.toString().mid(1, 36);
+        executeQuery(q.first, q.second);
+    }
+}
+
+void SqlDatabaseConnector::dispatchResult(const QUuid &uuid, const QueryResult &result)
+{
+    PendingQuery pending;
+    QList<QPair<QUuid, PendingQuery>> followers;
+    {
+        QMutexLocker locker(&_pendingMutex);
+        auto it = _pending.find(uuid);
+        if(it == _pending.end())
+            return;
+        pending = it.value();
+        _pending.erase(it);
+
+        if(!pending.dedupKey.isEmpty())
+        {
+            auto inflight = _inflightSelects.find(pending.dedupKey);
+            if(inflight != _inflightSelects.end() && inflight.value().leader == uuid)
+                _inflightSelects.erase(inflight);
+            followers = _followers.take(uuid);
+        }
+    }
+
+    deliverResult(uuid, pending, result);
+    for(const auto & follower: followers)
+        deliverResult(follower.first, follower.second, result);
 }
 
-void SqlDatabaseConnector::onQueryFinished(const QUuid &uuid, QueryResult res)
+void SqlDatabaseConnector::deliverResult(const QUuid &uuid, const PendingQuery &pending, const QueryResult &result)
 {
-    Q_UNUSED(res)
+    if(!pending.hasReceiver)
+    {
+        pending.handler(uuid, result);
+        return;
+    }
+
+    QObject * receiver = pending.receiver.data();
+    if(!receiver)
+        return;
 
-    if(!_queue.isEmpty())
+    if(receiver->thread() == QThread::currentThread())
+        pending.handler(uuid, result);
+    else
     {
-        auto q = _queue.dequeue();
-        if (debug) qDebug().noquote() << Title << "Dequeuing query" << uuid.toString().mid(1, 36);
-        emit sendQuerySignal(q.first, q.second);
+        // Результат ждет в очереди событий получателя, это тоже учитывается в memoryUsage()
+        const qint64 size = _memoryBudget > 0 ? SqlQueryCache::estimateSize(result) : 0;
+        std::shared_ptr<QAtomicInteger<qint64>> undelivered = _undelivered;
+        undelivered->fetchAndAddOrdered(size);
+
+        ResultHandler handler = pending.handler;
+        QMetaObject::invokeMethod(receiver, [handler, uuid, result, undelivered, size]() {
+            undelivered->fetchAndAddOrdered(-size);
+            handler(uuid, result);
+        }, Qt::QueuedConnection);
     }
 }
 
@@ -253,13 +642,11 @@ void SqlDatabaseConnector::onDBNotify(const QString &name, QSqlDriver::Notificat
     // qDebug() << "Source: " << source;
     // qDebug() << "Payload: " << payload;
 
-    SqlNotification notif;
+    // Уведомление разбирается один раз и дальше передается только по указателю
+    QSharedPointer<SqlNotification> parsed(new SqlNotification);
+    SqlNotification & notif = *parsed;
 
-    QByteArray bytes = payload.toByteArray();
-    if(_codec)
-        bytes = _codec->toUnicode(bytes).toUtf8();
-
-    QJsonObject obj = QJsonDocument::fromJson(bytes).object();
+    QJsonObject obj = QJsonDocument::fromJson(_decoder.decodePayload(payload)).object();
 
     if (debug) qDebug().noquote() << obj;
 
@@ -269,6 +656,9 @@ void SqlDatabaseConnector::onDBNotify(const QString &name, QSqlDriver::Notificat
     notif.table = obj.value("table").toString();
     notif.schema = obj.value("schema").toString();
     notif.itemUuid = notif.data.value("_uuid").toString();
+    notif.format = obj.value("format") == "pointer" ? SqlNotification::ChangePointer :
+                   obj.value("format") == "diff"    ? SqlNotification::ColumnDiff :
+                                                      SqlNotification::FullRow;
 
     notif.actionType = obj.value("action") == "UPDATE" ? SqlNotification::UPDATE :
                        obj.value("action") == "INSERT" ? SqlNotification::INSERT :
@@ -280,11 +670,30 @@ void SqlDatabaseConnector::onDBNotify(const QString &name, QSqlDriver::Notificat
         qDebug().noquote() << "-------Scheme: " << notif.schema;
         qDebug().noquote() << "-------Table: " << notif.table;
         qDebug().noquote() << "-------Action" << notif.actionType;
+        qDebug().noquote() << "-------Format" << notif.format;
         qDebug().noquote() << "-------Data: " << notif.data;
         qDebug().noquote() << "-------Old data: " << notif.oldData;
         qDebug() << "";
     }
-    emit dbNotification(notif);
+
+    dispatchNotification(parsed);
+}
+
+void SqlDatabaseConnector::dispatchNotification(SqlNotification::ptr notification)
+{
+    if(_resultCacheEnabled)
+        _cache.invalidateTable(notification->schema, notification->table);
+
+    if(m_listenMode == TableChannels &&
+       !_watchedChannels.contains(SqlNotificationTrigger::channelName(notification->schema, notification->table)))
+        return;
+
+    // Копия уведомления для сигнала по значению делается только при наличии подписчиков,
+    // менеджеры и хаб работают через sharedNotification
+    static const QMetaMethod valueSignal = QMetaMethod::fromSignal(&SqlDatabaseConnector::dbNotification);
+    if(isSignalConnected(valueSignal))
+        emit dbNotification(*notification);
+    emit sharedNotification(notification);
 }
 
 const SqlDatabaseConnector::State &SqlDatabaseConnector::state() const
@@ -294,13 +703,400 @@ const SqlDatabaseConnector::State &SqlDatabaseConnector::state() const
 
 QTextCodec * const SqlDatabaseConnector::codec() const
 {
-    return _codec;
+    return _decoder.codec();
 }
 
 void SqlDatabaseConnector::setCodec(QTextCodec *codec)
 {
-    _codec = codec;
-    qDebug().noquote().nospace() << "[SqlDatabaseConnector] : using codec : '" << codec->name() << "'";
+    _decoder.setCodec(codec);
+    if(codec)
+        qDebug().noquote().nospace() << "[SqlDatabaseConnector] : using codec : '" << codec->name() << "'";
+    else
+        qDebug().noquote() << "[SqlDatabaseConnector] : codec removed";
+}
+
+bool SqlDatabaseConnector::listenEnabled() const
+{
+    return m_listenEnabled;
+}
+
+void SqlDatabaseConnector::setListenEnabled(bool enabled)
+{
+    m_listenEnabled = enabled;
+    updateSubscriptions();
+}
+
+SqlDatabaseConnector::ListenMode SqlDatabaseConnector::listenMode() const
+{
+    return m_listenMode;
+}
+
+void SqlDatabaseConnector::setListenMode(ListenMode mode)
+{
+    // Результаты по таблицам, на каналы которых коннектор больше не подписан,
+    // перестанут инвалидироваться
+    if(mode == TableChannels && m_listenMode != TableChannels)
+        _cache.clear();
+    m_listenMode = mode;
+    updateSubscriptions();
+}
+
+void SqlDatabaseConnector::watchTable(const QString &schema, const QString &table)
+{
+    if(table.isEmpty())
+        return;
+    watchChannel(SqlNotificationTrigger::channelName(schema, table));
+}
+
+void SqlDatabaseConnector::unwatchTable(const QString &schema, const QString &table)
+{
+    if(table.isEmpty())
+        return;
+    const QString channel = SqlNotificationTrigger::channelName(schema, table);
+    unwatchChannel(channel);
+    if(m_listenMode == TableChannels && !_watchedChannels.contains(channel))
+        _cache.invalidateTable(schema, table);
+}
+
+void SqlDatabaseConnector::watchChannel(const QString &channel)
+{
+    if(++_watchedChannels[channel] > 1)
+        return;
+
+    if(m_listenMode == TableChannels)
+        updateSubscriptions();
+    notifyHub(channel, true);
+}
+
+void SqlDatabaseConnector::unwatchChannel(const QString &channel)
+{
+    auto it = _watchedChannels.find(channel);
+    if(it == _watchedChannels.end())
+        return;
+
+    if(--it.value() > 0)
+        return;
+
+    _watchedChannels.erase(it);
+    if(m_listenMode == TableChannels)
+        updateSubscriptions();
+    notifyHub(channel, false);
+}
+
+QStringList SqlDatabaseConnector::watchedChannels() const
+{
+    return _watchedChannels.keys();
+}
+
+SqlNotificationHub *SqlDatabaseConnector::notificationHub() const
+{
+    return _hub.data();
+}
+
+void SqlDatabaseConnector::setNotificationHub(SqlNotificationHub *hub)
+{
+    if(_hub == hub)
+        return;
+
+    for(auto it = _watchedChannels.constBegin(); it != _watchedChannels.constEnd(); ++it)
+        notifyHub(it.key(), false);
+
+    _hub = hub;
+
+    for(auto it = _watchedChannels.constBegin(); it != _watchedChannels.constEnd(); ++it)
+        notifyHub(it.key(), true);
+
+    setListenEnabled(hub == nullptr);
+}
+
+void SqlDatabaseConnector::notifyHub(const QString &channel, bool watch)
+{
+    if(!_hub)
+        return;
+
+    // Хаб может жить в другом потоке
+    QPointer<SqlNotificationHub> hub = _hub;
+    QMetaObject::invokeMethod(hub, [hub, channel, watch]() {
+        if(!hub)
+            return;
+        if(watch)
+            hub->watchChannel(channel);
+        else
+            hub->unwatchChannel(channel);
+    }, Qt::AutoConnection);
+}
+
+void SqlDatabaseConnector::updateSubscriptions()
+{
+    if(!_database.isOpen())
+        return;
+
+    QSqlDriver * driver = _database.driver();
+
+    // Если подписка выключена, отписываемся от всех каналов
+    QSet<QString> wanted;
+    if(m_listenEnabled && m_listenMode == GlobalChannel)
+        wanted.insert(QString::fromLatin1(IDSqlChangedEvent));
+    else if(m_listenEnabled)
+    {
+        for(auto it = _watchedChannels.constBegin(); it != _watchedChannels.constEnd(); ++it)
+            wanted.insert(it.key());
+    }
+
+    for(const auto & channel: driver->subscribedToNotifications())
+    {
+        if(wanted.remove(channel))
+            continue;
+        if(!driver->unsubscribeFromNotification(channel))
+            qWarning().noquote() << Title << driver->lastError().databaseText();
+        else if(debug)
+            qDebug().noquote().nospace() << Title << "unsubscribed from notification \"" << channel << "\"";
+    }
+
+    for(const auto & channel: wanted)
+    {
+        if(!driver->subscribeToNotification(channel))
+            qWarning().noquote() << Title << driver->lastError().databaseText();
+        else
+            qDebug().noquote().nospace() << Title << "subscribed for notification \"" << channel << "\"";
+    }
+
+    if(m_listenEnabled)
+        connect(driver, SIGNAL(notification(const QString &, QSqlDriver::NotificationSource, const QVariant &)),
+                this, SLOT(onDBNotify(const QString &, QSqlDriver::NotificationSource, const QVariant &)),
+                Qt::UniqueConnection);
+}
+
+int SqlDatabaseConnector::queueSize() const
+{
+    QMutexLocker locker(&_queueMutex);
+    return _queue.size();
+}
+
+void SqlDatabaseConnector::setQueueLimit(int entries, qint64 bytes)
+{
+    QMutexLocker locker(&_queueMutex);
+    _queueLimit = qMax(0, entries);
+    _queueByteLimit = qMax<qint64>(0, bytes);
+    _queueNotFull.wakeAll();
+}
+
+int SqlDatabaseConnector::queueLimit() const
+{
+    QMutexLocker locker(&_queueMutex);
+    return _queueLimit;
+}
+
+qint64 SqlDatabaseConnector::queueByteLimit() const
+{
+    QMutexLocker locker(&_queueMutex);
+    return _queueByteLimit;
+}
+
+void SqlDatabaseConnector::setOverflowPolicy(Priority priority, OverflowPolicy policy)
+{
+    QMutexLocker locker(&_queueMutex);
+    _overflowPolicies[priority] = policy;
+    _queueNotFull.wakeAll();
+}
+
+SqlDatabaseConnector::OverflowPolicy SqlDatabaseConnector::overflowPolicy(Priority priority) const
+{
+    QMutexLocker locker(&_queueMutex);
+    return _overflowPolicies[priority];
+}
+
+void SqlDatabaseConnector::setQueueWatermarks(int high, int low)
+{
+    QMutexLocker locker(&_queueMutex);
+    _highWatermark = qMax(0, high);
+    _lowWatermark = qBound(0, low, _highWatermark);
+    _aboveHighWatermark = false;
+}
+
+void SqlDatabaseConnector::setQueueWaitThreshold(qint64 ms)
+{
+    QMutexLocker locker(&_queueMutex);
+    _queueWaitThreshold = qMax<qint64>(0, ms);
+    _queueWaitExceeded = false;
+}
+
+SqlDatabaseConnector::QueueStats SqlDatabaseConnector::queueStats() const
+{
+    QMutexLocker locker(&_queueMutex);
+    return _queueStats;
+}
+
+bool SqlDatabaseConnector::isQueueFull(qint64 bytes) const
+{
+    // Пустая очередь принимает запрос любого размера, иначе он не пройдет никогда
+    if(_queueStats.depth == 0)
+        return false;
+    return (_queueLimit > 0 && _queueStats.depth >= _queueLimit)
+        || (_queueByteLimit > 0 && _queueStats.bytes + bytes > _queueByteLimit);
+}
+
+bool SqlDatabaseConnector::enterQueue(const QUuid &uuid, const QString &query, Priority priority)
+{
+    const qint64 bytes = query.size() * qint64(sizeof(QChar));
+    int crossed = -1;
+    {
+        QMutexLocker locker(&_queueMutex);
+        if(_waiting.contains(uuid))
+            return true;
+
+        OverflowPolicy policy = _overflowPolicies[priority];
+        // Очередь разбирает поток коннектора, поэтому ждать в нем нельзя
+        if(policy == Block && QThread::currentThread() == thread())
+            policy = Accept;
+
+        if(policy != Accept && isQueueFull(bytes))
+        {
+            if(policy == Reject)
+            {
+                _queueStats.rejected++;
+                locker.unlock();
+                qWarning().noquote() << Title << "query queue is full, rejecting query" << uuid.toString().mid(1, 36);
+                emit queryRejected(uuid);
+                return false;
+            }
+
+            _queueStats.blocked++;
+            while(_overflowPolicies[priority] == Block && isQueueFull(bytes))
+                _queueNotFull.wait(&_queueMutex);
+        }
+
+        _waiting.insert(uuid, qMakePair(_clock.elapsed(), bytes));
+        _queueStats.depth++;
+        _queueStats.bytes += bytes;
+        _queueStats.peakDepth = qMax(_queueStats.peakDepth, _queueStats.depth);
+
+        if(_highWatermark > 0 && !_aboveHighWatermark && _queueStats.depth >= _highWatermark)
+        {
+            _aboveHighWatermark = true;
+            crossed = _queueStats.depth;
+        }
+    }
+
+    if(crossed >= 0)
+        emit queueHighWatermark(crossed);
+    return true;
+}
+
+qint64 SqlDatabaseConnector::leaveQueue(const QUuid &uuid, bool started)
+{
+    int lowDepth = -1;
+    qint64 exceeded = -1;
+    qint64 wait = -1;
+    {
+        QMutexLocker locker(&_queueMutex);
+        auto it = _waiting.find(uuid);
+        if(it == _waiting.end())
+            return -1;
+
+        _queueStats.depth--;
+        _queueStats.bytes -= it.value().second;
+        if(started)
+        {
+            wait = _clock.elapsed() - it.value().first;
+            _queueStats.lastWaitMs = wait;
+            _queueStats.maxWaitMs = qMax(_queueStats.maxWaitMs, wait);
+            _queueStats.averageWaitMs += (wait - _queueStats.averageWaitMs) / 16.0;
+
+            if(_queueWaitThreshold > 0)
+            {
+                if(wait >= _queueWaitThreshold && !_queueWaitExceeded)
+                    exceeded = wait;
+                _queueWaitExceeded = wait >= _queueWaitThreshold;
+            }
+        }
+        _waiting.erase(it);
+
+        if(_aboveHighWatermark && _queueStats.depth <= _lowWatermark)
+        {
+            _aboveHighWatermark = false;
+            lowDepth = _queueStats.depth;
+        }
+        _queueNotFull.wakeAll();
+    }
+
+    if(lowDepth >= 0)
+        emit queueLowWatermark(lowDepth);
+    if(exceeded >= 0)
+        emit queueWaitExceeded(exceeded);
+    return wait;
+}
+
+void SqlDatabaseConnector::checkMemoryBudget()
+{
+    if(_memoryBudget <= 0)
+        return;
+
+    const qint64 usage = memoryUsage().total();
+    const bool exceeded = usage > _memoryBudget;
+    if(exceeded && !_memoryBudgetExceeded)
+    {
+        qWarning().noquote() << Title << connectionName() << QString("uses ~%1 bytes, budget is %2")
+                                .arg(usage).arg(_memoryBudget);
+        _memoryBudgetExceeded = true;
+        emit memoryBudgetExceeded(usage, _memoryBudget);
+    }
+    else if(!exceeded)
+        _memoryBudgetExceeded = false;
+}
+
+void SqlDatabaseConnector::explainSlowQuery(const QUuid &uuid, const QString &query)
+{
+    if(_slowQueryExplain == NoExplain || !_slowLog->beginExplain())
+        return;
+
+    // ANALYZE выполняет запрос еще раз, поэтому только для чистого чтения:
+    // без записи, блокировок строк и вызовов функций, у которых могут быть побочные эффекты
+    const bool analyze = _slowQueryExplain == ExplainAnalyze && SqlQueryText::isPure(query);
+    const QString explain = (analyze ? QStringLiteral("EXPLAIN (ANALYZE, BUFFERS) ")
+                                     : QStringLiteral("EXPLAIN ")) + query;
+    const QString source = _database.connectionName();
+    QTextCodec * codec = _decoder.codec();
+    std::shared_ptr<SqlSlowQueryLog> log = _slowLog;
+
+    // Соединение нельзя использовать из другого потока, поэтому
+    // задача открывает свою копию и закрывает ее после EXPLAIN
+    QtConcurrent::run([log, uuid, explain, analyze, source, codec]() {
+        const QString name = QUuid::createUuid().toString();
+        QStringList plan;
+        {
+            QSqlDatabase database = QSqlDatabase::cloneDatabase(source, name);
+            if(!database.open())
+                plan << QStringLiteral("EXPLAIN failed: ") + database.lastError().text();
+            else
+            {
+                QString explain_coded = explain;
+                if(codec)
+                    explain_coded = codec->fromUnicode(explain);
+
+                // Запрос под ANALYZE выполняется в транзакции только для чтения,
+                // которая всегда откатывается: даже если разбор текста ошибся,
+                // сервер не даст ничего изменить
+                QSqlQuery query(database);
+                if(analyze && !query.exec(QStringLiteral("BEGIN READ ONLY;")))
+                    plan << QStringLiteral("EXPLAIN failed: ") + query.lastError().text();
+                else
+                {
+                    if(!query.exec(explain_coded))
+                        plan << QStringLiteral("EXPLAIN failed: ") + query.lastError().text();
+                    while(query.next())
+                        plan << query.value(0).toString();
+                    if(analyze)
+                        query.exec(QStringLiteral("ROLLBACK;"));
+                }
+                database.close();
+            }
+        }
+        QSqlDatabase::removeDatabase(name);
+
+        log->attachPlan(uuid, plan.join('\n'));
+        log->endExplain();
+    });
 }
 
 void SqlDatabaseConnector::setConnectionName(const QString &newConnectionName)
@@ -0,0 +1,47 @@
+#include "SqlItemSnapshot.h"
+
+SqlItemSnapshot::SqlItemSnapshot(const Items &items, quint64 version) :
+    _items { items },
+    _version { version }
+{
+}
+
+quint64 SqlItemSnapshot::version() const
+{
+    return _version;
+}
+
+int SqlItemSnapshot::count() const
+{
+    return _items.size();
+}
+
+bool SqlItemSnapshot::isEmpty() const
+{
+    return _items.isEmpty();
+}
+
+bool SqlItemSnapshot::contains(const QString &uuid) const
+{
+    return _items.contains(uuid);
+}
+
+ISqlTableItem::ptr SqlItemSnapshot::item(const QString &uuid) const
+{
+    return _items.value(uuid);
+}
+
+const SqlItemSnapshot::Items &SqlItemSnapshot::items() const
+{
+    return _items;
+}
+
+SqlItemSnapshot::const_iterator SqlItemSnapshot::begin() const
+{
+    return _items.constBegin();
+}
+
+SqlItemSnapshot::const_iterator SqlItemSnapshot::end() const
+{
+    return _items.constEnd();
+}
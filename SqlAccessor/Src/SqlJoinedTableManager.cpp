@@ -0,0 +1,550 @@
+#include "SqlJoinedTableManager.h"
+#include <QDebug>
+#include <QJsonValue>
+
+namespace
+{
+    QByteArray Title = QByteArrayLiteral("[SqlJoinedTableManager] :");
+
+    //! Приводит значение ключа соединения к строке, чтобы 5 из базы
+    //! и 5.0 из Json уведомления были одним ключом
+    QString keyString(const QJsonValue & value)
+    {
+        switch(value.type())
+        {
+        case QJsonValue::String:
+            return value.toString();
+        case QJsonValue::Double:
+            return QString::number(value.toDouble(), 'g', 17);
+        case QJsonValue::Bool:
+            return value.toBool() ? "true" : "false";
+        default:
+            return QString();
+        }
+    }
+
+    QString sqlLiteral(const QString & value)
+    {
+        QString escaped = value;
+        escaped.replace("'", "''");
+        return QString("'%1'").arg(escaped);
+    }
+}
+
+
+SqlJoinedTableManager::SqlJoinedTableManager(SqlDatabaseConnector *connector, QObject *parent) :
+    QObject(parent)
+{
+    _connector = connector;
+    _members.resize(1);
+
+    // Уведомление приходит по указателю и не копируется,
+    // даже если коннектор живет в другом потоке
+    connect(_connector, &SqlDatabaseConnector::sharedNotification,
+            this, [this](SqlNotification::ptr notification) { onDBNotification(*notification); });
+}
+
+SqlJoinedTableManager::~SqlJoinedTableManager()
+{
+    if(!_connector)
+        return;
+    for(const auto & member: _members)
+        _connector->unwatchTable(member.scheme, member.table);
+}
+
+void SqlJoinedTableManager::setBaseTable(const QString &scheme, const QString &table, const QString &alias, ItemFactory factory)
+{
+    Member & base = _members[0];
+    _connector->unwatchTable(base.scheme, base.table);
+    _connector->watchTable(scheme, table);
+    base.scheme = scheme;
+    base.table = table;
+    base.alias = alias;
+    base.factory = factory;
+    base.fields = factory()->sqlFields();
+}
+
+void SqlJoinedTableManager::addJoin(const QString &scheme, const QString &table, const QString &alias,
+                                    const QString &localField, const QString &foreignField,
+                                    JoinType joinType, ItemFactory factory)
+{
+    if(memberIndex(alias) >= 0)
+    {
+        qWarning().noquote() << Title << "can't add join, alias already used:" << alias;
+        return;
+    }
+
+    Member member;
+    member.scheme = scheme;
+    member.table = table;
+    member.alias = alias;
+    member.factory = factory;
+    member.fields = factory()->sqlFields();
+    member.localField = localField;
+    member.foreignField = foreignField;
+    member.joinType = joinType;
+    _members << member;
+    _connector->watchTable(scheme, table);
+}
+
+void SqlJoinedTableManager::load()
+{
+    sendQuery(selectQuery(), -1);
+}
+
+void SqlJoinedTableManager::unload()
+{
+    for(auto & member: _members)
+    {
+        member.records.clear();
+        member.byKey.clear();
+        member.referrers.clear();
+    }
+    _joinedRows.clear();
+    _requestedKeys.clear();
+}
+
+int SqlJoinedTableManager::count() const
+{
+    return _joinedRows.size();
+}
+
+QStringList SqlJoinedTableManager::uuids() const
+{
+    return _joinedRows.values();
+}
+
+bool SqlJoinedTableManager::contains(const QString &uuid) const
+{
+    return _joinedRows.contains(uuid);
+}
+
+bool SqlJoinedTableManager::isJoined(const QString &uuid) const
+{
+    auto it = _members[0].records.constFind(uuid);
+    if(it == _members[0].records.constEnd())
+        return false;
+
+    for(int i = 1; i < _members.size(); i++)
+    {
+        if(_members[i].joinType == InnerJoin && !lookupRecord(i, it.value()))
+            return false;
+    }
+    return true;
+}
+
+QJsonObject SqlJoinedTableManager::row(const QString &uuid) const
+{
+    QJsonObject out;
+    if(!contains(uuid))
+        return out;
+
+    for(int i = 0; i < _members.size(); i++)
+    {
+        const QJsonObject rec = record(uuid, _members[i].alias);
+        const QString & alias = _members[i].alias;
+        for(auto it = rec.constBegin(); it != rec.constEnd(); ++it)
+            out.insert(QString("%1.%2").arg(alias, it.key()), it.value());
+    }
+    return out;
+}
+
+QJsonObject SqlJoinedTableManager::record(const QString &uuid, const QString &alias) const
+{
+    const int index = memberIndex(alias);
+    auto base = _members[0].records.constFind(uuid);
+    if(index < 0 || base == _members[0].records.constEnd())
+        return QJsonObject();
+
+    if(index == 0)
+        return base.value();
+
+    const QJsonObject * rec = lookupRecord(index, base.value());
+    return rec ? *rec : QJsonObject();
+}
+
+QVariant SqlJoinedTableManager::value(const QString &uuid, const QString &alias, const QString &field) const
+{
+    return record(uuid, alias).value(field).toVariant();
+}
+
+ISqlTableItem::ptr SqlJoinedTableManager::item(const QString &uuid, const QString &alias) const
+{
+    const int index = memberIndex(alias);
+    const QJsonObject rec = record(uuid, alias);
+    if(index < 0 || rec.isEmpty())
+        return ISqlTableItem::ptr(nullptr);
+
+    auto out = _members[index].factory();
+    out->setUuid(rec.value("_uuid").toString());
+    for(const auto & field: _members[index].fields)
+        out->setProperty(field.toStdString().c_str(), rec.value(field).toVariant());
+    return out;
+}
+
+QString SqlJoinedTableManager::selectQuery() const
+{
+    QStringList columns;
+    for(const auto & member: _members)
+    {
+        QStringList fields = member.fields;
+        fields.prepend("_uuid");
+        for(const auto & field: fields)
+            columns << QString("%1.%2 AS \"%1.%2\"").arg(member.alias, field);
+    }
+
+    const Member & base = _members[0];
+    QString query = QString("SELECT %1 FROM %2.%3 %4").
+            arg(columns.join(", "), base.scheme, base.table, base.alias);
+
+    for(int i = 1; i < _members.size(); i++)
+    {
+        const Member & member = _members[i];
+        query += QString(" %1 JOIN %2.%3 %4 ON %4.%5 = %6.%7").
+                arg(member.joinType == InnerJoin ? "INNER" : "LEFT",
+                    member.scheme, member.table, member.alias,
+                    member.foreignField, base.alias, member.localField);
+    }
+    return query + ";";
+}
+
+int SqlJoinedTableManager::memberIndex(const QString &alias) const
+{
+    for(int i = 0; i < _members.size(); i++)
+    {
+        if(_members[i].alias == alias)
+            return i;
+    }
+    return -1;
+}
+
+const QJsonObject *SqlJoinedTableManager::lookupRecord(int member, const QJsonObject &base) const
+{
+    const Member & lookup = _members[member];
+    const QString key = keyString(base.value(lookup.localField));
+    if(key.isEmpty())
+        return nullptr;
+
+    auto uuid = lookup.byKey.constFind(key);
+    if(uuid == lookup.byKey.constEnd())
+        return nullptr;
+
+    auto rec = lookup.records.constFind(uuid.value());
+    return rec == lookup.records.constEnd() ? nullptr : &rec.value();
+}
+
+void SqlJoinedTableManager::refreshJoined(const QSet<QString> &uuids)
+{
+    for(const auto & uuid: uuids)
+    {
+        if(isJoined(uuid))
+            _joinedRows.insert(uuid);
+        else
+            _joinedRows.remove(uuid);
+    }
+}
+
+void SqlJoinedTableManager::setBaseRecord(const QString &uuid, const QJsonObject &record, bool fetchMissing)
+{
+    Member & base = _members[0];
+    auto old = base.records.constFind(uuid);
+    if(old != base.records.constEnd())
+    {
+        for(int i = 1; i < _members.size(); i++)
+        {
+            auto & referrers = _members[i].referrers;
+            const QString key = keyString(old.value().value(_members[i].localField));
+            auto it = referrers.find(key);
+            if(it != referrers.end())
+            {
+                it->remove(uuid);
+                if(it->isEmpty())
+                    referrers.erase(it);
+            }
+        }
+    }
+
+    base.records.insert(uuid, record);
+
+    for(int i = 1; i < _members.size(); i++)
+    {
+        const QString key = keyString(record.value(_members[i].localField));
+        if(key.isEmpty())
+            continue;
+        _members[i].referrers[key].insert(uuid);
+        if(fetchMissing && !_members[i].byKey.contains(key))
+            requestLookup(i, key);
+    }
+    refreshJoined({ uuid });
+}
+
+void SqlJoinedTableManager::removeBaseRecord(const QString &uuid)
+{
+    Member & base = _members[0];
+    auto old = base.records.find(uuid);
+    if(old == base.records.end())
+        return;
+
+    for(int i = 1; i < _members.size(); i++)
+    {
+        auto & referrers = _members[i].referrers;
+        const QString key = keyString(old.value().value(_members[i].localField));
+        auto it = referrers.find(key);
+        if(it != referrers.end())
+        {
+            it->remove(uuid);
+            if(it->isEmpty())
+                referrers.erase(it);
+        }
+    }
+    base.records.erase(old);
+    _joinedRows.remove(uuid);
+}
+
+QSet<QString> SqlJoinedTableManager::setLookupRecord(int member, const QString &uuid, const QJsonObject &record)
+{
+    Member & lookup = _members[member];
+    QSet<QString> affected;
+
+    auto old = lookup.records.constFind(uuid);
+    if(old != lookup.records.constEnd())
+    {
+        const QString oldKey = keyString(old.value().value(lookup.foreignField));
+        if(lookup.byKey.value(oldKey) == uuid)
+            lookup.byKey.remove(oldKey);
+        affected += lookup.referrers.value(oldKey);
+    }
+
+    lookup.records.insert(uuid, record);
+
+    const QString key = keyString(record.value(lookup.foreignField));
+    if(!key.isEmpty())
+    {
+        lookup.byKey.insert(key, uuid);
+        affected += lookup.referrers.value(key);
+    }
+    if(lookup.joinType == InnerJoin)
+        refreshJoined(affected);
+    return affected;
+}
+
+QSet<QString> SqlJoinedTableManager::removeLookupRecord(int member, const QString &uuid)
+{
+    Member & lookup = _members[member];
+    auto old = lookup.records.find(uuid);
+    if(old == lookup.records.end())
+        return QSet<QString>();
+
+    const QString key = keyString(old.value().value(lookup.foreignField));
+    if(lookup.byKey.value(key) == uuid)
+        lookup.byKey.remove(key);
+    lookup.records.erase(old);
+    _requestedKeys.remove(QString("%1:%2").arg(member).arg(key));
+
+    const QSet<QString> affected = lookup.referrers.value(key);
+    if(lookup.joinType == InnerJoin)
+        refreshJoined(affected);
+    return affected;
+}
+
+void SqlJoinedTableManager::requestLookup(int member, const QString &key)
+{
+    const QString requestKey = QString("%1:%2").arg(member).arg(key);
+    if(_requestedKeys.contains(requestKey))
+        return;
+    _requestedKeys.insert(requestKey);
+
+    const Member & lookup = _members[member];
+    QStringList fields = lookup.fields;
+    fields.prepend("_uuid");
+    sendQuery(QString("SELECT %1 FROM %2.%3 WHERE %4 = %5;").
+              arg(fields.join(", "), lookup.scheme, lookup.table,
+                  lookup.foreignField, sqlLiteral(key)),
+              member);
+}
+
+void SqlJoinedTableManager::sendQuery(const QString &query, int member)
+{
+    _connector->sendQuery(query, this, [this, member](const QUuid &, const QueryResult & result) {
+        onQueryFinished(member, result);
+    });
+}
+
+void SqlJoinedTableManager::onQueryFinished(int member, const QueryResult &result)
+{
+    if(result.error.type() != QSqlError::NoError)
+    {
+        qWarning().noquote() << QString("[%1] query error : %2").arg(this->metaObject()->className(), result.error.text());
+        return;
+    }
+
+    if(member >= 0)
+    {
+        // Дозагрузка строки справочника
+        QSet<QString> affected;
+        for(const auto & record: result.records)
+            affected += setLookupRecord(member, record.value("_uuid").toString(), record);
+        if(!affected.isEmpty())
+            emit rowsChanged(affected.values());
+        return;
+    }
+
+    if(_debug) qDebug().noquote() << Title << "joined rows loaded:" << result.records.size();
+
+    unload();
+
+    QVector<QVector<QPair<QString, QString>>> columns(_members.size());
+    for(int i = 0; i < _members.size(); i++)
+    {
+        QStringList fields = _members[i].fields;
+        fields.prepend("_uuid");
+        for(const auto & field: fields)
+            columns[i] << qMakePair(field, QString("%1.%2").arg(_members[i].alias, field));
+    }
+
+    for(const auto & joined: result.records)
+    {
+        // Сначала справочники, чтобы строка основной таблицы
+        // не запрашивала их повторно
+        QString baseUuid;
+        QJsonObject baseRecord;
+        for(int i = _members.size() - 1; i >= 0; i--)
+        {
+            QJsonObject rec;
+            for(const auto & column: columns[i])
+                rec.insert(column.first, joined.value(column.second));
+
+            const QString uuid = rec.value("_uuid").toString();
+            if(uuid.isEmpty())
+                continue;
+
+            if(i == 0)
+            {
+                baseUuid = uuid;
+                baseRecord = rec;
+            }
+            else if(!_members[i].records.contains(uuid))
+                setLookupRecord(i, uuid, rec);
+        }
+        if(!baseUuid.isEmpty())
+            setBaseRecord(baseUuid, baseRecord, false);
+    }
+
+    emit updated();
+}
+
+void SqlJoinedTableManager::onDBNotification(const SqlNotification & incoming)
+{
+    for(int i = 0; i < _members.size(); i++)
+    {
+        const Member & member = _members[i];
+        if(member.table != incoming.table || member.scheme != incoming.schema)
+            continue;
+
+        if(incoming.format == SqlNotification::ChangePointer)
+        {
+            changeFetcher(i)->enqueue(incoming);
+            continue;
+        }
+
+        // Копия делается только для ColumnDiff, остальные уведомления читаются из общего объекта
+        SqlNotification mergedNotif;
+        const SqlNotification * current = &incoming;
+        if(incoming.format == SqlNotification::ColumnDiff && incoming.actionType == SqlNotification::UPDATE)
+        {
+            // Изменившиеся колонки накладываются на загруженную строку
+            auto loaded = member.records.constFind(incoming.itemUuid);
+            if(loaded == member.records.constEnd())
+            {
+                SqlNotification pointer = incoming;
+                pointer.format = SqlNotification::ChangePointer;
+                pointer.actionType = SqlNotification::INSERT;
+                changeFetcher(i)->enqueue(pointer);
+                continue;
+            }
+
+            mergedNotif = incoming;
+            QJsonObject merged = loaded.value();
+            for(auto it = incoming.data.constBegin(); it != incoming.data.constEnd(); ++it)
+            {
+                if(member.fields.contains(it.key()))
+                    merged.insert(it.key(), it.value());
+            }
+            mergedNotif.data = merged;
+            mergedNotif.format = SqlNotification::FullRow;
+            current = &mergedNotif;
+        }
+        const SqlNotification & notif = *current;
+
+        if(i == 0)
+        {
+            const bool wasIn = contains(notif.itemUuid);
+            if(notif.actionType == SqlNotification::DELETE)
+                removeBaseRecord(notif.itemUuid);
+            else
+                setBaseRecord(notif.itemUuid, notif.data);
+            const bool isIn = contains(notif.itemUuid);
+
+            if(!wasIn && isIn)
+                emit rowInserted(notif.itemUuid);
+            else if(wasIn && !isIn)
+                emit rowRemoved(notif.itemUuid);
+            else if(isIn)
+                emit rowsChanged(QStringList { notif.itemUuid });
+            continue;
+        }
+
+        // Изменилась строка справочника: затрагиваем только ссылающиеся строки
+        QSet<QString> candidates;
+        auto old = member.records.constFind(notif.itemUuid);
+        if(old != member.records.constEnd())
+            candidates += member.referrers.value(keyString(old.value().value(member.foreignField)));
+        candidates += member.referrers.value(keyString(notif.data.value(member.foreignField)));
+
+        QHash<QString, bool> before;
+        for(const auto & uuid: candidates)
+            before.insert(uuid, contains(uuid));
+
+        QSet<QString> affected;
+        if(notif.actionType == SqlNotification::DELETE)
+            affected = removeLookupRecord(i, notif.itemUuid);
+        else
+            affected = setLookupRecord(i, notif.itemUuid, notif.data);
+
+        QStringList changed;
+        for(const auto & uuid: affected)
+        {
+            const bool wasIn = before.value(uuid, false);
+            const bool isIn = contains(uuid);
+            if(!wasIn && isIn)
+                emit rowInserted(uuid);
+            else if(wasIn && !isIn)
+                emit rowRemoved(uuid);
+            else if(isIn)
+                changed << uuid;
+        }
+        if(!changed.isEmpty())
+            emit rowsChanged(changed);
+    }
+}
+
+SqlChangeFetcher *SqlJoinedTableManager::changeFetcher(int member)
+{
+    SqlChangeFetcher * fetcher = _changeFetchers.value(member, nullptr);
+    if(fetcher)
+        return fetcher;
+
+    const Member & m = _members[member];
+    QStringList fields = m.fields;
+    fields.prepend("_uuid");
+
+    fetcher = new SqlChangeFetcher(_connector, m.scheme, m.table, this);
+    fetcher->setColumns(fields.join(", "));
+    connect(fetcher, &SqlChangeFetcher::resolved,
+            this, [this](const QList<SqlNotification> & notifications) {
+        for(const auto & notif: notifications)
+            onDBNotification(notif);
+    });
+    _changeFetchers.insert(member, fetcher);
+    return fetcher;
+}
@@ -0,0 +1,136 @@
+#include "SqlNotificationHub.h"
+#include <QDebug>
+
+namespace
+{
+    QByteArray Title = QByteArrayLiteral("[SqlNotificationHub] :");
+}
+
+SqlNotificationHub::SqlNotificationHub(const QString &host, int port, const QString &baseName, QObject *parent) :
+    QObject(parent)
+{
+    _listener = new SqlDatabaseConnector(host, port, baseName, this);
+    _listener->setConnectionName(QString("%1-listen").arg(baseName));
+
+    connect(_listener, &SqlDatabaseConnector::sharedNotification,
+            this, &SqlNotificationHub::onNotification);
+}
+
+SqlNotificationHub::~SqlNotificationHub()
+{
+    const auto connectors = _connectors;
+    for(const auto & connector: connectors)
+    {
+        if(connector)
+            detach(connector);
+    }
+}
+
+QString SqlNotificationHub::key(const QString &host, int port, const QString &baseName)
+{
+    return QString("%1:%2/%3").arg(host).arg(port).arg(baseName);
+}
+
+bool SqlNotificationHub::open(const QString &username, const QString &password)
+{
+    if(_listener->isOpen())
+        return true;
+    return _listener->connectToBase(username, password);
+}
+
+void SqlNotificationHub::close()
+{
+    _listener->disconnectFromBase();
+}
+
+bool SqlNotificationHub::isOpen() const
+{
+    return _listener->isOpen();
+}
+
+void SqlNotificationHub::attach(SqlDatabaseConnector *connector)
+{
+    if(!connector || _connectors.contains(connector))
+        return;
+
+    if(key(connector->hostName(), connector->port(), connector->databaseName()) !=
+       key(_listener->hostName(), _listener->port(), _listener->databaseName()))
+    {
+        qWarning().noquote() << Title << "can't attach connector" << connector->connectionName()
+                             << "to a hub of another database";
+        return;
+    }
+
+    _connectors << connector;
+    connector->setNotificationHub(this);
+}
+
+void SqlNotificationHub::detach(SqlDatabaseConnector *connector)
+{
+    if(!_connectors.removeAll(connector))
+        return;
+
+    connector->setNotificationHub(nullptr);
+}
+
+QList<SqlDatabaseConnector *> SqlNotificationHub::connectors() const
+{
+    QList<SqlDatabaseConnector *> out;
+    for(const auto & connector: _connectors)
+    {
+        if(connector)
+            out << connector.data();
+    }
+    return out;
+}
+
+SqlDatabaseConnector *SqlNotificationHub::listener() const
+{
+    return _listener;
+}
+
+void SqlNotificationHub::setListenMode(SqlDatabaseConnector::ListenMode mode)
+{
+    _listener->setListenMode(mode);
+}
+
+void SqlNotificationHub::setCodec(QTextCodec *codec)
+{
+    _listener->setCodec(codec);
+}
+
+quint64 SqlNotificationHub::notificationCount() const
+{
+    return _notificationCount;
+}
+
+void SqlNotificationHub::watchChannel(const QString &channel)
+{
+    _listener->watchChannel(channel);
+}
+
+void SqlNotificationHub::unwatchChannel(const QString &channel)
+{
+    _listener->unwatchChannel(channel);
+}
+
+void SqlNotificationHub::onNotification(SqlNotification::ptr notification)
+{
+    _notificationCount++;
+
+    _connectors.removeAll(QPointer<SqlDatabaseConnector>());
+    const auto connectors = _connectors;
+    for(const auto & connector: connectors)
+    {
+        if(connector->thread() == QThread::currentThread())
+            connector->dispatchNotification(notification);
+        else
+        {
+            // Передается только указатель, само уведомление не копируется
+            QMetaObject::invokeMethod(connector, [connector, notification]() {
+                if(connector)
+                    connector->dispatchNotification(notification);
+            }, Qt::QueuedConnection);
+        }
+    }
+}
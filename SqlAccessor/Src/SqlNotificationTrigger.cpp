@@ -0,0 +1,125 @@
+#include "SqlNotificationTrigger.h"
+#include <QCryptographicHash>
+
+namespace
+{
+    //! Максимальная длина идентификатора в PostgreSQL (NAMEDATALEN - 1)
+    const int MaxIdentifierLength = 63;
+
+    //! Тело функции триггера. %1 - канал уведомлений, %2 - формат,
+    //! %3 и %4 - выражения для data и data_old
+    const QString FunctionBody = QStringLiteral(
+        "BEGIN\n"
+        "    PERFORM pg_notify(%1, json_build_object(\n"
+        "        'action', TG_OP,\n"
+        "        'schema', TG_TABLE_SCHEMA,\n"
+        "        'table', TG_TABLE_NAME,\n"
+        "        'format', %2,\n"
+        "        'data', %3,\n"
+        "        'data_old', %4\n"
+        "    )::text);\n"
+        "    RETURN NULL;\n"
+        "END;\n");
+
+    const QString FullData = QStringLiteral(
+        "CASE WHEN TG_OP = 'DELETE' THEN row_to_json(OLD) ELSE row_to_json(NEW) END");
+    const QString FullDataOld = QStringLiteral(
+        "CASE WHEN TG_OP = 'UPDATE' THEN row_to_json(OLD) ELSE NULL END");
+
+    //! Размер уведомления не зависит от ширины строки
+    const QString PointerData = QStringLiteral(
+        "json_build_object('_uuid', CASE WHEN TG_OP = 'DELETE' THEN OLD._uuid ELSE NEW._uuid END)");
+
+    //! При UPDATE - только колонки, значения которых отличаются от OLD
+    const QString DiffData = QStringLiteral(
+        "CASE WHEN TG_OP = 'UPDATE' THEN jsonb_build_object('_uuid', NEW._uuid) || COALESCE(("
+        "SELECT jsonb_object_agg(n.key, n.value) FROM jsonb_each(to_jsonb(NEW)) n "
+        "JOIN jsonb_each(to_jsonb(OLD)) o ON o.key = n.key "
+        "WHERE n.value IS DISTINCT FROM o.value), '{}'::jsonb) "
+        "WHEN TG_OP = 'DELETE' THEN to_jsonb(OLD) ELSE to_jsonb(NEW) END");
+}
+
+QString SqlNotificationTrigger::channelName(const QString &schema, const QString &table)
+{
+    const QString prefix = QString::fromLatin1(IDSqlChangedEvent);
+    const QString readable = QString("%1:%2:%3").arg(prefix, schema, table);
+
+    const bool safe = !schema.contains('.') && !schema.contains('"') &&
+                      !table.contains('.') && !table.contains('"');
+    if(safe && readable.toUtf8().size() <= MaxIdentifierLength)
+        return readable;
+
+    const QByteArray hash = QCryptographicHash::hash(QString("%1.%2").arg(schema, table).toUtf8(),
+                                                     QCryptographicHash::Md5).toHex();
+    return QString("%1:%2").arg(prefix, QString::fromLatin1(hash));
+}
+
+QString SqlNotificationTrigger::createDdl(const QString &schema, const QString &table,
+                                         SqlNotification::PayloadFormat format, bool tableChannel)
+{
+    const QString channel = tableChannel ? channelName(schema, table)
+                                         : QString::fromLatin1(IDSqlChangedEvent);
+    const QString function = QString("%1.%2").arg(quoteIdentifier(schema),
+                                                  quoteIdentifier(functionName(table)));
+    const QString target = QString("%1.%2").arg(quoteIdentifier(schema), quoteIdentifier(table));
+    const QString trigger = quoteIdentifier(triggerName(table));
+
+    return QString("CREATE OR REPLACE FUNCTION %1() RETURNS trigger AS $sql_accessor$\n"
+                   "%2"
+                   "$sql_accessor$ LANGUAGE plpgsql;\n"
+                   "DROP TRIGGER IF EXISTS %3 ON %4;\n"
+                   "CREATE TRIGGER %3 AFTER INSERT OR UPDATE OR DELETE ON %4\n"
+                   "    FOR EACH ROW EXECUTE PROCEDURE %1();\n")
+            .arg(function,
+                 functionBody(channel, format),
+                 trigger,
+                 target);
+}
+
+QString SqlNotificationTrigger::dropDdl(const QString &schema, const QString &table)
+{
+    return QString("DROP TRIGGER IF EXISTS %1 ON %2.%3;\n"
+                   "DROP FUNCTION IF EXISTS %2.%4();\n")
+            .arg(quoteIdentifier(triggerName(table)),
+                 quoteIdentifier(schema),
+                 quoteIdentifier(table),
+                 quoteIdentifier(functionName(table)));
+}
+
+QString SqlNotificationTrigger::functionBody(const QString &channel, SqlNotification::PayloadFormat format)
+{
+    switch(format)
+    {
+    case SqlNotification::ChangePointer:
+        return FunctionBody.arg(quoteLiteral(channel), quoteLiteral("pointer"), PointerData, "NULL");
+    case SqlNotification::ColumnDiff:
+        return FunctionBody.arg(quoteLiteral(channel), quoteLiteral("diff"), DiffData, "NULL");
+    case SqlNotification::FullRow:
+    default:
+        return FunctionBody.arg(quoteLiteral(channel), quoteLiteral("full"), FullData, FullDataOld);
+    }
+}
+
+QString SqlNotificationTrigger::quoteIdentifier(const QString &name)
+{
+    QString escaped = name;
+    escaped.replace('"', "\"\"");
+    return QString("\"%1\"").arg(escaped);
+}
+
+QString SqlNotificationTrigger::quoteLiteral(const QString &value)
+{
+    QString escaped = value;
+    escaped.replace('\'', "''");
+    return QString("'%1'").arg(escaped);
+}
+
+QString SqlNotificationTrigger::functionName(const QString &table)
+{
+    return QString("%1_notify_change").arg(table);
+}
+
+QString SqlNotificationTrigger::triggerName(const QString &table)
+{
+    return QString("%1_notify_change_trigger").arg(table);
+}
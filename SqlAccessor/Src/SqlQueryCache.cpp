@@ -0,0 +1,328 @@
+#include "SqlQueryCache.h"
+#include "SqlQueryText.h"
+#include <QRegularExpression>
+#include <QJsonValue>
+
+namespace
+{
+    //! Примерные накладные расходы на объект/значение Json
+    const qint64 ObjectOverhead = 64;
+    const qint64 ValueOverhead = 24;
+
+    const QString Identifier = QStringLiteral("(\"[^\"]+\"|[A-Za-z_][\\w$]*)");
+
+    QString normalizeIdentifier(const QString & name)
+    {
+        if(name.startsWith('"') && name.endsWith('"') && name.size() >= 2)
+            return name.mid(1, name.size() - 2);
+        return name.toLower();
+    }
+
+    QString tableTag(const QString & schema, const QString & table)
+    {
+        return QString("%1.%2").arg(schema, table);
+    }
+
+    //!
+    //! \brief The Scan struct
+    //! Таблицы, найденные в тексте запроса
+    struct Scan
+    {
+        //! Пометки "schema.table", с запасом (в том числе alias.column)
+        QSet<QString> tags;
+        //! Таблицы со схемой, стоящие после FROM/JOIN/INTO/UPDATE
+        QSet<QString> relations;
+        //! Таблицы без схемы, стоящие после FROM/JOIN/INTO/UPDATE
+        QSet<QString> unqualified;
+    };
+
+    Scan scanQuery(const QString & query)
+    {
+        // Лишняя пометка только приводит к лишней инвалидации,
+        // поэтому таблицы ищутся с запасом: любое "a.b" в запросе
+        // (в том числе alias.column) считается таблицей.
+        // Строки и комментарии не просматриваются: 'a.b' в условии - не таблица.
+        // Вызовы функций (FROM pg_logical_slot_get_changes(...) и т.п.)
+        // таблицами не считаются, и такие запросы не кэшируются
+        static const QRegularExpression qualified(
+                    Identifier + "\\s*\\.\\s*" + Identifier + "(?![\\w$]|\\s*\\()");
+        static const QRegularExpression fromList(
+                    "\\bFROM\\s+(.+?)(?=\\bWHERE\\b|\\bGROUP\\b|\\bORDER\\b|\\bLIMIT\\b|\\bHAVING\\b|"
+                    "\\bJOIN\\b|\\bLEFT\\b|\\bRIGHT\\b|\\bINNER\\b|\\bFULL\\b|\\bCROSS\\b|\\bUNION\\b|"
+                    "\\bRETURNING\\b|\\bUSING\\b|\\)|;|$)",
+                    QRegularExpression::CaseInsensitiveOption | QRegularExpression::DotMatchesEverythingOption);
+        static const QRegularExpression relation(
+                    "\\b(?:JOIN|UPDATE)\\s+" + Identifier + "(?:\\s*\\.\\s*" + Identifier + ")?(?![\\w$]|\\s*[.(])",
+                    QRegularExpression::CaseInsensitiveOption);
+        // После INSERT INTO table идет список колонок, а не аргументы функции
+        static const QRegularExpression into(
+                    "\\bINTO\\s+" + Identifier + "(?:\\s*\\.\\s*" + Identifier + ")?(?![\\w$]|\\s*\\.)",
+                    QRegularExpression::CaseInsensitiveOption);
+        static const QRegularExpression firstWord(
+                    "^\\s*" + Identifier + "(?:\\s*\\.\\s*" + Identifier + ")?(?![\\w$]|\\s*[.(])");
+
+        const QString text = SqlQueryText::stripLiterals(query);
+        Scan scan;
+
+        auto addRelation = [&scan](const QRegularExpressionMatch & match) {
+            if(match.capturedLength(2) > 0)
+                scan.relations.insert(tableTag(normalizeIdentifier(match.captured(1)),
+                                               normalizeIdentifier(match.captured(2))));
+            else
+                scan.unqualified.insert(normalizeIdentifier(match.captured(1)));
+        };
+
+        auto it = qualified.globalMatch(text);
+        while(it.hasNext())
+        {
+            auto match = it.next();
+            scan.tags.insert(tableTag(normalizeIdentifier(match.captured(1)),
+                                      normalizeIdentifier(match.captured(2))));
+        }
+
+        it = fromList.globalMatch(text);
+        while(it.hasNext())
+        {
+            auto match = it.next();
+            for(const auto & item: match.captured(1).split(','))
+            {
+                auto word = firstWord.match(item);
+                if(word.hasMatch())
+                    addRelation(word);
+            }
+        }
+
+        for(const auto * expression: { &relation, &into })
+        {
+            it = expression->globalMatch(text);
+            while(it.hasNext())
+                addRelation(it.next());
+        }
+
+        scan.tags.unite(scan.relations);
+        return scan;
+    }
+}
+
+SqlQueryCache::SqlQueryCache(qint64 budget) :
+    _budget { budget }
+{
+
+}
+
+bool SqlQueryCache::lookup(const QString &query, QueryResult &result)
+{
+    QMutexLocker locker(&_mutex);
+    auto it = _index.find(query);
+    if(it == _index.end())
+    {
+        _stats.misses++;
+        return false;
+    }
+
+    // Перемещаем запись в начало списка как использованную последней
+    _entries.splice(_entries.begin(), _entries, it.value());
+    result = it.value()->result;
+    _stats.hits++;
+    return true;
+}
+
+bool SqlQueryCache::insert(const QString &query, const QueryResult &result, const TableFilter &watched)
+{
+    // Результат функции может зависеть не только от таблиц запроса
+    // (now(), nextval(), чтение других таблиц внутри функции)
+    if(SqlQueryText::callsFunctions(query))
+        return false;
+
+    // Схема таблицы без схемы зависит от search_path соединения,
+    // и уведомление о ее изменении не с чем сопоставить
+    const Scan scan = scanQuery(query);
+    if(scan.relations.isEmpty() || !scan.unqualified.isEmpty())
+        return false;
+
+    if(watched)
+    {
+        for(const auto & relation: scan.relations)
+        {
+            const int dot = relation.indexOf('.');
+            if(!watched(relation.left(dot), relation.mid(dot + 1)))
+                return false;
+        }
+    }
+
+    const QStringList tables = scan.tags.values();
+
+    const qint64 size = estimateSize(result) + query.size() * qint64(sizeof(QChar));
+
+    QMutexLocker locker(&_mutex);
+    if(size > _budget)
+        return false;
+
+    auto old = _index.find(query);
+    if(old != _index.end())
+        removeEntry(old.value());
+
+    Entry entry;
+    entry.query = query;
+    entry.result = result;
+    entry.tables = tables;
+    entry.size = size;
+    _entries.push_front(entry);
+    _index.insert(query, _entries.begin());
+    for(const auto & table: tables)
+        _byTable[table].insert(query);
+
+    _stats.bytes += size;
+    _stats.entries++;
+    shrink();
+    return true;
+}
+
+void SqlQueryCache::invalidateTable(const QString &schema, const QString &table)
+{
+    QMutexLocker locker(&_mutex);
+    const QSet<QString> queries = _byTable.take(tableTag(schema, table));
+    for(const auto & query: queries)
+    {
+        auto it = _index.find(query);
+        if(it != _index.end())
+        {
+            removeEntry(it.value());
+            _stats.invalidations++;
+        }
+    }
+}
+
+void SqlQueryCache::invalidateQuery(const QString &query)
+{
+    // Функция может писать в любые таблицы
+    if(SqlQueryText::callsFunctions(query))
+    {
+        clear();
+        return;
+    }
+
+    const Scan scan = scanQuery(query);
+    for(const auto & table: scan.tags)
+    {
+        const int dot = table.indexOf('.');
+        invalidateTable(table.left(dot), table.mid(dot + 1));
+    }
+
+    // Таблица без схемы может оказаться в любой схеме из search_path
+    if(scan.unqualified.isEmpty())
+        return;
+
+    QMutexLocker locker(&_mutex);
+    QStringList tags;
+    for(auto tagged = _byTable.constBegin(); tagged != _byTable.constEnd(); ++tagged)
+    {
+        const QString & tag = tagged.key();
+        if(scan.unqualified.contains(tag.mid(tag.indexOf('.') + 1)))
+            tags << tag;
+    }
+
+    for(const auto & tag: tags)
+    {
+        const QSet<QString> queries = _byTable.take(tag);
+        for(const auto & cachedQuery: queries)
+        {
+            auto it = _index.find(cachedQuery);
+            if(it != _index.end())
+            {
+                removeEntry(it.value());
+                _stats.invalidations++;
+            }
+        }
+    }
+}
+
+void SqlQueryCache::clear()
+{
+    QMutexLocker locker(&_mutex);
+    _entries.clear();
+    _index.clear();
+    _byTable.clear();
+    _stats.bytes = 0;
+    _stats.entries = 0;
+}
+
+qint64 SqlQueryCache::budget() const
+{
+    QMutexLocker locker(&_mutex);
+    return _budget;
+}
+
+void SqlQueryCache::setBudget(qint64 bytes)
+{
+    QMutexLocker locker(&_mutex);
+    _budget = bytes;
+    shrink();
+}
+
+SqlQueryCache::Stats SqlQueryCache::stats() const
+{
+    QMutexLocker locker(&_mutex);
+    return _stats;
+}
+
+QStringList SqlQueryCache::tablesOf(const QString &query, QStringList *unqualified)
+{
+    const Scan scan = scanQuery(query);
+    if(unqualified)
+        *unqualified = scan.unqualified.values();
+    return scan.tags.values();
+}
+
+qint64 SqlQueryCache::estimateSize(const QueryResult &result)
+{
+    qint64 size = sizeof(QueryResult);
+    for(const auto & record: result.records)
+    {
+        size += ObjectOverhead;
+        for(auto it = record.constBegin(); it != record.constEnd(); ++it)
+        {
+            size += ValueOverhead + it.key().size() * qint64(sizeof(QChar));
+            const QJsonValue value = it.value();
+            if(value.isString())
+                size += value.toString().size() * qint64(sizeof(QChar));
+        }
+    }
+
+    for(const auto & column: result.columns)
+        size += column.size() * qint64(sizeof(QChar));
+    for(const auto & row: result.rows)
+    {
+        size += ObjectOverhead + row.size() * qint64(sizeof(SqlValue));
+        for(const auto & value: row)
+            size += value.heapSize();
+    }
+    return size;
+}
+
+void SqlQueryCache::removeEntry(Iterator it)
+{
+    for(const auto & table: it->tables)
+    {
+        auto tagged = _byTable.find(table);
+        if(tagged != _byTable.end())
+        {
+            tagged->remove(it->query);
+            if(tagged->isEmpty())
+                _byTable.erase(tagged);
+        }
+    }
+    _stats.bytes -= it->size;
+    _stats.entries--;
+    _index.remove(it->query);
+    _entries.erase(it);
+}
+
+void SqlQueryCache::shrink()
+{
+    while(_stats.bytes > _budget && !_entries.empty())
+    {
+        removeEntry(std::prev(_entries.end()));
+        _stats.evictions++;
+    }
+}
@@ -0,0 +1,220 @@
+#include "SqlQueryText.h"
+#include <QRegularExpression>
+#include <QSet>
+
+namespace
+{
+    bool isIdentifierChar(QChar c)
+    {
+        return c.isLetterOrNumber() || c == '_' || c == '$';
+    }
+
+    //! Слова, после которых скобка не означает вызов функции
+    const QSet<QString> & keywords()
+    {
+        static const QSet<QString> words {
+            "select", "from", "where", "in", "exists", "any", "all", "some", "values",
+            "as", "on", "using", "over", "filter", "within", "and", "or", "not", "join",
+            "lateral", "cast", "row", "array", "case", "when", "then", "else", "end",
+            "into", "set", "by", "having", "union", "intersect", "except", "is", "like",
+            "ilike", "similar", "between", "distinct", "returning", "with", "recursive",
+            "group", "order", "limit", "offset", "fetch", "only", "table", "partition",
+            "rows", "range", "groups", "window", "default", "null", "interval",
+            "timestamp", "timestamptz", "date", "time", "timetz", "numeric", "decimal",
+            "varchar", "char", "character", "varying", "float", "precision", "bit",
+            "extract", "position", "substring", "overlay", "trim", "coalesce", "nullif",
+            "greatest", "least", "collate", "escape", "zone", "cube", "rollup",
+            "grouping", "sets", "of", "for", "left", "right", "inner", "outer", "full",
+            "cross", "natural"
+        };
+        return words;
+    }
+
+    //! Агрегаты и встроенные функции без побочных эффектов, результат
+    //! которых зависит только от данных
+    const QSet<QString> & pureFunctions()
+    {
+        static const QSet<QString> functions {
+            "count", "sum", "min", "max", "avg", "bool_and", "bool_or", "every",
+            "array_agg", "string_agg", "json_agg", "jsonb_agg", "json_object_agg",
+            "jsonb_object_agg", "row_number", "rank", "dense_rank", "lag", "lead",
+            "first_value", "last_value", "lower", "upper", "length", "char_length",
+            "abs", "round", "trunc", "ceil", "floor", "mod", "concat", "concat_ws",
+            "replace", "split_part", "lpad", "rpad", "ltrim", "rtrim", "btrim", "md5",
+            "to_char", "to_number", "date_part", "date_trunc", "array_length", "unnest",
+            "json_build_object", "jsonb_build_object", "json_build_array", "jsonb_build_array"
+        };
+        return functions;
+    }
+
+    //! Позиция конца $tag$, если с pos начинается открывающий тег, иначе -1
+    int dollarTagEnd(const QString & query, int pos)
+    {
+        if(pos > 0 && isIdentifierChar(query[pos - 1]))
+            return -1;
+        int i = pos + 1;
+        if(i < query.size() && query[i].isDigit())
+            return -1;
+        while(i < query.size() && query[i] != '$')
+        {
+            if(!isIdentifierChar(query[i]))
+                return -1;
+            i++;
+        }
+        return i < query.size() ? i : -1;
+    }
+
+    //! callsFunctions() по тексту, уже прошедшему stripLiterals()
+    bool callsFunctionsIn(const QString & text)
+    {
+        static const QRegularExpression call("(\"(?:[^\"]|\"\")+\"|[A-Za-z_][\\w$]*)\\s*\\(");
+
+        auto it = call.globalMatch(text);
+        while(it.hasNext())
+        {
+            const auto match = it.next();
+            const QString name = match.captured(1);
+
+            // Тип с модификатором в приведении: ::numeric(10, 2)
+            int before = match.capturedStart(1) - 1;
+            while(before >= 0 && text[before].isSpace())
+                before--;
+            if(before >= 1 && text[before] == ':' && text[before - 1] == ':')
+                continue;
+            // Функция из схемы (public.f(), pg_catalog.now()) - всегда вызов
+            if(before >= 0 && text[before] == '.')
+                return true;
+            if(name.startsWith('"'))
+                return true;
+
+            const QString lower = name.toLower();
+            if(!keywords().contains(lower) && !pureFunctions().contains(lower))
+                return true;
+        }
+        return false;
+    }
+}
+
+SqlQueryText::Kind SqlQueryText::classify(const QString &query)
+{
+    static const QRegularExpression firstWord("^[\\s(]*([A-Za-z]+)");
+    static const QRegularExpression locking(
+                "\\bFOR\\s+(?:NO\\s+KEY\\s+UPDATE|UPDATE|KEY\\s+SHARE|SHARE)\\b",
+                QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression modifying(
+                "\\b(?:INSERT|UPDATE|DELETE|MERGE|TRUNCATE|INTO)\\b",
+                QRegularExpression::CaseInsensitiveOption);
+
+    QString text = stripLiterals(query);
+    const QString first = firstWord.match(text).captured(1).toLower();
+    if(first != "select" && first != "with" && first != "values" && first != "table")
+        return Write;
+
+    bool locked = false;
+    if(text.contains(locking))
+    {
+        locked = true;
+        text.replace(locking, " ");
+    }
+    if(text.contains(modifying) || callsFunctionsIn(text))
+        return Write;
+    return locked ? LockingRead : PureRead;
+}
+
+bool SqlQueryText::callsFunctions(const QString &query)
+{
+    return callsFunctionsIn(stripLiterals(query));
+}
+
+QString SqlQueryText::stripLiterals(const QString &query)
+{
+    QString out;
+    out.reserve(query.size());
+
+    int i = 0;
+    const int size = query.size();
+    while(i < size)
+    {
+        const QChar c = query[i];
+        const QChar next = i + 1 < size ? query[i + 1] : QChar();
+
+        if(c == '-' && next == '-')
+        {
+            while(i < size && query[i] != '\n')
+                i++;
+            out += ' ';
+        }
+        else if(c == '/' && next == '*')
+        {
+            // Комментарии в PostgreSQL бывают вложенными
+            int depth = 0;
+            do
+            {
+                if(query[i] == '/' && i + 1 < size && query[i + 1] == '*')
+                {
+                    depth++;
+                    i += 2;
+                }
+                else if(query[i] == '*' && i + 1 < size && query[i + 1] == '/')
+                {
+                    depth--;
+                    i += 2;
+                }
+                else
+                    i++;
+            }
+            while(i < size && depth > 0);
+            out += ' ';
+        }
+        else if(c == '\'')
+        {
+            const bool escapes = !out.isEmpty() && (out.endsWith('E') || out.endsWith('e')) &&
+                    (out.size() == 1 || !isIdentifierChar(out[out.size() - 2]));
+            if(escapes)
+                out.chop(1);
+            i++;
+            while(i < size)
+            {
+                if(escapes && query[i] == '\\')
+                    i += 2;
+                else if(query[i] == '\'' && i + 1 < size && query[i + 1] == '\'')
+                    i += 2;
+                else if(query[i] == '\'')
+                    break;
+                else
+                    i++;
+            }
+            i++;
+            out += "''";
+        }
+        else if(c == '"')
+        {
+            const int start = i++;
+            while(i < size)
+            {
+                if(query[i] == '"' && i + 1 < size && query[i + 1] == '"')
+                    i += 2;
+                else if(query[i] == '"')
+                    break;
+                else
+                    i++;
+            }
+            i++;
+            out += query.midRef(start, qMin(i, size) - start);
+        }
+        else if(c == '$' && dollarTagEnd(query, i) > 0)
+        {
+            const int end = dollarTagEnd(query, i);
+            const QString tag = query.mid(i, end - i + 1);
+            const int close = query.indexOf(tag, end + 1);
+            i = close < 0 ? size : close + tag.size();
+            out += "''";
+        }
+        else
+        {
+            out += c;
+            i++;
+        }
+    }
+    return out;
+}
@@ -0,0 +1,219 @@
+#include "SqlReplicaSet.h"
+#include <QDebug>
+
+namespace
+{
+    QByteArray Title = QByteArrayLiteral("[SqlReplicaSet] :");
+
+    //! Если реплика проиграла весь полученный WAL, она не отстает, даже если
+    //! на основном сервере давно не было транзакций, - но только пока WAL receiver
+    //! работает и получает сообщения. Это проверяется в lagOf() по остальным колонкам.
+    //! Строка есть всегда, даже если WAL receiver не запущен. Неизвестные
+    //! время и отставание передаются как -1: NULL чисел драйвер отдает нулем
+    const QString LagQuery = QStringLiteral(
+        "SELECT pg_is_in_recovery() AS in_recovery, COALESCE(r.status, '') AS receiver_status, "
+        "COALESCE(EXTRACT(EPOCH FROM now() - r.last_msg_receipt_time) * 1000, -1)::float8 AS receipt_age_ms, "
+        "COALESCE(CASE WHEN pg_last_wal_receive_lsn() = pg_last_wal_replay_lsn() THEN 0 "
+        "ELSE EXTRACT(EPOCH FROM now() - pg_last_xact_replay_timestamp()) * 1000 "
+        "END, -1)::float8 AS lag_ms "
+        "FROM (SELECT 1) AS one LEFT JOIN pg_stat_wal_receiver r ON true;");
+}
+
+SqlReplicaSet::SqlReplicaSet(SqlDatabaseConnector *primary, QObject *parent) :
+    QObject(parent),
+    _primary { primary }
+{
+    connect(&_lagTimer, &QTimer::timeout,
+            this, &SqlReplicaSet::checkLag);
+    connect(_primary, &SqlDatabaseConnector::writeQueued,
+            this, &SqlReplicaSet::noteWrite);
+    _lagTimer.start(1000);
+}
+
+SqlReplicaSet::~SqlReplicaSet()
+{
+    for(auto & replica: _replicas)
+        delete replica.connector;
+}
+
+SqlDatabaseConnector *SqlReplicaSet::primary() const
+{
+    return _primary;
+}
+
+void SqlReplicaSet::addReplica(SqlDatabaseConnector *connector)
+{
+    connector->setListenEnabled(false);
+
+    ReplicaInfo info;
+    info.connector = connector;
+    _replicas << info;
+
+    connect(connector, &SqlDatabaseConnector::connected,
+            this, &SqlReplicaSet::checkLag);
+}
+
+QList<SqlReplicaSet::ReplicaInfo> SqlReplicaSet::replicas() const
+{
+    QList<ReplicaInfo> out = _replicas;
+    for(auto & replica: out)
+    {
+        replica.open = replica.connector->isOpen();
+        replica.load = replica.connector->queueSize() +
+                (replica.connector->state() == SqlDatabaseConnector::Busy ? 1 : 0);
+    }
+    return out;
+}
+
+SqlDatabaseConnector *SqlReplicaSet::readConnector()
+{
+    if(isSticky())
+        return _primary;
+
+    for(auto & replica: _replicas)
+    {
+        replica.open = replica.connector->isOpen();
+        replica.load = replica.connector->queueSize() +
+                (replica.connector->state() == SqlDatabaseConnector::Busy ? 1 : 0);
+    }
+
+    const int best = route(_replicas, _next, _maxLag);
+    if(best < 0)
+        return _primary;
+
+    _next = (best + 1) % _replicas.size();
+    _replicas[best].routedQueries++;
+    return _replicas[best].connector;
+}
+
+int SqlReplicaSet::route(const QList<ReplicaInfo> &replicas, int start, qint64 maxLag)
+{
+    int best = -1;
+    for(int n = 0; n < replicas.size(); n++)
+    {
+        const int i = (start + n) % replicas.size();
+        const ReplicaInfo & replica = replicas[i];
+        if(!replica.open || replica.lagMs < 0 || replica.lagMs > maxLag)
+            continue;
+        if(best < 0 || replica.load < replicas[best].load)
+            best = i;
+    }
+    return best;
+}
+
+qint64 SqlReplicaSet::lagOf(const QJsonObject &record, qint64 receiverTimeout)
+{
+    // Основной сервер или отсоединенная реплика не отстают "на 0"
+    if(!record.value("in_recovery").toBool())
+        return -1;
+    if(record.value("receiver_status").toString() != "streaming")
+        return -1;
+
+    const QJsonValue receiptAge = record.value("receipt_age_ms");
+    if(!receiptAge.isDouble() || receiptAge.toDouble() < 0 || receiptAge.toDouble() > receiverTimeout)
+        return -1;
+
+    const QJsonValue lag = record.value("lag_ms");
+    if(!lag.isDouble() || lag.toDouble() < 0)
+        return -1;
+    return qint64(lag.toDouble());
+}
+
+void SqlReplicaSet::noteWrite()
+{
+    _lastWrite.start();
+}
+
+bool SqlReplicaSet::isSticky() const
+{
+    return _stickiness > 0 && _lastWrite.isValid() && _lastWrite.elapsed() < _stickiness;
+}
+
+qint64 SqlReplicaSet::maxLag() const
+{
+    return _maxLag;
+}
+
+void SqlReplicaSet::setMaxLag(qint64 ms)
+{
+    _maxLag = ms;
+}
+
+qint64 SqlReplicaSet::stickiness() const
+{
+    return _stickiness;
+}
+
+void SqlReplicaSet::setStickiness(qint64 ms)
+{
+    _stickiness = ms;
+}
+
+qint64 SqlReplicaSet::receiverTimeout() const
+{
+    return _receiverTimeout;
+}
+
+void SqlReplicaSet::setReceiverTimeout(qint64 ms)
+{
+    _receiverTimeout = ms;
+}
+
+void SqlReplicaSet::setLagCheckInterval(int ms)
+{
+    if(ms > 0)
+        _lagTimer.start(ms);
+    else
+        _lagTimer.stop();
+}
+
+void SqlReplicaSet::checkLag()
+{
+    for(int i = 0; i < _replicas.size(); i++)
+    {
+        SqlDatabaseConnector * connector = _replicas[i].connector;
+        if(!connector->isOpen())
+        {
+            _replicas[i].lagMs = -1;
+            continue;
+        }
+
+        // Не копим запросы в очереди реплики, если предыдущий еще не вернулся
+        if(_lagQueries.contains(i))
+            continue;
+
+        _lagQueries.insert(i);
+        connector->sendQuery(LagQuery, this, [this, i](const QUuid &, const QueryResult & result) {
+            onLagQueryFinished(i, result);
+        });
+    }
+}
+
+void SqlReplicaSet::onLagQueryFinished(int index, const QueryResult &result)
+{
+    _lagQueries.remove(index);
+
+    if(index >= _replicas.size())
+        return;
+
+    ReplicaInfo & replica = _replicas[index];
+    if(result.error.type() != QSqlError::NoError || result.records.isEmpty())
+    {
+        qWarning().noquote() << Title << "can't get lag of replica"
+                             << replica.connector->connectionName() << result.error.text();
+        replica.lagMs = -1;
+        return;
+    }
+
+    const QJsonObject & record = result.records.first();
+    const qint64 lag = lagOf(record, _receiverTimeout);
+    if(lag < 0 && replica.lagMs >= 0)
+    {
+        qWarning().noquote() << Title << "replica" << replica.connector->connectionName() << "is unhealthy: recovery"
+                             << record.value("in_recovery").toBool() << "receiver"
+                             << record.value("receiver_status").toString()
+                             << "last message" << record.value("receipt_age_ms").toDouble() << "ms ago";
+    }
+    replica.lagMs = lag;
+    emit replicaLagChanged(replica.connector->connectionName(), replica.lagMs);
+}
@@ -0,0 +1,398 @@
+#include "SqlSearchIndex.h"
+#include <QDebug>
+#include <QSet>
+#include <algorithm>
+
+namespace
+{
+    QByteArray Title = QByteArrayLiteral("[SqlSearchIndex] :");
+
+    bool lessValue(const SqlValue & a, const SqlValue & b)
+    {
+        return a.compare(b) < 0;
+    }
+
+    //! Заголовок QArrayData и строка с завершающим нулем
+    qint64 textSize(const QString & text)
+    {
+        return text.isEmpty() ? 0 : 24 + (text.size() + 1) * qint64(sizeof(QChar));
+    }
+}
+
+SqlFilter SqlFilter::equals(const QString &column, const SqlValue &value)
+{
+    SqlFilter out;
+    out.kind = Equals;
+    out.column = column;
+    out.min = value;
+    return out;
+}
+
+SqlFilter SqlFilter::range(const QString &column, const SqlValue &min, const SqlValue &max)
+{
+    SqlFilter out;
+    out.kind = Range;
+    out.column = column;
+    out.min = min;
+    out.max = max;
+    return out;
+}
+
+SqlFilter SqlFilter::in(const QString &column, const QVector<SqlValue> &values)
+{
+    SqlFilter out;
+    out.kind = In;
+    out.column = column;
+    out.values = values;
+    return out;
+}
+
+SqlFilter SqlFilter::contains(const QString &column, const QString &text)
+{
+    SqlFilter out;
+    out.kind = Contains;
+    out.column = column;
+    out.text = text;
+    return out;
+}
+
+
+
+SqlSearchIndex::SqlSearchIndex(ISqlTableManager *manager, const QStringList &columns,
+                               const QStringList &textColumns, QObject *parent) :
+    QObject(parent),
+    _manager { manager }
+{
+    for(const auto & column: columns)
+        _columnNames << column.toUtf8();
+    for(const auto & column: textColumns)
+    {
+        int index = _columnNames.indexOf(column.toUtf8());
+        if(index < 0)
+        {
+            index = _columnNames.size();
+            _columnNames << column.toUtf8();
+        }
+        _textColumns << index;
+    }
+    _values.resize(_columnNames.size());
+    _folded.resize(_textColumns.size());
+    _trigrams.resize(_textColumns.size());
+
+    connect(_manager, &ISqlTableManager::itemsChanged,
+            this, &SqlSearchIndex::onItemsChanged);
+    connect(_manager, &ISqlTableManager::itemsReset,
+            this, [this]() { clear(); reportMemory(); emit changed(); });
+    rebuild();
+}
+
+SqlSearchIndex::Query SqlSearchIndex::compile(const QList<SqlFilter> &filters) const
+{
+    Query query;
+    for(const auto & filter: filters)
+    {
+        Query::Predicate predicate { filter.kind, _columnNames.indexOf(filter.column.toUtf8()), -1,
+                                     filter.min, filter.max, filter.values, filter.text.toLower() };
+        if(predicate.column < 0)
+        {
+            qWarning().noquote() << Title << "column" << filter.column << "is not indexed";
+            query._valid = false;
+            continue;
+        }
+
+        if(filter.kind == SqlFilter::Contains)
+        {
+            predicate.textColumn = _textColumns.indexOf(predicate.column);
+            if(predicate.textColumn < 0)
+            {
+                qWarning().noquote() << Title << "column" << filter.column << "is not a text column of the index";
+                query._valid = false;
+                continue;
+            }
+            // Пустая строка подходит ко всему
+            if(predicate.text.isEmpty())
+                continue;
+        }
+
+        if(filter.kind == SqlFilter::In)
+            std::sort(predicate.values.begin(), predicate.values.end(), lessValue);
+
+        query._predicates << predicate;
+    }
+    return query;
+}
+
+QStringList SqlSearchIndex::find(const Query &query, int limit) const
+{
+    QStringList out;
+    if(!query.isValid() || limit == 0)
+        return out;
+
+    // Кандидаты - из самого редкого триграмма среди условий Contains
+    const QVector<int> * candidates = nullptr;
+    for(const auto & predicate: query._predicates)
+    {
+        if(predicate.kind != SqlFilter::Contains || predicate.text.size() < 3)
+            continue;
+
+        const auto & trigrams = _trigrams[predicate.textColumn];
+        for(int i = 0; i + 3 <= predicate.text.size(); i++)
+        {
+            auto posting = trigrams.constFind(trigram(predicate.text.constData() + i));
+            if(posting == trigrams.constEnd())
+                return out;
+            if(!candidates || posting.value().size() < candidates->size())
+                candidates = &posting.value();
+        }
+    }
+
+    if(!candidates)
+    {
+        for(int slot = 0; slot < _uuids.size(); slot++)
+        {
+            if(_uuids[slot].isEmpty() || !matches(query, slot))
+                continue;
+            out << _uuids[slot];
+            if(limit > 0 && out.size() >= limit)
+                break;
+        }
+        return out;
+    }
+
+    // Ячейка могла попасть в список несколько раз после переиндексации
+    QVector<bool> seen(_uuids.size(), false);
+    for(int slot: *candidates)
+    {
+        if(seen[slot] || _uuids[slot].isEmpty())
+            continue;
+        seen[slot] = true;
+        if(!matches(query, slot))
+            continue;
+        out << _uuids[slot];
+        if(limit > 0 && out.size() >= limit)
+            break;
+    }
+    return out;
+}
+
+QStringList SqlSearchIndex::find(const QList<SqlFilter> &filters, int limit) const
+{
+    return find(compile(filters), limit);
+}
+
+int SqlSearchIndex::count() const
+{
+    return _slots.size();
+}
+
+qint64 SqlSearchIndex::memoryUsage() const
+{
+    // Ячейки по колонкам, узлы _slots, текст в нижнем регистре
+    // и списки триграмм (узел хеша с заголовком списка и номера ячеек)
+    qint64 bytes = _uuids.capacity() * qint64(sizeof(QString)) + _slots.size() * 32
+            + _freeSlots.capacity() * qint64(sizeof(int)) + _foldedBytes;
+    for(const auto & column: _values)
+        bytes += column.capacity() * qint64(sizeof(SqlValue));
+    for(const auto & column: _folded)
+        bytes += column.capacity() * qint64(sizeof(QString));
+    for(const auto & trigrams: _trigrams)
+        bytes += trigrams.size() * 48;
+    bytes += qint64(_livePostings + _stalePostings) * qint64(sizeof(int));
+    return bytes;
+}
+
+void SqlSearchIndex::rebuild()
+{
+    clear();
+    if(_manager)
+    {
+        for(const auto & item: _manager->items())
+        {
+            if(item)
+                store(item->uuid(), item);
+        }
+    }
+    reportMemory();
+    emit changed();
+}
+
+void SqlSearchIndex::onItemsChanged(const QStringList &inserted, const QStringList &updated, const QStringList &removed)
+{
+    if(!_manager)
+        return;
+
+    for(const auto & uuid: removed)
+        release(uuid);
+
+    for(const auto & uuid: updated + inserted)
+    {
+        auto item = _manager->item(uuid);
+        if(item)
+            store(uuid, item);
+        else
+            release(uuid);
+    }
+
+    if(_stalePostings > qMax(1024, _livePostings))
+        rebuildTrigrams();
+
+    reportMemory();
+    emit changed();
+}
+
+void SqlSearchIndex::clear()
+{
+    _uuids.clear();
+    _slots.clear();
+    _freeSlots.clear();
+    for(auto & column: _values)
+        column.clear();
+    for(auto & column: _folded)
+        column.clear();
+    for(auto & trigrams: _trigrams)
+        trigrams.clear();
+    _livePostings = 0;
+    _stalePostings = 0;
+    _foldedBytes = 0;
+}
+
+void SqlSearchIndex::store(const QString &uuid, const ISqlTableItem::ptr &item)
+{
+    int slot = _slots.value(uuid, -1);
+    if(slot < 0)
+    {
+        if(!_freeSlots.isEmpty())
+        {
+            slot = _freeSlots.takeLast();
+            _uuids[slot] = uuid;
+        }
+        else
+        {
+            slot = _uuids.size();
+            _uuids << uuid;
+            for(auto & column: _values)
+                column.resize(slot + 1);
+            for(auto & column: _folded)
+                column.resize(slot + 1);
+        }
+        _slots.insert(uuid, slot);
+    }
+
+    for(int i = 0; i < _columnNames.size(); i++)
+        _values[i][slot] = SqlValue(item->property(_columnNames[i].constData()));
+
+    for(int i = 0; i < _textColumns.size(); i++)
+    {
+        const QString folded = _values[_textColumns[i]][slot].toString().toLower();
+        if(folded == _folded[i][slot])
+            continue;
+        indexText(i, slot, folded);
+    }
+}
+
+void SqlSearchIndex::release(const QString &uuid)
+{
+    auto it = _slots.find(uuid);
+    if(it == _slots.end())
+        return;
+
+    const int slot = it.value();
+    _slots.erase(it);
+    _uuids[slot].clear();
+    for(auto & column: _values)
+        column[slot] = SqlValue();
+    for(auto & column: _folded)
+    {
+        const int size = column[slot].size();
+        _stalePostings += qMax(0, size - 2);
+        _livePostings -= qMax(0, size - 2);
+        _foldedBytes -= textSize(column[slot]);
+        column[slot].clear();
+    }
+    _freeSlots << slot;
+}
+
+void SqlSearchIndex::indexText(int textColumn, int slot, const QString &folded)
+{
+    QString & current = _folded[textColumn][slot];
+    const int oldPostings = qMax(0, current.size() - 2);
+    _stalePostings += oldPostings;
+    _livePostings -= oldPostings;
+    _foldedBytes += textSize(folded) - textSize(current);
+    current = folded;
+
+    auto & trigrams = _trigrams[textColumn];
+    QSet<quint64> added;
+    for(int i = 0; i + 3 <= folded.size(); i++)
+    {
+        const quint64 key = trigram(folded.constData() + i);
+        if(added.contains(key))
+            continue;
+        added.insert(key);
+        trigrams[key] << slot;
+    }
+    _livePostings += qMax(0, folded.size() - 2);
+}
+
+void SqlSearchIndex::rebuildTrigrams()
+{
+    // Текст живых ячеек заново добавляется через indexText
+    _livePostings = 0;
+    _foldedBytes = 0;
+    for(int i = 0; i < _textColumns.size(); i++)
+    {
+        _trigrams[i].clear();
+        QVector<QString> & folded = _folded[i];
+        for(int slot = 0; slot < folded.size(); slot++)
+        {
+            const QString text = folded[slot];
+            folded[slot].clear();
+            if(!_uuids[slot].isEmpty())
+                indexText(i, slot, text);
+        }
+    }
+    _stalePostings = 0;
+}
+
+bool SqlSearchIndex::matches(const Query &query, int slot) const
+{
+    for(const auto & predicate: query._predicates)
+    {
+        const SqlValue & value = _values[predicate.column][slot];
+        switch(predicate.kind)
+        {
+        case SqlFilter::Equals:
+            if(value.compare(predicate.min) != 0)
+                return false;
+        break;
+        case SqlFilter::Range:
+            if(value.isNull())
+                return false;
+            if(!predicate.min.isNull() && value.compare(predicate.min) < 0)
+                return false;
+            if(!predicate.max.isNull() && value.compare(predicate.max) > 0)
+                return false;
+        break;
+        case SqlFilter::In:
+            if(!std::binary_search(predicate.values.constBegin(), predicate.values.constEnd(), value, lessValue))
+                return false;
+        break;
+        case SqlFilter::Contains:
+            if(!_folded[predicate.textColumn][slot].contains(predicate.text))
+                return false;
+        break;
+        }
+    }
+    return true;
+}
+
+void SqlSearchIndex::reportMemory()
+{
+    if(_manager)
+        _manager->reportIndexMemory(this, memoryUsage());
+}
+
+quint64 SqlSearchIndex::trigram(const QChar *text)
+{
+    return (quint64(text[0].unicode()) << 32) | (quint64(text[1].unicode()) << 16) | quint64(text[2].unicode());
+}
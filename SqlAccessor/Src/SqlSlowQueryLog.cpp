@@ -0,0 +1,142 @@
+#include "SqlSlowQueryLog.h"
+#include <QIODevice>
+#include <QTextStream>
+
+SqlSlowQueryLog::SqlSlowQueryLog(int capacity)
+{
+    _entries.resize(qMax(1, capacity));
+}
+
+qint64 SqlSlowQueryLog::threshold() const
+{
+    QMutexLocker locker(&_mutex);
+    return _threshold;
+}
+
+void SqlSlowQueryLog::setThreshold(qint64 ms)
+{
+    QMutexLocker locker(&_mutex);
+    _threshold = qMax<qint64>(0, ms);
+}
+
+bool SqlSlowQueryLog::isSlow(qint64 ms) const
+{
+    QMutexLocker locker(&_mutex);
+    return _threshold > 0 && ms >= _threshold;
+}
+
+int SqlSlowQueryLog::capacity() const
+{
+    QMutexLocker locker(&_mutex);
+    return _entries.size();
+}
+
+void SqlSlowQueryLog::setCapacity(int capacity)
+{
+    const QList<Entry> last = entries();
+
+    QMutexLocker locker(&_mutex);
+    _entries = QVector<Entry>(qMax(1, capacity));
+    _next = 0;
+    _size = 0;
+    for(int i = qMax(0, last.size() - _entries.size()); i < last.size(); i++)
+    {
+        _entries[_next] = last[i];
+        _next = (_next + 1) % _entries.size();
+        _size++;
+    }
+}
+
+void SqlSlowQueryLog::record(const Entry &entry)
+{
+    QMutexLocker locker(&_mutex);
+    _entries[_next] = entry;
+    _next = (_next + 1) % _entries.size();
+    _size = qMin(_size + 1, _entries.size());
+    _recorded++;
+}
+
+void SqlSlowQueryLog::attachPlan(const QUuid &uuid, const QString &plan)
+{
+    QMutexLocker locker(&_mutex);
+    for(int i = 0; i < _size; i++)
+    {
+        // Ищем с новых записей: план приходит вскоре после записи
+        const int index = (_next - 1 - i + _entries.size()) % _entries.size();
+        if(_entries[index].uuid == uuid)
+        {
+            _entries[index].plan = plan;
+            return;
+        }
+    }
+}
+
+QList<SqlSlowQueryLog::Entry> SqlSlowQueryLog::entries() const
+{
+    QMutexLocker locker(&_mutex);
+    QList<Entry> out;
+    out.reserve(_size);
+    for(int i = 0; i < _size; i++)
+        out << _entries[(_next - _size + i + _entries.size()) % _entries.size()];
+    return out;
+}
+
+quint64 SqlSlowQueryLog::recorded() const
+{
+    QMutexLocker locker(&_mutex);
+    return _recorded;
+}
+
+qint64 SqlSlowQueryLog::memoryUsage() const
+{
+    QMutexLocker locker(&_mutex);
+    qint64 size = _entries.size() * qint64(sizeof(Entry));
+    for(const auto & entry: _entries)
+        size += (entry.query.size() + entry.error.size() + entry.plan.size()) * qint64(sizeof(QChar));
+    return size;
+}
+
+void SqlSlowQueryLog::clear()
+{
+    QMutexLocker locker(&_mutex);
+    _entries = QVector<Entry>(_entries.size());
+    _next = 0;
+    _size = 0;
+}
+
+bool SqlSlowQueryLog::dump(QIODevice *device) const
+{
+    if(!device || !device->isWritable())
+        return false;
+
+    QTextStream stream(device);
+    stream.setCodec("UTF-8");
+    for(const auto & entry: entries())
+    {
+        stream << entry.startedAt.toString(Qt::ISODateWithMs)
+               << " total=" << entry.totalMs() << "ms"
+               << " wait=" << entry.waitMs << "ms"
+               << " exec=" << entry.executeMs << "ms"
+               << " fetch=" << entry.fetchMs << "ms"
+               << " rows=" << entry.rows
+               << " uuid=" << entry.uuid.toString(QUuid::WithoutBraces) << '\n'
+               << entry.query.trimmed() << '\n';
+        if(!entry.error.isEmpty())
+            stream << "error: " << entry.error << '\n';
+        if(!entry.plan.isEmpty())
+            stream << entry.plan << '\n';
+        stream << '\n';
+    }
+    stream.flush();
+    return stream.status() == QTextStream::Ok;
+}
+
+bool SqlSlowQueryLog::beginExplain()
+{
+    return _explaining.testAndSetOrdered(0, 1);
+}
+
+void SqlSlowQueryLog::endExplain()
+{
+    _explaining.storeRelease(0);
+}
@@ -0,0 +1,215 @@
+#include "SqlSortedView.h"
+#include <algorithm>
+
+SqlSortedView::SqlSortedView(ISqlTableManager *manager, const QList<Column> &columns, QObject *parent) :
+    QObject(parent),
+    _manager { manager }
+{
+    for(const auto & column: columns)
+        _columns << qMakePair(column.first.toUtf8(), column.second);
+
+    connect(_manager, &ISqlTableManager::itemsChanged,
+            this, &SqlSortedView::onItemsChanged);
+    connect(_manager, &ISqlTableManager::itemsReset,
+            this, &SqlSortedView::onItemsReset);
+    rebuild();
+}
+
+SqlSortedView::SqlSortedView(ISqlTableManager *manager, const QString &field, Qt::SortOrder order, QObject *parent) :
+    SqlSortedView(manager, QList<Column> { qMakePair(field, order) }, parent)
+{
+}
+
+int SqlSortedView::count() const
+{
+    return _entries.size();
+}
+
+ISqlTableItem::ptr SqlSortedView::at(int row) const
+{
+    if(row < 0 || row >= _entries.size())
+        return ISqlTableItem::ptr(nullptr);
+    return _entries[row].item;
+}
+
+int SqlSortedView::indexOf(const QString &uuid) const
+{
+    auto key = _keys.constFind(uuid);
+    if(key == _keys.constEnd())
+        return -1;
+
+    const int row = lowerBound(key.value(), uuid);
+    return (row < _entries.size() && _entries[row].uuid == uuid) ? row : -1;
+}
+
+QList<SqlSortedView::Column> SqlSortedView::columns() const
+{
+    QList<Column> out;
+    for(const auto & column: _columns)
+        out << qMakePair(QString::fromUtf8(column.first), column.second);
+    return out;
+}
+
+void SqlSortedView::setBatchResetThreshold(int changes)
+{
+    _batchResetThreshold = changes;
+}
+
+qint64 SqlSortedView::memoryUsage() const
+{
+    // Запись, ключ сортировки (разделяется с _keys) и узел _keys.
+    // Текст и uuid разделяются с элементами менеджера
+    const qint64 keySize = 24 + _columns.size() * qint64(sizeof(SqlValue));
+    return _entries.capacity() * qint64(sizeof(Entry)) + _entries.size() * (keySize + 32);
+}
+
+void SqlSortedView::rebuild()
+{
+    emit aboutToBeReset();
+
+    _entries.clear();
+    _keys.clear();
+    if(_manager)
+    {
+        const auto items = _manager->items();
+        _entries.reserve(items.size());
+        _keys.reserve(items.size());
+        for(const auto & item: items)
+        {
+            if(!item)
+                continue;
+            Entry entry { keyOf(item), item->uuid(), item };
+            _keys.insert(entry.uuid, entry.key);
+            _entries << entry;
+        }
+    }
+
+    std::sort(_entries.begin(), _entries.end(), [this](const Entry & a, const Entry & b) {
+        return compare(a.key, a.uuid, b) < 0;
+    });
+
+    reportMemory();
+    emit reset();
+}
+
+void SqlSortedView::onItemsChanged(const QStringList &inserted, const QStringList &updated, const QStringList &removed)
+{
+    if(!_manager)
+        return;
+
+    // Большую пачку (например, перезагрузку) дешевле отсортировать заново
+    const int changes = inserted.size() + updated.size() + removed.size();
+    const int threshold = _batchResetThreshold >= 0 ? _batchResetThreshold
+                                                    : qMax(64, _entries.size() / 8);
+    if(changes > threshold)
+    {
+        rebuild();
+        return;
+    }
+
+    for(const auto & uuid: removed)
+    {
+        const int row = indexOf(uuid);
+        if(row >= 0)
+            removeAt(row);
+    }
+
+    for(const auto & uuid: updated + inserted)
+    {
+        auto item = _manager->item(uuid);
+        if(!item)
+            continue;
+
+        const int row = indexOf(uuid);
+        if(row >= 0)
+            updateEntry(row, item);
+        else
+            insertEntry(uuid, item);
+    }
+    reportMemory();
+}
+
+void SqlSortedView::onItemsReset()
+{
+    emit aboutToBeReset();
+    _entries.clear();
+    _keys.clear();
+    reportMemory();
+    emit reset();
+}
+
+QVector<SqlValue> SqlSortedView::keyOf(const ISqlTableItem::ptr &item) const
+{
+    QVector<SqlValue> key;
+    key.reserve(_columns.size());
+    for(const auto & column: _columns)
+        key << SqlValue(item->property(column.first.constData()));
+    return key;
+}
+
+int SqlSortedView::compare(const QVector<SqlValue> &key, const QString &uuid, const Entry &entry) const
+{
+    for(int i = 0; i < _columns.size(); i++)
+    {
+        const int result = key[i].compare(entry.key[i]);
+        if(result != 0)
+            return _columns[i].second == Qt::AscendingOrder ? result : -result;
+    }
+    return uuid.compare(entry.uuid);
+}
+
+int SqlSortedView::lowerBound(const QVector<SqlValue> &key, const QString &uuid) const
+{
+    auto it = std::lower_bound(_entries.constBegin(), _entries.constEnd(), 0,
+                               [this, &key, &uuid](const Entry & entry, int) {
+        return compare(key, uuid, entry) > 0;
+    });
+    return int(it - _entries.constBegin());
+}
+
+void SqlSortedView::insertEntry(const QString &uuid, const ISqlTableItem::ptr &item)
+{
+    Entry entry { keyOf(item), uuid, item };
+    const int row = lowerBound(entry.key, uuid);
+
+    emit rowsAboutToBeInserted(row, row);
+    _keys.insert(uuid, entry.key);
+    _entries.insert(row, entry);
+    emit rowsInserted(row, row);
+}
+
+void SqlSortedView::removeAt(int row)
+{
+    emit rowsAboutToBeRemoved(row, row);
+    _keys.remove(_entries[row].uuid);
+    _entries.remove(row);
+    emit rowsRemoved(row, row);
+}
+
+void SqlSortedView::updateEntry(int row, const ISqlTableItem::ptr &item)
+{
+    const QVector<SqlValue> key = keyOf(item);
+    Entry & entry = _entries[row];
+
+    // Элемент остается на месте, если он все еще между соседями
+    const bool afterPrevious = row == 0 || compare(key, entry.uuid, _entries[row - 1]) > 0;
+    const bool beforeNext = row + 1 == _entries.size() || compare(key, entry.uuid, _entries[row + 1]) < 0;
+    if(afterPrevious && beforeNext)
+    {
+        entry.key = key;
+        entry.item = item;
+        _keys.insert(entry.uuid, key);
+        emit rowsChanged(row, row);
+        return;
+    }
+
+    const QString uuid = entry.uuid;
+    removeAt(row);
+    insertEntry(uuid, item);
+}
+
+void SqlSortedView::reportMemory()
+{
+    if(_manager)
+        _manager->reportIndexMemory(this, memoryUsage());
+}
@@ -0,0 +1,456 @@
+#include "SqlTableExporter.h"
+#include "ISqlTableManager.h"
+#include "SqlTextDecoder.h"
+#include "SqlValue.h"
+#include <QDebug>
+#include <QIODevice>
+#include <QDataStream>
+#include <QBuffer>
+#include <QJsonObject>
+
+namespace
+{
+    QByteArray Title = QByteArrayLiteral("[SqlTableExporter] :");
+
+    const quint32 Magic = 0x53514c54; // "SQLT"
+    //! 2 - добавлен тип SqlValue::Bytes (bytea). Файлы версии 1 читаются
+    const quint16 FormatVersion = 2;
+    const QDataStream::Version StreamVersion = QDataStream::Qt_5_12;
+
+    //! Отдельное соединение с параметрами коннектора на время выгрузки/загрузки
+    class SideConnection
+    {
+    public:
+        explicit SideConnection(SqlDatabaseConnector * connector) :
+            _name { QUuid::createUuid().toString() },
+            _database { QSqlDatabase::addDatabase("QPSQL", _name) }
+        {
+            _database.setHostName(connector->hostName());
+            _database.setPort(connector->port());
+            _database.setDatabaseName(connector->databaseName());
+            _database.setUserName(connector->username());
+            _database.setPassword(connector->password());
+        }
+
+        ~SideConnection()
+        {
+            _database.close();
+            _database = QSqlDatabase();
+            QSqlDatabase::removeDatabase(_name);
+        }
+
+        QSqlDatabase & database() { return _database; }
+
+    private:
+        QString _name;
+        QSqlDatabase _database;
+    };
+
+    QString encoded(QTextCodec * codec, const QString & query)
+    {
+        QString query_coded = query;
+        if(codec)
+            query_coded = codec->fromUnicode(query);
+        return query_coded;
+    }
+
+    //! Типы, которые QPSQL отдает с потерей точности:
+    //! numeric - как double, время - как QDateTime/QTime с миллисекундами
+    bool isPrecisionSensitive(const QString & type)
+    {
+        return type == QLatin1String("numeric") ||
+               type.startsWith(QLatin1String("timestamp")) ||
+               type.startsWith(QLatin1String("time "));
+    }
+
+    //! Список колонок для выгрузки: колонки с потерей точности читаются текстом,
+    //! при загрузке текстовый литерал приводится к типу колонки сервером
+    QString exportColumns(QSqlDatabase & database, const SqlTextDecoder & decoder,
+                          const QString & schema, const QString & table)
+    {
+        QSqlQuery query(database);
+        query.setForwardOnly(true);
+        const QString relation = QString("%1.%2").arg(schema, table).replace('\'', "''");
+        const QString columnsQuery = QString("SELECT attname, atttypid::regtype::text FROM pg_attribute "
+                                             "WHERE attrelid = to_regclass('%1') AND attnum > 0 AND NOT attisdropped "
+                                             "ORDER BY attnum;").arg(relation);
+        if(!query.exec(encoded(decoder.codec(), columnsQuery)))
+            return "*";
+
+        QStringList columns;
+        bool cast = false;
+        while(query.next())
+        {
+            const QString name = decoder.decodeText(query.value(0).toString());
+            const QString quoted = '"' + QString(name).replace('"', "\"\"") + '"';
+            if(isPrecisionSensitive(query.value(1).toString()))
+            {
+                columns << quoted + "::text AS " + quoted;
+                cast = true;
+            }
+            else
+                columns << quoted;
+        }
+        return cast ? columns.join(", ") : QString("*");
+    }
+}
+
+SqlTableExporter::SqlTableExporter(SqlDatabaseConnector *connector, QObject *parent) :
+    QObject(parent),
+    _connector { connector }
+{
+}
+
+int SqlTableExporter::batchSize() const
+{
+    return _batchSize;
+}
+
+void SqlTableExporter::setBatchSize(int rows)
+{
+    _batchSize = qMax(1, rows);
+}
+
+bool SqlTableExporter::exportTable(const QString &schema, const QString &table, QIODevice *device, const QString &where)
+{
+    _stats = Stats();
+    _lastError.clear();
+    _timer.start();
+
+    if(!_connector)
+        return fail("no connector");
+    if(!device || !device->isWritable())
+        return fail("device is not writable");
+
+    SideConnection connection(_connector);
+    QSqlDatabase & database = connection.database();
+    if(!database.open())
+        return fail(database.lastError().text());
+
+    // Курсор живет только внутри транзакции, заодно все блоки читаются из одного снимка
+    database.transaction();
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+    query.setNumericalPrecisionPolicy(QSql::HighPrecision);
+
+    SqlTextDecoder decoder(_connector->codec());
+    const QString select = QString("SELECT %1 FROM %2.%3").arg(exportColumns(database, decoder, schema, table), schema, table)
+            + (where.isEmpty() ? QString() : " WHERE " + where);
+    if(!query.exec(encoded(_connector->codec(), QString("DECLARE sql_table_export NO SCROLL CURSOR FOR %1;").arg(select))))
+    {
+        database.rollback();
+        return fail(query.lastError().text());
+    }
+
+    SqlTextDecoder::Plan plan;
+    bool headerWritten = false;
+    const QString fetch = QString("FETCH FORWARD %1 FROM sql_table_export;").arg(_batchSize);
+
+    forever
+    {
+        if(!query.exec(fetch))
+        {
+            database.rollback();
+            return fail(query.lastError().text());
+        }
+
+        if(!headerWritten)
+        {
+            plan = decoder.plan(query.record());
+            Header header { schema, table, QStringList(plan.fieldNames.toList()) };
+            if(!writeHeader(device, header))
+            {
+                database.rollback();
+                return false;
+            }
+            headerWritten = true;
+        }
+
+        QByteArray block;
+        QDataStream stream(&block, QIODevice::WriteOnly);
+        stream.setVersion(StreamVersion);
+        qint32 rows = 0;
+        while(query.next())
+        {
+            for(const auto & value: decoder.recordToValues(query.record(), plan))
+                stream << value;
+            rows++;
+        }
+        if(rows == 0)
+            break;
+
+        if(!writeBlock(device, rows, block))
+        {
+            database.rollback();
+            return false;
+        }
+    }
+
+    query.exec("CLOSE sql_table_export;");
+    database.commit();
+
+    if(!writeBlock(device, 0, QByteArray()))
+        return false;
+    return true;
+}
+
+bool SqlTableExporter::importTable(QIODevice *device, const QString &schema, const QString &table)
+{
+    _stats = Stats();
+    _lastError.clear();
+    _timer.start();
+
+    if(!_connector)
+        return fail("no connector");
+    if(!device || !device->isReadable())
+        return fail("device is not readable");
+
+    QDataStream stream(device);
+    Header header;
+    if(!readHeader(stream, header))
+        return false;
+
+    const QString targetSchema = schema.isEmpty() ? header.schema : schema;
+    const QString targetTable = table.isEmpty() ? header.table : table;
+
+    SideConnection connection(_connector);
+    QSqlDatabase & database = connection.database();
+    if(!database.open())
+        return fail(database.lastError().text());
+
+    database.transaction();
+    QSqlQuery query(database);
+    const QString insert = QString("INSERT INTO %1.%2 (%3) VALUES ").arg(targetSchema, targetTable, header.columns.join(", "));
+
+    forever
+    {
+        qint32 rows = 0;
+        QByteArray block;
+        stream >> rows;
+        if(rows > 0)
+            stream >> block;
+        if(stream.status() != QDataStream::Ok)
+        {
+            database.rollback();
+            return fail("unexpected end of file");
+        }
+        if(rows == 0)
+            break;
+
+        QDataStream blockStream(block);
+        blockStream.setVersion(StreamVersion);
+        QStringList tuples;
+        tuples.reserve(rows);
+        QStringList literals;
+        for(qint32 row = 0; row < rows; row++)
+        {
+            literals.clear();
+            for(int column = 0; column < header.columns.size(); column++)
+            {
+                SqlValue value;
+                blockStream >> value;
+                literals << value.toSqlLiteral();
+            }
+            tuples << "(" + literals.join(", ") + ")";
+        }
+        if(blockStream.status() != QDataStream::Ok)
+        {
+            database.rollback();
+            return fail("corrupt row block");
+        }
+
+        if(!query.exec(encoded(_connector->codec(), insert + tuples.join(",\n") + ";")))
+        {
+            database.rollback();
+            return fail(query.lastError().text());
+        }
+        finishBlock(rows, block.size());
+    }
+
+    if(!database.commit())
+        return fail(database.lastError().text());
+    return true;
+}
+
+bool SqlTableExporter::exportItems(ISqlTableManager *manager, QIODevice *device)
+{
+    _stats = Stats();
+    _lastError.clear();
+    _timer.start();
+
+    if(!manager)
+        return fail("no manager");
+    if(!device || !device->isWritable())
+        return fail("device is not writable");
+
+    // Снимок не меняется, пока по нему идет выгрузка
+    const SqlItemSnapshot::ptr snapshot = manager->snapshot();
+    Header header { manager->tableScheme(), manager->tableName(), QStringList() };
+    if(snapshot && !snapshot->isEmpty())
+        header.columns = snapshot->begin().value()->sqlFields() << "_uuid";
+    if(!writeHeader(device, header))
+        return false;
+
+    QBuffer block;
+    block.open(QIODevice::WriteOnly);
+    QDataStream stream(&block);
+    stream.setVersion(StreamVersion);
+    qint32 rows = 0;
+
+    if(snapshot)
+    {
+        for(auto it = snapshot->begin(); it != snapshot->end(); ++it)
+        {
+            if(!it.value())
+                continue;
+            const QJsonObject object = it.value()->toJsonObject();
+            for(const auto & column: header.columns)
+                stream << SqlValue::fromJson(object.value(column));
+
+            if(++rows == _batchSize)
+            {
+                if(!writeBlock(device, rows, block.data()))
+                    return false;
+                rows = 0;
+                block.setData(QByteArray());
+                block.seek(0);
+            }
+        }
+    }
+
+    if(rows > 0 && !writeBlock(device, rows, block.data()))
+        return false;
+    return writeBlock(device, 0, QByteArray());
+}
+
+bool SqlTableExporter::importItems(QIODevice *device, ItemFactory create, ItemHandler handler)
+{
+    _stats = Stats();
+    _lastError.clear();
+    _timer.start();
+
+    if(!device || !device->isReadable())
+        return fail("device is not readable");
+    if(!create || !handler)
+        return fail("no item factory or handler");
+
+    QDataStream stream(device);
+    Header header;
+    if(!readHeader(stream, header))
+        return false;
+
+    forever
+    {
+        qint32 rows = 0;
+        QByteArray block;
+        stream >> rows;
+        if(rows > 0)
+            stream >> block;
+        if(stream.status() != QDataStream::Ok)
+            return fail("unexpected end of file");
+        if(rows == 0)
+            break;
+
+        QDataStream blockStream(block);
+        blockStream.setVersion(StreamVersion);
+        for(qint32 row = 0; row < rows; row++)
+        {
+            QJsonObject object;
+            for(const auto & column: header.columns)
+            {
+                SqlValue value;
+                blockStream >> value;
+                object.insert(column, value.toJson());
+            }
+            if(blockStream.status() != QDataStream::Ok)
+                return fail("corrupt row block");
+
+            auto item = create();
+            if(!item)
+                return fail("item factory returned nullptr");
+            if(!item->fromJsonObject(object))
+                qWarning().noquote() << Title << "item" << object.value("_uuid").toString() << "is missing fields";
+            handler(item);
+        }
+        finishBlock(rows, block.size());
+    }
+    return true;
+}
+
+SqlTableExporter::Stats SqlTableExporter::stats() const
+{
+    return _stats;
+}
+
+QString SqlTableExporter::lastError() const
+{
+    return _lastError;
+}
+
+bool SqlTableExporter::fail(const QString &error)
+{
+    _lastError = error;
+    _stats.elapsedMs = _timer.elapsed();
+    qWarning().noquote() << Title << error;
+    return false;
+}
+
+bool SqlTableExporter::writeHeader(QIODevice *device, const Header &header)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << Magic << FormatVersion;
+    stream.setVersion(StreamVersion);
+    stream << header.schema << header.table << header.columns;
+
+    if(device->write(data) != data.size())
+        return fail(device->errorString());
+    _stats.bytes += data.size();
+    return true;
+}
+
+bool SqlTableExporter::writeBlock(QIODevice *device, qint32 rows, const QByteArray &block)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(StreamVersion);
+    stream << rows;
+    if(rows > 0)
+        stream << block;
+
+    if(device->write(data) != data.size())
+        return fail(device->errorString());
+    if(rows > 0)
+        finishBlock(rows, data.size());
+    else
+    {
+        _stats.bytes += data.size();
+        _stats.elapsedMs = _timer.elapsed();
+    }
+    return true;
+}
+
+bool SqlTableExporter::readHeader(QDataStream &stream, Header &header)
+{
+    quint32 magic = 0;
+    quint16 version = 0;
+    stream >> magic >> version;
+    if(magic != Magic)
+        return fail("not a table export file");
+    if(version < 1 || version > FormatVersion)
+        return fail(QString("unsupported format version %1").arg(version));
+
+    stream.setVersion(StreamVersion);
+    stream >> header.schema >> header.table >> header.columns;
+    if(stream.status() != QDataStream::Ok || header.columns.isEmpty())
+        return fail("corrupt file header");
+    return true;
+}
+
+void SqlTableExporter::finishBlock(qint64 rows, qint64 bytes)
+{
+    _stats.rows += rows;
+    _stats.bytes += bytes;
+    _stats.elapsedMs = _timer.elapsed();
+    emit progress(_stats.rows, _stats.bytes);
+}
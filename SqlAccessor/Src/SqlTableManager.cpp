@@ -0,0 +1,104 @@
+#include "SqlTableManager.h"
+#include <QDebug>
+
+namespace
+{
+    QByteArray Title = QByteArrayLiteral("[SqlTableManager] :");
+}
+
+SqlTableManagerBase::SqlTableManagerBase(SqlDatabaseConnector *connector, const QString &schema,
+                                         const QString &table, QObject *parent) :
+    QObject(parent),
+    _connector { connector },
+    _schema { schema },
+    _table { table }
+{
+    _connector->watchTable(_schema, _table);
+
+    connect(_connector, &SqlDatabaseConnector::sharedNotification,
+            this, [this](SqlNotification::ptr notification) { onNotification(*notification); });
+
+    _changeFetcher = new SqlChangeFetcher(_connector, _schema, _table, this);
+    connect(_changeFetcher, &SqlChangeFetcher::resolved,
+            this, &SqlTableManagerBase::onChangesResolved);
+}
+
+SqlTableManagerBase::~SqlTableManagerBase()
+{
+    if(_connector)
+        _connector->unwatchTable(_schema, _table);
+}
+
+const QString &SqlTableManagerBase::tableScheme() const
+{
+    return _schema;
+}
+
+const QString &SqlTableManagerBase::tableName() const
+{
+    return _table;
+}
+
+void SqlTableManagerBase::load()
+{
+    sendQuery(selectQuery());
+}
+
+SqlChangeFetcher *SqlTableManagerBase::changeFetcher() const
+{
+    return _changeFetcher;
+}
+
+void SqlTableManagerBase::sendQuery(const QString &query)
+{
+    if(!_connector)
+        return;
+
+    _connector->sendQuery(query, this, [this](const QUuid &, const QueryResult & result) {
+        onQueryResult(result);
+    });
+}
+
+void SqlTableManagerBase::onQueryResult(const QueryResult &result)
+{
+    if(result.error.type() != QSqlError::NoError)
+    {
+        qWarning().noquote() << Title << QString("query error for table %1.%2 :").arg(_schema, _table)
+                             << result.error.text();
+        return;
+    }
+
+    if(!result.isSelect)
+        return;
+
+    applyRecords(result.records);
+    emit updated();
+}
+
+void SqlTableManagerBase::onNotification(const SqlNotification &notif)
+{
+    if(notif.table != _table || notif.schema != _schema)
+        return;
+
+    if(notif.format == SqlNotification::ChangePointer)
+    {
+        _changeFetcher->enqueue(notif);
+        return;
+    }
+
+    if(!applyNotification(notif))
+        return;
+
+    emit updated();
+    emit rowChanged(notif.itemUuid, notif.actionType);
+}
+
+void SqlTableManagerBase::onChangesResolved(const QList<SqlNotification> &notifications)
+{
+    for(const auto & notif: notifications)
+        applyNotification(notif);
+
+    emit updated();
+    for(const auto & notif: notifications)
+        emit rowChanged(notif.itemUuid, notif.actionType);
+}
@@ -0,0 +1,163 @@
+#include "SqlTextDecoder.h"
+#include <QSqlField>
+#include <QJsonValue>
+#include <cstring>
+
+namespace
+{
+    const int Utf8Mib = 106;
+
+    // Проверяем блоками, чтобы компилятор мог векторизовать внутренний цикл,
+    // но не сканировать всю строку, если не-ASCII символ встретился в начале
+    const int BlockWords = 8;
+}
+
+SqlTextDecoder::SqlTextDecoder(QTextCodec *codec)
+{
+    setCodec(codec);
+}
+
+QTextCodec *SqlTextDecoder::codec() const
+{
+    return _codec;
+}
+
+void SqlTextDecoder::setCodec(QTextCodec *codec)
+{
+    _codec = codec;
+    _passthrough = !_codec || _codec->mibEnum() == Utf8Mib;
+
+    const QByteArray probe = QByteArrayLiteral("AZaz09 _{}\":,[]");
+    _asciiCompatible = _passthrough ||
+            (_codec->toUnicode(probe) == QLatin1String(probe));
+}
+
+bool SqlTextDecoder::isPassthrough() const
+{
+    return _passthrough;
+}
+
+SqlTextDecoder::Plan SqlTextDecoder::plan(const QSqlRecord &record) const
+{
+    Plan out;
+    const int count = record.count();
+    out.fieldNames.reserve(count);
+    out.textColumns.reserve(count);
+    for(int i = 0; i < count; i++)
+    {
+        out.fieldNames << record.fieldName(i);
+
+        const QVariant::Type type = record.field(i).type();
+        out.textColumns << (!_passthrough &&
+                            (type == QVariant::String || type == QVariant::Char));
+    }
+    return out;
+}
+
+QJsonObject SqlTextDecoder::recordToJson(const QSqlRecord &record, const Plan &plan) const
+{
+    QJsonObject out;
+    const int count = qMin(record.count(), plan.fieldNames.size());
+    for(int i = 0; i < count; i++)
+    {
+        const QVariant value = record.value(i);
+        if(plan.textColumns[i] && !value.isNull())
+            out.insert(plan.fieldNames[i], decodeText(value.toString()));
+        else
+            out.insert(plan.fieldNames[i], QJsonValue::fromVariant(value));
+    }
+    return out;
+}
+
+QVector<SqlValue> SqlTextDecoder::recordToValues(const QSqlRecord &record, const Plan &plan) const
+{
+    QVector<SqlValue> out;
+    const int count = qMin(record.count(), plan.fieldNames.size());
+    out.reserve(count);
+    for(int i = 0; i < count; i++)
+    {
+        const QVariant value = record.value(i);
+        if(plan.textColumns[i] && !value.isNull())
+            out << SqlValue(decodeText(value.toString()));
+        else
+            out << SqlValue(value);
+    }
+    return out;
+}
+
+QString SqlTextDecoder::decodeText(const QString &text) const
+{
+    if(_passthrough)
+        return text;
+    if(_asciiCompatible && isAscii(text.constData(), text.size()))
+        return text;
+    return _codec->toUnicode(text.toUtf8());
+}
+
+QByteArray SqlTextDecoder::decodePayload(const QVariant &payload) const
+{
+    if(payload.type() == QVariant::ByteArray)
+    {
+        QByteArray bytes = payload.toByteArray();
+        if(_passthrough || (_asciiCompatible && isAscii(bytes.constData(), bytes.size())))
+            return bytes;
+        return _codec->toUnicode(bytes).toUtf8();
+    }
+
+    const QString text = payload.toString();
+    return decodeText(text).toUtf8();
+}
+
+bool SqlTextDecoder::isAscii(const char *data, int size)
+{
+    const int wordSize = int(sizeof(quint64));
+    const quint64 mask = Q_UINT64_C(0x8080808080808080);
+
+    int i = 0;
+    while(i + wordSize * BlockWords <= size)
+    {
+        quint64 acc = 0;
+        for(int w = 0; w < BlockWords; w++)
+        {
+            quint64 word;
+            std::memcpy(&word, data + i + w * wordSize, wordSize);
+            acc |= word;
+        }
+        if(acc & mask)
+            return false;
+        i += wordSize * BlockWords;
+    }
+
+    uchar tail = 0;
+    for(; i < size; i++)
+        tail |= uchar(data[i]);
+    return (tail & 0x80) == 0;
+}
+
+bool SqlTextDecoder::isAscii(const QChar *data, int size)
+{
+    // 4 символа UTF-16 в одном 64-битном слове
+    const int charsPerWord = int(sizeof(quint64) / sizeof(QChar));
+    const quint64 mask = Q_UINT64_C(0xFF80FF80FF80FF80);
+    const char * bytes = reinterpret_cast<const char *>(data);
+
+    int i = 0;
+    while(i + charsPerWord * BlockWords <= size)
+    {
+        quint64 acc = 0;
+        for(int w = 0; w < BlockWords; w++)
+        {
+            quint64 word;
+            std::memcpy(&word, bytes + (i + w * charsPerWord) * int(sizeof(QChar)), sizeof(quint64));
+            acc |= word;
+        }
+        if(acc & mask)
+            return false;
+        i += charsPerWord * BlockWords;
+    }
+
+    ushort tail = 0;
+    for(; i < size; i++)
+        tail |= data[i].unicode();
+    return (tail & 0xFF80) == 0;
+}
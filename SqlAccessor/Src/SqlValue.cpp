@@ -1,7 +1,592 @@
 #include "SqlValue.h"
+#include <cstring>
+#include <limits>
+#include <new>
+#include <QtNumeric>
+#include <QJsonValue>
 
-SqlValue::SqlValue() :
-    _length { -1 }
+namespace
 {
+    static_assert(sizeof(QUuid) <= 24, "QUuid does not fit into SqlValue");
+    static_assert(sizeof(QString) <= 24, "QString does not fit into SqlValue");
+    static_assert(sizeof(QByteArray) <= 24, "QByteArray does not fit into SqlValue");
 
+    template<typename T>
+    T & as(char * data) { return *reinterpret_cast<T *>(data); }
+
+    template<typename T>
+    const T & as(const char * data) { return *reinterpret_cast<const T *>(data); }
+
+    //! Помещается ли число в qint64 без переполнения (2^63 как double - уже нет)
+    bool fitsInt64(double value)
+    {
+        return value >= -9223372036854775808.0 && value < 9223372036854775808.0;
+    }
+}
+
+SqlValue::SqlValue()
+{
+}
+
+SqlValue::SqlValue(qint32 value) :
+    _type { Int32 }
+{
+    as<qint32>(_data) = value;
+}
+
+SqlValue::SqlValue(qint64 value) :
+    _type { Int64 }
+{
+    as<qint64>(_data) = value;
+}
+
+SqlValue::SqlValue(double value) :
+    _type { Float64 }
+{
+    as<double>(_data) = value;
+}
+
+SqlValue::SqlValue(bool value) :
+    _type { Bool }
+{
+    as<bool>(_data) = value;
+}
+
+SqlValue::SqlValue(const QUuid &value) :
+    _type { Uuid }
+{
+    new (_data) QUuid(value);
+}
+
+SqlValue::SqlValue(const QDateTime &value)
+{
+    if(!value.isValid())
+        return;
+    _type = Timestamp;
+    as<qint64>(_data) = value.toMSecsSinceEpoch();
+    _extra = qint8(value.timeSpec() == Qt::UTC ? Qt::UTC : Qt::LocalTime);
+}
+
+SqlValue::SqlValue(const QString &value)
+{
+    if(value.isNull())
+        return;
+    if(value.size() > InlineTextSize)
+    {
+        _type = Text;
+        _extra = -1;
+        new (_data) QString(value);
+        return;
+    }
+    setText(value.constData(), value.size());
+}
+
+SqlValue::SqlValue(const char *value) :
+    SqlValue(QString::fromUtf8(value))
+{
+}
+
+SqlValue::SqlValue(const QByteArray &value)
+{
+    if(value.isNull())
+        return;
+    _type = Bytes;
+    new (_data) QByteArray(value);
+}
+
+SqlValue::SqlValue(const QSqlField &field) :
+    SqlValue(field.value())
+{
+}
+
+SqlValue::SqlValue(const SqlValue &other)
+{
+    copyFrom(other);
+}
+
+SqlValue::SqlValue(SqlValue &&other) noexcept
+{
+    // QString и QUuid можно перемещать побайтно
+    std::memcpy(_data, other._data, sizeof(_data));
+    _type = other._type;
+    _extra = other._extra;
+    other._type = Null;
+}
+
+SqlValue::SqlValue(const QVariant &other)
+{
+    if(other.isNull())
+        return;
+
+    // Значение читается прямо из QVariant, без его преобразований
+    const void * data = other.constData();
+    switch(other.userType())
+    {
+    case QMetaType::Short:
+        _type = Int32;
+        as<qint32>(_data) = *static_cast<const short *>(data);
+    break;
+    case QMetaType::Int:
+        _type = Int32;
+        as<qint32>(_data) = *static_cast<const int *>(data);
+    break;
+    case QMetaType::UInt:
+        _type = Int64;
+        as<qint64>(_data) = *static_cast<const uint *>(data);
+    break;
+    case QMetaType::LongLong:
+        _type = Int64;
+        as<qint64>(_data) = *static_cast<const qlonglong *>(data);
+    break;
+    case QMetaType::ULongLong:
+    {
+        const qulonglong value = *static_cast<const qulonglong *>(data);
+        if(value > qulonglong(std::numeric_limits<qint64>::max()))
+        {
+            _type = Float64;
+            as<double>(_data) = double(value);
+        }
+        else
+        {
+            _type = Int64;
+            as<qint64>(_data) = qint64(value);
+        }
+    }
+    break;
+    case QMetaType::Float:
+        _type = Float64;
+        as<double>(_data) = *static_cast<const float *>(data);
+    break;
+    case QMetaType::Double:
+        _type = Float64;
+        as<double>(_data) = *static_cast<const double *>(data);
+    break;
+    case QMetaType::Bool:
+        _type = Bool;
+        as<bool>(_data) = *static_cast<const bool *>(data);
+    break;
+    case QMetaType::QUuid:
+        _type = Uuid;
+        new (_data) QUuid(*static_cast<const QUuid *>(data));
+    break;
+    case QMetaType::QDateTime:
+        *this = SqlValue(*static_cast<const QDateTime *>(data));
+    break;
+    case QMetaType::QDate:
+        *this = SqlValue(QDateTime(*static_cast<const QDate *>(data), QTime(0, 0)));
+    break;
+    case QMetaType::QTime:
+        // QVariant::toString() отбросил бы миллисекунды
+        *this = SqlValue(static_cast<const QTime *>(data)->toString(Qt::ISODateWithMs));
+    break;
+    case QMetaType::QString:
+        *this = SqlValue(*static_cast<const QString *>(data));
+    break;
+    case QMetaType::QByteArray:
+        *this = SqlValue(*static_cast<const QByteArray *>(data));
+    break;
+    case QMetaType::QJsonValue:
+        *this = fromJson(*static_cast<const QJsonValue *>(data));
+    break;
+    default:
+        if(other.userType() == qMetaTypeId<SqlValue>())
+            copyFrom(*static_cast<const SqlValue *>(data));
+        else
+            *this = SqlValue(other.toString());
+    break;
+    }
+}
+
+SqlValue::~SqlValue()
+{
+    clear();
+}
+
+SqlValue &SqlValue::operator =(const SqlValue &other)
+{
+    if(this != &other)
+    {
+        clear();
+        copyFrom(other);
+    }
+    return *this;
+}
+
+SqlValue &SqlValue::operator =(SqlValue &&other) noexcept
+{
+    if(this != &other)
+    {
+        clear();
+        std::memcpy(_data, other._data, sizeof(_data));
+        _type = other._type;
+        _extra = other._extra;
+        other._type = Null;
+    }
+    return *this;
+}
+
+SqlValue SqlValue::fromJson(const QJsonValue &value)
+{
+    switch(value.type())
+    {
+    case QJsonValue::Bool:
+        return SqlValue(value.toBool());
+    case QJsonValue::Double:
+    {
+        const double number = value.toDouble();
+        if(!fitsInt64(number))
+            return SqlValue(number);
+        const qint64 integer = qint64(number);
+        if(double(integer) != number)
+            return SqlValue(number);
+        if(integer >= std::numeric_limits<qint32>::min() && integer <= std::numeric_limits<qint32>::max())
+            return SqlValue(qint32(integer));
+        return SqlValue(integer);
+    }
+    case QJsonValue::String:
+        return SqlValue(value.toString());
+    default:
+        return SqlValue();
+    }
+}
+
+SqlValue::Type SqlValue::type() const
+{
+    return _type;
+}
+
+bool SqlValue::isNull() const
+{
+    return _type == Null;
+}
+
+qint32 SqlValue::toInt() const
+{
+    return qint32(toLongLong());
+}
+
+qint64 SqlValue::toLongLong() const
+{
+    switch(_type)
+    {
+    case Int32:     return as<qint32>(_data);
+    case Int64:     return as<qint64>(_data);
+    case Float64:
+    {
+        const double value = as<double>(_data);
+        if(qIsNaN(value))
+            return 0;
+        if(!fitsInt64(value))
+            return value < 0 ? std::numeric_limits<qint64>::min() : std::numeric_limits<qint64>::max();
+        return qint64(value);
+    }
+    case Bool:      return as<bool>(_data) ? 1 : 0;
+    case Timestamp: return as<qint64>(_data);
+    case Text:      return toString().toLongLong();
+    default:        return 0;
+    }
+}
+
+double SqlValue::toDouble() const
+{
+    switch(_type)
+    {
+    case Float64: return as<double>(_data);
+    case Text:    return toString().toDouble();
+    default:      return double(toLongLong());
+    }
+}
+
+bool SqlValue::toBool() const
+{
+    switch(_type)
+    {
+    case Bool: return as<bool>(_data);
+    case Text:
+    {
+        const QString text = toString();
+        return text == "t" || text == "true" || text == "1";
+    }
+    default:   return toLongLong() != 0;
+    }
+}
+
+QUuid SqlValue::toUuid() const
+{
+    if(_type == Uuid)
+        return as<QUuid>(_data);
+    if(_type == Text)
+        return QUuid(toString());
+    return QUuid();
+}
+
+QDateTime SqlValue::toDateTime() const
+{
+    if(_type == Timestamp)
+        return QDateTime::fromMSecsSinceEpoch(as<qint64>(_data), Qt::TimeSpec(_extra));
+    if(_type == Text)
+        return QDateTime::fromString(toString(), Qt::ISODateWithMs);
+    return QDateTime();
+}
+
+QString SqlValue::toString() const
+{
+    switch(_type)
+    {
+    case Null:      return QString();
+    case Int32:     return QString::number(as<qint32>(_data));
+    case Int64:     return QString::number(as<qint64>(_data));
+    case Float64:   return QString::number(as<double>(_data), 'g', 17);
+    case Bool:      return as<bool>(_data) ? "true" : "false";
+    case Uuid:      return as<QUuid>(_data).toString().mid(1, 36);
+    case Timestamp: return toDateTime().toString(Qt::ISODateWithMs);
+    case Text:
+        if(_extra < 0)
+            return *longText();
+        return QString(reinterpret_cast<const QChar *>(_data), _extra);
+    case Bytes:     return QString::fromLatin1("\\x" + as<QByteArray>(_data).toHex());
+    }
+    return QString();
+}
+
+QByteArray SqlValue::toByteArray() const
+{
+    switch(_type)
+    {
+    case Null:  return QByteArray();
+    case Bytes: return as<QByteArray>(_data);
+    default:    return toString().toUtf8();
+    }
+}
+
+QVariant SqlValue::toVariant() const
+{
+    switch(_type)
+    {
+    case Int32:     return as<qint32>(_data);
+    case Int64:     return as<qint64>(_data);
+    case Float64:   return as<double>(_data);
+    case Bool:      return as<bool>(_data);
+    case Uuid:      return as<QUuid>(_data);
+    case Timestamp: return toDateTime();
+    case Text:      return toString();
+    case Bytes:     return as<QByteArray>(_data);
+    default:        return QVariant();
+    }
+}
+
+QJsonValue SqlValue::toJson() const
+{
+    switch(_type)
+    {
+    case Null:    return QJsonValue(QJsonValue::Null);
+    case Int32:   return as<qint32>(_data);
+    case Int64:   return double(as<qint64>(_data));
+    case Float64: return as<double>(_data);
+    case Bool:    return as<bool>(_data);
+    default:      return toString();
+    }
+}
+
+QString SqlValue::toSqlLiteral() const
+{
+    switch(_type)
+    {
+    case Null:
+        return "NULL";
+    case Int32:
+    case Int64:
+    case Bool:
+        return toString();
+    case Float64:
+    {
+        // nan и inf PostgreSQL принимает только как строки
+        const double value = as<double>(_data);
+        if(qIsNaN(value))
+            return "'NaN'";
+        if(qIsInf(value))
+            return value > 0 ? "'Infinity'" : "'-Infinity'";
+        return toString();
+    }
+    case Timestamp:
+    {
+        // Со смещением: в timestamptz попадает тот же момент при любом TimeZone сессии,
+        // а timestamp без зоны смещение игнорирует
+        const QDateTime value = toDateTime();
+        return QString("'%1'").arg(value.toOffsetFromUtc(value.offsetFromUtc()).toString(Qt::ISODateWithMs));
+    }
+    default:
+    {
+        QString escaped = toString();
+        escaped.replace('\'', "''");
+        return QString("'%1'").arg(escaped);
+    }
+    }
+}
+
+qint64 SqlValue::heapSize() const
+{
+    if(_type == Bytes)
+        return 24 + as<QByteArray>(_data).size() + 1;
+    if(_type != Text || _extra >= 0)
+        return 0;
+    // Заголовок QArrayData и строка с завершающим нулем
+    return 24 + (longText()->size() + 1) * qint64(sizeof(QChar));
+}
+
+int SqlValue::compare(const SqlValue &other) const
+{
+    const bool number = _type == Int32 || _type == Int64 || _type == Float64;
+    const bool otherNumber = other._type == Int32 || other._type == Int64 || other._type == Float64;
+    if(number && otherNumber)
+    {
+        if((_type == Float64) || (other._type == Float64))
+        {
+            const double a = toDouble();
+            const double b = other.toDouble();
+            return a < b ? -1 : (b < a ? 1 : 0);
+        }
+        const qint64 a = toLongLong();
+        const qint64 b = other.toLongLong();
+        return a < b ? -1 : (b < a ? 1 : 0);
+    }
+
+    if(_type != other._type)
+        return _type < other._type ? -1 : 1;
+
+    switch(_type)
+    {
+    case Bool:
+        return int(as<bool>(_data)) - int(as<bool>(other._data));
+    case Uuid:
+        return as<QUuid>(_data) < as<QUuid>(other._data) ? -1 :
+               (as<QUuid>(other._data) < as<QUuid>(_data) ? 1 : 0);
+    case Timestamp:
+    {
+        const qint64 a = as<qint64>(_data);
+        const qint64 b = as<qint64>(other._data);
+        return a < b ? -1 : (b < a ? 1 : 0);
+    }
+    case Text:
+        if(_extra >= 0 && other._extra >= 0)
+            return QString::compare(QString::fromRawData(reinterpret_cast<const QChar *>(_data), _extra),
+                                    QString::fromRawData(reinterpret_cast<const QChar *>(other._data), other._extra));
+        return toString().compare(other.toString());
+    case Bytes:
+    {
+        const QByteArray & a = as<QByteArray>(_data);
+        const QByteArray & b = as<QByteArray>(other._data);
+        return a < b ? -1 : (b < a ? 1 : 0);
+    }
+    default:
+        return 0;
+    }
+}
+
+bool SqlValue::operator ==(const SqlValue &other) const
+{
+    if(_type != other._type)
+    {
+        // Числа разных типов сравниваются по значению, как в QVariant
+        const bool number = _type == Int32 || _type == Int64 || _type == Float64;
+        const bool otherNumber = other._type == Int32 || other._type == Int64 || other._type == Float64;
+        return number && otherNumber && toDouble() == other.toDouble();
+    }
+
+    switch(_type)
+    {
+    case Null:      return true;
+    case Int32:     return as<qint32>(_data) == as<qint32>(other._data);
+    case Int64:     return as<qint64>(_data) == as<qint64>(other._data);
+    case Float64:   return as<double>(_data) == as<double>(other._data);
+    case Bool:      return as<bool>(_data) == as<bool>(other._data);
+    case Uuid:      return as<QUuid>(_data) == as<QUuid>(other._data);
+    case Timestamp: return as<qint64>(_data) == as<qint64>(other._data);
+    case Text:
+        if(_extra >= 0 && other._extra >= 0)
+            return _extra == other._extra &&
+                   std::memcmp(_data, other._data, size_t(_extra) * sizeof(QChar)) == 0;
+        return toString() == other.toString();
+    case Bytes:     return as<QByteArray>(_data) == as<QByteArray>(other._data);
+    }
+    return false;
+}
+
+void SqlValue::clear()
+{
+    if(_type == Text && _extra < 0)
+        as<QString>(_data).~QString();
+    else if(_type == Bytes)
+        as<QByteArray>(_data).~QByteArray();
+    _type = Null;
+    _extra = 0;
+}
+
+void SqlValue::copyFrom(const SqlValue &other)
+{
+    _type = other._type;
+    _extra = other._extra;
+    if(_type == Text && _extra < 0)
+        new (_data) QString(*other.longText());
+    else if(_type == Uuid)
+        new (_data) QUuid(as<QUuid>(other._data));
+    else if(_type == Bytes)
+        new (_data) QByteArray(as<QByteArray>(other._data));
+    else
+        std::memcpy(_data, other._data, sizeof(_data));
+}
+
+void SqlValue::setText(const QChar *text, int size)
+{
+    _type = Text;
+    _extra = qint8(size);
+    std::memcpy(_data, text, size_t(size) * sizeof(QChar));
+}
+
+const QString *SqlValue::longText() const
+{
+    return &as<QString>(_data);
+}
+
+QDataStream &operator <<(QDataStream &stream, const SqlValue &value)
+{
+    stream << quint8(value.type());
+    switch(value.type())
+    {
+    case SqlValue::Null:                                        break;
+    case SqlValue::Int32:     stream << value.toInt();          break;
+    case SqlValue::Int64:     stream << value.toLongLong();     break;
+    case SqlValue::Float64:   stream << value.toDouble();       break;
+    case SqlValue::Bool:      stream << value.toBool();         break;
+    case SqlValue::Uuid:      stream << value.toUuid();         break;
+    case SqlValue::Timestamp: stream << value.toDateTime();     break;
+    case SqlValue::Text:      stream << value.toString();       break;
+    case SqlValue::Bytes:     stream << value.toByteArray();    break;
+    }
+    return stream;
+}
+
+QDataStream &operator >>(QDataStream &stream, SqlValue &value)
+{
+    quint8 type = SqlValue::Null;
+    stream >> type;
+    switch(type)
+    {
+    case SqlValue::Int32:     { qint32 v;    stream >> v; value = SqlValue(v); } break;
+    case SqlValue::Int64:     { qint64 v;    stream >> v; value = SqlValue(v); } break;
+    case SqlValue::Float64:   { double v;    stream >> v; value = SqlValue(v); } break;
+    case SqlValue::Bool:      { bool v;      stream >> v; value = SqlValue(v); } break;
+    case SqlValue::Uuid:      { QUuid v;     stream >> v; value = SqlValue(v); } break;
+    case SqlValue::Timestamp: { QDateTime v; stream >> v; value = SqlValue(v); } break;
+    case SqlValue::Text:      { QString v;   stream >> v; value = SqlValue(v); } break;
+    case SqlValue::Bytes:     { QByteArray v; stream >> v; value = SqlValue(v); } break;
+    case SqlValue::Null:
+        value = SqlValue();
+    break;
+    default:
+        value = SqlValue();
+        stream.setStatus(QDataStream::ReadCorruptData);
+    break;
+    }
+    return stream;
 }
@@ -0,0 +1,159 @@
+#include "TableManagerBenchmark.h"
+#include <QElapsedTimer>
+#include <QDebug>
+#include <QRandomGenerator>
+#include <QHash>
+
+namespace
+{
+    //! Менеджер на ISqlTableItem, написанный как обычно
+    class LegacyManager : public ISqlTableManager
+    {
+    public:
+        LegacyManager(SqlDatabaseConnector * connector) :
+            ISqlTableManager(connector, "bench", "orders")
+        {
+            _debug = false;
+        }
+
+        void updateModel() override {}
+
+        void feed(const QueryResult & result) { onQueryFinished(QUuid(), result); }
+        void notify(const SqlNotification & notif) { onDBNotification(notif); }
+
+    protected:
+        ISqlTableItem::ptr parseSingleQuery(const QJsonObject & record) override
+        {
+            auto item = BenchItem::create();
+            autoParseQuery(item, record);
+            return item;
+        }
+    };
+
+    class TypedManager : public SqlTableManager<BenchRow>
+    {
+    public:
+        TypedManager(SqlDatabaseConnector * connector) :
+            SqlTableManager<BenchRow>(connector, "bench", "orders")
+        {
+        }
+
+        void feed(const QueryResult & result) { onQueryResult(result); }
+        void notify(const SqlNotification & notif) { onNotification(notif); }
+    };
+
+    QJsonObject makeRecord(const QString & uuid, int i)
+    {
+        QJsonObject record;
+        record.insert("_uuid", uuid);
+        record.insert("client", QString("client %1").arg(i % 1000));
+        record.insert("amount", i % 100);
+        record.insert("price", i * 0.25);
+        return record;
+    }
+
+    //! Сравнение строк обоих менеджеров с ожидаемыми записями.
+    //! Возвращает количество расхождений, первые из них пишет в лог
+    int verify(const QHash<QString, QJsonObject> & expected, LegacyManager & legacy, const TypedManager & typed)
+    {
+        int mismatches = 0;
+        auto mismatch = [&mismatches](const QString & what, const QString & uuid) {
+            if(mismatches++ < 10)
+                qWarning().noquote() << QString("%1 differs for %2").arg(what, uuid);
+        };
+
+        if(legacy.count() != expected.size())
+            mismatch("ISqlTableManager row count", QString::number(legacy.count()));
+        if(typed.count() != expected.size())
+            mismatch("SqlTableManager row count", QString::number(typed.count()));
+
+        for(auto it = expected.constBegin(); it != expected.constEnd(); ++it)
+        {
+            const QString client = it.value().value("client").toString();
+            const int amount = it.value().value("amount").toInt();
+            const double price = it.value().value("price").toDouble();
+
+            auto item = legacy.item(it.key()).dynamicCast<BenchItem>();
+            if(!item || item->client != client || item->amount != amount || item->price != price)
+                mismatch("ISqlTableManager row", it.key());
+
+            const BenchRow * row = typed.row(it.key());
+            if(!row || row->uuid != it.key() || row->client != client || row->amount != amount || row->price != price)
+                mismatch("SqlTableManager row", it.key());
+        }
+        return mismatches;
+    }
+
+    void report(const char * what, int count, qint64 ms)
+    {
+        qInfo().noquote() << QString("%1 : %2 in %3 ms (%4 per second)")
+                             .arg(what).arg(count).arg(ms)
+                             .arg(ms > 0 ? qint64(count) * 1000 / ms : 0);
+    }
+}
+
+int runTableManagerBenchmark(int rows, int notifications)
+{
+    SqlDatabaseConnector connector("localhost", 5432, "bench");
+
+    QueryResult result;
+    result.isSelect = true;
+    QStringList uuids;
+    uuids.reserve(rows);
+    for(int i = 0; i < rows; i++)
+    {
+        uuids << ISqlTableItem::makeUuid();
+        result.records << makeRecord(uuids.last(), i);
+    }
+
+    QList<SqlNotification> updates;
+    updates.reserve(notifications);
+    for(int i = 0; i < notifications; i++)
+    {
+        SqlNotification notif;
+        notif.schema = "bench";
+        notif.table = "orders";
+        notif.actionType = SqlNotification::UPDATE;
+        notif.itemUuid = uuids[QRandomGenerator::global()->bounded(rows)];
+        notif.data = makeRecord(notif.itemUuid, i);
+        updates << notif;
+    }
+
+    LegacyManager legacy(&connector);
+    TypedManager typed(&connector);
+    QElapsedTimer timer;
+
+    timer.start();
+    legacy.feed(result);
+    report("ISqlTableManager load", legacy.count(), timer.elapsed());
+
+    timer.restart();
+    typed.feed(result);
+    report("SqlTableManager load", typed.count(), timer.elapsed());
+
+    timer.restart();
+    for(const auto & notif: updates)
+        legacy.notify(notif);
+    report("ISqlTableManager notifications", updates.size(), timer.elapsed());
+
+    timer.restart();
+    for(const auto & notif: updates)
+        typed.notify(notif);
+    report("SqlTableManager notifications", updates.size(), timer.elapsed());
+
+    // Последнее уведомление по строке определяет ее итоговое состояние
+    QHash<QString, QJsonObject> expected;
+    expected.reserve(rows);
+    for(const auto & record: result.records)
+        expected.insert(record.value("_uuid").toString(), record);
+    for(const auto & notif: updates)
+        expected.insert(notif.itemUuid, notif.data);
+
+    const int mismatches = verify(expected, legacy, typed);
+    if(mismatches > 0)
+    {
+        qWarning().noquote() << QString("%1 rows differ from the expected data").arg(mismatches);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <QObject>
+#include <QString>
+#include "ISqlTableManager.h"
+#include "SqlTableManager.h"
+
+
+//!
+//! \brief The BenchItem class
+//! Элемент таблицы для сравнения ISqlTableManager и SqlTableManager
+//!
+class BenchItem : public ISqlTableItem
+{
+    Q_OBJECT
+    Q_PROPERTY(QString client MEMBER client)
+    Q_PROPERTY(int amount MEMBER amount)
+    Q_PROPERTY(double price MEMBER price)
+
+public:
+    using ptr = QSharedPointer<BenchItem>;
+    static ptr create() { return ptr(new BenchItem); }
+
+    QString client;
+    int amount { 0 };
+    double price { 0 };
+};
+
+//!
+//! \brief The BenchRow struct
+//! Та же строка для SqlTableManager
+//!
+struct BenchRow
+{
+    QString uuid;
+    QString client;
+    int amount { 0 };
+    double price { 0 };
+
+    static constexpr auto columns = std::make_tuple(
+        sqlColumn("client", &BenchRow::client),
+        sqlColumn("amount", &BenchRow::amount),
+        sqlColumn("price",  &BenchRow::price));
+};
+
+//!
+//! \brief runTableManagerBenchmark Сравнение загрузки и обработки уведомлений
+//! ISqlTableManager и SqlTableManager на одинаковых данных, без базы
+//! \param rows - Количество строк
+//! \param notifications - Количество уведомлений UPDATE
+//! \return Код возврата программы
+//!
+int runTableManagerBenchmark(int rows, int notifications);
@@ -1,10 +1,21 @@
 #include <QCoreApplication>
 #include <QDebug>
+#include "TableManagerBenchmark.h"
 
 
 int main(int argc, char *argv[])
 {
     QCoreApplication a(argc, argv);
 
+    // testing --bench [rows] [notifications]
+    const QStringList args = a.arguments();
+    const int bench = args.indexOf("--bench");
+    if(bench >= 0)
+    {
+        const int rows = args.value(bench + 1, "100000").toInt();
+        const int notifications = args.value(bench + 2, "100000").toInt();
+        return runTableManagerBenchmark(qMax(1, rows), qMax(0, notifications));
+    }
+
     return a.exec();
 }
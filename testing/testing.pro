@@ -1,6 +1,7 @@
-QT -= gui
+# ISqlTableManager.h uses QStandardItemModel
+QT += sql
 
-CONFIG += c++11 console
+CONFIG += c++17 console
 CONFIG -= app_bundle
 
 TARGET = testing
@@ -17,8 +18,12 @@ LIBS += -L../lib -lSqlAccessor
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+        TableManagerBenchmark.cpp \
         main.cpp
 
+HEADERS += \
+        TableManagerBenchmark.h
+
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
 else: unix:!android: target.path = /opt/$${TARGET}/bin
@@ -0,0 +1,78 @@
+#!/bin/sh
+#
+# Интеграционный тест SqlChangeDataCapture на локальном PostgreSQL.
+#
+# Запускает tst_SqlChangeDataCapture::slotRoundTrip против настоящего
+# сервера: создает слот test_decoding и таблицу, делает INSERT/UPDATE/DELETE,
+# проверяет, что уведомления пришли по одному разу и что после
+# pg_replication_slot_advance слот больше их не отдает.
+#
+# Требования:
+#   - PostgreSQL 11+ (pg_replication_slot_advance), плагин test_decoding
+#     (входит в contrib);
+#   - собранные тесты (qmake && make в корне репозитория);
+#   - для режима --temp-cluster: initdb и pg_ctl в PATH.
+#
+# Использование:
+#   tests/integration/cdc_local.sh [--temp-cluster] [каталог сборки]
+#
+#   Без --temp-cluster используется уже запущенный сервер. Он должен быть
+#   настроен с wal_level = logical и max_replication_slots >= 1,
+#   а пользователь - иметь право REPLICATION. Параметры соединения
+#   берутся из переменных PGHOST, PGPORT, PGDATABASE, PGUSER, PGPASSWORD
+#   (по умолчанию localhost:5432, база и пользователь postgres).
+#
+#   С --temp-cluster скрипт создает временный кластер с wal_level = logical
+#   на порту 54329, запускает тест и удаляет кластер.
+#
+#   Каталог сборки по умолчанию - текущий каталог.
+
+set -eu
+
+TEMP_CLUSTER=0
+if [ "${1:-}" = "--temp-cluster" ]; then
+    TEMP_CLUSTER=1
+    shift
+fi
+
+BUILD_DIR=${1:-.}
+TEST_BIN="$BUILD_DIR/tests/tst_SqlChangeDataCapture/tst_SqlChangeDataCapture"
+if [ ! -x "$TEST_BIN" ]; then
+    echo "cdc_local: $TEST_BIN not found, build the tests first" >&2
+    exit 2
+fi
+
+if [ "$TEMP_CLUSTER" -eq 1 ]; then
+    DATA_DIR=$(mktemp -d "${TMPDIR:-/tmp}/sql_accessor_cdc.XXXXXX")
+    PGHOST=127.0.0.1
+    PGPORT=54329
+    PGDATABASE=postgres
+    PGUSER=postgres
+    PGPASSWORD=
+    trap 'pg_ctl -D "$DATA_DIR" -m immediate stop >/dev/null 2>&1 || true; rm -rf "$DATA_DIR"' EXIT
+
+    initdb -D "$DATA_DIR" -U "$PGUSER" --auth=trust >/dev/null
+    cat >> "$DATA_DIR/postgresql.conf" <<EOF
+wal_level = logical
+max_replication_slots = 4
+max_wal_senders = 4
+listen_addresses = '$PGHOST'
+port = $PGPORT
+unix_socket_directories = '$DATA_DIR'
+EOF
+    pg_ctl -D "$DATA_DIR" -l "$DATA_DIR/server.log" -w start >/dev/null
+fi
+
+SQLACCESSOR_TEST_HOST=${PGHOST:-localhost}
+SQLACCESSOR_TEST_PORT=${PGPORT:-5432}
+SQLACCESSOR_TEST_DB=${PGDATABASE:-postgres}
+SQLACCESSOR_TEST_USER=${PGUSER:-postgres}
+SQLACCESSOR_TEST_PASSWORD=${PGPASSWORD:-}
+export SQLACCESSOR_TEST_HOST SQLACCESSOR_TEST_PORT SQLACCESSOR_TEST_DB \
+       SQLACCESSOR_TEST_USER SQLACCESSOR_TEST_PASSWORD
+
+# Без сервера slotRoundTrip пропускается (SKIP), поэтому успехом
+# считается только PASS этой функции
+OUTPUT=$("$TEST_BIN" slotRoundTrip) || { echo "$OUTPUT"; exit 1; }
+echo "$OUTPUT"
+echo "$OUTPUT" | grep -q "^PASS   : tst_SqlChangeDataCapture::slotRoundTrip()"
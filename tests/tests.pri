@@ -0,0 +1,12 @@
+# Общие настройки модульных тестов: make check в каталоге tests запускает все
+QT += testlib sql
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+MOC_DIR = moc
+OBJECTS_DIR = obj
+
+INCLUDEPATH += $$PWD/../SqlAccessor/Include
+LIBS += -L$$OUT_PWD/../../lib -lSqlAccessor
+unix: QMAKE_RPATHDIR += $$OUT_PWD/../../lib
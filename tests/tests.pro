@@ -0,0 +1,15 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    tst_SqlAggregate \
+    tst_SqlChangeDataCapture \
+    tst_SqlDataMapper \
+    tst_SqlJoinedTableManager \
+    tst_SqlQueryCache \
+    tst_SqlQueryText \
+    tst_SqlReplicaSet \
+    tst_SqlSearchIndex \
+    tst_SqlSortedView \
+    tst_SqlTableExporter \
+    tst_SqlTableManager \
+    tst_SqlValue
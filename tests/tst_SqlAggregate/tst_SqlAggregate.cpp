@@ -0,0 +1,195 @@
+#include <QtTest>
+#include "SqlAggregate.h"
+
+class RowItem : public ISqlTableItem
+{
+    Q_OBJECT
+    Q_PROPERTY(QString client MEMBER client)
+    Q_PROPERTY(QVariant amount MEMBER amount)
+
+public:
+    QString client;
+    QVariant amount;
+};
+
+
+namespace
+{
+    //! Менеджер без базы: элементы кладутся в _items напрямую,
+    //! изменения отдаются сигналом itemsChanged, как после уведомлений
+    class FakeManager : public ISqlTableManager
+    {
+    public:
+        explicit FakeManager(SqlDatabaseConnector * connector) :
+            ISqlTableManager(connector, "shop", "orders")
+        {
+        }
+
+        void updateModel() override {}
+
+        RowItem * put(const QString & uuid, const QString & client, const QVariant & amount)
+        {
+            auto & item = _items[uuid];
+            if(!item)
+            {
+                item = ISqlTableItem::ptr(new RowItem);
+                item->setUuid(uuid);
+            }
+            auto row = static_cast<RowItem *>(item.data());
+            row->client = client;
+            row->amount = amount;
+            return row;
+        }
+
+        void drop(const QString & uuid) { _items.remove(uuid); }
+
+    protected:
+        ISqlTableItem::ptr parseSingleQuery(const QJsonObject & record) override
+        {
+            ISqlTableItem::ptr item(new RowItem);
+            autoParseQuery(item, record);
+            return item;
+        }
+    };
+
+    const QString First = QStringLiteral("aaaaaaaa-0000-0000-0000-000000000001");
+    const QString Second = QStringLiteral("aaaaaaaa-0000-0000-0000-000000000002");
+    const QString Third = QStringLiteral("aaaaaaaa-0000-0000-0000-000000000003");
+}
+
+
+class tst_SqlAggregate : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void groups();
+    void moveBetweenGroups();
+    void exactIntegerSum();
+    void floatSumDoesNotDrift();
+};
+
+void tst_SqlAggregate::groups()
+{
+    SqlDatabaseConnector connector("localhost", 5432, "test");
+    FakeManager manager(&connector);
+    manager.put(First, "x", 10);
+    manager.put(Second, "x", 5);
+    manager.put(Third, "y", QVariant());
+
+    SqlAggregate aggregate(&manager, "client", "amount");
+    QCOMPARE(aggregate.groups(), QList<SqlValue>({ SqlValue("x"), SqlValue("y") }));
+
+    const SqlAggregate::Result x = aggregate.value(SqlValue("x"));
+    QCOMPARE(x.count, qint64(2));
+    QCOMPARE(x.valueCount, qint64(2));
+    QCOMPARE(x.integerSum, qint64(15));
+    QCOMPARE(x.sum, 15.0);
+    QCOMPARE(x.min.toLongLong(), qint64(5));
+    QCOMPARE(x.max.toLongLong(), qint64(10));
+
+    const SqlAggregate::Result y = aggregate.value(SqlValue("y"));
+    QCOMPARE(y.count, qint64(1));
+    QCOMPARE(y.valueCount, qint64(0));
+    QVERIFY(y.min.isNull());
+
+    QCOMPARE(aggregate.total().count, qint64(3));
+    QCOMPARE(aggregate.value(SqlValue("z")).count, qint64(0));
+}
+
+void tst_SqlAggregate::moveBetweenGroups()
+{
+    SqlDatabaseConnector connector("localhost", 5432, "test");
+    FakeManager manager(&connector);
+    manager.put(First, "x", 10);
+    manager.put(Second, "x", 5);
+    manager.put(Third, "y", 7);
+    SqlAggregate aggregate(&manager, "client", "amount");
+
+    // SqlValue не зарегистрирован как метатип, поэтому без QSignalSpy
+    QStringList changed;
+    QStringList removed;
+    connect(&aggregate, &SqlAggregate::groupChanged, this,
+            [&changed](const SqlValue & group) { changed << group.toString(); });
+    connect(&aggregate, &SqlAggregate::groupRemoved, this,
+            [&removed](const SqlValue & group) { removed << group.toString(); });
+
+    manager.put(First, "y", 10);
+    emit manager.itemsChanged({}, { First }, {});
+    QCOMPARE(changed, QStringList({ "x", "y" }));
+    QVERIFY(removed.isEmpty());
+    QCOMPARE(aggregate.value(SqlValue("x")).integerSum, qint64(5));
+    QCOMPARE(aggregate.value(SqlValue("x")).max.toLongLong(), qint64(5));
+    QCOMPARE(aggregate.value(SqlValue("y")).integerSum, qint64(17));
+    QCOMPARE(aggregate.value(SqlValue("y")).max.toLongLong(), qint64(10));
+
+    // Изменение без смены группы и значения не дает сигналов
+    changed.clear();
+    emit manager.itemsChanged({}, { Third }, {});
+    QVERIFY(changed.isEmpty());
+
+    manager.drop(Second);
+    emit manager.itemsChanged({}, {}, { Second });
+    QCOMPARE(removed, QStringList({ "x" }));
+    QVERIFY(!aggregate.contains(SqlValue("x")));
+    QCOMPARE(aggregate.total().count, qint64(2));
+    QCOMPARE(aggregate.total().integerSum, qint64(17));
+    QCOMPARE(aggregate.total().min.toLongLong(), qint64(7));
+}
+
+void tst_SqlAggregate::exactIntegerSum()
+{
+    SqlDatabaseConnector connector("localhost", 5432, "test");
+    FakeManager manager(&connector);
+    // 2^53 + 1 не представимо в double
+    const qint64 big = (Q_INT64_C(1) << 53) + 1;
+    manager.put(First, "x", big);
+    manager.put(Second, "x", 1);
+    SqlAggregate aggregate(&manager, QString(), "amount");
+
+    QCOMPARE(aggregate.total().integerSum, big + 1);
+
+    for(int i = 0; i < 1000; i++)
+    {
+        manager.put(Second, "x", i % 2 ? 3 : 2);
+        emit manager.itemsChanged({}, { Second }, {});
+    }
+    QCOMPARE(aggregate.total().integerSum, big + 3);
+
+    manager.drop(First);
+    emit manager.itemsChanged({}, {}, { First });
+    QCOMPARE(aggregate.total().integerSum, qint64(3));
+    QCOMPARE(aggregate.total().sum, 3.0);
+}
+
+void tst_SqlAggregate::floatSumDoesNotDrift()
+{
+    SqlDatabaseConnector connector("localhost", 5432, "test");
+    FakeManager manager(&connector);
+    manager.put(First, "x", 0.1);
+    manager.put(Second, "x", 1e16);
+    SqlAggregate aggregate(&manager, QString(), "amount");
+
+    // Без компенсации 0.1 теряется при сложении с 1e16
+    manager.drop(Second);
+    emit manager.itemsChanged({}, {}, { Second });
+    QCOMPARE(aggregate.total().sum, 0.1);
+
+    for(int i = 0; i < 1000; i++)
+    {
+        manager.put(Second, "x", i % 2 ? 0.7 : 1e15 + 0.3);
+        emit manager.itemsChanged({}, { Second }, {});
+    }
+    manager.drop(Second);
+    emit manager.itemsChanged({}, {}, { Second });
+    QCOMPARE(aggregate.total().sum, 0.1);
+
+    // Когда дробных значений не остается, ошибка сбрасывается вместе с суммой
+    manager.drop(First);
+    emit manager.itemsChanged({}, {}, { First });
+    QCOMPARE(aggregate.total().sum, 0.0);
+}
+
+QTEST_GUILESS_MAIN(tst_SqlAggregate)
+
+#include "tst_SqlAggregate.moc"
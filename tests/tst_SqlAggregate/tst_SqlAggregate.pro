@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_SqlAggregate
+
+SOURCES += \
+    tst_SqlAggregate.cpp
@@ -0,0 +1,201 @@
+#include <QtTest>
+#include "SqlChangeDataCapture.h"
+
+namespace
+{
+    const QString SlotName = QStringLiteral("sql_accessor_cdc_test");
+    const QString TableName = QStringLiteral("sql_accessor_cdc_test");
+
+    QueryResult run(SqlDatabaseConnector & connector, const QString & query)
+    {
+        return connector.execute(query).result();
+    }
+}
+
+
+class tst_SqlChangeDataCapture : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void parseInsert();
+    void parseUpdateWithOldKey();
+    void parseDelete();
+    void parseDeleteWithoutIdentity();
+    void parseQuotedIdentifiers();
+    void parseUnchangedToast();
+    void parseNonRowChanges_data();
+    void parseNonRowChanges();
+
+    //! Требует сервер, см. tests/integration/cdc_local.sh
+    void slotRoundTrip();
+};
+
+void tst_SqlChangeDataCapture::parseInsert()
+{
+    SqlNotification notification;
+    QVERIFY(SqlChangeDataCapture::parseChange(
+                "table public.orders: INSERT: _uuid[uuid]:'0b7ad2c4-3c5e-4a8e-9a57-2d1f6c3e4b10' "
+                "qty[integer]:3 price[numeric]:12.50 paid[boolean]:true note[text]:'it''s here' "
+                "shipped[timestamp with time zone]:null", notification));
+
+    QCOMPARE(notification.schema, QString("public"));
+    QCOMPARE(notification.table, QString("orders"));
+    QCOMPARE(notification.actionType, SqlNotification::INSERT);
+    QCOMPARE(notification.format, SqlNotification::FullRow);
+    QCOMPARE(notification.itemUuid, QString("0b7ad2c4-3c5e-4a8e-9a57-2d1f6c3e4b10"));
+    QCOMPARE(notification.data.value("qty").toDouble(), 3.0);
+    QCOMPARE(notification.data.value("price").toDouble(), 12.5);
+    QCOMPARE(notification.data.value("paid").toBool(), true);
+    QCOMPARE(notification.data.value("note").toString(), QString("it's here"));
+    QVERIFY(notification.data.contains("shipped"));
+    QVERIFY(notification.data.value("shipped").isNull());
+    QVERIFY(notification.oldData.isEmpty());
+}
+
+void tst_SqlChangeDataCapture::parseUpdateWithOldKey()
+{
+    SqlNotification notification;
+    QVERIFY(SqlChangeDataCapture::parseChange(
+                "table public.orders: UPDATE: old-key: _uuid[uuid]:'aaaaaaaa-0000-0000-0000-000000000001' "
+                "new-tuple: _uuid[uuid]:'aaaaaaaa-0000-0000-0000-000000000002' qty[integer]:4", notification));
+
+    QCOMPARE(notification.actionType, SqlNotification::UPDATE);
+    QCOMPARE(notification.oldData.value("_uuid").toString(), QString("aaaaaaaa-0000-0000-0000-000000000001"));
+    QCOMPARE(notification.oldData.size(), 1);
+    QCOMPARE(notification.itemUuid, QString("aaaaaaaa-0000-0000-0000-000000000002"));
+    QCOMPARE(notification.data.value("qty").toDouble(), 4.0);
+}
+
+void tst_SqlChangeDataCapture::parseDelete()
+{
+    SqlNotification notification;
+    QVERIFY(SqlChangeDataCapture::parseChange(
+                "table public.orders: DELETE: _uuid[uuid]:'aaaaaaaa-0000-0000-0000-000000000003'", notification));
+
+    QCOMPARE(notification.actionType, SqlNotification::DELETE);
+    QCOMPARE(notification.itemUuid, QString("aaaaaaaa-0000-0000-0000-000000000003"));
+    QCOMPARE(notification.data.size(), 1);
+}
+
+void tst_SqlChangeDataCapture::parseDeleteWithoutIdentity()
+{
+    SqlNotification notification;
+    QVERIFY(SqlChangeDataCapture::parseChange("table public.log: DELETE: (no-tuple-data)", notification));
+    QCOMPARE(notification.actionType, SqlNotification::DELETE);
+    QVERIFY(notification.data.isEmpty());
+    QVERIFY(notification.itemUuid.isEmpty());
+}
+
+void tst_SqlChangeDataCapture::parseQuotedIdentifiers()
+{
+    SqlNotification notification;
+    QVERIFY(SqlChangeDataCapture::parseChange(
+                "table \"Sales Dept\".\"Order \"\"Items\"\"\": INSERT: \"Item Id\"[integer]:7 "
+                "\"a:b\"[text]:'x y' plain[text]:'z'", notification));
+
+    QCOMPARE(notification.schema, QString("Sales Dept"));
+    QCOMPARE(notification.table, QString("Order \"Items\""));
+    QCOMPARE(notification.data.value("Item Id").toDouble(), 7.0);
+    QCOMPARE(notification.data.value("a:b").toString(), QString("x y"));
+    QCOMPARE(notification.data.value("plain").toString(), QString("z"));
+}
+
+void tst_SqlChangeDataCapture::parseUnchangedToast()
+{
+    SqlNotification notification;
+    QVERIFY(SqlChangeDataCapture::parseChange(
+                "table public.docs: UPDATE: _uuid[uuid]:'aaaaaaaa-0000-0000-0000-000000000004' "
+                "body[text]:unchanged-toast-datum title[text]:'new'", notification));
+
+    // Неизмененное значение не попадает в data и не затирает загруженное
+    QVERIFY(!notification.data.contains("body"));
+    QCOMPARE(notification.data.value("title").toString(), QString("new"));
+    QCOMPARE(notification.itemUuid, QString("aaaaaaaa-0000-0000-0000-000000000004"));
+}
+
+void tst_SqlChangeDataCapture::parseNonRowChanges_data()
+{
+    QTest::addColumn<QString>("line");
+
+    QTest::newRow("begin") << "BEGIN 529";
+    QTest::newRow("commit") << "COMMIT 529";
+    QTest::newRow("truncate") << "table public.orders: TRUNCATE: (no-flags)";
+    QTest::newRow("message") << "message: transactional: 1 prefix: app, sz: 3 content:abc";
+    QTest::newRow("broken") << "table public.orders INSERT";
+}
+
+void tst_SqlChangeDataCapture::parseNonRowChanges()
+{
+    QFETCH(QString, line);
+    SqlNotification notification;
+    QVERIFY(!SqlChangeDataCapture::parseChange(line, notification));
+}
+
+void tst_SqlChangeDataCapture::slotRoundTrip()
+{
+    const QString host = qEnvironmentVariable("SQLACCESSOR_TEST_HOST");
+    if(host.isEmpty())
+        QSKIP("SQLACCESSOR_TEST_HOST is not set, see tests/integration/cdc_local.sh");
+
+    bool portSet = false;
+    const int port = qEnvironmentVariableIntValue("SQLACCESSOR_TEST_PORT", &portSet);
+    SqlDatabaseConnector connector(host, portSet ? port : 5432,
+                                   qEnvironmentVariable("SQLACCESSOR_TEST_DB", "postgres"));
+    connector.setListenEnabled(false);
+    QVERIFY(connector.connectToBase(qEnvironmentVariable("SQLACCESSOR_TEST_USER", "postgres"),
+                                    qEnvironmentVariable("SQLACCESSOR_TEST_PASSWORD")));
+
+    QCOMPARE(run(connector, QString("SELECT pg_drop_replication_slot(slot_name) FROM pg_replication_slots "
+                                    "WHERE slot_name = '%1';").arg(SlotName)).error.type(), QSqlError::NoError);
+    QCOMPARE(run(connector, QString("DROP TABLE IF EXISTS public.%1;").arg(TableName)).error.type(), QSqlError::NoError);
+    QCOMPARE(run(connector, QString("CREATE TABLE public.%1 (_uuid uuid PRIMARY KEY, name text);").arg(TableName)).error.type(),
+             QSqlError::NoError);
+
+    SqlChangeDataCapture cdc(&connector, SlotName);
+    cdc.createSlot();
+
+    QList<SqlNotification> received;
+    connect(&connector, &SqlDatabaseConnector::dbNotification, this, [&received](const SqlNotification & notification) {
+        if(notification.table == TableName)
+            received << notification;
+    });
+
+    const QString first = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    const QString second = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    run(connector, QString("INSERT INTO public.%1 VALUES ('%2', 'first'), ('%3', 'second');").arg(TableName, first, second));
+    run(connector, QString("UPDATE public.%1 SET name = 'renamed' WHERE _uuid = '%2';").arg(TableName, first));
+    run(connector, QString("DELETE FROM public.%1 WHERE _uuid = '%2';").arg(TableName, second));
+
+    cdc.start(50);
+    QTRY_COMPARE_WITH_TIMEOUT(received.size(), 4, 10000);
+    QTRY_VERIFY_WITH_TIMEOUT(!cdc.lastConfirmedLsn().isEmpty(), 5000);
+    cdc.stop();
+
+    QCOMPARE(received[0].actionType, SqlNotification::INSERT);
+    QCOMPARE(received[1].actionType, SqlNotification::INSERT);
+    QCOMPARE(received[2].actionType, SqlNotification::UPDATE);
+    QCOMPARE(received[2].itemUuid, first);
+    QCOMPARE(received[2].data.value("name").toString(), QString("renamed"));
+    QCOMPARE(received[3].actionType, SqlNotification::DELETE);
+    QCOMPARE(received[3].itemUuid, second);
+
+    // Подтвержденные изменения из слота больше не читаются
+    const QueryResult left = run(connector, QString("SELECT count(*) AS n FROM pg_logical_slot_peek_changes('%1', NULL, NULL) "
+                                                    "WHERE data LIKE 'table public.%2:%';").arg(SlotName, TableName));
+    QCOMPARE(left.error.type(), QSqlError::NoError);
+    QCOMPARE(left.records.first().value("n").toDouble(), 0.0);
+
+    received.clear();
+    cdc.start(50);
+    QTest::qWait(500);
+    cdc.stop();
+    QCOMPARE(received.size(), 0);
+
+    cdc.dropSlot();
+    run(connector, QString("DROP TABLE public.%1;").arg(TableName));
+}
+
+QTEST_GUILESS_MAIN(tst_SqlChangeDataCapture)
+
+#include "tst_SqlChangeDataCapture.moc"
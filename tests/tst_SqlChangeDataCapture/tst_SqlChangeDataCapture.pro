@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_SqlChangeDataCapture
+
+SOURCES += \
+    tst_SqlChangeDataCapture.cpp
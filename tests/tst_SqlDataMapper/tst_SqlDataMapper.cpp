@@ -0,0 +1,73 @@
+#include <QtTest>
+#include "SqlDataMapper.h"
+
+
+class tst_SqlDataMapper : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void lookupBothWays();
+    void numericTypesShareKey();
+    void numericStringSharesKey();
+    void largeIntegersDoNotCollide();
+    void unknownKeyReturnsDefault();
+    void laterPairWins();
+};
+
+void tst_SqlDataMapper::lookupBothWays()
+{
+    SqlDataMapper mapper({ {0, "Нет"}, {1, "Да"} });
+    QCOMPARE(mapper.sval(1).toString(), QString("Да"));
+    QCOMPARE(mapper.bval("Нет").toInt(), 0);
+    QCOMPARE(mapper[1].toString(), QString("Да"));
+    QCOMPARE(mapper["Да"].toInt(), 1);
+}
+
+void tst_SqlDataMapper::numericTypesShareKey()
+{
+    SqlDataMapper mapper({ {1, "Да"} });
+    QCOMPARE(mapper.sval(qlonglong(1)).toString(), QString("Да"));
+    QCOMPARE(mapper.sval(1.0).toString(), QString("Да"));
+    QCOMPARE(mapper.sval(1u).toString(), QString("Да"));
+    QCOMPARE(mapper.sval(1.5).toString(), QString("0"));
+}
+
+void tst_SqlDataMapper::numericStringSharesKey()
+{
+    SqlDataMapper mapper({ {1, "Да"} });
+    QCOMPARE(mapper.sval("1").toString(), QString("Да"));
+    QCOMPARE(mapper.sval("01").toString(), QString("0"));
+    QCOMPARE(mapper.sval(" 1").toString(), QString("0"));
+}
+
+void tst_SqlDataMapper::largeIntegersDoNotCollide()
+{
+    // 2^53 и 2^53 + 1 одинаковы в double
+    const qlonglong a = 9007199254740992LL;
+    const qlonglong b = a + 1;
+    SqlDataMapper mapper({ {a, "a"}, {b, "b"} });
+    QCOMPARE(mapper.sval(a).toString(), QString("a"));
+    QCOMPARE(mapper.sval(b).toString(), QString("b"));
+    QCOMPARE(mapper.bval("a").toLongLong(), a);
+}
+
+void tst_SqlDataMapper::unknownKeyReturnsDefault()
+{
+    SqlDataMapper mapper({ {0, "Нет"} });
+    QCOMPARE(mapper.bval("Может быть").toString(), QString("Неизвестно"));
+    QCOMPARE(mapper.sval(42).toString(), QString("0"));
+    QCOMPARE(mapper[42].toString(), QString("0"));
+}
+
+void tst_SqlDataMapper::laterPairWins()
+{
+    SqlDataMapper mapper({ {0, "Нет"} });
+    mapper.registerValue({0, "Выключен"});
+    QCOMPARE(mapper.sval(0).toString(), QString("Выключен"));
+    QCOMPARE(mapper.allBaseValues().size(), 1);
+}
+
+QTEST_APPLESS_MAIN(tst_SqlDataMapper)
+
+#include "tst_SqlDataMapper.moc"
@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_SqlDataMapper
+
+SOURCES += \
+    tst_SqlDataMapper.cpp
@@ -0,0 +1,174 @@
+#include <QtTest>
+#include "SqlJoinedTableManager.h"
+
+class OrderItem : public ISqlTableItem
+{
+    Q_OBJECT
+    Q_PROPERTY(QString client_uuid MEMBER client_uuid)
+    Q_PROPERTY(QVariant status MEMBER status)
+
+public:
+    QString client_uuid;
+    QVariant status;
+};
+
+class ClientItem : public ISqlTableItem
+{
+    Q_OBJECT
+    Q_PROPERTY(QString name MEMBER name)
+
+public:
+    QString name;
+};
+
+class StatusItem : public ISqlTableItem
+{
+    Q_OBJECT
+    Q_PROPERTY(QVariant code MEMBER code)
+    Q_PROPERTY(QString title MEMBER title)
+
+public:
+    QVariant code;
+    QString title;
+};
+
+
+namespace
+{
+    class JoinedManager : public SqlJoinedTableManager
+    {
+    public:
+        JoinedManager(SqlDatabaseConnector * connector) :
+            SqlJoinedTableManager(connector)
+        {
+            setBaseTable("shop", "orders", "o", [] { return ISqlTableItem::ptr(new OrderItem); });
+            addJoin("shop", "clients", "c", "client_uuid", "_uuid", LeftJoin,
+                    [] { return ISqlTableItem::ptr(new ClientItem); });
+            addJoin("shop", "statuses", "s", "status", "code", InnerJoin,
+                    [] { return ISqlTableItem::ptr(new StatusItem); });
+        }
+
+        using SqlJoinedTableManager::setBaseRecord;
+        using SqlJoinedTableManager::removeBaseRecord;
+        using SqlJoinedTableManager::setLookupRecord;
+        using SqlJoinedTableManager::removeLookupRecord;
+
+        const QSet<QString> & requestedKeys() const { return _requestedKeys; }
+    };
+
+    enum MemberIndex { Clients = 1, Statuses = 2 };
+
+    const QString Order1 = QStringLiteral("aaaaaaaa-0000-0000-0000-000000000001");
+    const QString Order2 = QStringLiteral("aaaaaaaa-0000-0000-0000-000000000002");
+    const QString Order3 = QStringLiteral("aaaaaaaa-0000-0000-0000-000000000003");
+    const QString Client1 = QStringLiteral("cccccccc-0000-0000-0000-000000000001");
+    const QString Client2 = QStringLiteral("cccccccc-0000-0000-0000-000000000002");
+    const QString Paid = QStringLiteral("bbbbbbbb-0000-0000-0000-000000000001");
+
+    QJsonObject order(const QString & uuid, const QString & client, const QJsonValue & status)
+    {
+        return QJsonObject { { "_uuid", uuid }, { "client_uuid", client }, { "status", status } };
+    }
+}
+
+
+class tst_SqlJoinedTableManager : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void keyNormalization();
+    void countFollowsLookups();
+    void requestLookup();
+};
+
+void tst_SqlJoinedTableManager::keyNormalization()
+{
+    SqlDatabaseConnector connector("localhost", 5432, "test");
+    JoinedManager manager(&connector);
+
+    // Код из базы приходит числом 5.0, а в строке заказа - 5 или "5"
+    manager.setLookupRecord(Statuses, Paid, QJsonObject { { "_uuid", Paid }, { "code", 5.0 }, { "title", "paid" } });
+    manager.setBaseRecord(Order1, order(Order1, Client1, 5), false);
+    manager.setBaseRecord(Order2, order(Order2, Client1, "5"), false);
+    manager.setBaseRecord(Order3, order(Order3, Client1, 7), false);
+
+    QVERIFY(manager.contains(Order1));
+    QVERIFY(manager.contains(Order2));
+    QVERIFY(!manager.contains(Order3));
+    QCOMPARE(manager.count(), 2);
+    QCOMPARE(manager.value(Order1, "s", "title").toString(), QString("paid"));
+    QCOMPARE(manager.value(Order2, "s", "title").toString(), QString("paid"));
+
+    // Смена кода справочника переносит соединение на другие строки
+    manager.setLookupRecord(Statuses, Paid, QJsonObject { { "_uuid", Paid }, { "code", "7" }, { "title", "paid" } });
+    QVERIFY(!manager.contains(Order1));
+    QVERIFY(!manager.contains(Order2));
+    QVERIFY(manager.contains(Order3));
+    QCOMPARE(manager.count(), 1);
+}
+
+void tst_SqlJoinedTableManager::countFollowsLookups()
+{
+    SqlDatabaseConnector connector("localhost", 5432, "test");
+    JoinedManager manager(&connector);
+
+    manager.setBaseRecord(Order1, order(Order1, Client1, 5), false);
+    manager.setBaseRecord(Order2, order(Order2, Client2, 5), false);
+    QCOMPARE(manager.count(), 0);
+    QVERIFY(manager.uuids().isEmpty());
+
+    // LeftJoin на клиентов строку не исключает, InnerJoin на статусы - исключает
+    manager.setLookupRecord(Statuses, Paid, QJsonObject { { "_uuid", Paid }, { "code", 5 }, { "title", "paid" } });
+    QCOMPARE(manager.count(), 2);
+    QStringList uuids = manager.uuids();
+    uuids.sort();
+    QCOMPARE(uuids, QStringList({ Order1, Order2 }));
+    QVERIFY(manager.record(Order1, "c").isEmpty());
+
+    manager.removeBaseRecord(Order2);
+    QCOMPARE(manager.count(), 1);
+    QVERIFY(!manager.contains(Order2));
+
+    manager.removeLookupRecord(Statuses, Paid);
+    QCOMPARE(manager.count(), 0);
+
+    manager.setLookupRecord(Statuses, Paid, QJsonObject { { "_uuid", Paid }, { "code", 5 }, { "title", "paid" } });
+    QCOMPARE(manager.count(), 1);
+
+    manager.unload();
+    QCOMPARE(manager.count(), 0);
+}
+
+void tst_SqlJoinedTableManager::requestLookup()
+{
+    SqlDatabaseConnector connector("localhost", 5432, "test");
+    JoinedManager manager(&connector);
+    manager.setLookupRecord(Statuses, Paid, QJsonObject { { "_uuid", Paid }, { "code", 5 }, { "title", "paid" } });
+    const int pending = connector.pendingCount();
+
+    // Клиента еще нет - он запрашивается один раз, сколько бы строк на него ни ссылалось
+    manager.setBaseRecord(Order1, order(Order1, Client1, 5));
+    manager.setBaseRecord(Order2, order(Order2, Client1, 5));
+    QCOMPARE(connector.pendingCount(), pending + 1);
+    QVERIFY(manager.requestedKeys().contains(QString("%1:%2").arg(Clients).arg(Client1)));
+
+    // Статус уже загружен и не запрашивается
+    QVERIFY(!manager.requestedKeys().contains(QString("%1:5").arg(Statuses)));
+
+    // Загруженный клиент больше не запрашивается
+    manager.setLookupRecord(Clients, Client1, QJsonObject { { "_uuid", Client1 }, { "name", "first" } });
+    manager.setBaseRecord(Order3, order(Order3, Client1, 5));
+    QCOMPARE(connector.pendingCount(), pending + 1);
+    QCOMPARE(manager.value(Order3, "c", "name").toString(), QString("first"));
+
+    // После удаления клиента ключ можно запросить снова
+    manager.removeLookupRecord(Clients, Client1);
+    QVERIFY(!manager.requestedKeys().contains(QString("%1:%2").arg(Clients).arg(Client1)));
+    manager.setBaseRecord(Order3, order(Order3, Client1, 5));
+    QCOMPARE(connector.pendingCount(), pending + 2);
+}
+
+QTEST_GUILESS_MAIN(tst_SqlJoinedTableManager)
+
+#include "tst_SqlJoinedTableManager.moc"
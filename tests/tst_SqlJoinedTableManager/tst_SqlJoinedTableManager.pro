@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_SqlJoinedTableManager
+
+SOURCES += \
+    tst_SqlJoinedTableManager.cpp
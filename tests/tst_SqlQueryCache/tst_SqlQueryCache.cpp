@@ -0,0 +1,154 @@
+#include <QtTest>
+#include "SqlQueryCache.h"
+
+
+class tst_SqlQueryCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void tablesOfQualifiedAndPlain();
+    void tablesOfIgnoresLiterals();
+    void tablesOfQuotedIdentifiers();
+    void tablesOfInsertColumns();
+    void functionCallsAreNotCached();
+    void unqualifiedTablesAreNotCached();
+    void unwatchedTablesAreNotCached();
+    void invalidateByTable();
+    void invalidateByWrite();
+    void invalidateUnqualifiedWrite();
+    void functionWriteClearsCache();
+
+private:
+    static QueryResult result(int rows);
+};
+
+QueryResult tst_SqlQueryCache::result(int rows)
+{
+    QueryResult out;
+    out.isSelect = true;
+    for(int i = 0; i < rows; i++)
+        out.records << QJsonObject { { "id", i } };
+    return out;
+}
+
+void tst_SqlQueryCache::tablesOfQualifiedAndPlain()
+{
+    QStringList unqualified;
+    const QStringList tables = SqlQueryCache::tablesOf(
+                "SELECT * FROM sales.orders o JOIN items ON items.order_id = o.id;", &unqualified);
+    QVERIFY(tables.contains("sales.orders"));
+    // Схема таблицы без схемы зависит от search_path, public не подставляется
+    QVERIFY(!tables.contains("public.items"));
+    QCOMPARE(unqualified, QStringList { "items" });
+}
+
+void tst_SqlQueryCache::tablesOfIgnoresLiterals()
+{
+    const QStringList tables = SqlQueryCache::tablesOf(
+                "SELECT * FROM public.log WHERE message = 'see audit.events' -- from archive.old\n;");
+    QVERIFY(tables.contains("public.log"));
+    QVERIFY(!tables.contains("audit.events"));
+    QVERIFY(!tables.contains("archive.old"));
+    QVERIFY(!tables.contains("public.archive"));
+}
+
+void tst_SqlQueryCache::tablesOfQuotedIdentifiers()
+{
+    const QStringList tables = SqlQueryCache::tablesOf("SELECT * FROM \"Sales\".\"Orders\";");
+    QVERIFY(tables.contains("Sales.Orders"));
+}
+
+void tst_SqlQueryCache::tablesOfInsertColumns()
+{
+    const QStringList tables = SqlQueryCache::tablesOf("INSERT INTO shop.orders (client, amount) VALUES ('a', 1);");
+    QVERIFY(tables.contains("shop.orders"));
+}
+
+void tst_SqlQueryCache::functionCallsAreNotCached()
+{
+    SqlQueryCache cache;
+    QVERIFY(!cache.insert("SELECT nextval('orders_id_seq') FROM public.orders;", result(1)));
+    QVERIFY(!cache.insert("SELECT * FROM public.orders WHERE created > now();", result(1)));
+    QVERIFY(!cache.insert("SELECT * FROM public.get_orders(1);", result(1)));
+    QVERIFY(cache.insert("SELECT count(*) FROM public.orders;", result(1)));
+    QCOMPARE(cache.stats().entries, 1);
+}
+
+void tst_SqlQueryCache::unqualifiedTablesAreNotCached()
+{
+    SqlQueryCache cache;
+    QVERIFY(!cache.insert("SELECT * FROM orders;", result(1)));
+    QVERIFY(!cache.insert("SELECT * FROM shop.orders o JOIN clients c ON c.uuid = o.client;", result(1)));
+    QVERIFY(cache.insert("SELECT * FROM shop.orders o JOIN shop.clients c ON c.uuid = o.client;", result(1)));
+    QCOMPARE(cache.stats().entries, 1);
+}
+
+void tst_SqlQueryCache::unwatchedTablesAreNotCached()
+{
+    SqlQueryCache cache;
+    auto watched = [](const QString & schema, const QString & table) {
+        return schema == "shop" && table == "orders";
+    };
+
+    // alias.column не считается таблицей запроса
+    QVERIFY(cache.insert("SELECT o.client FROM shop.orders o;", result(1), watched));
+    QVERIFY(!cache.insert("SELECT * FROM shop.orders o JOIN shop.clients c ON c.uuid = o.client;",
+                          result(1), watched));
+    QVERIFY(!cache.insert("SELECT * FROM shop.orders WHERE client IN (SELECT uuid FROM shop.clients);",
+                          result(1), watched));
+    QCOMPARE(cache.stats().entries, 1);
+}
+
+void tst_SqlQueryCache::invalidateByTable()
+{
+    SqlQueryCache cache;
+    const QString query = "SELECT * FROM public.orders;";
+    QVERIFY(cache.insert(query, result(3)));
+
+    QueryResult cached;
+    QVERIFY(cache.lookup(query, cached));
+    QCOMPARE(cached.records.size(), 3);
+
+    cache.invalidateTable("public", "items");
+    QVERIFY(cache.lookup(query, cached));
+    cache.invalidateTable("public", "orders");
+    QVERIFY(!cache.lookup(query, cached));
+}
+
+void tst_SqlQueryCache::invalidateByWrite()
+{
+    SqlQueryCache cache;
+    QVERIFY(cache.insert("SELECT * FROM public.orders;", result(1)));
+    QVERIFY(cache.insert("SELECT * FROM public.items;", result(1)));
+
+    cache.invalidateQuery("UPDATE orders SET state = 'public.items';");
+    QueryResult cached;
+    QVERIFY(!cache.lookup("SELECT * FROM public.orders;", cached));
+    QVERIFY(cache.lookup("SELECT * FROM public.items;", cached));
+}
+
+void tst_SqlQueryCache::invalidateUnqualifiedWrite()
+{
+    SqlQueryCache cache;
+    QVERIFY(cache.insert("SELECT * FROM shop.orders;", result(1)));
+    QVERIFY(cache.insert("SELECT * FROM shop.items;", result(1)));
+
+    // orders может оказаться в любой схеме из search_path
+    cache.invalidateQuery("DELETE FROM orders WHERE amount = 0;");
+    QueryResult cached;
+    QVERIFY(!cache.lookup("SELECT * FROM shop.orders;", cached));
+    QVERIFY(cache.lookup("SELECT * FROM shop.items;", cached));
+}
+
+void tst_SqlQueryCache::functionWriteClearsCache()
+{
+    SqlQueryCache cache;
+    QVERIFY(cache.insert("SELECT * FROM public.orders;", result(1)));
+    cache.invalidateQuery("SELECT archive_orders();");
+    QCOMPARE(cache.stats().entries, 0);
+}
+
+QTEST_APPLESS_MAIN(tst_SqlQueryCache)
+
+#include "tst_SqlQueryCache.moc"
@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_SqlQueryCache
+
+SOURCES += \
+    tst_SqlQueryCache.cpp
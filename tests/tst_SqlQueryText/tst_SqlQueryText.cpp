@@ -0,0 +1,84 @@
+#include <QtTest>
+#include "SqlQueryText.h"
+
+Q_DECLARE_METATYPE(SqlQueryText::Kind)
+
+
+class tst_SqlQueryText : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void classify_data();
+    void classify();
+    void stripLiterals_data();
+    void stripLiterals();
+};
+
+void tst_SqlQueryText::classify_data()
+{
+    QTest::addColumn<QString>("query");
+    QTest::addColumn<SqlQueryText::Kind>("kind");
+
+    QTest::newRow("select") << "SELECT * FROM public.orders;" << SqlQueryText::PureRead;
+    QTest::newRow("lowercase") << "  select id from orders where id = 1" << SqlQueryText::PureRead;
+    QTest::newRow("with select") << "WITH last AS (SELECT * FROM orders ORDER BY id DESC LIMIT 10) SELECT * FROM last;"
+                                 << SqlQueryText::PureRead;
+    QTest::newRow("parenthesized") << "(SELECT 1) UNION (SELECT 2);" << SqlQueryText::PureRead;
+    QTest::newRow("aggregates") << "SELECT count(*), max(price), coalesce(sum(qty), 0) FROM orders GROUP BY state;"
+                                << SqlQueryText::PureRead;
+    QTest::newRow("in list") << "SELECT * FROM orders WHERE state IN (1, 2) AND EXISTS (SELECT 1 FROM items);"
+                             << SqlQueryText::PureRead;
+    QTest::newRow("typed cast") << "SELECT price::numeric(10, 2) FROM orders;" << SqlQueryText::PureRead;
+    QTest::newRow("keyword in literal") << "SELECT * FROM log WHERE text = 'DELETE FROM orders; nextval(''x'')';"
+                                        << SqlQueryText::PureRead;
+    QTest::newRow("keyword in comment") << "SELECT 1 -- UPDATE orders\n;" << SqlQueryText::PureRead;
+    QTest::newRow("for update") << "SELECT * FROM orders WHERE id = 1 FOR UPDATE;" << SqlQueryText::LockingRead;
+    QTest::newRow("for no key update") << "SELECT * FROM orders FOR NO KEY UPDATE SKIP LOCKED;" << SqlQueryText::LockingRead;
+    QTest::newRow("for share") << "SELECT * FROM orders FOR SHARE;" << SqlQueryText::LockingRead;
+    QTest::newRow("nextval") << "SELECT nextval('orders_id_seq');" << SqlQueryText::Write;
+    QTest::newRow("now") << "SELECT now();" << SqlQueryText::Write;
+    QTest::newRow("schema function") << "SELECT * FROM public.get_orders(1);" << SqlQueryText::Write;
+    QTest::newRow("quoted function") << "SELECT \"Touch\"(id) FROM orders;" << SqlQueryText::Write;
+    QTest::newRow("modifying cte") << "WITH gone AS (DELETE FROM orders RETURNING *) SELECT count(*) FROM gone;"
+                                   << SqlQueryText::Write;
+    QTest::newRow("select into") << "SELECT * INTO backup FROM orders;" << SqlQueryText::Write;
+    QTest::newRow("insert") << "INSERT INTO orders (id) VALUES (1);" << SqlQueryText::Write;
+    QTest::newRow("update") << "UPDATE orders SET state = 1;" << SqlQueryText::Write;
+    QTest::newRow("listen") << "LISTEN orders;" << SqlQueryText::Write;
+    QTest::newRow("empty") << "" << SqlQueryText::Write;
+}
+
+void tst_SqlQueryText::classify()
+{
+    QFETCH(QString, query);
+    QFETCH(SqlQueryText::Kind, kind);
+    QCOMPARE(SqlQueryText::classify(query), kind);
+}
+
+void tst_SqlQueryText::stripLiterals_data()
+{
+    QTest::addColumn<QString>("query");
+    QTest::addColumn<QString>("stripped");
+
+    QTest::newRow("plain") << "SELECT a FROM t" << "SELECT a FROM t";
+    QTest::newRow("doubled quote") << "WHERE a = 'it''s'" << "WHERE a = ''";
+    QTest::newRow("escape string") << "WHERE a = E'x\\'y'" << "WHERE a = ''";
+    QTest::newRow("identifier ending in e") << "WHERE name='x'" << "WHERE name=''";
+    QTest::newRow("dollar") << "SELECT $$a ' b$$, $tag$c$$d$tag$" << "SELECT '', ''";
+    QTest::newRow("parameter") << "WHERE a = $1" << "WHERE a = $1";
+    QTest::newRow("quoted identifier") << "FROM \"My 'Table'\"" << "FROM \"My 'Table'\"";
+    QTest::newRow("line comment") << "SELECT 1 -- x.y\nFROM t" << "SELECT 1  \nFROM t";
+    QTest::newRow("nested comment") << "SELECT /* a /* b */ c */ 1" << "SELECT   1";
+}
+
+void tst_SqlQueryText::stripLiterals()
+{
+    QFETCH(QString, query);
+    QFETCH(QString, stripped);
+    QCOMPARE(SqlQueryText::stripLiterals(query), stripped);
+}
+
+QTEST_APPLESS_MAIN(tst_SqlQueryText)
+
+#include "tst_SqlQueryText.moc"
@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_SqlQueryText
+
+SOURCES += \
+    tst_SqlQueryText.cpp
@@ -0,0 +1,144 @@
+#include <QtTest>
+#include "SqlReplicaSet.h"
+
+namespace
+{
+    void ignore(const QUuid &, const QueryResult &) {}
+
+    QJsonObject lagRecord(bool inRecovery, const QString & status, double receiptAgeMs, double lagMs)
+    {
+        return QJsonObject { { "in_recovery", inRecovery }, { "receiver_status", status },
+                             { "receipt_age_ms", receiptAgeMs }, { "lag_ms", lagMs } };
+    }
+}
+
+class tst_SqlReplicaSet : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void routeSkipsLaggingReplicas();
+    void routeSkipsClosedAndUnknown();
+    void routePrefersLeastLoaded();
+    void routeRotatesOnEqualLoad();
+    void writeThroughPrimaryIsSticky();
+    void readDoesNotStick();
+    void stickinessDisabledByDefault();
+    void lagOfStreamingReplica();
+    void lagOfUnhealthyReplica_data();
+    void lagOfUnhealthyReplica();
+
+private:
+    static SqlReplicaSet::ReplicaInfo replica(bool open, qint64 lagMs, int load = 0);
+};
+
+SqlReplicaSet::ReplicaInfo tst_SqlReplicaSet::replica(bool open, qint64 lagMs, int load)
+{
+    SqlReplicaSet::ReplicaInfo info;
+    info.open = open;
+    info.lagMs = lagMs;
+    info.load = load;
+    return info;
+}
+
+void tst_SqlReplicaSet::routeSkipsLaggingReplicas()
+{
+    const QList<SqlReplicaSet::ReplicaInfo> replicas { replica(true, 6000), replica(true, 100, 5) };
+    QCOMPARE(SqlReplicaSet::route(replicas, 0, 5000), 1);
+    QCOMPARE(SqlReplicaSet::route(replicas, 0, 50), -1);
+    QCOMPARE(SqlReplicaSet::route(replicas, 0, 6000), 0);
+}
+
+void tst_SqlReplicaSet::routeSkipsClosedAndUnknown()
+{
+    const QList<SqlReplicaSet::ReplicaInfo> replicas { replica(false, 0), replica(true, -1) };
+    QCOMPARE(SqlReplicaSet::route(replicas, 0, 5000), -1);
+    QCOMPARE(SqlReplicaSet::route({}, 0, 5000), -1);
+}
+
+void tst_SqlReplicaSet::routePrefersLeastLoaded()
+{
+    const QList<SqlReplicaSet::ReplicaInfo> replicas { replica(true, 0, 3), replica(true, 10, 1), replica(true, 0, 2) };
+    QCOMPARE(SqlReplicaSet::route(replicas, 0, 5000), 1);
+}
+
+void tst_SqlReplicaSet::routeRotatesOnEqualLoad()
+{
+    const QList<SqlReplicaSet::ReplicaInfo> replicas { replica(true, 0), replica(true, 0), replica(true, 0) };
+    QCOMPARE(SqlReplicaSet::route(replicas, 0, 5000), 0);
+    QCOMPARE(SqlReplicaSet::route(replicas, 1, 5000), 1);
+    QCOMPARE(SqlReplicaSet::route(replicas, 5, 5000), 2);
+}
+
+void tst_SqlReplicaSet::writeThroughPrimaryIsSticky()
+{
+    // Соединение не открыто: запрос сразу вернется с ошибкой,
+    // но запись учитывается при отправке
+    SqlDatabaseConnector primary;
+    SqlReplicaSet set(&primary);
+    set.setLagCheckInterval(0);
+    set.setStickiness(200);
+    QVERIFY(!set.isSticky());
+
+    primary.sendQuery("UPDATE public.orders SET state = 1;", nullptr, ignore);
+    QVERIFY(set.isSticky());
+    QCOMPARE(set.readConnector(), &primary);
+    QTRY_VERIFY_WITH_TIMEOUT(!set.isSticky(), 2000);
+
+    primary.sendQuery(QUuid::createUuid(), "DELETE FROM public.orders;");
+    QVERIFY(set.isSticky());
+}
+
+void tst_SqlReplicaSet::readDoesNotStick()
+{
+    SqlDatabaseConnector primary;
+    SqlReplicaSet set(&primary);
+    set.setLagCheckInterval(0);
+    set.setStickiness(200);
+
+    primary.sendQuery("SELECT * FROM public.orders;", nullptr, ignore);
+    QVERIFY(!set.isSticky());
+}
+
+void tst_SqlReplicaSet::stickinessDisabledByDefault()
+{
+    SqlDatabaseConnector primary;
+    SqlReplicaSet set(&primary);
+    set.setLagCheckInterval(0);
+    QCOMPARE(set.stickiness(), qint64(0));
+
+    primary.sendQuery("UPDATE public.orders SET state = 1;", nullptr, ignore);
+    QVERIFY(!set.isSticky());
+}
+
+void tst_SqlReplicaSet::lagOfStreamingReplica()
+{
+    QCOMPARE(SqlReplicaSet::lagOf(lagRecord(true, "streaming", 200, 0), 60000), qint64(0));
+    QCOMPARE(SqlReplicaSet::lagOf(lagRecord(true, "streaming", 200, 1500.7), 60000), qint64(1500));
+}
+
+void tst_SqlReplicaSet::lagOfUnhealthyReplica_data()
+{
+    QTest::addColumn<QJsonObject>("record");
+
+    // Основной сервер раньше отдавал 0 через COALESCE
+    QTest::newRow("primary") << lagRecord(false, "", -1, -1);
+    QTest::newRow("primary with zero lag") << lagRecord(false, "", -1, 0);
+    // receive_lsn = replay_lsn у остановленного WAL receiver раньше давало 0
+    QTest::newRow("no receiver") << lagRecord(true, "", -1, 0);
+    QTest::newRow("receiver stopping") << lagRecord(true, "stopping", 100, 0);
+    QTest::newRow("receiver stale") << lagRecord(true, "streaming", 61000, 0);
+    QTest::newRow("receipt unknown") << lagRecord(true, "streaming", -1, 0);
+    QTest::newRow("lag unknown") << lagRecord(true, "streaming", 100, -1);
+    QTest::newRow("empty") << QJsonObject();
+}
+
+void tst_SqlReplicaSet::lagOfUnhealthyReplica()
+{
+    QFETCH(QJsonObject, record);
+    QCOMPARE(SqlReplicaSet::lagOf(record, 60000), qint64(-1));
+}
+
+QTEST_GUILESS_MAIN(tst_SqlReplicaSet)
+
+#include "tst_SqlReplicaSet.moc"
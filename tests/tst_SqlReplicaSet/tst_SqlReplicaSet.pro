@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_SqlReplicaSet
+
+SOURCES += \
+    tst_SqlReplicaSet.cpp
@@ -0,0 +1,169 @@
+#include <QtTest>
+#include "SqlSearchIndex.h"
+
+class RowItem : public ISqlTableItem
+{
+    Q_OBJECT
+    Q_PROPERTY(QString client MEMBER client)
+    Q_PROPERTY(int amount MEMBER amount)
+
+public:
+    QString client;
+    int amount { 0 };
+};
+
+
+namespace
+{
+    //! Менеджер без базы: элементы кладутся в _items напрямую,
+    //! изменения отдаются сигналом itemsChanged, как после уведомлений
+    class FakeManager : public ISqlTableManager
+    {
+    public:
+        explicit FakeManager(SqlDatabaseConnector * connector) :
+            ISqlTableManager(connector, "shop", "orders")
+        {
+        }
+
+        void updateModel() override {}
+
+        RowItem * put(const QString & uuid, const QString & client, int amount = 0)
+        {
+            auto & item = _items[uuid];
+            if(!item)
+            {
+                item = ISqlTableItem::ptr(new RowItem);
+                item->setUuid(uuid);
+            }
+            auto row = static_cast<RowItem *>(item.data());
+            row->client = client;
+            row->amount = amount;
+            return row;
+        }
+
+        void drop(const QString & uuid) { _items.remove(uuid); }
+
+    protected:
+        ISqlTableItem::ptr parseSingleQuery(const QJsonObject & record) override
+        {
+            ISqlTableItem::ptr item(new RowItem);
+            autoParseQuery(item, record);
+            return item;
+        }
+    };
+
+    const QString First = QStringLiteral("aaaaaaaa-0000-0000-0000-000000000001");
+    const QString Second = QStringLiteral("aaaaaaaa-0000-0000-0000-000000000002");
+    const QString Third = QStringLiteral("aaaaaaaa-0000-0000-0000-000000000003");
+
+    QStringList sorted(QStringList uuids)
+    {
+        uuids.sort();
+        return uuids;
+    }
+}
+
+
+class tst_SqlSearchIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void filters();
+    void stalePostingsSkipped();
+    void slotReuse();
+    void compaction();
+};
+
+void tst_SqlSearchIndex::filters()
+{
+    SqlDatabaseConnector connector("localhost", 5432, "test");
+    FakeManager manager(&connector);
+    manager.put(First, "Alpha", 5);
+    manager.put(Second, "Beta", 10);
+    manager.put(Third, "alphabet", 15);
+    SqlSearchIndex index(&manager, { "amount" }, { "client" });
+
+    QCOMPARE(sorted(index.find({ SqlFilter::contains("client", "ALPH") })), QStringList({ First, Third }));
+    QCOMPARE(index.find({ SqlFilter::contains("client", "alph"), SqlFilter::range("amount", 10, SqlValue()) }),
+             QStringList({ Third }));
+    QCOMPARE(index.find({ SqlFilter::equals("amount", 10.0) }), QStringList({ Second }));
+    QCOMPARE(sorted(index.find({ SqlFilter::in("amount", { 15, 5 }) })), QStringList({ First, Third }));
+    // Подстрока короче триграмма проверяется по всем ячейкам
+    QCOMPARE(sorted(index.find({ SqlFilter::contains("client", "ta") })), QStringList({ Second }));
+    QCOMPARE(index.find({ SqlFilter::contains("client", "alph") }, 1).size(), 1);
+    QVERIFY(!index.compile({ SqlFilter::contains("amount", "1") }).isValid());
+}
+
+void tst_SqlSearchIndex::stalePostingsSkipped()
+{
+    SqlDatabaseConnector connector("localhost", 5432, "test");
+    FakeManager manager(&connector);
+    manager.put(First, "Alpha");
+    manager.put(Second, "Beta");
+    SqlSearchIndex index(&manager, {}, { "client" });
+
+    // Старые триграммы остаются в списках, но ячейка с новым текстом
+    // под них больше не подходит
+    manager.put(First, "Gamma");
+    emit manager.itemsChanged({}, { First }, {});
+    QVERIFY(index.find({ SqlFilter::contains("client", "alp") }).isEmpty());
+    QCOMPARE(index.find({ SqlFilter::contains("client", "amm") }), QStringList({ First }));
+
+    // Возврат к прежнему тексту не дает повторов из старых списков
+    manager.put(First, "Alpha");
+    emit manager.itemsChanged({}, { First }, {});
+    QCOMPARE(index.find({ SqlFilter::contains("client", "alp") }), QStringList({ First }));
+    QVERIFY(index.find({ SqlFilter::contains("client", "gam") }).isEmpty());
+}
+
+void tst_SqlSearchIndex::slotReuse()
+{
+    SqlDatabaseConnector connector("localhost", 5432, "test");
+    FakeManager manager(&connector);
+    manager.put(First, "Gamma", 1);
+    manager.put(Second, "Beta", 2);
+    SqlSearchIndex index(&manager, { "amount" }, { "client" });
+
+    manager.drop(First);
+    emit manager.itemsChanged({}, {}, { First });
+    QCOMPARE(index.count(), 1);
+    QVERIFY(index.find({ SqlFilter::contains("client", "gam") }).isEmpty());
+    QVERIFY(index.find({ SqlFilter::equals("amount", 1) }).isEmpty());
+
+    // Новый элемент занимает освободившуюся ячейку, старые списки
+    // триграмм указывают на нее же
+    manager.put(Third, "Gambit", 3);
+    emit manager.itemsChanged({ Third }, {}, {});
+    QCOMPARE(index.count(), 2);
+    QCOMPARE(index.find({ SqlFilter::contains("client", "gam") }), QStringList({ Third }));
+    QVERIFY(index.find({ SqlFilter::contains("client", "amm") }).isEmpty());
+    QCOMPARE(index.find({ SqlFilter::equals("amount", 3) }), QStringList({ Third }));
+    QVERIFY(index.find({ SqlFilter::equals("amount", 1) }).isEmpty());
+}
+
+void tst_SqlSearchIndex::compaction()
+{
+    SqlDatabaseConnector connector("localhost", 5432, "test");
+    FakeManager manager(&connector);
+    manager.put(First, "Alpha");
+    manager.put(Second, "Beta");
+    SqlSearchIndex index(&manager, {}, { "client" });
+    const qint64 initial = index.memoryUsage();
+
+    // Устаревших записей становится больше 1024, и списки пересобираются
+    for(int i = 0; i < 600; i++)
+    {
+        manager.put(First, i % 2 ? "Alpha" : "Omega");
+        emit manager.itemsChanged({}, { First }, {});
+    }
+
+    QCOMPARE(index.find({ SqlFilter::contains("client", "alp") }), QStringList({ First }));
+    QVERIFY(index.find({ SqlFilter::contains("client", "meg") }).isEmpty());
+    QCOMPARE(index.find({ SqlFilter::contains("client", "bet") }), QStringList({ Second }));
+    QVERIFY(index.memoryUsage() < initial + 1024 * qint64(sizeof(int)));
+}
+
+QTEST_GUILESS_MAIN(tst_SqlSearchIndex)
+
+#include "tst_SqlSearchIndex.moc"
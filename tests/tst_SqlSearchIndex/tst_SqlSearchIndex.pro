@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_SqlSearchIndex
+
+SOURCES += \
+    tst_SqlSearchIndex.cpp
@@ -0,0 +1,232 @@
+#include <QtTest>
+#include "SqlSortedView.h"
+
+class RowItem : public ISqlTableItem
+{
+    Q_OBJECT
+    Q_PROPERTY(QString client MEMBER client)
+    Q_PROPERTY(int amount MEMBER amount)
+
+public:
+    QString client;
+    int amount { 0 };
+};
+
+
+namespace
+{
+    //! Менеджер без базы: элементы кладутся в _items напрямую,
+    //! изменения отдаются сигналом itemsChanged, как после уведомлений
+    class FakeManager : public ISqlTableManager
+    {
+    public:
+        explicit FakeManager(SqlDatabaseConnector * connector) :
+            ISqlTableManager(connector, "shop", "orders")
+        {
+        }
+
+        void updateModel() override {}
+
+        RowItem * put(const QString & uuid, const QString & client, int amount = 0)
+        {
+            auto & item = _items[uuid];
+            if(!item)
+            {
+                item = ISqlTableItem::ptr(new RowItem);
+                item->setUuid(uuid);
+            }
+            auto row = static_cast<RowItem *>(item.data());
+            row->client = client;
+            row->amount = amount;
+            return row;
+        }
+
+        void drop(const QString & uuid) { _items.remove(uuid); }
+
+    protected:
+        ISqlTableItem::ptr parseSingleQuery(const QJsonObject & record) override
+        {
+            ISqlTableItem::ptr item(new RowItem);
+            autoParseQuery(item, record);
+            return item;
+        }
+    };
+
+    const QString First = QStringLiteral("aaaaaaaa-0000-0000-0000-000000000001");
+    const QString Second = QStringLiteral("aaaaaaaa-0000-0000-0000-000000000002");
+    const QString Third = QStringLiteral("aaaaaaaa-0000-0000-0000-000000000003");
+    const QString Fourth = QStringLiteral("aaaaaaaa-0000-0000-0000-000000000004");
+
+    //! Сигналы представления в порядке отправки
+    void watch(SqlSortedView & view, QStringList & log)
+    {
+        auto row = [&log](const QString & name) {
+            return [&log, name](int first, int last) { log << QString("%1 %2 %3").arg(name).arg(first).arg(last); };
+        };
+        QObject::connect(&view, &SqlSortedView::rowsAboutToBeInserted, &view, row("aboutToInsert"));
+        QObject::connect(&view, &SqlSortedView::rowsInserted, &view, row("inserted"));
+        QObject::connect(&view, &SqlSortedView::rowsAboutToBeRemoved, &view, row("aboutToRemove"));
+        QObject::connect(&view, &SqlSortedView::rowsRemoved, &view, row("removed"));
+        QObject::connect(&view, &SqlSortedView::rowsChanged, &view, row("changed"));
+        QObject::connect(&view, &SqlSortedView::aboutToBeReset, &view, [&log] { log << "aboutToReset"; });
+        QObject::connect(&view, &SqlSortedView::reset, &view, [&log] { log << "reset"; });
+    }
+
+    QStringList order(const SqlSortedView & view)
+    {
+        QStringList out;
+        for(int row = 0; row < view.count(); row++)
+            out << view.at(row)->uuid();
+        return out;
+    }
+}
+
+
+class tst_SqlSortedView : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void sorting();
+    void insertAndRemove();
+    void moveIsRemoveAndInsert();
+    void updateInPlace();
+    void storedKeyLookup();
+    void batchReset();
+};
+
+void tst_SqlSortedView::sorting()
+{
+    SqlDatabaseConnector connector("localhost", 5432, "test");
+    FakeManager manager(&connector);
+    manager.put(First, "b", 1);
+    manager.put(Second, "a", 5);
+    manager.put(Third, "a", 7);
+    manager.put(Fourth, "b", 1);
+
+    // При равенстве колонок порядок определяет uuid
+    SqlSortedView view(&manager, { { "client", Qt::AscendingOrder }, { "amount", Qt::DescendingOrder } });
+    QCOMPARE(order(view), QStringList({ Third, Second, First, Fourth }));
+    QCOMPARE(view.indexOf(Second), 1);
+    QCOMPARE(view.indexOf(Fourth), 3);
+    QCOMPARE(view.indexOf("missing"), -1);
+}
+
+void tst_SqlSortedView::insertAndRemove()
+{
+    SqlDatabaseConnector connector("localhost", 5432, "test");
+    FakeManager manager(&connector);
+    manager.put(First, "a");
+    manager.put(Second, "c");
+    SqlSortedView view(&manager, "client");
+    QStringList log;
+    watch(view, log);
+
+    manager.put(Third, "b");
+    emit manager.itemsChanged({ Third }, {}, {});
+    QCOMPARE(log, QStringList({ "aboutToInsert 1 1", "inserted 1 1" }));
+    QCOMPARE(order(view), QStringList({ First, Third, Second }));
+
+    log.clear();
+    manager.drop(First);
+    emit manager.itemsChanged({}, {}, { First });
+    QCOMPARE(log, QStringList({ "aboutToRemove 0 0", "removed 0 0" }));
+    QCOMPARE(order(view), QStringList({ Third, Second }));
+}
+
+void tst_SqlSortedView::moveIsRemoveAndInsert()
+{
+    SqlDatabaseConnector connector("localhost", 5432, "test");
+    FakeManager manager(&connector);
+    manager.put(First, "a");
+    manager.put(Second, "b");
+    manager.put(Third, "c");
+    SqlSortedView view(&manager, "client");
+    QStringList log;
+    watch(view, log);
+
+    manager.put(First, "d");
+    emit manager.itemsChanged({}, { First }, {});
+    QCOMPARE(log, QStringList({ "aboutToRemove 0 0", "removed 0 0", "aboutToInsert 2 2", "inserted 2 2" }));
+    QCOMPARE(order(view), QStringList({ Second, Third, First }));
+    QCOMPARE(view.indexOf(First), 2);
+
+    log.clear();
+    manager.put(Third, "0");
+    emit manager.itemsChanged({}, { Third }, {});
+    QCOMPARE(log, QStringList({ "aboutToRemove 1 1", "removed 1 1", "aboutToInsert 0 0", "inserted 0 0" }));
+    QCOMPARE(order(view), QStringList({ Third, Second, First }));
+}
+
+void tst_SqlSortedView::updateInPlace()
+{
+    SqlDatabaseConnector connector("localhost", 5432, "test");
+    FakeManager manager(&connector);
+    manager.put(First, "a");
+    manager.put(Second, "c");
+    manager.put(Third, "e");
+    SqlSortedView view(&manager, "client");
+    QStringList log;
+    watch(view, log);
+
+    // Элемент остался между соседями - перестановки нет
+    manager.put(Second, "d");
+    emit manager.itemsChanged({}, { Second }, {});
+    QCOMPARE(log, QStringList({ "changed 1 1" }));
+    QCOMPARE(order(view), QStringList({ First, Second, Third }));
+    QCOMPARE(view.indexOf(Second), 1);
+}
+
+void tst_SqlSortedView::storedKeyLookup()
+{
+    SqlDatabaseConnector connector("localhost", 5432, "test");
+    FakeManager manager(&connector);
+    manager.put(First, "a");
+    manager.put(Second, "b");
+    manager.put(Third, "c");
+    SqlSortedView view(&manager, "client");
+    QStringList log;
+    watch(view, log);
+
+    // Поля элемента уже изменились, а сигнала еще не было:
+    // позиция ищется по сохраненному ключу
+    manager.put(First, "z");
+    QCOMPARE(view.indexOf(First), 0);
+
+    manager.drop(First);
+    emit manager.itemsChanged({}, {}, { First });
+    QCOMPARE(log, QStringList({ "aboutToRemove 0 0", "removed 0 0" }));
+    QCOMPARE(order(view), QStringList({ Second, Third }));
+}
+
+void tst_SqlSortedView::batchReset()
+{
+    SqlDatabaseConnector connector("localhost", 5432, "test");
+    FakeManager manager(&connector);
+    manager.put(First, "a");
+    manager.put(Second, "b");
+    SqlSortedView view(&manager, "client");
+    view.setBatchResetThreshold(2);
+    QStringList log;
+    watch(view, log);
+
+    // Пачка не больше порога применяется по одному элементу
+    manager.put(First, "c");
+    manager.put(Third, "0");
+    emit manager.itemsChanged({ Third }, { First }, {});
+    QVERIFY(!log.contains("reset"));
+    QCOMPARE(order(view), QStringList({ Third, Second, First }));
+
+    // Пачка больше порога - пересортировка с сигналами сброса
+    log.clear();
+    manager.put(First, "0");
+    manager.put(Second, "1");
+    manager.put(Fourth, "2");
+    emit manager.itemsChanged({ Fourth }, { First, Second }, {});
+    QCOMPARE(log, QStringList({ "aboutToReset", "reset" }));
+    QCOMPARE(order(view), QStringList({ First, Third, Second, Fourth }));
+}
+
+QTEST_GUILESS_MAIN(tst_SqlSortedView)
+
+#include "tst_SqlSortedView.moc"
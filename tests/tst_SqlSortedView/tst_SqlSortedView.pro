@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_SqlSortedView
+
+SOURCES += \
+    tst_SqlSortedView.cpp
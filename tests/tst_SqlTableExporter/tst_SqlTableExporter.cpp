@@ -0,0 +1,74 @@
+#include <QtTest>
+#include "SqlTableExporter.h"
+
+namespace
+{
+    const QString TableName = QStringLiteral("sql_accessor_export_test");
+
+    QueryResult run(SqlDatabaseConnector & connector, const QString & query)
+    {
+        return connector.execute(query).result();
+    }
+}
+
+
+class tst_SqlTableExporter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    //! Требует сервер, переменные SQLACCESSOR_TEST_* - как в tests/integration/cdc_local.sh
+    void precisionRoundTrip();
+};
+
+void tst_SqlTableExporter::precisionRoundTrip()
+{
+    const QString host = qEnvironmentVariable("SQLACCESSOR_TEST_HOST");
+    if(host.isEmpty())
+        QSKIP("SQLACCESSOR_TEST_HOST is not set");
+
+    bool portSet = false;
+    const int port = qEnvironmentVariableIntValue("SQLACCESSOR_TEST_PORT", &portSet);
+    SqlDatabaseConnector connector(host, portSet ? port : 5432,
+                                   qEnvironmentVariable("SQLACCESSOR_TEST_DB", "postgres"));
+    connector.setListenEnabled(false);
+    QVERIFY(connector.connectToBase(qEnvironmentVariable("SQLACCESSOR_TEST_USER", "postgres"),
+                                    qEnvironmentVariable("SQLACCESSOR_TEST_PASSWORD")));
+
+    QCOMPARE(run(connector, QString("DROP TABLE IF EXISTS public.%1;").arg(TableName)).error.type(), QSqlError::NoError);
+    QCOMPARE(run(connector, QString("CREATE TABLE public.%1 (_uuid uuid PRIMARY KEY, amount numeric(30,10), "
+                                    "created timestamp, created_tz timestamptz);").arg(TableName)).error.type(),
+             QSqlError::NoError);
+
+    // 30 значащих цифр не влезают в double, микросекунды - в QDateTime
+    const QString uuid = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    const QString amount = QStringLiteral("12345678901234567890.1234567891");
+    const QString created = QStringLiteral("2024-05-06 07:08:09.123456");
+    QCOMPARE(run(connector, QString("INSERT INTO public.%1 VALUES ('%2', %3, '%4', '%4+03');")
+                 .arg(TableName, uuid, amount, created)).error.type(), QSqlError::NoError);
+
+    QBuffer file;
+    file.open(QIODevice::ReadWrite);
+    SqlTableExporter exporter(&connector);
+    QVERIFY2(exporter.exportTable("public", TableName, &file), qPrintable(exporter.lastError()));
+    QCOMPARE(exporter.stats().rows, qint64(1));
+
+    QCOMPARE(run(connector, QString("TRUNCATE public.%1;").arg(TableName)).error.type(), QSqlError::NoError);
+    file.seek(0);
+    QVERIFY2(exporter.importTable(&file), qPrintable(exporter.lastError()));
+
+    const QueryResult loaded = run(connector, QString("SELECT amount::text AS amount, created::text AS created, "
+                                                      "created_tz = '%2+03' AS same_tz FROM public.%1;")
+                                   .arg(TableName, created));
+    QCOMPARE(loaded.error.type(), QSqlError::NoError);
+    QCOMPARE(loaded.records.size(), 1);
+    QCOMPARE(loaded.records.first().value("amount").toString(), amount);
+    QCOMPARE(loaded.records.first().value("created").toString(), created);
+    QVERIFY(loaded.records.first().value("same_tz").toBool());
+
+    run(connector, QString("DROP TABLE public.%1;").arg(TableName));
+}
+
+QTEST_GUILESS_MAIN(tst_SqlTableExporter)
+
+#include "tst_SqlTableExporter.moc"
@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_SqlTableExporter
+
+SOURCES += \
+    tst_SqlTableExporter.cpp
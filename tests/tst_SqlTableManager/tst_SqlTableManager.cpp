@@ -0,0 +1,216 @@
+#include <QtTest>
+#include "SqlTableManager.h"
+
+namespace
+{
+    struct OrderRow
+    {
+        QString uuid;
+        QString client;
+        int amount { 0 };
+        double price { 0 };
+        bool paid { false };
+
+        static constexpr auto columns = std::make_tuple(
+            sqlColumn("client", &OrderRow::client),
+            sqlColumn("amount", &OrderRow::amount),
+            sqlColumn("price",  &OrderRow::price),
+            sqlColumn("paid",   &OrderRow::paid));
+    };
+
+    class OrderManager : public SqlTableManager<OrderRow>
+    {
+    public:
+        OrderManager(SqlDatabaseConnector * connector) :
+            SqlTableManager<OrderRow>(connector, "shop", "orders")
+        {
+        }
+
+        void feed(const QList<QJsonObject> & records)
+        {
+            QueryResult result;
+            result.isSelect = true;
+            result.records = records;
+            onQueryResult(result);
+        }
+        void notify(const SqlNotification & notif) { onNotification(notif); }
+    };
+
+    const QString First = QStringLiteral("aaaaaaaa-0000-0000-0000-000000000001");
+    const QString Second = QStringLiteral("aaaaaaaa-0000-0000-0000-000000000002");
+
+    QJsonObject record(const QString & uuid, const QJsonValue & client, int amount, double price)
+    {
+        return QJsonObject { { "_uuid", uuid }, { "client", client }, { "amount", amount },
+                             { "price", price }, { "paid", true } };
+    }
+
+    SqlNotification notification(SqlNotification::ActionType action, SqlNotification::PayloadFormat format,
+                                 const QString & uuid, const QJsonObject & data)
+    {
+        SqlNotification notif;
+        notif.schema = "shop";
+        notif.table = "orders";
+        notif.actionType = action;
+        notif.format = format;
+        notif.itemUuid = uuid;
+        notif.data = data;
+        return notif;
+    }
+}
+
+
+class tst_SqlTableManager : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void columnList();
+    void stringNullRoundTrip();
+    void specialDoubles();
+    void queries();
+    void decodePartial();
+    void load();
+    void notifications();
+    void otherTableIgnored();
+};
+
+void tst_SqlTableManager::columnList()
+{
+    QCOMPARE(SqlTableManager<OrderRow>::columnList(), QString("client, amount, price, paid, _uuid"));
+}
+
+void tst_SqlTableManager::stringNullRoundTrip()
+{
+    QCOMPARE(SqlFieldTraits<QString>::toSql(QString()), QString("NULL"));
+    QCOMPARE(SqlFieldTraits<QString>::toSql(QString("")), QString("''"));
+    QCOMPARE(SqlFieldTraits<QString>::toSql(QString("it's")), QString("'it''s'"));
+
+    QVERIFY(SqlFieldTraits<QString>::fromJson(QJsonValue()).isNull());
+    QVERIFY(!SqlFieldTraits<QString>::fromJson(QJsonValue("")).isNull());
+
+    OrderRow row;
+    SqlTableManager<OrderRow>::decode(record(First, QJsonValue(), 1, 2), row);
+    QVERIFY(row.client.isNull());
+    QCOMPARE(SqlTableManager<OrderRow>::values(row).first(), QString("NULL"));
+}
+
+void tst_SqlTableManager::specialDoubles()
+{
+    QCOMPARE(SqlFieldTraits<double>::toSql(0.25), QString("0.25"));
+    QCOMPARE(SqlFieldTraits<double>::toSql(qQNaN()), QString("'NaN'"));
+    QCOMPARE(SqlFieldTraits<double>::toSql(qInf()), QString("'Infinity'"));
+    QCOMPARE(SqlFieldTraits<double>::toSql(-qInf()), QString("'-Infinity'"));
+}
+
+void tst_SqlTableManager::queries()
+{
+    SqlDatabaseConnector connector("localhost", 5432, "test");
+    OrderManager manager(&connector);
+
+    OrderRow row;
+    row.uuid = First;
+    row.client = "O'Brien";
+    row.amount = 3;
+    row.price = 1.5;
+    row.paid = true;
+
+    QCOMPARE(manager.selectQuery(), QString("SELECT client, amount, price, paid, _uuid FROM shop.orders;"));
+    QCOMPARE(manager.insertQuery(row),
+             QString("INSERT INTO shop.orders (client, amount, price, paid, _uuid) "
+                     "VALUES ('O''Brien', 3, 1.5, true, '%1');").arg(First));
+    QCOMPARE(manager.updateQuery(row),
+             QString("UPDATE shop.orders SET client='O''Brien', amount=3, price=1.5, paid=true "
+                     "WHERE _uuid='%1';").arg(First));
+    QCOMPARE(manager.deleteQuery(row), QString("DELETE FROM shop.orders WHERE _uuid='%1';").arg(First));
+}
+
+void tst_SqlTableManager::decodePartial()
+{
+    OrderRow row;
+    SqlTableManager<OrderRow>::decode(record(First, "client", 7, 0.5), row);
+
+    // Колонки, которых нет в записи, остаются прежними
+    const int applied = SqlTableManager<OrderRow>::decode(QJsonObject { { "amount", 9 } }, row);
+    QCOMPARE(applied, 1);
+    QCOMPARE(row.uuid, First);
+    QCOMPARE(row.client, QString("client"));
+    QCOMPARE(row.amount, 9);
+    QCOMPARE(row.price, 0.5);
+    QCOMPARE(row.paid, true);
+}
+
+void tst_SqlTableManager::load()
+{
+    SqlDatabaseConnector connector("localhost", 5432, "test");
+    OrderManager manager(&connector);
+    QSignalSpy updated(&manager, &SqlTableManagerBase::updated);
+
+    manager.feed({ record(First, "first", 1, 0.5), record(Second, "second", 2, 1.5) });
+
+    QCOMPARE(updated.count(), 1);
+    QCOMPARE(manager.count(), 2);
+    QVERIFY(manager.row(First));
+    QCOMPARE(manager.row(First)->client, QString("first"));
+    QCOMPARE(manager.row(Second)->amount, 2);
+    QCOMPARE(manager.row(Second)->price, 1.5);
+    QVERIFY(!manager.row("missing"));
+
+    // Повторная загрузка заменяет строки целиком
+    manager.feed({ record(Second, "again", 3, 2.5) });
+    QCOMPARE(manager.count(), 1);
+    QVERIFY(!manager.row(First));
+    QCOMPARE(manager.row(Second)->client, QString("again"));
+}
+
+void tst_SqlTableManager::notifications()
+{
+    SqlDatabaseConnector connector("localhost", 5432, "test");
+    OrderManager manager(&connector);
+    manager.feed({ record(First, "first", 1, 0.5) });
+    // ActionType не зарегистрирован как метатип, поэтому без QSignalSpy
+    QStringList changed;
+    connect(&manager, &SqlTableManagerBase::rowChanged, this,
+            [&changed](const QString & uuid, SqlNotification::ActionType) { changed << uuid; });
+
+    manager.notify(notification(SqlNotification::INSERT, SqlNotification::FullRow,
+                                Second, record(Second, "second", 2, 1.5)));
+    QCOMPARE(manager.count(), 2);
+    QCOMPARE(manager.row(Second)->client, QString("second"));
+
+    manager.notify(notification(SqlNotification::UPDATE, SqlNotification::ColumnDiff,
+                                First, QJsonObject { { "amount", 5 } }));
+    QCOMPARE(manager.row(First)->amount, 5);
+    QCOMPARE(manager.row(First)->client, QString("first"));
+
+    manager.notify(notification(SqlNotification::UPDATE, SqlNotification::FullRow,
+                                First, record(First, QJsonValue(), 6, 2.5)));
+    QVERIFY(manager.row(First)->client.isNull());
+    QCOMPARE(manager.row(First)->amount, 6);
+
+    manager.notify(notification(SqlNotification::DELETE, SqlNotification::FullRow,
+                                Second, QJsonObject { { "_uuid", Second } }));
+    QCOMPARE(manager.count(), 1);
+    QVERIFY(!manager.row(Second));
+
+    QCOMPARE(changed, QStringList({ Second, First, First, Second }));
+}
+
+void tst_SqlTableManager::otherTableIgnored()
+{
+    SqlDatabaseConnector connector("localhost", 5432, "test");
+    OrderManager manager(&connector);
+    QSignalSpy updated(&manager, &SqlTableManagerBase::updated);
+
+    SqlNotification notif = notification(SqlNotification::INSERT, SqlNotification::FullRow,
+                                         First, record(First, "first", 1, 0.5));
+    notif.table = "clients";
+    manager.notify(notif);
+
+    QCOMPARE(manager.count(), 0);
+    QCOMPARE(updated.count(), 0);
+}
+
+QTEST_GUILESS_MAIN(tst_SqlTableManager)
+
+#include "tst_SqlTableManager.moc"
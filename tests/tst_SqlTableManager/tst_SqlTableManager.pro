@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_SqlTableManager
+
+SOURCES += \
+    tst_SqlTableManager.cpp
@@ -0,0 +1,268 @@
+#include <QtTest>
+#include <limits>
+#include "SqlValue.h"
+
+
+class tst_SqlValue : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void fromVariant_data();
+    void fromVariant();
+    void fromVariantJson();
+    void fromJsonNumbers_data();
+    void fromJsonNumbers();
+    void shortAndLongText();
+    void bytes();
+    void toLongLongSaturates();
+    void sqlLiterals();
+    void timestampLiteralKeepsInstant();
+    void compare_data();
+    void compare();
+    void equality();
+    void dataStreamRoundTrip_data();
+    void dataStreamRoundTrip();
+    void dataStreamCorrupt();
+};
+
+void tst_SqlValue::fromVariant_data()
+{
+    QTest::addColumn<QVariant>("variant");
+    QTest::addColumn<int>("type");
+    QTest::addColumn<QString>("text");
+
+    QTest::newRow("null") << QVariant() << int(SqlValue::Null) << QString();
+    QTest::newRow("null string") << QVariant(QString()) << int(SqlValue::Null) << QString();
+    QTest::newRow("int") << QVariant(42) << int(SqlValue::Int32) << "42";
+    QTest::newRow("uint") << QVariant(4000000000u) << int(SqlValue::Int64) << "4000000000";
+    QTest::newRow("longlong") << QVariant(Q_INT64_C(-9000000000)) << int(SqlValue::Int64) << "-9000000000";
+    QTest::newRow("ulonglong") << QVariant(Q_UINT64_C(9000000000)) << int(SqlValue::Int64) << "9000000000";
+    QTest::newRow("ulonglong max") << QVariant(std::numeric_limits<qulonglong>::max())
+                                   << int(SqlValue::Float64) << "1.8446744073709552e+19";
+    QTest::newRow("double") << QVariant(0.5) << int(SqlValue::Float64) << "0.5";
+    QTest::newRow("bool") << QVariant(true) << int(SqlValue::Bool) << "true";
+    QTest::newRow("uuid") << QVariant(QUuid("{0b7ad2c4-3c5e-4a8e-9a57-2d1f6c3e4b10}"))
+                          << int(SqlValue::Uuid) << "0b7ad2c4-3c5e-4a8e-9a57-2d1f6c3e4b10";
+    QTest::newRow("date") << QVariant(QDate(2024, 2, 29)) << int(SqlValue::Timestamp) << "2024-02-29T00:00:00.000";
+    QTest::newRow("time") << QVariant(QTime(12, 30, 15, 250)) << int(SqlValue::Text) << "12:30:15.250";
+    QTest::newRow("string") << QVariant(QString("text")) << int(SqlValue::Text) << "text";
+    QTest::newRow("bytes") << QVariant(QByteArray("\x01\xff", 2)) << int(SqlValue::Bytes) << "\\x01ff";
+}
+
+void tst_SqlValue::fromVariant()
+{
+    QFETCH(QVariant, variant);
+    QFETCH(int, type);
+    QFETCH(QString, text);
+
+    const SqlValue value(variant);
+    QCOMPARE(int(value.type()), type);
+    QCOMPARE(value.toString(), text);
+}
+
+void tst_SqlValue::fromVariantJson()
+{
+    // QJsonValue разбирается как Json, а не через toString()
+    QCOMPARE(SqlValue(QVariant::fromValue(QJsonValue(7))).type(), SqlValue::Int32);
+    QCOMPARE(SqlValue(QVariant::fromValue(QJsonValue(7))).toInt(), 7);
+    QCOMPARE(SqlValue(QVariant::fromValue(QJsonValue(2.5))).toDouble(), 2.5);
+    QCOMPARE(SqlValue(QVariant::fromValue(QJsonValue(true))).type(), SqlValue::Bool);
+    QCOMPARE(SqlValue(QVariant::fromValue(QJsonValue("abc"))).toString(), QString("abc"));
+    QVERIFY(SqlValue(QVariant::fromValue(QJsonValue(QJsonValue::Null))).isNull());
+
+    // SqlValue внутри QVariant копируется как есть
+    QCOMPARE(SqlValue(QVariant::fromValue(SqlValue(qint64(5)))).type(), SqlValue::Int64);
+}
+
+void tst_SqlValue::fromJsonNumbers_data()
+{
+    QTest::addColumn<double>("number");
+    QTest::addColumn<int>("type");
+
+    QTest::newRow("zero") << 0.0 << int(SqlValue::Int32);
+    QTest::newRow("int32 max") << 2147483647.0 << int(SqlValue::Int32);
+    QTest::newRow("int32 min") << -2147483648.0 << int(SqlValue::Int32);
+    QTest::newRow("above int32") << 2147483648.0 << int(SqlValue::Int64);
+    QTest::newRow("fraction") << 1.25 << int(SqlValue::Float64);
+    QTest::newRow("int64 min") << -9223372036854775808.0 << int(SqlValue::Int64);
+    QTest::newRow("2^63") << 9223372036854775808.0 << int(SqlValue::Float64);
+    QTest::newRow("-2^64") << -18446744073709551616.0 << int(SqlValue::Float64);
+    QTest::newRow("1e300") << 1e300 << int(SqlValue::Float64);
+}
+
+void tst_SqlValue::fromJsonNumbers()
+{
+    QFETCH(double, number);
+    QFETCH(int, type);
+
+    const SqlValue value = SqlValue::fromJson(QJsonValue(number));
+    QCOMPARE(int(value.type()), type);
+    QCOMPARE(value.toDouble(), number);
+}
+
+void tst_SqlValue::shortAndLongText()
+{
+    const QString inline_ = QString(SqlValue::InlineTextSize, 'a');
+    const QString heap = QString(SqlValue::InlineTextSize + 1, 'b');
+
+    QCOMPARE(SqlValue(inline_).heapSize(), qint64(0));
+    QVERIFY(SqlValue(heap).heapSize() > 0);
+    QCOMPARE(SqlValue(inline_).toString(), inline_);
+    QCOMPARE(SqlValue(heap).toString(), heap);
+
+    SqlValue copy = SqlValue(heap);
+    SqlValue moved = std::move(copy);
+    QVERIFY(copy.isNull());
+    QCOMPARE(moved.toString(), heap);
+    QCOMPARE(SqlValue("it's").toSqlLiteral(), QString("'it''s'"));
+}
+
+void tst_SqlValue::bytes()
+{
+    const QByteArray raw("\x00\x10\xab", 3);
+    const SqlValue value(raw);
+
+    QCOMPARE(value.type(), SqlValue::Bytes);
+    QCOMPARE(value.toByteArray(), raw);
+    QCOMPARE(value.toVariant(), QVariant(raw));
+    QCOMPARE(value.toSqlLiteral(), QString("'\\x0010ab'"));
+    QVERIFY(value.heapSize() > 0);
+
+    SqlValue copy(value);
+    QCOMPARE(copy, value);
+    QVERIFY(SqlValue(QByteArray()).isNull());
+}
+
+void tst_SqlValue::toLongLongSaturates()
+{
+    QCOMPARE(SqlValue(1e30).toLongLong(), std::numeric_limits<qint64>::max());
+    QCOMPARE(SqlValue(-1e30).toLongLong(), std::numeric_limits<qint64>::min());
+    QCOMPARE(SqlValue(qQNaN()).toLongLong(), qint64(0));
+    QCOMPARE(SqlValue(-2.75).toLongLong(), qint64(-2));
+}
+
+void tst_SqlValue::sqlLiterals()
+{
+    QCOMPARE(SqlValue().toSqlLiteral(), QString("NULL"));
+    QCOMPARE(SqlValue(-3).toSqlLiteral(), QString("-3"));
+    QCOMPARE(SqlValue(false).toSqlLiteral(), QString("false"));
+    QCOMPARE(SqlValue(0.5).toSqlLiteral(), QString("0.5"));
+    QCOMPARE(SqlValue(qQNaN()).toSqlLiteral(), QString("'NaN'"));
+    QCOMPARE(SqlValue(qInf()).toSqlLiteral(), QString("'Infinity'"));
+    QCOMPARE(SqlValue(-qInf()).toSqlLiteral(), QString("'-Infinity'"));
+    QCOMPARE(SqlValue(QUuid("{0b7ad2c4-3c5e-4a8e-9a57-2d1f6c3e4b10}")).toSqlLiteral(),
+             QString("'0b7ad2c4-3c5e-4a8e-9a57-2d1f6c3e4b10'"));
+}
+
+void tst_SqlValue::timestampLiteralKeepsInstant()
+{
+    // Момент с чужим смещением хранится в локальном времени,
+    // но литерал все равно должен указывать на тот же момент
+    const QDateTime moment(QDate(2024, 7, 1), QTime(12, 0, 0, 5), Qt::OffsetFromUTC, 5 * 3600);
+    const QString literal = SqlValue(moment).toSqlLiteral();
+
+    QVERIFY(literal.startsWith('\'') && literal.endsWith('\''));
+    const QString text = literal.mid(1, literal.size() - 2);
+    QVERIFY2(text.endsWith('Z') || text.contains(QRegularExpression("[+-]\\d\\d:\\d\\d$")), qPrintable(text));
+    QCOMPARE(QDateTime::fromString(text, Qt::ISODateWithMs).toMSecsSinceEpoch(), moment.toMSecsSinceEpoch());
+
+    const QString utc = SqlValue(QDateTime::fromMSecsSinceEpoch(0, Qt::UTC)).toSqlLiteral();
+    QCOMPARE(QDateTime::fromString(utc.mid(1, utc.size() - 2), Qt::ISODateWithMs).toMSecsSinceEpoch(), qint64(0));
+}
+
+void tst_SqlValue::compare_data()
+{
+    QTest::addColumn<SqlValue>("a");
+    QTest::addColumn<SqlValue>("b");
+    QTest::addColumn<int>("expected");
+
+    QTest::newRow("null first") << SqlValue() << SqlValue(0) << -1;
+    QTest::newRow("int vs int64") << SqlValue(2) << SqlValue(qint64(3)) << -1;
+    QTest::newRow("int vs double") << SqlValue(3) << SqlValue(2.5) << 1;
+    QTest::newRow("equal numbers") << SqlValue(2) << SqlValue(2.0) << 0;
+    QTest::newRow("text") << SqlValue("abc") << SqlValue("abd") << -1;
+    QTest::newRow("long text") << SqlValue(QString(20, 'z')) << SqlValue("a") << 1;
+    QTest::newRow("bool") << SqlValue(false) << SqlValue(true) << -1;
+    QTest::newRow("timestamp") << SqlValue(QDateTime::fromMSecsSinceEpoch(1000, Qt::UTC))
+                               << SqlValue(QDateTime::fromMSecsSinceEpoch(2000, Qt::UTC)) << -1;
+    QTest::newRow("bytes") << SqlValue(QByteArray("b")) << SqlValue(QByteArray("a")) << 1;
+    QTest::newRow("type order") << SqlValue(true) << SqlValue("text") << -1;
+}
+
+void tst_SqlValue::compare()
+{
+    QFETCH(SqlValue, a);
+    QFETCH(SqlValue, b);
+    QFETCH(int, expected);
+
+    QCOMPARE(qBound(-1, a.compare(b), 1), expected);
+    QCOMPARE(qBound(-1, b.compare(a), 1), -expected);
+    QCOMPARE(a < b, expected < 0);
+}
+
+void tst_SqlValue::equality()
+{
+    QVERIFY(SqlValue() == SqlValue());
+    QVERIFY(SqlValue(1) == SqlValue(qint64(1)));
+    QVERIFY(SqlValue(1) == SqlValue(1.0));
+    QVERIFY(SqlValue(1) != SqlValue("1"));
+    QVERIFY(SqlValue("short") == SqlValue(QString("short")));
+    QVERIFY(SqlValue(QString(30, 'x')) == SqlValue(QString(30, 'x')));
+    QVERIFY(SqlValue(QString(30, 'x')) != SqlValue(QString(30, 'y')));
+    QVERIFY(SqlValue(QUuid::createUuid()) != SqlValue(QUuid::createUuid()));
+    QVERIFY(SqlValue(QByteArray("a")) != SqlValue("a"));
+}
+
+void tst_SqlValue::dataStreamRoundTrip_data()
+{
+    QTest::addColumn<SqlValue>("value");
+
+    QTest::newRow("null") << SqlValue();
+    QTest::newRow("int32") << SqlValue(-7);
+    QTest::newRow("int64") << SqlValue(Q_INT64_C(1) << 60);
+    QTest::newRow("double") << SqlValue(0.1);
+    QTest::newRow("bool") << SqlValue(true);
+    QTest::newRow("uuid") << SqlValue(QUuid::createUuid());
+    QTest::newRow("timestamp") << SqlValue(QDateTime::fromMSecsSinceEpoch(1700000000123, Qt::UTC));
+    QTest::newRow("short text") << SqlValue("short");
+    QTest::newRow("long text") << SqlValue(QString("a long text that is not inline"));
+    QTest::newRow("bytes") << SqlValue(QByteArray("\x00\x01\x02", 3));
+}
+
+void tst_SqlValue::dataStreamRoundTrip()
+{
+    QFETCH(SqlValue, value);
+
+    QByteArray buffer;
+    {
+        QDataStream out(&buffer, QIODevice::WriteOnly);
+        out << value;
+    }
+
+    QDataStream in(buffer);
+    SqlValue read(QString("previous"));
+    in >> read;
+    QCOMPARE(in.status(), QDataStream::Ok);
+    QCOMPARE(read.type(), value.type());
+    QCOMPARE(read, value);
+}
+
+void tst_SqlValue::dataStreamCorrupt()
+{
+    QByteArray buffer;
+    {
+        QDataStream out(&buffer, QIODevice::WriteOnly);
+        out << quint8(200);
+    }
+
+    QDataStream in(buffer);
+    SqlValue read(5);
+    in >> read;
+    QCOMPARE(in.status(), QDataStream::ReadCorruptData);
+    QVERIFY(read.isNull());
+}
+
+QTEST_APPLESS_MAIN(tst_SqlValue)
+
+#include "tst_SqlValue.moc"
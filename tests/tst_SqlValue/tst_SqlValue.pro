@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_SqlValue
+
+SOURCES += \
+    tst_SqlValue.cpp